@@ -0,0 +1,199 @@
+// Scaling benchmark of gsl_parse_batch(): parses the same set of records on 1..N threads.
+// The last columns are gsl_parse_batch_pool() on a pool of as many workers, and
+// gsl_parse_task_pool() of the whole buffer as the fields of a single record.
+//
+// Usage: batch_bench [num_records] [max_threads] [num_runs]
+
+#include "bench.h"
+
+#include <gsl-parser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_LARGE_RECORD_EVERY 64
+#define BENCH_LARGE_RECORD_GROUPS 512
+
+struct BenchUser {
+    char name[64]; size_t name_size;
+    char sid[16]; size_t sid_size;
+    size_t age;
+    size_t num_groups;
+    size_t num_records;
+};
+
+static gsl_err_t run_group(void *obj, const char *val, size_t val_size) {
+    struct BenchUser *self = (struct BenchUser *)obj;
+    (void)val; (void)val_size;
+    self->num_groups++;
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t parse_user(void *obj, const char *rec, size_t *total_size) {
+    struct BenchUser *self = (struct BenchUser *)obj;
+    struct gslTaskSpec group_spec = { .is_list_item = true, .run = run_group, .obj = self };
+    struct gslTaskSpec specs[] = {
+        { .is_implied = true,
+          .buf = self->name, .buf_size = &self->name_size, .max_buf_size = sizeof self->name },
+        { .name = "sid", .name_size = strlen("sid"),
+          .buf = self->sid, .buf_size = &self->sid_size, .max_buf_size = sizeof self->sid },
+        { .name = "age", .name_size = strlen("age"),
+          .run = gsl_run_set_size_t, .obj = &self->age },
+        { .type = GSL_GET_ARRAY_STATE, .name = "groups", .name_size = strlen("groups"),
+          .parse = gsl_parse_array, .obj = &group_spec }
+    };
+    return gsl_parse_task(rec, total_size, specs, sizeof specs / sizeof specs[0]);
+}
+
+static gsl_err_t parse_record(void *obj, size_t rec_idx, const char *rec, size_t *total_size) {
+    struct BenchUser *self = (struct BenchUser *)obj;
+    struct gslTaskSpec specs[] = {
+        { .name = "user", .name_size = strlen("user"), .parse = parse_user, .obj = self }
+    };
+    (void)rec_idx;
+
+    self->name_size = 0;
+    self->sid_size = 0;
+    self->num_records++;
+    return gsl_parse_task(rec, total_size, specs, sizeof specs / sizeof specs[0]);
+}
+
+// The callbacks of gsl_parse_task_pool() run on the workers at once, so each one fills
+// the user of its worker.
+static gsl_err_t parse_pooled_user(void *obj, const char *rec, size_t *total_size) {
+    struct BenchUser *users = (struct BenchUser *)obj;
+    size_t worker_idx = gsl_pool_worker_idx();
+    struct BenchUser *self = &users[worker_idx == SIZE_MAX ? 0 : worker_idx];
+
+    self->name_size = 0;
+    self->sid_size = 0;
+    self->num_records++;
+    return parse_user(self, rec, total_size);
+}
+
+static char *gen_records(size_t num_records, size_t *size) {
+    size_t max_size = num_records * 128 + (num_records / BENCH_LARGE_RECORD_EVERY + 1) * BENCH_LARGE_RECORD_GROUPS * 16;
+    char *buf = malloc(max_size + 1);
+    size_t n = 0;
+
+    if (!buf) return NULL;
+
+    // Record sizes are skewed on purpose: every BENCH_LARGE_RECORD_EVERY record is huge.
+    for (size_t i = 0; i < num_records; i++) {
+        size_t num_groups = i % BENCH_LARGE_RECORD_EVERY ? i % 8 : BENCH_LARGE_RECORD_GROUPS;
+        n += sprintf(buf + n, "{user User%zu {sid s%zu} {age %zu} [groups", i, i % 100000, 20 + i % 50);
+        for (size_t j = 0; j < num_groups; j++)
+            n += sprintf(buf + n, " group%zu", j);
+        n += sprintf(buf + n, "]}\n");
+    }
+
+    buf[n] = '\0';  // for gsl_parse_task_pool()
+    *size = n;
+    return buf;
+}
+
+int main(int argc, char **argv) {
+    size_t num_records = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max_threads = argc > 2 ? strtoul(argv[2], NULL, 10) : (size_t)(num_cpus > 0 ? num_cpus : 1);
+    size_t num_runs = argc > 3 ? strtoul(argv[3], NULL, 10) : 3;
+
+    size_t buf_size, total_size;
+    char *buf = gen_records(num_records, &buf_size);
+    struct gslRecord *records = calloc(num_records, sizeof *records);
+    struct BenchUser *users = calloc(max_threads, sizeof *users);
+    struct gslBatchWorker *workers = calloc(max_threads, sizeof *workers);
+    gsl_err_t err;
+
+    if (!buf || !records || !users || !workers || !max_threads || !num_runs) {
+        fprintf(stderr, "cannot prepare the benchmark\n");
+        return EXIT_FAILURE;
+    }
+
+    uint64_t t0 = bench_now_ns();
+    err = gsl_split_records(buf, buf_size, records, num_records, &num_records, &total_size);
+    uint64_t split_ns = bench_now_ns() - t0;
+    if (err.code || total_size != buf_size) {
+        fprintf(stderr, "split failed: %d at %zu\n", err.code, total_size);
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < max_threads; i++)
+        workers[i] = (struct gslBatchWorker){ .obj = &users[i], .parse = parse_record };
+
+    printf("records: %zu  bytes: %zu  cpus: %ld\n", num_records, buf_size, num_cpus);
+    printf("split: %.1f MB/s\n\n", buf_size / (split_ns / 1e9) / 1e6);
+    printf("%7s %10s %10s %12s %8s %10s %10s\n", "threads", "seconds", "MB/s", "records/s", "speedup", "pool MB/s",
+           "1 rec MB/s");
+
+    double base_sec = 0;
+    for (size_t num_threads = 1; num_threads <= max_threads; num_threads++) {
+        double best_sec = 0;
+
+        for (size_t run = 0; run < num_runs; run++) {
+            t0 = bench_now_ns();
+            err = gsl_parse_batch(records, num_records, workers, num_threads, NULL);
+            double sec = (bench_now_ns() - t0) / 1e9;
+            if (err.code) {
+                fprintf(stderr, "parse failed: %d\n", err.code);
+                return EXIT_FAILURE;
+            }
+            if (!run || sec < best_sec)
+                best_sec = sec;
+        }
+
+        if (num_threads == 1)
+            base_sec = best_sec;
+
+        struct gslPoolOptions pool_options = { .num_workers = num_threads };
+        struct gslPool *pool;
+        double pool_sec = 0;
+
+        if (gsl_pool_create(&pool_options, &pool).code) {
+            fprintf(stderr, "cannot create a pool of %zu workers\n", num_threads);
+            return EXIT_FAILURE;
+        }
+        for (size_t run = 0; run < num_runs; run++) {
+            t0 = bench_now_ns();
+            err = gsl_parse_batch_pool(pool, records, num_records, workers, NULL);
+            double sec = (bench_now_ns() - t0) / 1e9;
+            if (err.code) {
+                fprintf(stderr, "pool parse failed: %d\n", err.code);
+                return EXIT_FAILURE;
+            }
+            if (!run || sec < pool_sec)
+                pool_sec = sec;
+        }
+
+        struct gslTaskSpec specs[] = {
+            { .name = "user", .name_size = strlen("user"), .parse = parse_pooled_user, .obj = users }
+        };
+        double task_sec = 0;
+
+        for (size_t run = 0; run < num_runs; run++) {
+            specs[0].is_completed = false;
+            t0 = bench_now_ns();
+            err = gsl_parse_task_pool(pool, buf, &total_size, specs, sizeof specs / sizeof specs[0]);
+            double sec = (bench_now_ns() - t0) / 1e9;
+            if (err.code || total_size != buf_size) {
+                fprintf(stderr, "single record parse failed: %d at %zu\n", err.code, total_size);
+                return EXIT_FAILURE;
+            }
+            if (!run || sec < task_sec)
+                task_sec = sec;
+        }
+        gsl_pool_destroy(pool);
+
+        printf("%7zu %10.4f %10.1f %12.0f %7.2fx %10.1f %10.1f\n", num_threads, best_sec,
+               buf_size / best_sec / 1e6, num_records / best_sec, base_sec / best_sec, buf_size / pool_sec / 1e6,
+               buf_size / task_sec / 1e6);
+    }
+
+    free(workers);
+    free(users);
+    free(records);
+    free(buf);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+static inline uint64_t
+bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Time stamp counter where there is one: ticks at a constant rate, which is the nominal
+// frequency, so cycles of a core running above or below it are scaled.  Falls back to
+// nanoseconds elsewhere.
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+#define BENCH_CYCLES_UNIT "cycles"
+
+static inline uint64_t
+bench_now_cycles(void)
+{
+    return __rdtsc();
+}
+#else
+#define BENCH_CYCLES_UNIT "ns"
+
+static inline uint64_t
+bench_now_cycles(void)
+{
+    return bench_now_ns();
+}
+#endif
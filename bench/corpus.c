@@ -0,0 +1,356 @@
+#include "corpus.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CORPUS_MIN_BUF_SIZE (64 * 1024)
+#define CORPUS_MAX_COMMENT_DASHES 3
+#define CORPUS_GLOSS_WORDS 6
+#define CORPUS_HOSTILE_RUN 4  // dashes or quotes of a closing sequence, see gen_hostile_record()
+
+static const char *const corpus_words[] = {
+    "star", "orbit", "moon", "planet", "body", "mass", "rigid", "solar", "system", "light",
+    "wave", "field", "force", "charge", "atom", "nucleus", "cell", "tissue", "organ", "tree",
+    "root", "leaf", "river", "delta", "stone", "metal", "glass", "salt", "water", "fire",
+    "motion", "energy"
+};
+
+struct CorpusGen {
+    struct BenchCorpus *corpus;
+    const struct BenchCorpusParams *params;
+    uint64_t rng;
+    size_t pos;
+    size_t num_nodes;
+    bool is_failed;
+};
+
+enum { CORPUS_GLOSS, CORPUS_ID, CORPUS_TAGS, CORPUS_TEXT, CORPUS_REL };
+
+static bool gen_reserve(struct CorpusGen *gen, size_t size) {
+    struct BenchCorpus *corpus = gen->corpus;
+    size_t buf_size = corpus->buf_size ? corpus->buf_size : CORPUS_MIN_BUF_SIZE;
+    char *buf;
+
+    if (gen->is_failed) return false;
+    if (gen->pos + size <= corpus->buf_size) return true;
+
+    while (buf_size < gen->pos + size)
+        buf_size *= 2;
+    buf = realloc(corpus->buf, buf_size);
+    if (!buf) {
+        gen->is_failed = true;
+        return false;
+    }
+    corpus->buf = buf;
+    corpus->buf_size = buf_size;
+    return true;
+}
+
+static void gen_put(struct CorpusGen *gen, const char *str, size_t size) {
+    if (!gen_reserve(gen, size)) return;
+    memcpy(gen->corpus->buf + gen->pos, str, size);
+    gen->pos += size;
+}
+
+static void gen_putc(struct CorpusGen *gen, char c) {
+    gen_put(gen, &c, 1);
+}
+
+static void gen_puts(struct CorpusGen *gen, const char *str) {
+    gen_put(gen, str, strlen(str));
+}
+
+static void gen_putn(struct CorpusGen *gen, const char *prefix, size_t num) {
+    char buf[32];
+    gen_put(gen, buf, snprintf(buf, sizeof buf, "%s%zu", prefix, num));
+}
+
+static bool gen_chance(struct CorpusGen *gen, unsigned pct) {
+    return bench_rand_below(&gen->rng, 100) < pct;
+}
+
+static const char *gen_word(struct CorpusGen *gen) {
+    return corpus_words[bench_rand_below(&gen->rng, sizeof corpus_words / sizeof corpus_words[0])];
+}
+
+static void gen_space(struct CorpusGen *gen) {
+    gen_putc(gen, bench_rand_below(&gen->rng, 8) ? ' ' : '\n');
+}
+
+// Example: {-- old value {id 3} -} --}
+//      or: [- star orbit -]
+static void gen_comment(struct CorpusGen *gen) {
+    size_t num_dashes = 1 + bench_rand_below(&gen->rng, CORPUS_MAX_COMMENT_DASHES);
+    char closing_brace = bench_rand_below(&gen->rng, 4) ? '}' : ']';
+    size_t num_words = 2 + bench_rand_below(&gen->rng, 5);
+
+    gen_putc(gen, closing_brace == '}' ? '{' : '[');
+    for (size_t i = 0; i < num_dashes; i++)
+        gen_putc(gen, '-');
+    for (size_t i = 0; i < num_words; i++) {
+        gen_space(gen);
+        gen_puts(gen, gen_word(gen));
+    }
+    if (num_dashes > 1) {
+        // A shorter closing sequence must not end the comment.
+        gen_putc(gen, ' ');
+        for (size_t i = 0; i < num_dashes - 1; i++)
+            gen_putc(gen, '-');
+        gen_putc(gen, closing_brace);
+    }
+    gen_putc(gen, ' ');
+    for (size_t i = 0; i < num_dashes; i++)
+        gen_putc(gen, '-');
+    gen_putc(gen, closing_brace);
+    gen_putc(gen, ' ');
+}
+
+static void gen_field_open(struct CorpusGen *gen, char brace, const char *tag) {
+    if (gen_chance(gen, gen->params->comment_pct))
+        gen_comment(gen);
+    gen_putc(gen, brace);
+    if (gen_chance(gen, gen->params->set_pct))
+        gen_putc(gen, '!');
+    gen_puts(gen, tag);
+}
+
+// Example: {""a "} inside""}
+//              ^^^^^^^^^^  -- |size| bytes; quotes are never followed by a closing brace
+//                             twice, and the data doesn't start or end with a quote
+static void gen_cdata_value(struct CorpusGen *gen, size_t size) {
+    size_t n = 0;
+
+    gen_puts(gen, "{\"\"");
+    while (n < size) {
+        const char *word = gen_word(gen);
+        size_t word_size = strlen(word);
+
+        if (n + word_size > size)
+            word_size = size - n;
+        gen_put(gen, word, word_size);
+        n += word_size;
+        if (n + 3 >= size) {
+            // Fill the tail with letters.
+            for (; n < size; n++)
+                gen_putc(gen, 'x');
+            break;
+        }
+
+        switch (bench_rand_below(&gen->rng, 16)) {
+        case 0: gen_put(gen, " \"}", 3); n += 3; break;
+        case 1: gen_put(gen, " {", 2); n += 2; break;
+        case 2: gen_put(gen, "} ", 2); n += 2; break;
+        case 3: gen_putc(gen, '\n'); n++; break;
+        default: gen_putc(gen, ' '); n++; break;
+        }
+    }
+    gen_puts(gen, "\"\"}");
+}
+
+static void gen_node(struct CorpusGen *gen, size_t depth);
+
+static void gen_tagged_field(struct CorpusGen *gen, size_t depth) {
+    const struct BenchCorpusParams *params = gen->params;
+    size_t num_kinds = depth ? CORPUS_REL + 1 : CORPUS_TEXT + 1;
+    size_t kind;
+
+    // Example: no array fields with |array_len| == 0
+    do {
+        kind = bench_rand_below(&gen->rng, num_kinds);
+    } while ((kind == CORPUS_TEXT && !params->cdata_size) ||
+             ((kind == CORPUS_TAGS || kind == CORPUS_REL) && !params->array_len));
+
+    switch (kind) {
+    case CORPUS_GLOSS:
+        gen_field_open(gen, '{', "_gloss");
+        for (size_t i = 0, n = 1 + bench_rand_below(&gen->rng, CORPUS_GLOSS_WORDS); i < n; i++) {
+            gen_putc(gen, ' ');
+            gen_puts(gen, gen_word(gen));
+        }
+        gen_putc(gen, '}');
+        gen->corpus->num_fields++;
+        break;
+    case CORPUS_ID:
+        gen_field_open(gen, '{', "id");
+        gen_putn(gen, " ", bench_rand(&gen->rng) >> (bench_rand_below(&gen->rng, 4) * 16));
+        gen_putc(gen, '}');
+        gen->corpus->num_fields++;
+        break;
+    case CORPUS_TAGS:
+        gen_field_open(gen, '[', "tags");
+        for (size_t i = 0; i < params->array_len; i++) {
+            gen_space(gen);
+            gen_puts(gen, gen_word(gen));
+        }
+        gen_putc(gen, ']');
+        gen->corpus->num_fields += params->array_len;
+        break;
+    case CORPUS_TEXT:
+        gen_field_open(gen, '{', "text");
+        gen_putc(gen, ' ');
+        gen_cdata_value(gen, params->cdata_size);
+        gen_putc(gen, '}');
+        gen->corpus->num_fields++;
+        break;
+    case CORPUS_REL:
+        gen_field_open(gen, '[', "rel");
+        for (size_t i = 0; i < params->array_len; i++) {
+            gen_space(gen);
+            gen_putc(gen, '{');
+            gen_node(gen, 0);
+            gen_putc(gen, '}');
+        }
+        gen_putc(gen, ']');
+        break;
+    }
+}
+
+// Example: Node17 {_gloss rigid body} {id 42} {is Node18 ...}
+static void gen_node(struct CorpusGen *gen, size_t depth) {
+    gen_putn(gen, "Node", gen->num_nodes++);
+    gen->corpus->num_fields++;
+
+    for (size_t i = 0; i < gen->params->num_tags; i++) {
+        gen_space(gen);
+        gen_tagged_field(gen, depth);
+    }
+
+    if (depth) {
+        gen_space(gen);
+        gen_field_open(gen, '{', "is");
+        gen_putc(gen, ' ');
+        gen_node(gen, depth - 1);
+        gen_putc(gen, '}');
+    }
+}
+
+typedef void (*corpus_gen_record_t)(struct CorpusGen *gen);
+
+static int gen_corpus(struct BenchCorpus *self, const struct BenchCorpusParams *params,
+                      corpus_gen_record_t gen_record) {
+    struct CorpusGen gen = { .corpus = self, .params = params, .rng = params->seed | 1 };
+
+    memset(self, 0, sizeof *self);
+    self->offsets = calloc(params->num_records ? params->num_records : 1, sizeof *self->offsets);
+    if (!self->offsets) return -1;
+
+    for (size_t i = 0; i < params->num_records; i++) {
+        self->offsets[i] = gen.pos;
+        gen_record(&gen);
+        self->size += gen.pos - self->offsets[i];
+        gen_putc(&gen, '\0');
+    }
+    if (gen.is_failed) {
+        bench_corpus_free(self);
+        return -1;
+    }
+
+    self->num_records = params->num_records;
+    return 0;
+}
+
+static void gen_record(struct CorpusGen *gen) {
+    gen_puts(gen, "{class ");
+    gen_node(gen, gen->params->depth);
+    gen_putc(gen, '}');
+}
+
+static void gen_array_record(struct CorpusGen *gen) {
+    size_t array_len = gen->params->array_len ? gen->params->array_len : 1;
+
+    for (size_t i = 0; i < array_len; i++) {
+        gen_space(gen);
+        gen_puts(gen, gen_word(gen));
+    }
+    gen_putc(gen, ']');
+    gen->corpus->num_fields += array_len;
+}
+
+static void gen_cdata_record(struct CorpusGen *gen) {
+    gen_putc(gen, ' ');
+    gen_cdata_value(gen, gen->params->cdata_size ? gen->params->cdata_size : 1);
+    gen->corpus->num_fields++;
+}
+
+// Near misses of a closing sequence: runs of one dash or quote less, followed by |brace|.
+static void gen_near_misses(struct CorpusGen *gen, char repeatee, char brace, size_t size) {
+    for (size_t n = 0; n < size; n += CORPUS_HOSTILE_RUN + 1) {
+        for (size_t i = 0; i < CORPUS_HOSTILE_RUN - 1; i++)
+            gen_putc(gen, repeatee);
+        gen_putc(gen, bench_rand_below(&gen->rng, 2) ? brace : ' ');
+        gen_putc(gen, ' ');
+    }
+}
+
+static void gen_run(struct CorpusGen *gen, char repeatee) {
+    for (size_t i = 0; i < CORPUS_HOSTILE_RUN; i++)
+        gen_putc(gen, repeatee);
+}
+
+// Shapes that cost the most per byte in the fuzz targets (see fuzz/fuzz.h): list items of
+// tiny objects, each a parse callback with a fresh spec set, long near misses of the
+// closing sequences of comments and cdata, and deep nesting.
+// Example: {class Node3 [rel{x} {x}{x} ...] {---- --- ---} ... ----}
+//          {text {""""x """} """ ... x""""}} {is Node5 {is Node6 ...}}}
+static void gen_hostile_record(struct CorpusGen *gen) {
+    const struct BenchCorpusParams *params = gen->params;
+    size_t depth = 8 * (params->depth ? params->depth : 1);
+
+    gen_puts(gen, "{class ");
+    gen_putn(gen, "Node", gen->num_nodes++);
+    gen->corpus->num_fields++;
+
+    gen_puts(gen, " [rel");
+    for (size_t i = 0; i < 8 * params->array_len; i++) {
+        gen_puts(gen, i % 2 ? " {x}" : "{x}");
+        gen->corpus->num_fields++;
+    }
+    gen_puts(gen, "] {");
+    gen_run(gen, '-');
+    gen_putc(gen, ' ');
+    gen_near_misses(gen, '-', '}', params->cdata_size);
+    gen_run(gen, '-');
+    gen_putc(gen, '}');
+
+    if (params->cdata_size) {
+        gen_puts(gen, " {text {");
+        gen_run(gen, '"');
+        gen_puts(gen, "x ");
+        gen_near_misses(gen, '"', '}', params->cdata_size);
+        gen_putc(gen, 'x');
+        gen_run(gen, '"');
+        gen_puts(gen, "}}");
+        gen->corpus->num_fields++;
+    }
+
+    for (size_t i = 0; i < depth; i++) {
+        gen_putn(gen, " {is Node", gen->num_nodes++);
+        gen->corpus->num_fields++;
+    }
+    for (size_t i = 0; i < depth; i++)
+        gen_putc(gen, '}');
+    gen_putc(gen, '}');
+}
+
+int bench_corpus_gen_records(struct BenchCorpus *self, const struct BenchCorpusParams *params) {
+    return gen_corpus(self, params, gen_record);
+}
+
+int bench_corpus_gen_arrays(struct BenchCorpus *self, const struct BenchCorpusParams *params) {
+    return gen_corpus(self, params, gen_array_record);
+}
+
+int bench_corpus_gen_cdata(struct BenchCorpus *self, const struct BenchCorpusParams *params) {
+    return gen_corpus(self, params, gen_cdata_record);
+}
+
+int bench_corpus_gen_hostile(struct BenchCorpus *self, const struct BenchCorpusParams *params) {
+    return gen_corpus(self, params, gen_hostile_record);
+}
+
+void bench_corpus_free(struct BenchCorpus *self) {
+    free(self->buf);
+    free(self->offsets);
+    memset(self, 0, sizeof *self);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+// Seeded generator of Knowdy-style graphs for the benchmarks.  The same parameters and
+// seed always give the same bytes, so that numbers of different builds are comparable.
+//
+// Example of a record with depth 1, 3 tags, comments and SET fields:
+//   {class Node17 {_gloss rigid body of the solar system} {-- fixme: -} --} [!tags star orbit]
+//                 {text {""cdata with "} inside""}} {is Node18 {id 42} [rel {Node19 {id 7}}]}}
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct BenchCorpusParams {
+    uint64_t seed;
+    size_t num_records;
+    size_t depth;        // levels of {is ...} below the top-level object
+    size_t num_tags;     // tagged fields of every object, without comments and {is ...}
+    size_t array_len;    // items of [tags ...] and [rel ...]
+    size_t cdata_size;   // bytes of {text {"..."}}, 0 - no cdata fields
+    unsigned comment_pct;  // chance of a comment before a field
+    unsigned set_pct;      // chance of a field to be in SET state: {!name ...}
+};
+
+// Records are null-terminated one by one: gsl_parse_task() doesn't stop after the first.
+struct BenchCorpus {
+    char *buf;
+    size_t buf_size;     // allocated
+    size_t *offsets;
+    size_t num_records;
+    size_t size;         // bytes of the records without the terminating nulls
+    size_t num_fields;   // values passed to the callbacks: implied, terminal, items, cdata
+};
+
+static inline uint64_t
+bench_rand(uint64_t *state)
+{
+    // xorshift64*
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * UINT64_C(2685821657736338717);
+}
+
+static inline size_t
+bench_rand_below(uint64_t *state, size_t n)
+{
+    return n ? (size_t)(bench_rand(state) % n) : 0;
+}
+
+// Full records: {class ...}
+int bench_corpus_gen_records(struct BenchCorpus *self, const struct BenchCorpusParams *params);
+
+// Bodies of atomic arrays as gsl_parse_array() gets them: " star orbit moon]"
+int bench_corpus_gen_arrays(struct BenchCorpus *self, const struct BenchCorpusParams *params);
+
+// Bodies of cdata fields as gsl_parse_cdata() gets them: " {\"\"cdata\"\"}"
+int bench_corpus_gen_cdata(struct BenchCorpus *self, const struct BenchCorpusParams *params);
+
+// Full records of the shapes the fuzz targets found to be the slowest per byte, see fuzz/.
+int bench_corpus_gen_hostile(struct BenchCorpus *self, const struct BenchCorpusParams *params);
+
+void bench_corpus_free(struct BenchCorpus *self);
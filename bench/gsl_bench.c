@@ -0,0 +1,452 @@
+// Throughput of gsl_parse_task(), gsl_parse_array() and gsl_parse_cdata() on a seeded
+// synthetic corpus (see corpus.h).  Run it with the same options before and after a
+// change: the corpus is the same byte for byte.
+//
+// Usage: gsl_bench [-s seed] [-n records] [-d depth] [-t tags] [-a array_len] [-c cdata_size]
+//                  [-m comment_pct] [-x set_pct] [-r runs] [-o corpus_file] [-j json_file]
+//                  [workload...]
+//
+// Workloads: task (full records), sax and reader (the same records through gsl_sax_parse()
+// and gsl_next()), array (atomic array bodies), cdata (cdata bodies), hostile (full records
+// of the slowest shapes found by fuzz/); all by default.
+//
+// Where perf events are available (see counters.h), the cycles, instructions, branch and
+// cache misses of every workload are reported per field and per byte as well.
+//
+// With a library built with GSL_WITH_STATS, the input shape of a pass over every corpus is
+// reported too (see gsl_stats.h), and with GSL_WITH_PROFILE the time of the callbacks by
+// tag (see gsl_profile.h).
+//
+// -j writes the results for perf_check: besides ns/field, the time per field in steps of a
+// calibration loop, which doesn't depend on the clock rate of the machine as much, and the
+// counters per field.
+
+#define _GNU_SOURCE  // syscall() in counters.h
+
+#include "bench.h"
+#include "corpus.h"
+#include "counters.h"
+
+#include <gsl-parser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifndef GSL_BENCH_BUILD_TYPE
+#define GSL_BENCH_BUILD_TYPE "unknown"
+#endif
+
+#define BENCH_MIN_RUN_NS 50000000
+#define BENCH_CALIBRATION_STEPS (4 * 1024 * 1024)
+
+struct BenchCtx {
+    size_t num_fields;
+};
+
+struct BenchResult {
+    const char *workload;
+    size_t size;
+    size_t num_records;
+    size_t num_fields;
+    double sec;  // best of the runs
+    double time_per_field;  // best of the runs in calibration steps, see calibrate()
+    uint64_t counters[BENCH_NUM_COUNTERS];  // per pass, of the fastest run
+    bool has_counters[BENCH_NUM_COUNTERS];
+    struct gslStats stats;  // of a single pass
+};
+
+// Keys of the counters per field in the results of -j.
+static const char *const bench_counter_keys[BENCH_NUM_COUNTERS] = {
+    "cycles_per_field", "instructions_per_field", "branch_misses_per_field", "l1d_misses_per_field",
+    "llc_misses_per_field"
+};
+
+static volatile uint64_t bench_sink;
+
+typedef gsl_err_t (*bench_parse_t)(struct BenchCtx *ctx, const char *rec, size_t *total_size);
+
+static gsl_err_t run_count(void *obj, const char *val, size_t val_size) {
+    struct BenchCtx *ctx = (struct BenchCtx *)obj;
+    (void)val; (void)val_size;
+    ctx->num_fields++;
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t run_id(void *obj, const char *val, size_t val_size) {
+    struct BenchCtx *ctx = (struct BenchCtx *)obj;
+    size_t id;
+    gsl_err_t err = gsl_run_set_size_t(&id, val, val_size);
+    if (err.code) return err;
+    ctx->num_fields++;
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t parse_text(void *obj, const char *rec, size_t *total_size) {
+    struct gslTaskSpec spec = { .name = "text", .name_size = strlen("text"), .run = run_count, .obj = obj };
+    return gsl_parse_cdata(&spec, rec, total_size);
+}
+
+static gsl_err_t parse_node(void *obj, const char *rec, size_t *total_size) {
+    struct BenchCtx *ctx = (struct BenchCtx *)obj;
+    struct gslTaskSpec tag_spec = { .is_list_item = true, .run = run_count, .obj = ctx };
+    struct gslTaskSpec rel_spec = { .is_list_item = true, .parse = parse_node, .obj = ctx };
+    struct gslTaskSpec specs[] = {
+        { .is_implied = true, .run = run_count, .obj = ctx },
+
+        { .name = "_gloss", .name_size = strlen("_gloss"), .run = run_count, .obj = ctx },
+        { .name = "id", .name_size = strlen("id"), .run = run_id, .obj = ctx },
+        { .name = "text", .name_size = strlen("text"), .parse = parse_text, .obj = ctx },
+        { .name = "is", .name_size = strlen("is"), .parse = parse_node, .obj = ctx },
+        { .type = GSL_GET_ARRAY_STATE, .name = "tags", .name_size = strlen("tags"),
+          .parse = gsl_parse_array, .obj = &tag_spec },
+        { .type = GSL_GET_ARRAY_STATE, .name = "rel", .name_size = strlen("rel"),
+          .parse = gsl_parse_array, .obj = &rel_spec },
+
+        { .type = GSL_SET_STATE, .name = "_gloss", .name_size = strlen("_gloss"), .run = run_count, .obj = ctx },
+        { .type = GSL_SET_STATE, .name = "id", .name_size = strlen("id"), .run = run_id, .obj = ctx },
+        { .type = GSL_SET_STATE, .name = "text", .name_size = strlen("text"), .parse = parse_text, .obj = ctx },
+        { .type = GSL_SET_STATE, .name = "is", .name_size = strlen("is"), .parse = parse_node, .obj = ctx },
+        { .type = GSL_SET_ARRAY_STATE, .name = "tags", .name_size = strlen("tags"),
+          .parse = gsl_parse_array, .obj = &tag_spec },
+        { .type = GSL_SET_ARRAY_STATE, .name = "rel", .name_size = strlen("rel"),
+          .parse = gsl_parse_array, .obj = &rel_spec }
+    };
+    return gsl_parse_task(rec, total_size, specs, sizeof specs / sizeof specs[0]);
+}
+
+static gsl_err_t bench_parse_task(struct BenchCtx *ctx, const char *rec, size_t *total_size) {
+    struct gslTaskSpec specs[] = {
+        { .name = "class", .name_size = strlen("class"), .parse = parse_node, .obj = ctx }
+    };
+    return gsl_parse_task(rec, total_size, specs, sizeof specs / sizeof specs[0]);
+}
+
+static gsl_err_t bench_parse_array(struct BenchCtx *ctx, const char *rec, size_t *total_size) {
+    struct gslTaskSpec spec = { .is_list_item = true, .run = run_count, .obj = ctx };
+    return gsl_parse_array(&spec, rec, total_size);
+}
+
+static gsl_err_t bench_parse_cdata(struct BenchCtx *ctx, const char *rec, size_t *total_size) {
+    return parse_text(ctx, rec, total_size);
+}
+
+// A "{...}" item comes with NULL and has no value of its own, as in rel_spec above.
+static gsl_err_t sax_count(void *obj, const char *val, size_t val_size) {
+    (void)val_size;
+    ((struct BenchCtx *)obj)->num_fields += val != NULL;
+    return make_gsl_err(gsl_OK);
+}
+
+// The task corpus through gsl_sax_parse(): the same values without any spec lookups.
+static gsl_err_t bench_parse_sax(struct BenchCtx *ctx, const char *rec, size_t *total_size) {
+    struct gslSaxHandler handler = { .obj = ctx, .on_terminal = sax_count, .on_implied = sax_count,
+                                     .on_cdata = sax_count, .on_array_item = sax_count };
+    return gsl_sax_parse(rec, total_size, &handler);
+}
+
+// Same by gsl_next(): the count stays in a register.
+static gsl_err_t bench_parse_reader(struct BenchCtx *ctx, const char *rec, size_t *total_size) {
+    struct gslReader reader;
+    struct gslEvent event;
+    size_t num_fields = 0;
+    gsl_err_t err;
+
+    gsl_reader_init(&reader, rec);
+    while (!(err = gsl_next(&reader, &event)).code && event.type != GSL_EVENT_END)
+        num_fields += event.type != GSL_EVENT_FIELD_OPEN && event.type != GSL_EVENT_FIELD_CLOSE && event.val;
+    *total_size = reader.pos - rec;
+    ctx->num_fields += num_fields;
+    return err;
+}
+
+static const struct {
+    const char *name;
+    int (*gen)(struct BenchCorpus *self, const struct BenchCorpusParams *params);
+    bench_parse_t parse;
+} bench_workloads[] = {
+    { "task", bench_corpus_gen_records, bench_parse_task },
+    { "sax", bench_corpus_gen_records, bench_parse_sax },
+    { "reader", bench_corpus_gen_records, bench_parse_reader },
+    { "array", bench_corpus_gen_arrays, bench_parse_array },
+    { "cdata", bench_corpus_gen_cdata, bench_parse_cdata },
+    { "hostile", bench_corpus_gen_hostile, bench_parse_task }
+};
+
+// Returns the best ns per step of a serial multiply-add chain: a few cycles each on any
+// machine, so that times divided by it are roughly comparable between machines.  Every
+// run is calibrated right before it, so that both see the same phases of a busy machine.
+static double calibrate(size_t num_runs) {
+    double best_ns = 0;
+
+    for (size_t r = 0; r < num_runs; r++) {
+        uint64_t h = r;
+        uint64_t t0 = bench_now_ns();
+        for (size_t i = 0; i < BENCH_CALIBRATION_STEPS; i++)
+            h = h * 31 + (i & 0xff);
+        double ns = (double)(bench_now_ns() - t0) / BENCH_CALIBRATION_STEPS;
+        bench_sink = h;
+        if (!r || ns < best_ns)
+            best_ns = ns;
+    }
+    return best_ns;
+}
+
+// Parses every record of |corpus| |num_passes| times.
+static int parse_corpus(bench_parse_t parse, const struct BenchCorpus *corpus, size_t num_passes,
+                        const char *workload) {
+    struct BenchCtx ctx = { 0 };
+
+    for (size_t p = 0; p < num_passes; p++) {
+        for (size_t i = 0; i < corpus->num_records; i++) {
+            const char *rec = corpus->buf + corpus->offsets[i];
+            size_t total_size;
+            gsl_err_t err = parse(&ctx, rec, &total_size);
+            if (err.code) {
+                fprintf(stderr, "%s #%zu: %d at %zu: %.*s\n", workload, i, err.code, total_size,
+                        64, rec + total_size);
+                return -1;
+            }
+        }
+    }
+
+    // Every pass must see all the fields of the corpus, otherwise the numbers are meaningless.
+    if (ctx.num_fields != corpus->num_fields * num_passes) {
+        fprintf(stderr, "%s: %zu fields parsed, %zu expected\n", workload, ctx.num_fields / num_passes,
+                corpus->num_fields);
+        return -1;
+    }
+    return 0;
+}
+
+// A run is as many passes over |corpus| as take BENCH_MIN_RUN_NS, so that small corpora
+// are not lost in the noise.  The result is per pass.
+static int run(bench_parse_t parse, const struct BenchCorpus *corpus, size_t num_runs,
+               struct BenchCounters *counters, struct BenchResult *result) {
+    size_t num_passes;
+    uint64_t t0;
+
+    // Example: the first pass also warms up the caches
+    gsl_stats_reset();
+    t0 = bench_now_ns();
+    if (parse_corpus(parse, corpus, 1, result->workload))
+        return -1;
+    num_passes = BENCH_MIN_RUN_NS / (bench_now_ns() - t0 + 1) + 1;
+    result->stats = *gsl_stats_get();
+
+    double best_calibration_ns = 0;
+
+    for (size_t r = 0; r < num_runs; r++) {
+        double calibration_ns = calibrate(1);
+        if (!r || calibration_ns < best_calibration_ns)
+            best_calibration_ns = calibration_ns;
+
+        bench_counters_start(counters);
+        t0 = bench_now_ns();
+        if (parse_corpus(parse, corpus, num_passes, result->workload))
+            return -1;
+        double sec = (bench_now_ns() - t0) / 1e9 / num_passes;
+        bench_counters_stop(counters);
+
+        if (!r || sec < result->sec) {
+            result->sec = sec;
+            for (int i = 0; i < BENCH_NUM_COUNTERS; i++) {
+                result->has_counters[i] = counters->is_valid[i];
+                result->counters[i] = counters->values[i] / num_passes;
+            }
+        }
+    }
+
+    // Both minimums are of the quietest moments: a ratio per run would pair a lucky run
+    // with an unlucky calibration.
+    result->time_per_field = result->sec * 1e9 / corpus->num_fields / best_calibration_ns;
+
+    result->size = corpus->size;
+    result->num_records = corpus->num_records;
+    result->num_fields = corpus->num_fields;
+    return 0;
+}
+
+// Example: task     per field     612.3  1203.5   1.97      3.10    ...
+//                   per byte        ...
+static void print_counters(const struct BenchResult *result) {
+    for (int per_byte = 0; per_byte < 2; per_byte++) {
+        double num = per_byte ? result->size : result->num_fields;
+
+        printf("%-8s %-10s", per_byte ? "" : result->workload, per_byte ? "per byte" : "per field");
+        for (int i = 0; i < BENCH_NUM_COUNTERS; i++) {
+            if (result->has_counters[i])
+                printf(" %14.4f", result->counters[i] / num);
+            else
+                printf(" %14s", "-");
+        }
+        if (!per_byte && result->has_counters[BENCH_CYCLES] && result->has_counters[BENCH_INSTRUCTIONS])
+            printf(" %6.2f", (double)result->counters[BENCH_INSTRUCTIONS] / result->counters[BENCH_CYCLES]);
+        printf("\n");
+    }
+}
+
+// Example: task     bytes 13952558 visited 14010321 depth 6 comment_bytes 474975 cdata_bytes 9259008
+//                   fields get 103301 get_array 36084 ...
+static void print_stats(const struct BenchResult *result) {
+    const struct gslStats *stats = &result->stats;
+
+    printf("%-8s bytes %zu visited %zu depth %zu comment_bytes %zu cdata_bytes %zu\n", result->workload,
+           stats->bytes_scanned, stats->bytes_visited, stats->max_depth, stats->comment_bytes, stats->cdata_bytes);
+    printf("%-8s fields get %zu get_array %zu set %zu set_array %zu implied %zu list_items %zu\n", "",
+           stats->fields[GSL_GET_STATE], stats->fields[GSL_GET_ARRAY_STATE], stats->fields[GSL_SET_STATE],
+           stats->fields[GSL_SET_ARRAY_STATE], stats->implied_fields, stats->list_items);
+    printf("%-8s lookups %zu index_hits %zu misses %zu calls run %zu parse %zu validate %zu buf %zu\n", "",
+           stats->spec_lookups, stats->spec_index_hits, stats->spec_misses,
+           stats->runs, stats->parses, stats->validates, stats->bufs);
+}
+
+// Example: {"name": "task", ..., "time_per_field": 512.3, "cycles_per_field": null, ...}
+static int write_json(const char *path, const char *params, double calibration_ns,
+                      const struct BenchResult *results, size_t num_results) {
+    FILE *file = fopen(path, "w");
+    if (!file) return -1;
+
+    fprintf(file, "{\n  \"build\": \"%s\",\n  \"params\": \"%s\",\n  \"calibration_ns\": %.4f,\n"
+                  "  \"workloads\": [\n", GSL_BENCH_BUILD_TYPE, params, calibration_ns);
+    for (size_t i = 0; i < num_results; i++) {
+        const struct BenchResult *result = &results[i];
+        double ns_per_field = result->sec * 1e9 / result->num_fields;
+
+        fprintf(file, "    {\"name\": \"%s\", \"bytes\": %zu, \"records\": %zu, \"fields\": %zu, "
+                      "\"ns_per_field\": %.3f, \"time_per_field\": %.3f",
+                result->workload, result->size, result->num_records, result->num_fields,
+                ns_per_field, result->time_per_field);
+        for (int c = 0; c < BENCH_NUM_COUNTERS; c++) {
+            if (result->has_counters[c])
+                fprintf(file, ", \"%s\": %.3f", bench_counter_keys[c], (double)result->counters[c] / result->num_fields);
+            else
+                fprintf(file, ", \"%s\": null", bench_counter_keys[c]);
+        }
+        fprintf(file, "}%s\n", i + 1 < num_results ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return fclose(file);
+}
+
+static int write_corpus(const char *path, const struct BenchCorpus *corpus) {
+    FILE *file = fopen(path, "w");
+    if (!file) return -1;
+
+    for (size_t i = 0; i < corpus->num_records; i++)
+        fprintf(file, "%s\n", corpus->buf + corpus->offsets[i]);
+    return fclose(file);
+}
+
+int main(int argc, char **argv) {
+    struct BenchCorpusParams params = {
+        .seed = 1, .num_records = 10000, .depth = 2, .num_tags = 5, .array_len = 6,
+        .cdata_size = 256, .comment_pct = 10, .set_pct = 10
+    };
+    size_t num_runs = 3;
+    const char *corpus_path = NULL;
+    const char *json_path = NULL;
+    struct BenchResult results[sizeof bench_workloads / sizeof bench_workloads[0]];
+    size_t num_results = 0;
+    char params_str[256];
+    struct BenchCounters counters;
+    int num_counters;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:n:d:t:a:c:m:x:r:o:j:")) != -1) {
+        size_t val = strtoul(optarg ? optarg : "0", NULL, 10);
+        switch (opt) {
+        case 's': params.seed = strtoull(optarg, NULL, 10); break;
+        case 'n': params.num_records = val; break;
+        case 'd': params.depth = val; break;
+        case 't': params.num_tags = val; break;
+        case 'a': params.array_len = val; break;
+        case 'c': params.cdata_size = val; break;
+        case 'm': params.comment_pct = val; break;
+        case 'x': params.set_pct = val; break;
+        case 'r': num_runs = val; break;
+        case 'o': corpus_path = optarg; break;
+        case 'j': json_path = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-s seed] [-n records] [-d depth] [-t tags] [-a array_len] [-c cdata_size] "
+                            "[-m comment_pct] [-x set_pct] [-r runs] [-o corpus_file] [-j json_file] [workload...]\n",
+                    argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!params.num_records || !num_runs) {
+        fprintf(stderr, "no records or runs\n");
+        return EXIT_FAILURE;
+    }
+
+    // Example: seed=1 records=10000 depth=2 tags=5 array=6 cdata=256 comments=10 set=10
+    snprintf(params_str, sizeof params_str, "seed=%llu records=%zu depth=%zu tags=%zu array=%zu cdata=%zu "
+             "comments=%u set=%u", (unsigned long long)params.seed, params.num_records, params.depth,
+             params.num_tags, params.array_len, params.cdata_size, params.comment_pct, params.set_pct);
+    printf("%s runs=%zu\n", params_str, num_runs);
+    num_counters = bench_counters_open(&counters);
+    bench_counters_print(&counters, stdout);
+    printf("\n");
+
+    printf("%-8s %10s %10s %12s %10s %10s\n", "workload", "MB", "MB/s", "records/s", "fields", "ns/field");
+
+    for (size_t w = 0; w < sizeof bench_workloads / sizeof bench_workloads[0]; w++) {
+        struct BenchResult result = { .workload = bench_workloads[w].name };
+        struct BenchCorpus corpus;
+        bool is_selected = optind == argc;
+
+        for (int i = optind; i < argc; i++)
+            is_selected |= !strcmp(argv[i], result.workload);
+        if (!is_selected)
+            continue;
+
+        if (bench_workloads[w].gen(&corpus, &params)) {
+            fprintf(stderr, "cannot generate the %s corpus\n", result.workload);
+            return EXIT_FAILURE;
+        }
+        if (corpus_path && bench_workloads[w].parse == bench_parse_task && write_corpus(corpus_path, &corpus)) {
+            fprintf(stderr, "cannot write the corpus to %s\n", corpus_path);
+            return EXIT_FAILURE;
+        }
+
+        if (run(bench_workloads[w].parse, &corpus, num_runs, &counters, &result)) {
+            bench_corpus_free(&corpus);
+            bench_counters_close(&counters);
+            return EXIT_FAILURE;
+        }
+        printf("%-8s %10.1f %10.1f %12.0f %10zu %10.2f\n", result.workload, result.size / 1e6,
+               result.size / result.sec / 1e6, result.num_records / result.sec, result.num_fields,
+               result.sec * 1e9 / result.num_fields);
+        results[num_results++] = result;
+        bench_corpus_free(&corpus);
+    }
+    bench_counters_close(&counters);
+
+    if (num_counters) {
+        printf("\n%-8s %-10s", "workload", "");
+        for (int i = 0; i < BENCH_NUM_COUNTERS; i++)
+            printf(" %14s", bench_counter_names[i]);
+        printf(" %6s\n", "IPC");
+        for (size_t i = 0; i < num_results; i++)
+            print_counters(&results[i]);
+    }
+
+    if (gsl_stats_enabled()) {
+        printf("\ninput shape of a pass:\n");
+        for (size_t i = 0; i < num_results; i++)
+            print_stats(&results[i]);
+    }
+
+    if (gsl_profile_enabled()) {
+        printf("\ncallback profile of all the runs:\n");
+        gsl_profile_report(stdout);
+    }
+
+    if (json_path && write_json(json_path, params_str, calibrate(num_runs), results, num_results)) {
+        fprintf(stderr, "cannot write the results to %s\n", json_path);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,290 @@
+#pragma once
+
+// Transport shared by msg_server, msg_client and msg_load.
+//
+// Messages are plain GSL records written back to back on a stream socket, the record
+// itself is the frame: gsl_split_records() finds where it ends.
+//
+// Request: {msg {seq 42} {from load-3} {body Hello} [tags a b c]}
+// Reply:   {ack {seq 42} {tags 3}}
+//      or: {nack {seq 42} {code 3}}
+//
+// Addresses: "tcp:HOST:PORT" or "unix:PATH".
+
+#include <gsl-parser.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define MSG_DEFAULT_ADDRESS "tcp:127.0.0.1:7878"
+#define MSG_MAX_SIZE (64 * 1024)
+#define MSG_MAX_SPLIT_RECORDS 64
+
+struct MsgBuf {
+    char *data;
+    size_t size;
+    size_t cap;
+};
+
+static inline int
+msg_buf_reserve(struct MsgBuf *self, size_t size)
+{
+    size_t cap = self->cap ? self->cap : 4096;
+    char *data;
+
+    if (self->size + size <= self->cap)
+        return 0;
+    while (cap < self->size + size)
+        cap *= 2;
+    data = realloc(self->data, cap);
+    if (!data)
+        return -1;
+    self->data = data;
+    self->cap = cap;
+    return 0;
+}
+
+static inline void
+msg_buf_consume(struct MsgBuf *self, size_t size)
+{
+    memmove(self->data, self->data + size, self->size - size);
+    self->size -= size;
+}
+
+// Reads what is available from the non-blocking |fd|, but stops once |max_size| bytes
+// are buffered: the caller processes the complete records and comes back, as the socket
+// stays readable.  The limit is thus on the incomplete message left after that, see
+// msg_buf_check().  One spare byte is always kept after the data so that a record can be
+// null-terminated in place.  Returns the number of bytes read, 0 on EOF, -2 if nothing
+// is available yet and -1 on error.
+static inline ssize_t
+msg_buf_fill(struct MsgBuf *self, int fd, size_t max_size)
+{
+    ssize_t total = 0, n;
+
+    for (;;) {
+        if (self->size >= max_size) {
+            if (total)
+                return total;
+            errno = EMSGSIZE;
+            return -1;
+        }
+        if (msg_buf_reserve(self, 4096 + 1))
+            return -1;
+
+        n = read(fd, self->data + self->size, self->cap - self->size - 1);
+        if (n > 0) {
+            self->size += (size_t)n;
+            total += n;
+            continue;
+        }
+        if (n == 0)
+            return total;
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return total ? total : -2;
+        return -1;
+    }
+}
+
+// Writes as much as the non-blocking |fd| takes.  Returns the number of bytes left.
+static inline ssize_t
+msg_buf_flush(struct MsgBuf *self, int fd)
+{
+    size_t done = 0;
+    ssize_t n;
+
+    while (done < self->size) {
+        n = write(fd, self->data + done, self->size - done);
+        if (n > 0) {
+            done += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        return -1;
+    }
+    msg_buf_consume(self, done);
+    return (ssize_t)self->size;
+}
+
+// Calls |process| on every complete record in |self| and drops them from the buffer.
+// Records are null-terminated in place for the parser.
+static inline int
+msg_buf_process(struct MsgBuf *self, int (*process)(void *obj, const char *rec, size_t rec_size),
+                void *obj)
+{
+    struct gslRecord records[MSG_MAX_SPLIT_RECORDS];
+    size_t num_records, total_size, offset = 0;
+    gsl_err_t err;
+
+    do {
+        err = gsl_split_records(self->data + offset, self->size - offset,
+                                records, MSG_MAX_SPLIT_RECORDS, &num_records, &total_size);
+        if (err.code && err.code != gsl_LIMIT)
+            return -1;
+
+        for (size_t i = 0; i < num_records; i++) {
+            char *end = self->data + (records[i].rec - self->data) + records[i].rec_size;
+            char saved = *end;
+            int ret;
+
+            *end = '\0';
+            ret = process(obj, records[i].rec, records[i].rec_size);
+            *end = saved;
+            if (ret)
+                return -1;
+        }
+        offset += total_size;
+    } while (err.code == gsl_LIMIT);
+
+    msg_buf_consume(self, offset);
+    return 0;
+}
+
+// Fails with EMSGSIZE if what is left after msg_buf_process() is an incomplete message of
+// |max_size| bytes or more.
+// Example: 300 KiB of pipelined messages are fine, a single 65 KiB one is not
+static inline int
+msg_buf_check(const struct MsgBuf *self, size_t max_size)
+{
+    if (self->size < max_size)
+        return 0;
+    errno = EMSGSIZE;
+    return -1;
+}
+
+struct MsgReply {
+    bool is_ack;
+    size_t seq;
+    size_t num_tags;
+    size_t code;
+};
+
+static inline gsl_err_t
+msg_parse_ack(void *obj, const char *rec, size_t *total_size)
+{
+    struct MsgReply *self = (struct MsgReply *)obj;
+    struct gslTaskSpec specs[] = {
+        { .name = "seq", .name_size = strlen("seq"), .run = gsl_run_set_size_t, .obj = &self->seq },
+        { .name = "tags", .name_size = strlen("tags"), .run = gsl_run_set_size_t, .obj = &self->num_tags },
+        { .name = "code", .name_size = strlen("code"), .run = gsl_run_set_size_t, .obj = &self->code }
+    };
+    return gsl_parse_task(rec, total_size, specs, sizeof specs / sizeof specs[0]);
+}
+
+static inline gsl_err_t
+msg_parse_nack(void *obj, const char *rec, size_t *total_size)
+{
+    struct MsgReply *self = (struct MsgReply *)obj;
+    self->is_ack = false;
+    return msg_parse_ack(obj, rec, total_size);
+}
+
+static inline gsl_err_t
+msg_parse_reply(struct MsgReply *self, const char *rec)
+{
+    struct gslTaskSpec specs[] = {
+        { .name = "ack", .name_size = strlen("ack"), .parse = msg_parse_ack, .obj = self },
+        { .name = "nack", .name_size = strlen("nack"), .parse = msg_parse_nack, .obj = self }
+    };
+    size_t total_size;
+
+    *self = (struct MsgReply){ .is_ack = true };
+    return gsl_parse_task(rec, &total_size, specs, sizeof specs / sizeof specs[0]);
+}
+
+static inline int
+msg_set_nonblock(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// Resolves |address| and either binds + listens (|is_server|) or connects.
+static inline int
+msg_open(const char *address, bool is_server)
+{
+    int fd = -1;
+
+    if (!strncmp(address, "unix:", strlen("unix:"))) {
+        struct sockaddr_un sa = { .sun_family = AF_UNIX };
+        const char *path = address + strlen("unix:");
+
+        if (strlen(path) >= sizeof sa.sun_path) {
+            fprintf(stderr, "unix socket path is too long: %s\n", path);
+            return -1;
+        }
+        strcpy(sa.sun_path, path);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        if (is_server) {
+            unlink(path);
+            if (bind(fd, (struct sockaddr *)&sa, sizeof sa) || listen(fd, SOMAXCONN))
+                goto error;
+        } else if (connect(fd, (struct sockaddr *)&sa, sizeof sa)) {
+            goto error;
+        }
+        return fd;
+    }
+
+    if (!strncmp(address, "tcp:", strlen("tcp:"))) {
+        struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+        struct addrinfo *ai;
+        char host[256];
+        const char *port = strrchr(address, ':');
+        size_t host_size = port - address - strlen("tcp:");
+        int one = 1;
+
+        if (port == address + strlen("tcp:") - 1 || host_size >= sizeof host) {
+            fprintf(stderr, "bad address: %s\n", address);
+            return -1;
+        }
+        memcpy(host, address + strlen("tcp:"), host_size);
+        host[host_size] = '\0';
+
+        if (is_server)
+            hints.ai_flags = AI_PASSIVE;
+        if (getaddrinfo(host, port + 1, &hints, &ai)) {
+            fprintf(stderr, "cannot resolve: %s\n", address);
+            return -1;
+        }
+
+        fd = socket(ai->ai_family, SOCK_STREAM, 0);
+        if (fd < 0) {
+            freeaddrinfo(ai);
+            return -1;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        if (is_server ? bind(fd, ai->ai_addr, ai->ai_addrlen) || listen(fd, SOMAXCONN)
+                      : connect(fd, ai->ai_addr, ai->ai_addrlen)) {
+            freeaddrinfo(ai);
+            goto error;
+        }
+        freeaddrinfo(ai);
+        return fd;
+    }
+
+    fprintf(stderr, "unknown address: %s (expected tcp:HOST:PORT or unix:PATH)\n", address);
+    return -1;
+
+error:
+    close(fd);
+    return -1;
+}
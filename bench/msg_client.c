@@ -0,0 +1,97 @@
+// Message client: sends the GSL messages read from stdin and prints the replies.
+//
+// Usage: msg_client [address] < messages.gsl
+//
+// Example: echo '{msg {seq 1} {from me} {body Hello} [tags a b]}' | msg_client unix:/tmp/gsl.sock
+
+#include "msg.h"
+
+#include <gsl-parser.h>
+
+#include <signal.h>
+
+struct Client {
+    size_t num_replies;
+    size_t num_nacks;
+};
+
+static int print_reply(void *obj, const char *rec, size_t rec_size) {
+    struct Client *self = (struct Client *)obj;
+    struct MsgReply reply;
+    gsl_err_t err = msg_parse_reply(&reply, rec);
+
+    printf("%.*s\n", (int)rec_size, rec);
+    self->num_replies++;
+    if (err.code || !reply.is_ack)
+        self->num_nacks++;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *address = argc > 1 ? argv[1] : MSG_DEFAULT_ADDRESS;
+    struct MsgBuf in = { 0 }, out = { 0 };
+    struct gslRecord records[MSG_MAX_SPLIT_RECORDS];
+    struct Client self = { 0 };
+    size_t num_msgs = 0, offset = 0, num_records, total_size;
+    ssize_t n;
+    int fd;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    // Example: the whole input is "{msg {seq 1}} {msg {seq 2}}"
+    for (;;) {
+        if (msg_buf_reserve(&out, 4096))
+            return EXIT_FAILURE;
+        n = read(STDIN_FILENO, out.data + out.size, out.cap - out.size);
+        if (n <= 0)
+            break;
+        out.size += (size_t)n;
+    }
+    for (;;) {
+        gsl_err_t err = gsl_split_records(out.data + offset, out.size - offset,
+                                          records, MSG_MAX_SPLIT_RECORDS, &num_records, &total_size);
+        offset += total_size;
+        num_msgs += num_records;
+        if (err.code != gsl_LIMIT) {
+            if (err.code || offset != out.size) {
+                fprintf(stderr, "malformed input at byte %zu\n", offset);
+                return EXIT_FAILURE;
+            }
+            break;
+        }
+    }
+
+    fd = msg_open(address, false);
+    if (fd < 0) {
+        perror(address);
+        return EXIT_FAILURE;
+    }
+
+    for (offset = 0; offset < out.size; offset += (size_t)n) {
+        n = write(fd, out.data + offset, out.size - offset);
+        if (n < 0) {
+            perror("write");
+            return EXIT_FAILURE;
+        }
+    }
+
+    while (self.num_replies < num_msgs) {
+        if (msg_buf_reserve(&in, 4096 + 1))
+            return EXIT_FAILURE;
+        n = read(fd, in.data + in.size, in.cap - in.size - 1);
+        if (n <= 0) {
+            fprintf(stderr, "connection closed after %zu of %zu replies\n", self.num_replies, num_msgs);
+            return EXIT_FAILURE;
+        }
+        in.size += (size_t)n;
+        if (msg_buf_process(&in, print_reply, &self)) {
+            fprintf(stderr, "malformed reply\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    close(fd);
+    free(in.data);
+    free(out.data);
+    return self.num_nacks ? EXIT_FAILURE : EXIT_SUCCESS;
+}
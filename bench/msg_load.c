@@ -0,0 +1,264 @@
+// Load generator for msg_server: keeps |depth| messages in flight on each of the
+// connections and reports throughput and round-trip latency percentiles.
+//
+// Usage: msg_load [-c connections] [-d depth] [-n messages] [-b body_size] [-t tags]
+//                 [-w warmup] [address]
+
+#include "bench.h"
+#include "msg.h"
+
+#include <gsl-parser.h>
+
+#include <signal.h>
+#include <sys/epoll.h>
+
+#define LOAD_MAX_EVENTS 64
+
+struct LoadOptions {
+    size_t num_conns;
+    size_t depth;
+    size_t num_msgs;
+    size_t body_size;
+    size_t num_tags;
+    size_t num_warmup;  // first messages of every connection excluded from latencies
+};
+
+struct Load;
+
+struct LoadConn {
+    struct Load *load;
+    size_t idx;
+    int fd;
+    struct MsgBuf in;
+    struct MsgBuf out;
+    bool is_writing;
+
+    // Send times of the messages in flight, replies come in order.
+    uint64_t *sent_ns;
+    size_t head;
+    size_t num_in_flight;
+
+    size_t num_msgs;  // quota of this connection
+    size_t num_sent;
+    size_t num_acked;
+};
+
+struct Load {
+    struct LoadOptions opts;
+    int epoll_fd;
+    char *body;
+    char *tags;
+    size_t num_bytes;
+
+    uint64_t *latencies;
+    size_t num_latencies;
+    size_t num_errors;
+    size_t num_done;
+};
+
+static int fill_conn(struct Load *self, struct LoadConn *conn) {
+    while (conn->num_in_flight < self->opts.depth && conn->num_sent < conn->num_msgs) {
+        size_t max_size = 128 + self->opts.body_size + strlen(self->tags);
+        int n;
+
+        if (msg_buf_reserve(&conn->out, max_size))
+            return -1;
+        n = sprintf(conn->out.data + conn->out.size, "{msg {seq %zu} {from load-%zu} {body %s} [tags%s]}\n",
+                    conn->num_sent, conn->idx, self->body, self->tags);
+        conn->out.size += (size_t)n;
+        self->num_bytes += (size_t)n;
+
+        conn->sent_ns[(conn->head + conn->num_in_flight++) % self->opts.depth] = bench_now_ns();
+        conn->num_sent++;
+    }
+
+    ssize_t left = msg_buf_flush(&conn->out, conn->fd);
+    if (left < 0)
+        return -1;
+    if ((left > 0) != conn->is_writing) {
+        struct epoll_event ev = { .events = EPOLLIN | (left > 0 ? EPOLLOUT : 0), .data.ptr = conn };
+        conn->is_writing = left > 0;
+        epoll_ctl(self->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+    }
+    return 0;
+}
+
+static int on_reply(void *obj, const char *rec, size_t rec_size) {
+    struct LoadConn *conn = (struct LoadConn *)obj;
+    struct Load *self = conn->load;
+    struct MsgReply reply;
+    gsl_err_t err = msg_parse_reply(&reply, rec);
+    uint64_t now = bench_now_ns();
+
+    (void)rec_size;
+    if (!conn->num_in_flight) {
+        fprintf(stderr, "unexpected reply on connection #%zu\n", conn->idx);
+        return -1;
+    }
+    if (err.code || !reply.is_ack || reply.seq != conn->num_acked)
+        self->num_errors++;
+
+    if (conn->num_acked >= self->opts.num_warmup)
+        self->latencies[self->num_latencies++] = now - conn->sent_ns[conn->head];
+    conn->head = (conn->head + 1) % self->opts.depth;
+    conn->num_in_flight--;
+    conn->num_acked++;
+    if (conn->num_acked == conn->num_msgs)
+        self->num_done++;
+    return 0;
+}
+
+static int handle_conn(struct Load *self, struct LoadConn *conn, uint32_t events) {
+    if (events & EPOLLIN) {
+        ssize_t n = msg_buf_fill(&conn->in, conn->fd, MSG_MAX_SIZE);
+        if (n == 0)
+            errno = ECONNRESET;
+        if (n == 0 || n == -1)
+            return -1;
+        if (msg_buf_process(&conn->in, on_reply, conn) || msg_buf_check(&conn->in, MSG_MAX_SIZE))
+            return -1;
+    } else if (!(events & EPOLLOUT)) {
+        errno = ECONNRESET;
+        return -1;
+    }
+    return fill_conn(self, conn);
+}
+
+// Example: the server closes a connection on a malformed or too large message, and the
+// next write gets EPIPE
+static void report_conn_failure(const struct LoadConn *conn) {
+    if (errno == EPIPE || errno == ECONNRESET)
+        fprintf(stderr, "connection #%zu dropped by the server after %zu replies (see its errors)\n",
+                conn->idx, conn->num_acked);
+    else
+        fprintf(stderr, "connection #%zu failed after %zu replies: %s\n", conn->idx, conn->num_acked, strerror(errno));
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile_us(const uint64_t *sorted, size_t n, double p) {
+    size_t i = (size_t)(p * n);
+    return n ? sorted[i < n ? i : n - 1] / 1e3 : 0;
+}
+
+int main(int argc, char **argv) {
+    struct Load self = {
+        .opts = { .num_conns = 4, .depth = 16, .num_msgs = 200000, .body_size = 64, .num_tags = 4, .num_warmup = 100 }
+    };
+    struct epoll_event events[LOAD_MAX_EVENTS];
+    struct LoadConn *conns;
+    const char *address;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:d:n:b:t:w:")) != -1) {
+        size_t val = strtoul(optarg ? optarg : "0", NULL, 10);
+        switch (opt) {
+        case 'c': self.opts.num_conns = val; break;
+        case 'd': self.opts.depth = val; break;
+        case 'n': self.opts.num_msgs = val; break;
+        case 'b': self.opts.body_size = val; break;
+        case 't': self.opts.num_tags = val; break;
+        case 'w': self.opts.num_warmup = val; break;
+        default:
+            fprintf(stderr, "usage: %s [-c connections] [-d depth] [-n messages] [-b body_size] [-t tags] "
+                            "[-w warmup] [address]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    address = optind < argc ? argv[optind] : MSG_DEFAULT_ADDRESS;
+    if (!self.opts.num_conns || !self.opts.depth) {
+        fprintf(stderr, "connections and depth must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    self.body = malloc(self.opts.body_size + 1);
+    self.tags = malloc(self.opts.num_tags * 16 + 1);
+    self.latencies = calloc(self.opts.num_msgs + 1, sizeof *self.latencies);
+    conns = calloc(self.opts.num_conns, sizeof *conns);
+    self.epoll_fd = epoll_create1(0);
+    if (!self.body || !self.tags || !self.latencies || !conns || self.epoll_fd < 0) {
+        fprintf(stderr, "cannot prepare the load\n");
+        return EXIT_FAILURE;
+    }
+
+    // Example: {msg {seq 7} {from load-0} {body bbbbbbbb} [tags tag0 tag1 tag2 tag3]}
+    memset(self.body, 'b', self.opts.body_size);
+    self.body[self.opts.body_size] = '\0';
+    self.tags[0] = '\0';
+    for (size_t i = 0, n = 0; i < self.opts.num_tags; i++)
+        n += sprintf(self.tags + n, " tag%zu", i % 1000);
+
+    for (size_t i = 0; i < self.opts.num_conns; i++) {
+        struct LoadConn *conn = &conns[i];
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = conn };
+
+        conn->load = &self;
+        conn->idx = i;
+        conn->num_msgs = self.opts.num_msgs / self.opts.num_conns + (i < self.opts.num_msgs % self.opts.num_conns);
+        conn->sent_ns = calloc(self.opts.depth, sizeof *conn->sent_ns);
+        conn->fd = msg_open(address, false);
+        if (conn->fd < 0 || !conn->sent_ns || msg_set_nonblock(conn->fd) ||
+            epoll_ctl(self.epoll_fd, EPOLL_CTL_ADD, conn->fd, &ev)) {
+            perror(address);
+            return EXIT_FAILURE;
+        }
+        if (!conn->num_msgs)
+            self.num_done++;
+    }
+
+    uint64_t t0 = bench_now_ns();
+    for (size_t i = 0; i < self.opts.num_conns; i++) {
+        if (fill_conn(&self, &conns[i])) {
+            report_conn_failure(&conns[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    while (self.num_done < self.opts.num_conns) {
+        int n = epoll_wait(self.epoll_fd, events, LOAD_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            return EXIT_FAILURE;
+        }
+        for (int i = 0; i < n; i++) {
+            struct LoadConn *conn = (struct LoadConn *)events[i].data.ptr;
+            if (handle_conn(&self, conn, events[i].events)) {
+                report_conn_failure(conn);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    double sec = (bench_now_ns() - t0) / 1e9;
+
+    qsort(self.latencies, self.num_latencies, sizeof *self.latencies, cmp_u64);
+
+    printf("address: %s  connections: %zu  depth: %zu  errors: %zu\n",
+           address, self.opts.num_conns, self.opts.depth, self.num_errors);
+    printf("messages: %zu  seconds: %.3f  msgs/s: %.0f  MB/s: %.1f\n",
+           self.opts.num_msgs, sec, self.opts.num_msgs / sec, self.num_bytes / sec / 1e6);
+    printf("latency us: p50 %.1f  p99 %.1f  p999 %.1f  max %.1f\n",
+           percentile_us(self.latencies, self.num_latencies, 0.50),
+           percentile_us(self.latencies, self.num_latencies, 0.99),
+           percentile_us(self.latencies, self.num_latencies, 0.999),
+           percentile_us(self.latencies, self.num_latencies, 1.0));
+
+    for (size_t i = 0; i < self.opts.num_conns; i++) {
+        close(conns[i].fd);
+        free(conns[i].sent_ns);
+        free(conns[i].in.data);
+        free(conns[i].out.data);
+    }
+    free(conns);
+    free(self.latencies);
+    free(self.tags);
+    free(self.body);
+    close(self.epoll_fd);
+    return self.num_errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
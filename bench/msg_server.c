@@ -0,0 +1,208 @@
+// Message server: accepts connections, parses the incoming GSL messages as soon as they
+// are complete and replies to each of them.  Single-threaded, epoll-driven.
+//
+// Usage: msg_server [address]
+//
+// SIGINT/SIGTERM prints the counters and stops the server.
+
+#include "msg.h"
+
+#include <gsl-parser.h>
+
+#include <signal.h>
+#include <sys/epoll.h>
+
+#define SERVER_MAX_EVENTS 64
+#define SERVER_MAX_BODY_SIZE 1024
+
+struct ServerMsg {
+    size_t seq;
+    char from[64]; size_t from_size;
+    char body[SERVER_MAX_BODY_SIZE]; size_t body_size;
+    size_t num_tags;
+};
+
+struct Server;
+
+struct ServerConn {
+    struct Server *server;
+    int fd;
+    struct MsgBuf in;
+    struct MsgBuf out;
+    bool is_writing;  // EPOLLOUT is armed
+};
+
+struct Server {
+    int epoll_fd;
+    size_t num_msgs;
+    size_t num_errors;
+    size_t num_conns;
+};
+
+static volatile sig_atomic_t is_stopped;
+
+static void on_signal(int sig) {
+    (void)sig;
+    is_stopped = 1;
+}
+
+static gsl_err_t run_tag(void *obj, const char *val, size_t val_size) {
+    struct ServerMsg *self = (struct ServerMsg *)obj;
+    (void)val; (void)val_size;
+    self->num_tags++;
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t parse_msg(void *obj, const char *rec, size_t *total_size) {
+    struct ServerMsg *self = (struct ServerMsg *)obj;
+    struct gslTaskSpec tag_spec = { .is_list_item = true, .run = run_tag, .obj = self };
+    struct gslTaskSpec specs[] = {
+        { .name = "seq", .name_size = strlen("seq"),
+          .run = gsl_run_set_size_t, .obj = &self->seq },
+        { .name = "from", .name_size = strlen("from"),
+          .buf = self->from, .buf_size = &self->from_size, .max_buf_size = sizeof self->from },
+        { .name = "body", .name_size = strlen("body"),
+          .buf = self->body, .buf_size = &self->body_size, .max_buf_size = sizeof self->body },
+        { .type = GSL_GET_ARRAY_STATE, .name = "tags", .name_size = strlen("tags"),
+          .parse = gsl_parse_array, .obj = &tag_spec }
+    };
+    return gsl_parse_task(rec, total_size, specs, sizeof specs / sizeof specs[0]);
+}
+
+static int process_msg(void *obj, const char *rec, size_t rec_size) {
+    struct ServerConn *conn = (struct ServerConn *)obj;
+    struct ServerMsg msg = { 0 };
+    struct gslTaskSpec specs[] = {
+        { .name = "msg", .name_size = strlen("msg"), .parse = parse_msg, .obj = &msg }
+    };
+    size_t total_size;
+    gsl_err_t err;
+    int n;
+
+    (void)rec_size;
+    err = gsl_parse_task(rec, &total_size, specs, sizeof specs / sizeof specs[0]);
+
+    if (msg_buf_reserve(&conn->out, 128))
+        return -1;
+    conn->server->num_msgs++;
+    if (err.code) {
+        conn->server->num_errors++;
+        n = sprintf(conn->out.data + conn->out.size, "{nack {seq %zu} {code %d}}\n", msg.seq, err.code);
+    } else {
+        n = sprintf(conn->out.data + conn->out.size, "{ack {seq %zu} {tags %zu}}\n", msg.seq, msg.num_tags);
+    }
+    conn->out.size += (size_t)n;
+    return 0;
+}
+
+static void close_conn(struct Server *self, struct ServerConn *conn) {
+    epoll_ctl(self->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    free(conn->in.data);
+    free(conn->out.data);
+    free(conn);
+    self->num_conns--;
+}
+
+static void accept_conns(struct Server *self, int listen_fd) {
+    for (;;) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+            return;
+
+        struct ServerConn *conn = calloc(1, sizeof *conn);
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = conn };
+        if (!conn || msg_set_nonblock(fd) || epoll_ctl(self->epoll_fd, EPOLL_CTL_ADD, fd, &ev)) {
+            free(conn);
+            close(fd);
+            continue;
+        }
+        conn->server = self;
+        conn->fd = fd;
+        self->num_conns++;
+    }
+}
+
+static int handle_conn(struct Server *self, struct ServerConn *conn, uint32_t events) {
+    if (events & EPOLLIN) {
+        ssize_t n = msg_buf_fill(&conn->in, conn->fd, MSG_MAX_SIZE);
+        if (n == 0 || n == -1)
+            return -1;
+
+        // Example: garbage between the messages
+        if (msg_buf_process(&conn->in, process_msg, conn) || msg_buf_check(&conn->in, MSG_MAX_SIZE)) {
+            self->num_errors++;
+            return -1;
+        }
+    } else if (!(events & EPOLLOUT)) {
+        return -1;
+    }
+
+    ssize_t left = msg_buf_flush(&conn->out, conn->fd);
+    if (left < 0)
+        return -1;
+
+    // Wait for the socket to become writable only while there are pending replies.
+    if ((left > 0) != conn->is_writing) {
+        struct epoll_event ev = { .events = EPOLLIN | (left > 0 ? EPOLLOUT : 0), .data.ptr = conn };
+        conn->is_writing = left > 0;
+        epoll_ctl(self->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *address = argc > 1 ? argv[1] : MSG_DEFAULT_ADDRESS;
+    struct Server self = { 0 };
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    struct sigaction sa = { .sa_handler = on_signal };
+    int listen_fd;
+
+    signal(SIGPIPE, SIG_IGN);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    listen_fd = msg_open(address, true);
+    if (listen_fd < 0 || msg_set_nonblock(listen_fd)) {
+        perror(address);
+        return EXIT_FAILURE;
+    }
+
+    self.epoll_fd = epoll_create1(0);
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    if (self.epoll_fd < 0 || epoll_ctl(self.epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev)) {
+        perror("epoll");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, "listening on %s\n", address);
+
+    while (!is_stopped) {
+        int n = epoll_wait(self.epoll_fd, events, SERVER_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            struct ServerConn *conn = (struct ServerConn *)events[i].data.ptr;
+            if (!conn) {
+                accept_conns(&self, listen_fd);
+                continue;
+            }
+            if (handle_conn(&self, conn, events[i].events))
+                close_conn(&self, conn);
+        }
+    }
+
+    fprintf(stderr, "messages: %zu  errors: %zu  open connections: %zu\n",
+            self.num_msgs, self.num_errors, self.num_conns);
+
+    close(self.epoll_fd);
+    close(listen_fd);
+    if (!strncmp(address, "unix:", strlen("unix:")))
+        unlink(address + strlen("unix:"));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+// Compares the results of gsl_bench -j with a baseline.  A workload regresses when its
+// instructions per field (if both files have them) or its calibrated time per field grow
+// more than the tolerance.  Time is only compared for the workloads which run at least
+// |min_time_ms| in the baseline: shorter ones swing by more than any sane tolerance, and
+// are just reported.
+//
+// Usage: perf_check [-t instructions_tolerance_pct] [-T time_tolerance_pct] [-m min_time_ms]
+//                   baseline.json results.json
+//
+// Exit codes: 0 - no regressions, 1 - regressions or bad input, 77 - skipped: the baseline is
+// for another build type, or no workload could be compared.
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PERF_CHECK_SKIPPED 77
+#define PERF_CHECK_MAX_STRING 256
+
+struct PerfFile {
+    const char *path;
+    char *buf;
+    char build[PERF_CHECK_MAX_STRING];
+    char params[PERF_CHECK_MAX_STRING];
+};
+
+static char *read_file(const char *path) {
+    FILE *file = fopen(path, "r");
+    char *buf = NULL;
+    long size;
+
+    if (!file) return NULL;
+    if (!fseek(file, 0, SEEK_END) && (size = ftell(file)) >= 0 && !fseek(file, 0, SEEK_SET) &&
+        (buf = malloc(size + 1))) {
+        if (fread(buf, 1, size, file) == (size_t)size) {
+            buf[size] = '\0';
+        } else {
+            free(buf);
+            buf = NULL;
+        }
+    }
+    fclose(file);
+    return buf;
+}
+
+// Returns the value after "key": in [b, e) or NULL.  Only the flat format of gsl_bench -j
+// is supported: no nested keys of the same name, no escapes in strings.
+static const char *find_value(const char *b, const char *e, const char *key) {
+    size_t key_size = strlen(key);
+
+    for (const char *c = b; c + key_size + 2 < e; c++) {
+        if (c[0] != '"' || strncmp(c + 1, key, key_size) || c[key_size + 1] != '"') continue;
+        for (c += key_size + 2; c < e && (*c == ' ' || *c == ':'); c++)
+            ;
+        return c < e ? c : NULL;
+    }
+    return NULL;
+}
+
+static bool find_string(const char *b, const char *e, const char *key, char *buf, size_t max_size) {
+    const char *c = find_value(b, e, key);
+    const char *end;
+
+    if (!c || *c != '"' || !(end = memchr(c + 1, '"', e - c - 1)) || (size_t)(end - c - 1) >= max_size)
+        return false;
+    memcpy(buf, c + 1, end - c - 1);
+    buf[end - c - 1] = '\0';
+    return true;
+}
+
+// Returns false for a missing key or null.
+static bool find_number(const char *b, const char *e, const char *key, double *num) {
+    const char *c = find_value(b, e, key);
+    char *end;
+
+    if (!c || !strncmp(c, "null", strlen("null"))) return false;
+    *num = strtod(c, &end);
+    return end != c;
+}
+
+// Returns the workload object {"name": |name|, ...} or NULL; |*e| is set to its closing brace.
+static const char *find_workload(const struct PerfFile *file, const char *name, const char **e) {
+    char buf[PERF_CHECK_MAX_STRING];
+
+    for (const char *b = strstr(file->buf, "\"workloads\""); b && (b = strchr(b, '{')); b = *e) {
+        if (!(*e = strchr(b, '}'))) return NULL;
+        if (find_string(b, *e, "name", buf, sizeof buf) && !strcmp(buf, name))
+            return b;
+    }
+    return NULL;
+}
+
+static int load(struct PerfFile *file, const char *path) {
+    file->path = path;
+    file->buf = read_file(path);
+    if (!file->buf) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return -1;
+    }
+
+    const char *e = file->buf + strlen(file->buf);
+    if (!find_string(file->buf, e, "build", file->build, sizeof file->build) ||
+        !find_string(file->buf, e, "params", file->params, sizeof file->params) ||
+        !strstr(file->buf, "\"workloads\"")) {
+        fprintf(stderr, "%s: not a gsl_bench result\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static int usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-t instructions_tolerance_pct] [-T time_tolerance_pct] [-m min_time_ms] "
+                    "baseline.json results.json\n", prog);
+    return EXIT_FAILURE;
+}
+
+int main(int argc, char **argv) {
+    double instructions_tolerance = 3;
+    double time_tolerance = 30;
+    double min_time_ms = 10;
+    struct PerfFile baseline = { 0 }, results = { 0 };
+    size_t num_regressions = 0, num_checked = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:T:m:")) != -1) {
+        switch (opt) {
+        case 't': instructions_tolerance = strtod(optarg, NULL); break;
+        case 'T': time_tolerance = strtod(optarg, NULL); break;
+        case 'm': min_time_ms = strtod(optarg, NULL); break;
+        default:
+            return usage(argv[0]);
+        }
+    }
+    if (argc - optind != 2)
+        return usage(argv[0]);
+
+    if (load(&baseline, argv[optind]) || load(&results, argv[optind + 1]))
+        return EXIT_FAILURE;
+
+    if (strcmp(baseline.build, results.build)) {
+        printf("perf check skipped: the baseline is for a %s build, this is a %s build\n",
+               baseline.build, results.build);
+        return PERF_CHECK_SKIPPED;
+    }
+    if (strcmp(baseline.params, results.params)) {
+        fprintf(stderr, "the baseline was recorded with \"%s\", the results with \"%s\": update the baseline\n",
+                baseline.params, results.params);
+        return EXIT_FAILURE;
+    }
+
+    printf("%-8s %-14s %12s %12s %9s %9s\n", "workload", "metric", "baseline", "current", "change", "limit");
+    for (const char *b = strstr(baseline.buf, "\"workloads\""), *e; b && (b = strchr(b, '{')); b = e) {
+        char name[PERF_CHECK_MAX_STRING];
+        const char *metric = "instructions";
+        double tolerance = instructions_tolerance;
+        double base_val, val, ns_per_field, num_fields;
+        bool is_gated = true;
+        const char *rb, *re;
+
+        if (!(e = strchr(b, '}')) || !find_string(b, e, "name", name, sizeof name)) {
+            fprintf(stderr, "%s: bad workload\n", baseline.path);
+            return EXIT_FAILURE;
+        }
+        if (!(rb = find_workload(&results, name, &re))) {
+            fprintf(stderr, "%s: no results for the %s workload\n", results.path, name);
+            return EXIT_FAILURE;
+        }
+
+        // Example: no counters on one of the machines -- fall back to the noisier time
+        if (!find_number(b, e, "instructions_per_field", &base_val) ||
+            !find_number(rb, re, "instructions_per_field", &val)) {
+            metric = "time";
+            tolerance = time_tolerance;
+            if (!find_number(b, e, "time_per_field", &base_val) || !find_number(rb, re, "time_per_field", &val)) {
+                fprintf(stderr, "no time of the %s workload\n", name);
+                return EXIT_FAILURE;
+            }
+
+            // Example: array: 12000 fields * 30 ns = 0.4 ms, a page fault or a migration is +30%
+            is_gated = find_number(b, e, "ns_per_field", &ns_per_field) && find_number(b, e, "fields", &num_fields) &&
+                       ns_per_field * num_fields / 1e6 >= min_time_ms;
+        }
+
+        double change = (val / base_val - 1) * 100;
+        bool is_regression = is_gated && change > tolerance;
+        printf("%-8s %-14s %12.2f %12.2f %+8.1f%% %8.1f%%%s\n", name, metric, base_val, val, change, tolerance,
+               !is_gated ? "  (too short to compare the time)" : is_regression ? "  REGRESSION" :
+               change < -tolerance ? "  (faster: update the baseline?)" : "");
+        num_regressions += is_regression;
+        num_checked += is_gated;
+    }
+
+    free(baseline.buf);
+    free(results.buf);
+    if (!num_checked) {
+        printf("perf check skipped: no instruction counts, and every workload is shorter than %.1f ms\n", min_time_ms);
+        return PERF_CHECK_SKIPPED;
+    }
+    return num_regressions ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,18 @@
+# Runs gsl_bench on the perf check corpus and compares the results with the baseline.
+# Called by the perf_check test with -DGSL_BENCH, -DPERF_CHECK, -DBENCH_ARGS, -DBASELINE,
+# -DRESULTS, -DTOLERANCE, -DTIME_TOLERANCE and -DMIN_TIME_MS.
+
+separate_arguments(BENCH_ARGS)
+
+execute_process(COMMAND ${GSL_BENCH} ${BENCH_ARGS} -j ${RESULTS} RESULT_VARIABLE bench_result)
+if(NOT bench_result EQUAL 0)
+  message(FATAL_ERROR "gsl_bench failed: ${bench_result}")
+endif()
+
+execute_process(COMMAND ${PERF_CHECK} -t ${TOLERANCE} -T ${TIME_TOLERANCE} -m ${MIN_TIME_MS} ${BASELINE} ${RESULTS}
+    RESULT_VARIABLE check_result)
+if(check_result EQUAL 77)
+  message("perf check skipped")
+elseif(NOT check_result EQUAL 0)
+  message(FATAL_ERROR "performance regression against ${BASELINE}, see ${RESULTS}")
+endif()
@@ -0,0 +1,70 @@
+# Profile-guided build in WORK_DIR/pgo:
+#   1. an instrumented Release build (GSL_PGO=GENERATE),
+#   2. a training run of its gsl_bench on a corpus of another seed than the measured one,
+#   3. the optimized build (GSL_PGO=USE) in the same directory, so that GCC finds the
+#      profile of every object by its path.
+# A plain Release build in WORK_DIR/plain is measured along for the before/after numbers.
+# Called by the pgo target with -DSOURCE_DIR, -DWORK_DIR, -DC_COMPILER, -DWITH_LTO,
+# -DTRAIN_ARGS and -DBENCH_ARGS.
+
+separate_arguments(TRAIN_ARGS)
+separate_arguments(BENCH_ARGS)
+
+set(profile_dir ${WORK_DIR}/profile)
+
+function(gsl_pgo_build dir)
+  execute_process(COMMAND ${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${dir} -DCMAKE_BUILD_TYPE=Release
+          -DCMAKE_C_COMPILER=${C_COMPILER} -DGSL_WITH_LTO=${WITH_LTO} -DGSL_PGO_DIR=${profile_dir} ${ARGN}
+      RESULT_VARIABLE result OUTPUT_QUIET)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "cannot configure ${dir}")
+  endif()
+  execute_process(COMMAND ${CMAKE_COMMAND} --build ${dir} --target gsl_bench RESULT_VARIABLE result OUTPUT_QUIET)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "cannot build ${dir}")
+  endif()
+endfunction()
+
+function(gsl_pgo_run dir)
+  execute_process(COMMAND ${dir}/bin/gsl_bench ${ARGN} RESULT_VARIABLE result OUTPUT_VARIABLE output)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${dir}/bin/gsl_bench failed: ${result}")
+  endif()
+  message("${output}")
+endfunction()
+
+message("-- plain Release build")
+gsl_pgo_build(${WORK_DIR}/plain -DGSL_PGO=OFF)
+
+message("-- instrumented build")
+file(REMOVE_RECURSE ${profile_dir})
+file(MAKE_DIRECTORY ${profile_dir})
+gsl_pgo_build(${WORK_DIR}/pgo -DGSL_PGO=GENERATE)
+
+message("-- training run")
+execute_process(COMMAND ${WORK_DIR}/pgo/bin/gsl_bench ${TRAIN_ARGS} RESULT_VARIABLE result OUTPUT_QUIET)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "the training run failed: ${result}")
+endif()
+
+# Example: Clang writes raw profiles that are merged for -fprofile-instr-use
+file(GLOB raw_profiles ${profile_dir}/*.profraw)
+if(raw_profiles)
+  find_program(LLVM_PROFDATA NAMES llvm-profdata)
+  if(NOT LLVM_PROFDATA)
+    message(FATAL_ERROR "llvm-profdata is not found")
+  endif()
+  execute_process(COMMAND ${LLVM_PROFDATA} merge -o ${profile_dir}/gsl.profdata ${raw_profiles}
+      RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "cannot merge the profiles")
+  endif()
+endif()
+
+message("-- optimized build")
+gsl_pgo_build(${WORK_DIR}/pgo -DGSL_PGO=USE)
+
+message("\n-- before: ${WORK_DIR}/plain")
+gsl_pgo_run(${WORK_DIR}/plain ${BENCH_ARGS})
+message("-- after: ${WORK_DIR}/pgo")
+gsl_pgo_run(${WORK_DIR}/pgo ${BENCH_ARGS})
@@ -0,0 +1,167 @@
+// Hand-off benchmark: N producers and N consumers pass items through a queue of the same
+// capacity, either a ring under a mutex with two condition variables (the record queue
+// gsl_ingest_files() used to have) or gsl_mpmc_push()/gsl_mpmc_pop() taking batches.
+//
+// Usage: queue_bench [num_items] [max_threads] [batch_size]
+
+#include "bench.h"
+
+#include <gsl-parser.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define BENCH_QUEUE_SIZE 4096
+#define BENCH_MAX_BATCH_SIZE 256
+
+struct LockedQueue {
+    pthread_mutex_t lock;
+    pthread_cond_t pushed;
+    pthread_cond_t popped;
+    size_t items[BENCH_QUEUE_SIZE];
+    size_t head;
+    size_t num_items;
+    bool is_closed;
+};
+
+struct BenchThread {
+    struct LockedQueue *locked;
+    struct gslMpmcQueue *mpmc;
+    size_t num_items;
+    size_t batch_size;
+    size_t sum;
+    pthread_t thread;
+};
+
+static void *run_locked_producer(void *arg) {
+    struct BenchThread *self = (struct BenchThread *)arg;
+    struct LockedQueue *queue = self->locked;
+
+    for (size_t i = 0; i < self->num_items; i++) {
+        pthread_mutex_lock(&queue->lock);
+        while (queue->num_items == BENCH_QUEUE_SIZE)
+            pthread_cond_wait(&queue->popped, &queue->lock);
+        queue->items[(queue->head + queue->num_items++) % BENCH_QUEUE_SIZE] = i;
+        pthread_cond_signal(&queue->pushed);
+        pthread_mutex_unlock(&queue->lock);
+    }
+    return NULL;
+}
+
+static void *run_locked_consumer(void *arg) {
+    struct BenchThread *self = (struct BenchThread *)arg;
+    struct LockedQueue *queue = self->locked;
+
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        while (!queue->num_items && !queue->is_closed)
+            pthread_cond_wait(&queue->pushed, &queue->lock);
+        if (!queue->num_items) {
+            pthread_mutex_unlock(&queue->lock);
+            break;
+        }
+        self->sum += queue->items[queue->head];
+        queue->head = (queue->head + 1) % BENCH_QUEUE_SIZE;
+        queue->num_items--;
+        pthread_cond_signal(&queue->popped);
+        pthread_mutex_unlock(&queue->lock);
+    }
+    return NULL;
+}
+
+static void *run_mpmc_producer(void *arg) {
+    struct BenchThread *self = (struct BenchThread *)arg;
+
+    for (size_t i = 0; i < self->num_items; i++)
+        gsl_mpmc_push(self->mpmc, &i);
+    return NULL;
+}
+
+static void *run_mpmc_consumer(void *arg) {
+    struct BenchThread *self = (struct BenchThread *)arg;
+    size_t items[BENCH_MAX_BATCH_SIZE], num_items;
+
+    while ((num_items = gsl_mpmc_pop(self->mpmc, items, self->batch_size))) {
+        for (size_t i = 0; i < num_items; i++)
+            self->sum += items[i];
+    }
+    return NULL;
+}
+
+// Returns the seconds of the hand-off, or a negative value on a lost item.
+static double run(size_t num_threads, size_t num_items, size_t batch_size, bool is_mpmc) {
+    struct BenchThread producers[num_threads], consumers[num_threads];
+    static struct LockedQueue locked;
+    struct gslMpmcQueue *mpmc = NULL;
+    size_t sum = 0, per_producer = num_items / num_threads;
+
+    locked = (struct LockedQueue){ .head = 0 };
+    pthread_mutex_init(&locked.lock, NULL);
+    pthread_cond_init(&locked.pushed, NULL);
+    pthread_cond_init(&locked.popped, NULL);
+    if (is_mpmc && gsl_mpmc_create(BENCH_QUEUE_SIZE, sizeof(size_t), &mpmc).code)
+        return -1;
+
+    uint64_t t0 = bench_now_ns();
+    for (size_t i = 0; i < num_threads; i++) {
+        consumers[i] = (struct BenchThread){ .locked = &locked, .mpmc = mpmc, .batch_size = batch_size };
+        pthread_create(&consumers[i].thread, NULL, is_mpmc ? run_mpmc_consumer : run_locked_consumer, &consumers[i]);
+    }
+    for (size_t i = 0; i < num_threads; i++) {
+        producers[i] = (struct BenchThread){ .locked = &locked, .mpmc = mpmc, .num_items = per_producer };
+        pthread_create(&producers[i].thread, NULL, is_mpmc ? run_mpmc_producer : run_locked_producer, &producers[i]);
+    }
+    for (size_t i = 0; i < num_threads; i++)
+        pthread_join(producers[i].thread, NULL);
+
+    if (is_mpmc) {
+        gsl_mpmc_close(mpmc);
+    } else {
+        pthread_mutex_lock(&locked.lock);
+        locked.is_closed = true;
+        pthread_cond_broadcast(&locked.pushed);
+        pthread_mutex_unlock(&locked.lock);
+    }
+    for (size_t i = 0; i < num_threads; i++) {
+        pthread_join(consumers[i].thread, NULL);
+        sum += consumers[i].sum;
+    }
+    double sec = (bench_now_ns() - t0) / 1e9;
+
+    gsl_mpmc_destroy(mpmc);
+    pthread_cond_destroy(&locked.popped);
+    pthread_cond_destroy(&locked.pushed);
+    pthread_mutex_destroy(&locked.lock);
+
+    return sum == num_threads * (per_producer * (per_producer - 1) / 2) ? sec : -1;
+}
+
+int main(int argc, char **argv) {
+    size_t num_items = argc > 1 ? strtoul(argv[1], NULL, 10) : 4000000;
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max_threads = argc > 2 ? strtoul(argv[2], NULL, 10) : (size_t)(num_cpus > 0 ? num_cpus : 1);
+    size_t batch_size = argc > 3 ? strtoul(argv[3], NULL, 10) : 16;
+
+    if (!max_threads || !batch_size || batch_size > BENCH_MAX_BATCH_SIZE || num_items < max_threads) {
+        fprintf(stderr, "bad arguments\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("items: %zu  batch: %zu  cpus: %ld\n\n", num_items, batch_size, num_cpus);
+    printf("%7s %14s %14s %8s\n", "threads", "locked Mops/s", "mpmc Mops/s", "speedup");
+
+    for (size_t num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+        double locked_sec = run(num_threads, num_items, batch_size, false);
+        double mpmc_sec = run(num_threads, num_items, batch_size, true);
+
+        if (locked_sec < 0 || mpmc_sec < 0) {
+            fprintf(stderr, "items lost with %zu threads\n", num_threads);
+            return EXIT_FAILURE;
+        }
+        printf("%7zu %14.1f %14.1f %7.2fx\n", num_threads, num_items / locked_sec / 1e6,
+               num_items / mpmc_sec / 1e6, locked_sec / mpmc_sec);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+// Specialized parsers generated from schema/messages.gsl against gsl_parse_task() driven
+// by the generated spec tables, on the same records of the five hottest message types.
+//
+// Usage: schema_bench [num_records] [num_runs]
+
+#include "bench.h"
+#include "messages.gsl.h"
+
+#include <gsl-parser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_ARENA_RESET_EVERY 1024
+
+typedef gsl_err_t (*bench_parse_t)(void *obj, struct gslArena *arena, const char *rec, size_t *total_size);
+
+struct BenchType {
+    const char *name;
+    const struct gslObjectSpec *spec;
+    bench_parse_t parse;
+    int (*gen)(char *buf, size_t i);
+};
+
+#define BENCH_PARSE(prefix, type)                                                                    \
+    static gsl_err_t prefix##_bench_parse(void *obj, struct gslArena *arena, const char *rec,      \
+                                          size_t *total_size) {                                    \
+        return prefix##_parse_record((struct type *)obj, arena, rec, total_size);                  \
+    }
+
+BENCH_PARSE(msg, Msg)
+BENCH_PARSE(ack, Ack)
+BENCH_PARSE(login, Login)
+BENCH_PARSE(order, Order)
+BENCH_PARSE(metric, Metric)
+
+static int gen_msg(char *buf, size_t i) {
+    return sprintf(buf, "{msg {seq %zu} {from load-%zu} {body Hello, this is message number %zu of the run}"
+                        " [tags tag%zu tag%zu tag%zu tag%zu]}", i, i % 16, i, i % 7, i % 11, i % 13, i % 17);
+}
+
+static int gen_ack(char *buf, size_t i) {
+    return sprintf(buf, "{ack {seq %zu} {tags %zu}}", i, i % 5);
+}
+
+static int gen_login(char *buf, size_t i) {
+    return sprintf(buf, "{login user%zu {token %016zx%016zx} {client gsl-cli/1.%zu} {version %zu}}",
+                   i, i * 2654435761u, ~i, i % 10, 3 + i % 2);
+}
+
+static int gen_order(char *buf, size_t i) {
+    int n = sprintf(buf, "{order ord-%zu {customer Customer %zu} {note leave at the door} [lines", i, i % 1000);
+    for (size_t j = 0; j < 1 + i % 4; j++)
+        n += sprintf(buf + n, " {sku%zu {qty %zu} {price %zu}}", (i + j) % 500, 1 + j, 100 + (i * 7 + j) % 9000);
+    return n + sprintf(buf + n, "]}");
+}
+
+static int gen_metric(char *buf, size_t i) {
+    return sprintf(buf, "{metric cpu.load.%zu {ts %zu} {value %zu} [labels host%zu dc%zu prod]}",
+                   i % 8, 1700000000000 + i, i % 100, i % 64, i % 3);
+}
+
+static const struct BenchType bench_types[] = {
+    { "msg", &msg_spec, msg_bench_parse, gen_msg },
+    { "ack", &ack_spec, ack_bench_parse, gen_ack },
+    { "login", &login_spec, login_bench_parse, gen_login },
+    { "order", &order_spec, order_bench_parse, gen_order },
+    { "metric", &metric_spec, metric_bench_parse, gen_metric }
+};
+
+// Records are null-terminated one by one: gsl_parse_task() doesn't stop after the first.
+static char *gen_records(const struct BenchType *type, size_t num_records, size_t *offsets, size_t *size) {
+    char *buf = malloc(num_records * 512);
+    size_t n = 0;
+
+    if (!buf) return NULL;
+    for (size_t i = 0; i < num_records; i++) {
+        offsets[i] = n;
+        n += type->gen(buf + n, i) + 1;
+    }
+    *size = n - num_records;
+    return buf;
+}
+
+// Returns the best time of |num_runs| in seconds, or a negative value on error.
+static double run(const struct BenchType *type, bool is_specialized, const struct gslObjectSpec *spec,
+                  const char *buf, const size_t *offsets, size_t num_records, size_t num_runs) {
+    union { struct Msg msg; struct Ack ack; struct Login login; struct Order order; struct Metric metric; } obj;
+    struct gslArena arena;
+    double best_sec = 0;
+    size_t total_size;
+    gsl_err_t err;
+
+    gsl_arena_init(&arena, 0);
+    for (size_t r = 0; r < num_runs; r++) {
+        uint64_t t0 = bench_now_ns();
+        for (size_t i = 0; i < num_records; i++) {
+            if (i % BENCH_ARENA_RESET_EVERY == 0)
+                gsl_arena_reset(&arena);
+            err = is_specialized ? type->parse(&obj, &arena, buf + offsets[i], &total_size)
+                                 : gsl_parse_object_record(spec, &obj, &arena, buf + offsets[i], &total_size);
+            if (err.code) {
+                fprintf(stderr, "%s #%zu: %d at %zu: %s\n", type->name, i, err.code, total_size, buf + offsets[i]);
+                gsl_arena_free(&arena);
+                return -1;
+            }
+        }
+        double sec = (bench_now_ns() - t0) / 1e9;
+        if (!r || sec < best_sec)
+            best_sec = sec;
+    }
+    gsl_arena_free(&arena);
+    return best_sec;
+}
+
+int main(int argc, char **argv) {
+    size_t num_records = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+    size_t num_runs = argc > 2 ? strtoul(argv[2], NULL, 10) : 3;
+    size_t *offsets = calloc(num_records, sizeof *offsets);
+
+    if (!offsets || !num_records || !num_runs) {
+        fprintf(stderr, "cannot prepare the benchmark\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("records: %zu  runs: %zu\n\n", num_records, num_runs);
+    printf("%-8s %-12s %10s %12s %10s %8s\n", "type", "parser", "MB/s", "records/s", "ns/record", "speedup");
+
+    for (size_t t = 0; t < sizeof bench_types / sizeof bench_types[0]; t++) {
+        const struct BenchType *type = &bench_types[t];
+        struct gslObjectSpec scan_spec = *type->spec;
+        size_t buf_size;
+        char *buf = gen_records(type, num_records, offsets, &buf_size);
+        struct {
+            const char *name;
+            bool is_specialized;
+            const struct gslObjectSpec *spec;
+        } parsers[] = {
+            { "generic", false, &scan_spec },
+            { "lookup", false, type->spec },
+            { "specialized", true, type->spec }
+        };
+        double base_sec = 0;
+
+        if (!buf) {
+            fprintf(stderr, "cannot generate %s records\n", type->name);
+            return EXIT_FAILURE;
+        }
+
+        // Example: generic  -- gsl_parse_task() scans the specs of the top-level object
+        scan_spec.lookup = NULL;
+
+        for (size_t p = 0; p < sizeof parsers / sizeof parsers[0]; p++) {
+            double sec = run(type, parsers[p].is_specialized, parsers[p].spec, buf, offsets, num_records, num_runs);
+            if (sec < 0)
+                return EXIT_FAILURE;
+            if (!p)
+                base_sec = sec;
+            printf("%-8s %-12s %10.1f %12.0f %10.1f %7.2fx\n", type->name, parsers[p].name,
+                   buf_size / sec / 1e6, num_records / sec, sec * 1e9 / num_records, base_sec / sec);
+        }
+        free(buf);
+    }
+
+    free(offsets);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,354 @@
+// Microbenchmarks of the parser stages in cycles per operation: tag resolution against the
+// number of specs, numeric conversion, comment skipping against dash density, cdata
+// boundary search and the spec checks on entry of every parsing call (GSL_WITH_CHECKS).
+//
+// Usage: stage_bench [-r runs] [stage...]
+//
+// Stages: find_spec, size_t, comment, cdata, spec_check (GSL_WITH_CHECKS builds); all by default.
+//
+// Cycles are the core cycles of perf events where available, the TSC otherwise; with perf
+// events instructions, branch and L1d misses per op are reported too (see counters.h).
+
+#define _GNU_SOURCE  // syscall() in counters.h
+
+#include "bench.h"
+#include "corpus.h"  // for bench_rand()
+#include "counters.h"
+
+// The stages are static functions: build them into this file with the same flags instead
+// of linking the library's copy.
+#include "../src/parser.c"
+
+#include <unistd.h>
+
+#define STAGE_MIN_RUN_NS 20000000
+#define STAGE_MAX_SPECS 64
+#define STAGE_BODY_SIZE 1024
+
+typedef void (*stage_op_t)(void *arg, size_t num_ops);
+
+static volatile size_t stage_sink;
+
+static struct BenchCounters stage_counters;
+
+struct StageResult {
+    double cycles;  // per op
+    double ns;
+    double counters[BENCH_NUM_COUNTERS];
+    bool has_counters[BENCH_NUM_COUNTERS];
+};
+
+// Returns the run of |num_runs| with the fewest cycles per op.  The number of ops is doubled
+// until a run takes at least STAGE_MIN_RUN_NS.
+static void measure(stage_op_t op, void *arg, size_t num_runs, struct StageResult *result) {
+    size_t num_ops = 1;
+
+    for (;;) {
+        uint64_t t0 = bench_now_ns();
+        op(arg, num_ops);
+        if (bench_now_ns() - t0 >= STAGE_MIN_RUN_NS) break;
+        num_ops *= 2;
+    }
+
+    for (size_t r = 0; r < num_runs; r++) {
+        bench_counters_start(&stage_counters);
+        uint64_t t0 = bench_now_ns();
+        uint64_t c0 = bench_now_cycles();
+        op(arg, num_ops);
+        double cycles = (double)(bench_now_cycles() - c0) / num_ops;
+        double ns = (double)(bench_now_ns() - t0) / num_ops;
+        bench_counters_stop(&stage_counters);
+
+        if (stage_counters.is_valid[BENCH_CYCLES])
+            cycles = (double)stage_counters.values[BENCH_CYCLES] / num_ops;
+        if (!r || cycles < result->cycles) {
+            result->cycles = cycles;
+            result->ns = ns;
+            for (int i = 0; i < BENCH_NUM_COUNTERS; i++) {
+                result->has_counters[i] = stage_counters.is_valid[i];
+                result->counters[i] = (double)stage_counters.values[i] / num_ops;
+            }
+        }
+    }
+}
+
+static void report(const char *stage, const char *name, size_t size, stage_op_t op, void *arg, size_t num_runs) {
+    static const int counters[] = { BENCH_INSTRUCTIONS, BENCH_BRANCH_MISSES, BENCH_L1D_MISSES };
+    struct StageResult result = { 0 };
+
+    measure(op, arg, num_runs, &result);
+    printf("%-12s %-24s %12.1f", stage, name, result.cycles);
+    if (size)
+        printf(" %12.3f", result.cycles / size);
+    else
+        printf(" %12s", "-");
+    printf(" %10.1f", result.ns);
+
+    for (size_t i = 0; i < sizeof counters / sizeof counters[0]; i++) {
+        if (result.has_counters[counters[i]])
+            printf(" %12.2f", result.counters[counters[i]]);
+        else if (stage_counters.fds[counters[i]] >= 0)
+            printf(" %12s", "-");
+    }
+    printf("\n");
+}
+
+// --------------------------------------------------------------------------------
+// gsl_find_spec(): linear scan of the specs, every tag in turn
+
+struct FindSpecArg {
+    struct gslTaskSpec specs[STAGE_MAX_SPECS];
+    char names[STAGE_MAX_SPECS][16];
+    size_t num_specs;
+};
+
+static gsl_err_t run_nop(void *obj, const char *val, size_t val_size) {
+    (void)obj; (void)val; (void)val_size;
+    return make_gsl_err(gsl_OK);
+}
+
+static void op_find_spec(void *arg, size_t num_ops) {
+    struct FindSpecArg *self = (struct FindSpecArg *)arg;
+    struct gslTaskSpec *spec = NULL;
+
+    for (size_t i = 0; i < num_ops; i++) {
+        const struct gslTaskSpec *tag = &self->specs[i % self->num_specs];
+        gsl_err_t err = gsl_find_spec(tag->name, tag->name_size, GSL_GET_STATE, self->specs, self->num_specs, NULL, &spec);
+        stage_sink += err.code + (size_t)(spec - self->specs);
+    }
+}
+
+static void bench_find_spec(size_t num_runs) {
+    static struct FindSpecArg arg;
+
+    for (size_t i = 0; i < STAGE_MAX_SPECS; i++) {
+        int n = snprintf(arg.names[i], sizeof arg.names[i], "field%zu", i);
+        arg.specs[i] = (struct gslTaskSpec){ .name = arg.names[i], .name_size = n, .run = run_nop };
+    }
+
+    for (arg.num_specs = 1; arg.num_specs <= STAGE_MAX_SPECS; arg.num_specs *= 2) {
+        char name[32];
+        snprintf(name, sizeof name, "%zu specs", arg.num_specs);
+        report("find_spec", name, 0, op_find_spec, &arg, num_runs);
+    }
+}
+
+// --------------------------------------------------------------------------------
+// gsl_run_set_size_t()
+
+struct SizeTArg {
+    char val[32];
+    size_t val_size;
+};
+
+static void op_size_t(void *arg, size_t num_ops) {
+    struct SizeTArg *self = (struct SizeTArg *)arg;
+    size_t num = 0;
+
+    for (size_t i = 0; i < num_ops; i++) {
+        gsl_err_t err = gsl_run_set_size_t(&num, self->val, self->val_size);
+        stage_sink += err.code + num;
+    }
+}
+
+static void bench_size_t(size_t num_runs) {
+    static const char *const vals[] = { "7", "1234", "1700000000", "18446744073709551615" };
+    struct SizeTArg arg;
+
+    for (size_t i = 0; i < sizeof vals / sizeof vals[0]; i++) {
+        char name[32];
+
+        // Example: "1234}"  -- a delimiter follows the value as in a record
+        arg.val_size = snprintf(arg.val, sizeof arg.val, "%s}", vals[i]) - 1;
+        snprintf(name, sizeof name, "%zu digits", arg.val_size);
+        report("size_t", name, arg.val_size, op_size_t, &arg, num_runs);
+    }
+}
+
+// --------------------------------------------------------------------------------
+// gsl_parse_comment() and gsl_parse_cdata(): a body of STAGE_BODY_SIZE bytes where
+// |density| percent are the repeated character
+
+struct BodyArg {
+    char rec[STAGE_BODY_SIZE + 16];
+    size_t size;
+};
+
+// Example: repeatee = '-', density = 10: "ab-cdefg--hij..."
+static void fill_body(char *buf, char repeatee, unsigned density, uint64_t seed) {
+    uint64_t rng = seed;
+    for (size_t i = 0; i < STAGE_BODY_SIZE; i++)
+        buf[i] = i && i + 1 < STAGE_BODY_SIZE && bench_rand_below(&rng, 100) < density ? repeatee
+                                                                                        : "abcdefgh ij"[i % 11];
+}
+
+static void op_comment(void *arg, size_t num_ops) {
+    struct BodyArg *self = (struct BodyArg *)arg;
+    size_t total_size;
+
+    for (size_t i = 0; i < num_ops; i++) {
+        gsl_err_t err = gsl_parse_comment(GSL_GET_STATE, self->rec, &total_size);
+        stage_sink += err.code + total_size;
+    }
+}
+
+static void bench_comment(size_t num_runs) {
+    static const unsigned densities[] = { 0, 1, 10, 50 };
+    struct BodyArg arg;
+
+    for (size_t num_dashes = 1; num_dashes <= 3; num_dashes += 2) {
+        for (size_t i = 0; i < sizeof densities / sizeof densities[0]; i++) {
+            char name[32];
+
+            // Example: rec = "---body---}"
+            memset(arg.rec, '-', num_dashes);
+            fill_body(arg.rec + num_dashes, '-', densities[i], 1);
+            memset(arg.rec + num_dashes + STAGE_BODY_SIZE, '-', num_dashes);
+            arg.size = 2 * num_dashes + STAGE_BODY_SIZE + 1;
+            arg.rec[arg.size - 1] = '}';
+            arg.rec[arg.size] = '\0';
+
+            snprintf(name, sizeof name, "%zu-dash, %u%% dashes", num_dashes, densities[i]);
+            report("comment", name, arg.size, op_comment, &arg, num_runs);
+        }
+    }
+}
+
+static void op_cdata(void *arg, size_t num_ops) {
+    struct BodyArg *self = (struct BodyArg *)arg;
+    struct gslTaskSpec spec = { .name = "text", .name_size = strlen("text"), .run = run_nop, .obj = self };
+    size_t total_size;
+
+    for (size_t i = 0; i < num_ops; i++) {
+        spec.is_completed = false;
+        gsl_err_t err = gsl_parse_cdata(&spec, self->rec, &total_size);
+        stage_sink += err.code + total_size;
+    }
+}
+
+static void bench_cdata(size_t num_runs) {
+    static const unsigned densities[] = { 0, 1, 10 };
+    struct BodyArg arg;
+
+    for (size_t num_quotes = 1; num_quotes <= 3; num_quotes += 2) {
+        for (size_t i = 0; i < sizeof densities / sizeof densities[0]; i++) {
+            char name[32];
+            char *c = arg.rec;
+
+            // Example: rec = " {"""body"""}"
+            *c++ = ' ';
+            *c++ = '{';
+            memset(c, '"', num_quotes);
+            c += num_quotes;
+            fill_body(c, '"', densities[i], 2);
+            c += STAGE_BODY_SIZE;
+            memset(c, '"', num_quotes);
+            c += num_quotes;
+            *c++ = '}';
+            *c = '\0';
+            arg.size = c - arg.rec;
+
+            snprintf(name, sizeof name, "%zu-quote, %u%% quotes", num_quotes, densities[i]);
+            report("cdata", name, arg.size, op_cdata, &arg, num_runs);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------------
+// gsl_check_task_specs() on entry of gsl_parse_task()
+#ifdef GSL_CHECKED
+
+struct SpecCheckArg {
+    struct gslTaskSpec specs[STAGE_MAX_SPECS];
+    size_t num_specs;
+};
+
+static void op_spec_check(void *arg, size_t num_ops) {
+    struct SpecCheckArg *self = (struct SpecCheckArg *)arg;
+
+    for (size_t i = 0; i < num_ops; i++) {
+        for (size_t j = 0; j < self->num_specs; j++)
+            stage_sink += gsl_check_spec(&self->specs[j]).code;
+    }
+}
+
+static void bench_spec_check(size_t num_runs) {
+    static struct SpecCheckArg arg;
+    static char bufs[STAGE_MAX_SPECS][16];
+    static size_t buf_sizes[STAGE_MAX_SPECS];
+
+    // Example: a typical mix of buffers, callbacks and nested parsers
+    for (size_t i = 0; i < STAGE_MAX_SPECS; i++) {
+        struct gslTaskSpec *spec = &arg.specs[i];
+        *spec = (struct gslTaskSpec){ .name = "field", .name_size = strlen("field") };
+        switch (i % 3) {
+        case 0: spec->buf = bufs[i]; spec->buf_size = &buf_sizes[i]; spec->max_buf_size = sizeof bufs[i]; break;
+        case 1: spec->run = run_nop; spec->obj = &buf_sizes[i]; break;
+        case 2: spec->parse = gsl_parse_size_t; spec->obj = &buf_sizes[i]; break;
+        }
+    }
+
+    for (arg.num_specs = 1; arg.num_specs <= STAGE_MAX_SPECS; arg.num_specs *= 8) {
+        char name[32];
+        snprintf(name, sizeof name, "%zu specs", arg.num_specs);
+        report("spec_check", name, 0, op_spec_check, &arg, num_runs);
+    }
+}
+#endif
+
+static const struct {
+    const char *name;
+    void (*run)(size_t num_runs);
+} stages[] = {
+    { "find_spec", bench_find_spec },
+    { "size_t", bench_size_t },
+    { "comment", bench_comment },
+    { "cdata", bench_cdata },
+#ifdef GSL_CHECKED
+    { "spec_check", bench_spec_check }
+#endif
+};
+
+int main(int argc, char **argv) {
+    size_t num_runs = 5;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:")) != -1) {
+        switch (opt) {
+        case 'r': num_runs = strtoul(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "usage: %s [-r runs] [stage...]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!num_runs) {
+        fprintf(stderr, "no runs\n");
+        return EXIT_FAILURE;
+    }
+
+    bench_counters_open(&stage_counters);
+    bench_counters_print(&stage_counters, stdout);
+    printf("\n");
+
+    // Example: "cycles/op" from perf events, "ns/op" where there is no TSC either
+    const char *unit = stage_counters.fds[BENCH_CYCLES] >= 0 ? "cycles" : BENCH_CYCLES_UNIT;
+    printf("%-12s %-24s %9s/op %7s/byte %10s", "stage", "case", unit, unit, "ns/op");
+    if (stage_counters.fds[BENCH_INSTRUCTIONS] >= 0)
+        printf(" %12s", "inst/op");
+    if (stage_counters.fds[BENCH_BRANCH_MISSES] >= 0)
+        printf(" %12s", "br-miss/op");
+    if (stage_counters.fds[BENCH_L1D_MISSES] >= 0)
+        printf(" %12s", "L1d-miss/op");
+    printf("\n");
+    for (size_t s = 0; s < sizeof stages / sizeof stages[0]; s++) {
+        bool is_selected = optind == argc;
+
+        for (int i = optind; i < argc; i++)
+            is_selected |= !strcmp(argv[i], stages[s].name);
+        if (is_selected)
+            stages[s].run(num_runs);
+    }
+
+    bench_counters_close(&stage_counters);
+    return EXIT_SUCCESS;
+}
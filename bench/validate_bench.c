@@ -0,0 +1,162 @@
+// Throughput of gsl_validate() on the concatenated records of the gsl_bench corpus (see
+// corpus.h), next to a memchr() over the same bytes, which is about as fast as the memory
+// goes, and to the other spec-free passes: gsl_split_records(), gsl_sax_parse(),
+// gsl_parse_projection() of two paths, and gsl_filter_match() of the split records.
+//
+// Usage: validate_bench [num_records] [num_runs]
+
+#include "bench.h"
+#include "corpus.h"
+
+#include <gsl-parser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_SPLIT_RECORDS 1024
+
+static volatile size_t bench_sink;
+static struct gslProjection *bench_projection;
+static struct gslFilter *bench_filter;
+
+typedef int (*bench_pass_t)(const char *buf, size_t buf_size);
+
+static int pass_memchr(const char *buf, size_t buf_size) {
+    bench_sink = memchr(buf, '\x01', buf_size) != NULL;
+    return 0;
+}
+
+static int pass_validate(const char *buf, size_t buf_size) {
+    size_t total_size;
+    return gsl_validate(buf, buf_size, &total_size).code;
+}
+
+static int pass_split(const char *buf, size_t buf_size) {
+    static struct gslRecord records[BENCH_SPLIT_RECORDS];
+    size_t num_records, total_size;
+    gsl_err_t err;
+
+    do {
+        err = gsl_split_records(buf, buf_size, records, BENCH_SPLIT_RECORDS, &num_records, &total_size);
+        buf += total_size;
+        buf_size -= total_size;
+    } while (err.code == gsl_LIMIT);
+    return err.code || buf_size;
+}
+
+// The records are fields of one top-level body for gsl_sax_parse(), and the buffer is
+// null-terminated, see main().
+static int pass_sax(const char *buf, size_t buf_size) {
+    struct gslSaxHandler handler = { .obj = NULL };
+    size_t total_size;
+    return gsl_sax_parse(buf, &total_size, &handler).code || total_size != buf_size;
+}
+
+static gsl_err_t run_count(void *obj, const char *val, size_t val_size) {
+    (void)obj, (void)val;
+    bench_sink += val_size;
+    return make_gsl_err(gsl_OK);
+}
+
+// Same as pass_sax(): the top-level "{class" fields of one body.
+static int pass_projection(const char *buf, size_t buf_size) {
+    size_t total_size;
+    return gsl_parse_projection(buf, &total_size, bench_projection).code || total_size != buf_size;
+}
+
+// A grep for a few records: every record is split off and dropped by the filter as soon as
+// it can't match.
+static int pass_filter(const char *buf, size_t buf_size) {
+    static struct gslRecord records[BENCH_SPLIT_RECORDS];
+    size_t num_records, total_size, rec_size;
+    gsl_err_t err;
+
+    do {
+        err = gsl_split_records(buf, buf_size, records, BENCH_SPLIT_RECORDS, &num_records, &total_size);
+        for (size_t i = 0; i < num_records; i++) {
+            gsl_err_t match = gsl_filter_match(records[i].rec, &rec_size, bench_filter);
+            if (match.code && match.code != gsl_NO_MATCH)
+                return 1;
+            bench_sink += !match.code;
+        }
+        buf += total_size;
+        buf_size -= total_size;
+    } while (err.code == gsl_LIMIT);
+    return err.code || buf_size;
+}
+
+static const struct {
+    const char *name;
+    bench_pass_t pass;
+} bench_passes[] = {
+    { "memchr", pass_memchr },
+    { "validate", pass_validate },
+    { "split", pass_split },
+    { "sax", pass_sax },
+    { "project", pass_projection },
+    { "filter", pass_filter }
+};
+
+int main(int argc, char **argv) {
+    struct BenchCorpusParams params = {
+        .seed = 1, .num_records = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000, .depth = 2, .num_tags = 5,
+        .array_len = 6, .cdata_size = 256, .comment_pct = 10, .set_pct = 10
+    };
+    size_t num_runs = argc > 2 ? strtoul(argv[2], NULL, 10) : 5;
+    const struct gslPath paths[] = {
+        { "class/tags[]", NULL, run_count },
+        { "class/is/id", NULL, run_count }
+    };
+    const struct gslPredicate preds[] = {
+        { .path = "class/tags", .type = GSL_PREDICATE_CONTAINS, .val = "star" },
+        { .path = "class/id", .type = GSL_PREDICATE_RANGE, .min = 0, .max = 65535 }
+    };
+    struct BenchCorpus corpus;
+    char *buf;
+    size_t buf_size = 0;
+
+    if (!params.num_records || !num_runs || bench_corpus_gen_records(&corpus, &params) ||
+        gsl_projection_create(paths, sizeof paths / sizeof paths[0], &bench_projection).code ||
+        gsl_filter_create(preds, sizeof preds / sizeof preds[0], &bench_filter).code) {
+        fprintf(stderr, "bad arguments\n");
+        return EXIT_FAILURE;
+    }
+
+    // Example: "{class ...}\n{class ...}\n" -- as a buffer read from a socket
+    buf = malloc(corpus.size + corpus.num_records + 1);
+    if (!buf) return EXIT_FAILURE;
+    for (size_t i = 0; i < corpus.num_records; i++) {
+        const char *rec = corpus.buf + corpus.offsets[i];
+        size_t rec_size = strlen(rec);
+        memcpy(buf + buf_size, rec, rec_size);
+        buf_size += rec_size;
+        buf[buf_size++] = '\n';
+    }
+    buf[buf_size] = '\0';
+
+    printf("records: %zu  MB: %.1f\n\n", corpus.num_records, buf_size / 1e6);
+    printf("%-8s %10s\n", "pass", "MB/s");
+
+    for (size_t p = 0; p < sizeof bench_passes / sizeof bench_passes[0]; p++) {
+        double best_sec = 0;
+
+        for (size_t r = 0; r < num_runs; r++) {
+            uint64_t t0 = bench_now_ns();
+            if (bench_passes[p].pass(buf, buf_size)) {
+                fprintf(stderr, "%s failed\n", bench_passes[p].name);
+                return EXIT_FAILURE;
+            }
+            double sec = (bench_now_ns() - t0) / 1e9;
+            if (!r || sec < best_sec)
+                best_sec = sec;
+        }
+        printf("%-8s %10.1f\n", bench_passes[p].name, buf_size / best_sec / 1e6);
+    }
+
+    free(buf);
+    gsl_projection_destroy(bench_projection);
+    gsl_filter_destroy(bench_filter);
+    bench_corpus_free(&corpus);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+// main() of the fuzz targets for builds without libFuzzer: runs the inputs of the files and
+// directories given, or of stdin, e.g. for AFL++ or to replay a corpus or a crash.  Prints
+// the input with the most work per byte.
+//
+// Usage: fuzz_<target> [file_or_dir...]
+
+#define _POSIX_C_SOURCE 200809L  // opendir()
+
+#include "fuzz.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+struct DriverWorst {
+    char path[4096];
+    double visits_per_byte;
+    double callbacks_per_byte;
+};
+
+static struct DriverWorst driver_worst;
+static size_t driver_num_inputs;
+
+static void run_input(const char *path, FILE *file) {
+    uint8_t *data = NULL;
+    size_t size = 0, max_size = 0, n;
+
+    do {
+        if (size == max_size) {
+            uint8_t *p = realloc(data, max_size = max_size ? 2 * max_size : 4096);
+            if (!p) {
+                fprintf(stderr, "%s: out of memory\n", path);
+                exit(EXIT_FAILURE);
+            }
+            data = p;
+        }
+        n = fread(data + size, 1, max_size - size, file);
+        size += n;
+    } while (n);
+
+    LLVMFuzzerTestOneInput(data, size);
+    free(data);
+    driver_num_inputs++;
+
+    const struct FuzzWork *work = fuzz_last_work();
+    if (work->size < FUZZ_MIN_CHECKED_SIZE) return;
+
+    double visits_per_byte = (double)work->bytes_visited / work->size;
+    double callbacks_per_byte = (double)work->callbacks / work->size;
+    if (visits_per_byte + callbacks_per_byte > driver_worst.visits_per_byte + driver_worst.callbacks_per_byte) {
+        snprintf(driver_worst.path, sizeof driver_worst.path, "%s", path);
+        driver_worst.visits_per_byte = visits_per_byte;
+        driver_worst.callbacks_per_byte = callbacks_per_byte;
+    }
+}
+
+static void run_path(const char *path) {
+    struct stat st;
+    FILE *file;
+
+    if (stat(path, &st)) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        DIR *dir = opendir(path);
+        struct dirent *entry;
+        char child[4096];
+
+        if (!dir) {
+            perror(path);
+            exit(EXIT_FAILURE);
+        }
+        while ((entry = readdir(dir))) {
+            if (entry->d_name[0] == '.') continue;
+            snprintf(child, sizeof child, "%s/%s", path, entry->d_name);
+            run_path(child);
+        }
+        closedir(dir);
+        return;
+    }
+
+    if (!(file = fopen(path, "rb"))) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    run_input(path, file);
+    fclose(file);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2)
+        run_input("-", stdin);
+    for (int i = 1; i < argc; i++)
+        run_path(argv[i]);
+
+    printf("%zu inputs", driver_num_inputs);
+    if (driver_worst.path[0])
+        printf(", most work per byte: %s (%.2f bytes visited, %.3f callbacks)", driver_worst.path,
+               driver_worst.visits_per_byte, driver_worst.callbacks_per_byte);
+    printf("\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+#include "fuzz.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FUZZ_GLOSS_SIZE 64
+
+static struct FuzzWork fuzz_work;
+
+static volatile unsigned char fuzz_sink;
+
+// Reads every byte of a value, so that the sanitizers see reads out of the record.
+static void touch(const char *val, size_t val_size) {
+    unsigned char h = 0;
+    for (size_t i = 0; i < val_size; i++)
+        h ^= (unsigned char)val[i];
+    fuzz_sink = h;
+}
+
+static gsl_err_t run_touch(void *obj, const char *val, size_t val_size) {
+    (void)obj;
+    fuzz_work.callbacks++;
+    touch(val, val_size);
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t run_id(void *obj, const char *val, size_t val_size) {
+    size_t id;
+    (void)obj;
+    fuzz_work.callbacks++;
+    return gsl_run_set_size_t(&id, val, val_size);
+}
+
+// Example: {is Node3} -- an object without fields
+static gsl_err_t run_default(void *obj, const char *val, size_t val_size) {
+    (void)obj; (void)val; (void)val_size;
+    fuzz_work.callbacks++;
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t parse_text(void *obj, const char *rec, size_t *total_size) {
+    struct gslTaskSpec spec = { .name = "text", .name_size = strlen("text"), .run = run_touch, .obj = obj };
+    fuzz_work.callbacks++;
+    return gsl_parse_cdata(&spec, rec, total_size);
+}
+
+// Example: [!unknown a b c] -- any other SET array
+static gsl_err_t validate_array(void *obj, const char *name, size_t name_size, const char *rec,
+                                size_t *total_size) {
+    struct gslTaskSpec item_spec = { .is_list_item = true, .run = run_touch, .obj = obj };
+    fuzz_work.callbacks++;
+    touch(name, name_size);
+    return gsl_parse_array(&item_spec, rec, total_size);
+}
+
+static gsl_err_t parse_node(void *obj, const char *rec, size_t *total_size) {
+    struct gslTaskSpec tag_spec = { .is_list_item = true, .run = run_touch, .obj = obj };
+    struct gslTaskSpec rel_spec = { .is_list_item = true, .parse = parse_node, .obj = obj };
+    char gloss[FUZZ_GLOSS_SIZE];
+    size_t gloss_size = 0;
+    struct gslTaskSpec specs[] = {
+        { .is_implied = true, .run = run_touch, .obj = obj },
+        { .is_default = true, .run = run_default, .obj = obj },
+
+        { .name = "_gloss", .name_size = strlen("_gloss"), .run = run_touch, .obj = obj },
+        { .name = "id", .name_size = strlen("id"), .run = run_id, .obj = obj },
+        { .name = "text", .name_size = strlen("text"), .parse = parse_text, .obj = obj },
+        { .name = "is", .name_size = strlen("is"), .parse = parse_node, .obj = obj },
+        { .type = GSL_GET_ARRAY_STATE, .name = "tags", .name_size = strlen("tags"),
+          .parse = gsl_parse_array, .obj = &tag_spec },
+        { .type = GSL_GET_ARRAY_STATE, .name = "rel", .name_size = strlen("rel"),
+          .parse = gsl_parse_array, .obj = &rel_spec },
+
+        { .type = GSL_SET_STATE, .name = "_gloss", .name_size = strlen("_gloss"),
+          .buf = gloss, .buf_size = &gloss_size, .max_buf_size = sizeof gloss },
+        { .type = GSL_SET_STATE, .name = "id", .name_size = strlen("id"), .run = run_id, .obj = obj },
+        { .type = GSL_SET_STATE, .name = "text", .name_size = strlen("text"), .parse = parse_text, .obj = obj },
+        { .type = GSL_SET_STATE, .name = "is", .name_size = strlen("is"), .parse = parse_node, .obj = obj },
+        { .type = GSL_SET_ARRAY_STATE, .name = "tags", .name_size = strlen("tags"),
+          .parse = gsl_parse_array, .obj = &tag_spec },
+        { .type = GSL_SET_ARRAY_STATE, .name = "rel", .name_size = strlen("rel"),
+          .parse = gsl_parse_array, .obj = &rel_spec },
+        { .type = GSL_SET_ARRAY_STATE, .validate = validate_array, .obj = obj }
+    };
+    gsl_err_t err;
+
+    fuzz_work.callbacks++;
+    err = gsl_parse_task(rec, total_size, specs, sizeof specs / sizeof specs[0]);
+    touch(gloss, gloss_size);
+    return err;
+}
+
+gsl_err_t fuzz_parse_task(const char *rec, size_t *total_size) {
+    struct gslTaskSpec specs[] = {
+        { .name = "class", .name_size = strlen("class"), .parse = parse_node, .obj = &fuzz_work }
+    };
+    return gsl_parse_task(rec, total_size, specs, sizeof specs / sizeof specs[0]);
+}
+
+gsl_err_t fuzz_parse_array(const char *rec, size_t *total_size) {
+    struct gslTaskSpec spec = { .is_list_item = true, .run = run_touch, .obj = &fuzz_work };
+    return gsl_parse_array(&spec, rec, total_size);
+}
+
+gsl_err_t fuzz_parse_cdata(const char *rec, size_t *total_size) {
+    struct gslTaskSpec spec = { .name = "text", .name_size = strlen("text"), .run = run_touch, .obj = &fuzz_work };
+    return gsl_parse_cdata(&spec, rec, total_size);
+}
+
+static void fail(const char *what, const struct FuzzWork *work) {
+    fprintf(stderr, "fuzz: %s: size %zu callbacks %zu bytes_visited %zu total_size %zu code %d\n", what,
+            work->size, work->callbacks, work->bytes_visited, work->total_size, work->code);
+    abort();
+}
+
+void fuzz_one_input(fuzz_parse_t parse, const uint8_t *data, size_t size) {
+    char *rec = malloc(size + 1);
+    gsl_err_t err;
+
+    if (!rec) return;
+    memcpy(rec, data, size);
+    rec[size] = '\0';
+
+    memset(&fuzz_work, 0, sizeof fuzz_work);
+    fuzz_work.size = strlen(rec);
+    fuzz_work.total_size = (size_t)-1;
+
+    gsl_stats_reset();
+    err = parse(rec, &fuzz_work.total_size);
+    fuzz_work.code = err.code;
+    fuzz_work.bytes_visited = gsl_stats_get()->bytes_visited;
+    free(rec);
+
+    if (fuzz_work.total_size > fuzz_work.size)
+        fail("total_size is out of the record", &fuzz_work);
+    if (fuzz_work.size < FUZZ_MIN_CHECKED_SIZE)
+        return;
+    if (fuzz_work.bytes_visited > FUZZ_MAX_VISITS_PER_BYTE * fuzz_work.size)
+        fail("too many bytes visited", &fuzz_work);
+    if (fuzz_work.callbacks > FUZZ_MAX_CALLBACKS_PER_BYTE * fuzz_work.size)
+        fail("too many callbacks", &fuzz_work);
+}
+
+const struct FuzzWork *fuzz_last_work(void) {
+    return &fuzz_work;
+}
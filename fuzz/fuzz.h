@@ -0,0 +1,48 @@
+#pragma once
+
+// Fuzz targets of gsl_parse_task(), gsl_parse_array() and gsl_parse_cdata() with the spec
+// sets of the Knowdy-style schema of gsl_bench (see fuzz.c).  Besides crashes, every input
+// is checked for the work it takes: the bytes visited by the scanning loops of the parser
+// (gslStats.bytes_visited, needs GSL_WITH_STATS) and the callbacks per byte of input.
+// Linear parsing keeps both under small constants; an input over the limits aborts, so
+// the fuzzer keeps it as a crash.  Such inputs belong to the "hostile" workload of
+// gsl_bench (see bench/corpus.c).
+
+#include <gsl-parser.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Inputs shorter than this are not checked for work: constants dominate them.
+#define FUZZ_MIN_CHECKED_SIZE 64
+
+#ifndef FUZZ_MAX_VISITS_PER_BYTE
+#define FUZZ_MAX_VISITS_PER_BYTE 8
+#endif
+
+#ifndef FUZZ_MAX_CALLBACKS_PER_BYTE
+#define FUZZ_MAX_CALLBACKS_PER_BYTE 1
+#endif
+
+struct FuzzWork {
+    size_t size;           // of the input up to the first null byte
+    size_t callbacks;      // run, parse and validate calls of the spec sets
+    size_t bytes_visited;  // 0 without GSL_WITH_STATS
+    size_t total_size;     // reported by the parser
+    int code;              // of the parser
+};
+
+typedef gsl_err_t (*fuzz_parse_t)(const char *rec, size_t *total_size);
+
+// The spec sets: full records {class ...}, atomic array bodies " star orbit]" and cdata
+// bodies " {\"\"...\"\"}".
+gsl_err_t fuzz_parse_task(const char *rec, size_t *total_size);
+gsl_err_t fuzz_parse_array(const char *rec, size_t *total_size);
+gsl_err_t fuzz_parse_cdata(const char *rec, size_t *total_size);
+
+// Parses a null-terminated copy of |data| with |parse| and checks the result and the work.
+// Aborts on a violation.
+void fuzz_one_input(fuzz_parse_t parse, const uint8_t *data, size_t size);
+
+// Of the last fuzz_one_input() call, e.g. for driver.c to report the worst inputs.
+const struct FuzzWork *fuzz_last_work(void);
@@ -0,0 +1,10 @@
+// libFuzzer / AFL++ target of gsl_parse_array(), see fuzz.h.
+
+#include "fuzz.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    fuzz_one_input(fuzz_parse_array, data, size);
+    return 0;
+}
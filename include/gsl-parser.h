@@ -1,20 +1,285 @@
 #pragma once
 
+#include "gsl-parser/config.h"
+#include "gsl-parser/gsl_arena.h"
+#include "gsl-parser/gsl_batch.h"
+#include "gsl-parser/gsl_ctx.h"
 #include "gsl-parser/gsl_err.h"
+#include "gsl-parser/gsl_filter.h"
+#include "gsl-parser/gsl_ingest.h"
+#include "gsl-parser/gsl_object.h"
+#include "gsl-parser/gsl_pool.h"
+#include "gsl-parser/gsl_profile.h"
+#include "gsl-parser/gsl_projection.h"
+#include "gsl-parser/gsl_queue.h"
+#include "gsl-parser/gsl_reader.h"
+#include "gsl-parser/gsl_sax.h"
+#include "gsl-parser/gsl_scan.h"
+#include "gsl-parser/gsl_stats.h"
 #include "gsl-parser/gsl_task_spec.h"
+#include "gsl-parser/gsl_trace.h"
+#include "gsl-parser/gsl_xobject.h"
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 
 // obj of type size_t*
-extern gsl_err_t gsl_run_set_size_t(void *obj, const char *val, size_t val_size);
-extern gsl_err_t gsl_parse_size_t(void *obj, const char *rec, size_t *total_size);
+extern GSL_API gsl_err_t gsl_run_set_size_t(void *obj, const char *val, size_t val_size);
+extern GSL_API gsl_err_t gsl_parse_size_t(void *obj, const char *rec, size_t *total_size);
 
 // obj of type gslTaskSpec*
-extern gsl_err_t gsl_parse_array(void *obj, const char *rec, size_t *total_size);
+extern GSL_API gsl_err_t gsl_parse_array(void *obj, const char *rec, size_t *total_size);
 
 // obj of type gslTaskSpec*
-extern gsl_err_t gsl_parse_cdata(void *obj, const char *rec, size_t *total_size);
+extern GSL_API gsl_err_t gsl_parse_cdata(void *obj, const char *rec, size_t *total_size);
 
-extern gsl_err_t gsl_parse_task(const char *rec, size_t *total_size,
-                                struct gslTaskSpec *specs, size_t num_specs);
+extern GSL_API gsl_err_t gsl_parse_task(const char *rec, size_t *total_size,
+                                        struct gslTaskSpec *specs, size_t num_specs);
 
+// Scans |rec| like gsl_parse_task() does, up to the unmatched closing brace or the end,
+// but reports what it finds to |handler| instead of matching it with specs.  Every field
+// is checked to be closed by a matching brace, nothing else is validated.
+extern GSL_API gsl_err_t gsl_sax_parse(const char *rec, size_t *total_size, const struct gslSaxHandler *handler);
+
+// The same scan event by event, see gsl_reader.h.  gsl_next() fills |event| and returns
+// gsl_OK until the scan ends with GSL_EVENT_END, or an error; it returns the same from
+// then on.  Stopping early needs no cleanup.
+extern GSL_API void gsl_reader_init(struct gslReader *self, const char *rec);
+extern GSL_API gsl_err_t gsl_next(struct gslReader *self, struct gslEvent *event);
+// Skips the rest of the innermost open field or "{...}" item by its braces alone: the next
+// gsl_next() gives its GSL_EVENT_FIELD_CLOSE.  Out of any field, skips to the end.
+extern GSL_API gsl_err_t gsl_reader_skip(struct gslReader *self);
+
+// Compiles |paths| (see gsl_projection.h) for gsl_parse_projection().  Returns gsl_INVALID
+// for a malformed path or a NULL callback, gsl_EXISTS for a path given twice, with the
+// path in the description.  A NULL path is gsl_INVALID without a description.
+extern GSL_API gsl_err_t gsl_projection_create(const struct gslPath *paths, size_t num_paths,
+                                               struct gslProjection **projection);
+extern GSL_API void gsl_projection_destroy(struct gslProjection *self);
+// Scans |rec| like gsl_sax_parse() does and calls back only for the fields on the paths of
+// |projection|.  Every other field is skipped by gsl_reader_skip(): its braces are checked
+// to match, and nothing else is looked at.
+extern GSL_API gsl_err_t gsl_parse_projection(const char *rec, size_t *total_size,
+                                              const struct gslProjection *projection);
+
+// Compiles |preds| (see gsl_filter.h) for gsl_filter_match().  Returns gsl_LIMIT for more
+// than GSL_FILTER_MAX_PREDICATES, gsl_INVALID for a malformed path or a missing |val|,
+// with the path in the description.  A NULL path is gsl_INVALID without a description.
+extern GSL_API gsl_err_t gsl_filter_create(const struct gslPredicate *preds, size_t num_preds,
+                                           struct gslFilter **filter);
+extern GSL_API void gsl_filter_destroy(struct gslFilter *self);
+// Checks that |rec| meets all the predicates of |filter|: gsl_OK or gsl_NO_MATCH.  Scans
+// as gsl_parse_projection() does, along the paths of the predicates, and stops as soon as
+// the record is decided either way: |*total_size| is where, e.g. the value which doesn't
+// match.  The rest of the record is not checked.
+extern GSL_API gsl_err_t gsl_filter_match(const char *rec, size_t *total_size, const struct gslFilter *filter);
+// gsl_parse_task() of |rec| if it matches |filter|, otherwise gsl_NO_MATCH before any
+// callback of |specs| is called.
+extern GSL_API gsl_err_t gsl_parse_task_filtered(const struct gslFilter *filter, const char *rec, size_t *total_size,
+                                                 struct gslTaskSpec *specs, size_t num_specs);
+
+// |options| can be NULL, the allocator is malloc()/free() until replaced.
+extern GSL_API void gsl_ctx_init(struct gslCtx *self, const struct gslCtxOptions *options);
+// Zeroes the stats and the error info.
+extern GSL_API void gsl_ctx_reset(struct gslCtx *self);
+
+// Runs |parse| of |obj| on |rec| under |self|: the nested parser calls count the depth
+// against |self->options|, their stats go to |self->stats| (and to the thread ones), and
+// a failure is described in |self->error|.  |*total_size| is 0 until |parse| sets it.
+// Called with the context of the running parse (by a callback), it's just |parse|.
+extern GSL_API gsl_err_t gsl_ctx_parse(struct gslCtx *self,
+                                       gsl_err_t (*parse)(void *obj, const char *rec, size_t *total_size), void *obj,
+                                       const char *rec, size_t *total_size);
+// gsl_parse_task() under |self|.
+extern GSL_API gsl_err_t gsl_ctx_parse_task(struct gslCtx *self, const char *rec, size_t *total_size,
+                                            struct gslTaskSpec *specs, size_t num_specs);
+
+// Context of the parse the calling thread runs, for the callbacks.  NULL outside of
+// gsl_ctx_parse().
+extern GSL_API struct gslCtx *gsl_ctx_current(void);
+extern GSL_API void *gsl_ctx_alloc(struct gslCtx *self, size_t size);
+extern GSL_API void gsl_ctx_free(struct gslCtx *self, void *ptr);
+
+// Finds boundaries of the concatenated top-level records in |rec| of |rec_size| bytes.
+// |total_size| is set to the offset the next call should start from: either the end of
+// the input, or the beginning of an incomplete record (wait for more data), or the first
+// record which didn't fit into |records| (gsl_LIMIT is returned in this case).
+extern GSL_API gsl_err_t gsl_split_records(const char *rec, size_t rec_size,
+                                           struct gslRecord *records, size_t max_records,
+                                           size_t *num_records, size_t *total_size);
+
+// Checks the structure of the concatenated top-level records in |rec| of |rec_size| bytes
+// without any specs or callbacks: braces are balanced and matched, '!' goes right before
+// a tag or a comment, comments and cdata are closed by as many dashes or quotes as they
+// are opened with, nothing is deeper than GSL_READER_MAX_DEPTH (gsl_LIMIT), and there is
+// nothing but spaces between the records.  Tags and values are not looked at.  Returns
+// gsl_FORMAT otherwise, an incomplete last record included; |total_size| is set to the
+// offset of the error, or to |rec_size|.
+extern GSL_API gsl_err_t gsl_validate(const char *rec, size_t rec_size, size_t *total_size);
+
+// Parses |records| on |num_workers| threads (the calling thread is one of them).
+// |errs| is optional, it receives a status of each record.  Returns the error of the
+// first failed record or gsl_OK.
+extern GSL_API gsl_err_t gsl_parse_batch(const struct gslRecord *records, size_t num_records,
+                                         struct gslBatchWorker *workers, size_t num_workers,
+                                         gsl_err_t *errs);
+
+// Same on the workers of |pool|: |workers| has gsl_pool_num_workers() items, and the
+// worker number i of the pool parses by |workers[i]| under gsl_pool_ctx(pool, i).  The
+// records are split in halves rather than picked one by one, so an idle worker steals the
+// largest range left.  Can be called from a task of |pool|.
+extern GSL_API gsl_err_t gsl_parse_batch_pool(struct gslPool *pool, const struct gslRecord *records, size_t num_records,
+                                              struct gslBatchWorker *workers, gsl_err_t *errs);
+
+// gsl_parse_task() of one huge record on the workers of |pool|.  Its top-level fields are
+// found in parallel by their braces, as gsl_validate() does, and are split into ranges of
+// about the same size.  The ranges are parsed in parallel with copies of |specs| under the
+// contexts of the workers; then |is_completed| of the copies is merged into |specs|, the
+// values of buf specs are copied in the order of the record, and the default spec is run
+// if nothing is completed.  The result and |*total_size| are those of gsl_parse_task(),
+// except that on an error the fields after the failed one can be handled already.
+//
+// The callbacks of |specs| are called from several threads at once, the same callback for
+// the fields of different ranges.  The braces are counted up to the '\0' of |rec|, and a
+// callback which parses its value by itself must agree with them.  A record shorter than
+// GSL_POOL_MIN_TASK_SIZE goes to gsl_parse_task() right away.  Can be called from a task
+// of |pool|, e.g. by the callback of a huge field.
+extern GSL_API gsl_err_t gsl_parse_task_pool(struct gslPool *pool, const char *rec, size_t *total_size,
+                                             struct gslTaskSpec *specs, size_t num_specs);
+
+// Starts the workers of a pool.  |options| can be NULL.
+extern GSL_API gsl_err_t gsl_pool_create(const struct gslPoolOptions *options, struct gslPool **pool);
+// Stops the workers.  Every group must be waited for before.
+extern GSL_API void gsl_pool_destroy(struct gslPool *self);
+extern GSL_API size_t gsl_pool_num_workers(const struct gslPool *self);
+// Number of the pool worker the calling thread is, or SIZE_MAX.
+extern GSL_API size_t gsl_pool_worker_idx(void);
+// Arena and context of the worker number |worker_idx|.  A task uses the ones of its worker
+// without locks; others should touch them only while the pool is idle, e.g. to reset the
+// arenas or to sum up the stats after a batch.
+extern GSL_API struct gslArena *gsl_pool_arena(struct gslPool *self, size_t worker_idx);
+extern GSL_API struct gslCtx *gsl_pool_ctx(struct gslPool *self, size_t worker_idx);
+
+// Queues |task| of |group|.  From a worker of |self| (e.g. a callback splitting off large
+// array items or independent subtrees) it goes to the deque of the worker, otherwise to
+// the queue of the pool.
+extern GSL_API void gsl_pool_submit(struct gslPool *self, struct gslPoolGroup *group, struct gslPoolTask *task);
+// Returns when all the tasks of |group| are done.  A worker runs the tasks of |group| that
+// are not stolen yet and waits for the rest, so the groups of a worker are waited for in
+// the reverse order of their submission.
+extern GSL_API void gsl_pool_wait(struct gslPool *self, struct gslPoolGroup *group);
+
+// Queues of |capacity| (rounded up to a power of 2) items of |item_size| bytes.  A
+// blocking push waits while the queue is full and returns false once it's closed.  A pop
+// takes up to |max_items| items at once into |items|: a blocking one waits while the
+// queue is empty, and returns 0 once it's closed and drained.  Close a queue after the
+// last push to let the consumers finish.
+extern GSL_API gsl_err_t gsl_spsc_create(size_t capacity, size_t item_size, struct gslSpscQueue **queue);
+extern GSL_API void gsl_spsc_destroy(struct gslSpscQueue *self);
+extern GSL_API bool gsl_spsc_try_push(struct gslSpscQueue *self, const void *item);
+extern GSL_API bool gsl_spsc_push(struct gslSpscQueue *self, const void *item);
+extern GSL_API size_t gsl_spsc_try_pop(struct gslSpscQueue *self, void *items, size_t max_items);
+extern GSL_API size_t gsl_spsc_pop(struct gslSpscQueue *self, void *items, size_t max_items);
+extern GSL_API void gsl_spsc_close(struct gslSpscQueue *self);
+
+extern GSL_API gsl_err_t gsl_mpmc_create(size_t capacity, size_t item_size, struct gslMpmcQueue **queue);
+extern GSL_API void gsl_mpmc_destroy(struct gslMpmcQueue *self);
+extern GSL_API bool gsl_mpmc_try_push(struct gslMpmcQueue *self, const void *item);
+extern GSL_API bool gsl_mpmc_push(struct gslMpmcQueue *self, const void *item);
+extern GSL_API size_t gsl_mpmc_try_pop(struct gslMpmcQueue *self, void *items, size_t max_items);
+extern GSL_API size_t gsl_mpmc_pop(struct gslMpmcQueue *self, void *items, size_t max_items);
+extern GSL_API void gsl_mpmc_close(struct gslMpmcQueue *self);
+
+// Reads |paths| asynchronously and parses their records on |num_workers| threads while
+// the next buffers are being read.  |options| can be NULL.  Records are numbered
+// across all the files in order.  Stops at the first error and returns it.
+extern GSL_API gsl_err_t gsl_ingest_files(const char *const *paths, size_t num_paths,
+                                          const struct gslIngestOptions *options,
+                                          struct gslBatchWorker *workers, size_t num_workers);
+
+// Same with the third stage: |parse| of the workers passes its results (e.g. decoded
+// objects) to gsl_ingest_emit(), and |num_consumers| threads take them from there.  The
+// stages are connected by lock-free queues, and a full queue holds the previous stage back.
+extern GSL_API gsl_err_t gsl_ingest_pipeline(const char *const *paths, size_t num_paths,
+                                             const struct gslIngestOptions *options,
+                                             struct gslBatchWorker *workers, size_t num_workers,
+                                             struct gslIngestConsumer *consumers, size_t num_consumers);
+
+// From |parse| of a worker of gsl_ingest_pipeline(): queues |out| for a consumer, waiting
+// while the queue is full.  Fails with gsl_FAIL out of a pipeline with consumers, and
+// after an error of the pipeline; |out| isn't passed to a consumer then.
+extern GSL_API gsl_err_t gsl_ingest_emit(void *out);
+
+// Name of the I/O backend of gsl_ingest_files(): "io_uring" or "pread", the one the last
+// ingestion has actually taken.  Before the first one, "io_uring" if the library is built
+// with liburing and a ring can be set up right now, else "pread".
+extern GSL_API const char *gsl_ingest_backend(void);
+
+// |chunk_size| of 0 selects the default.
+extern GSL_API void gsl_arena_init(struct gslArena *self, size_t chunk_size);
+// Same with the chunks allocated by |allocator|, e.g. of gsl_ctx_current().  It must
+// outlive the arena.
+extern GSL_API void gsl_arena_init_allocator(struct gslArena *self, size_t chunk_size,
+                                             const struct gslAllocator *allocator);
+extern GSL_API void *gsl_arena_alloc(struct gslArena *self, size_t size);
+extern GSL_API gsl_err_t gsl_arena_set_str(struct gslArena *self, struct gslStr *str,
+                                           const char *val, size_t val_size);
+// Releases all the strings, but keeps one chunk for reuse.
+extern GSL_API void gsl_arena_reset(struct gslArena *self);
+extern GSL_API void gsl_arena_free(struct gslArena *self);
+
+// Parses the fields of |obj| described by |spec|.  |rec| points inside of a record,
+// e.g. after "{user".  |obj| is zeroed first.  |arena| is needed only for
+// GSL_FIELD_ARENA_STR fields, and it keeps their strings.
+extern GSL_API gsl_err_t gsl_parse_object(const struct gslObjectSpec *spec, void *obj, struct gslArena *arena,
+                                          const char *rec, size_t *total_size);
+
+// Same for a whole record tagged with |spec->tag|, e.g. "{user John {sid 1}}".
+extern GSL_API gsl_err_t gsl_parse_object_record(const struct gslObjectSpec *spec, void *obj, struct gslArena *arena,
+                                                 const char *rec, size_t *total_size);
+
+// Emitters append to |self|, each value is preceded by a space.  Values which wouldn't
+// be parsed back the same (empty, with braces, with leading/trailing spaces; list items
+// also with spaces and dashes) fail with gsl_FORMAT, overflow fails with gsl_LIMIT.
+extern GSL_API void gsl_emit_raw(struct gslEmitter *self, const char *val, size_t val_size);
+extern GSL_API void gsl_emit_value(struct gslEmitter *self, const char *val, size_t val_size);
+extern GSL_API void gsl_emit_item(struct gslEmitter *self, const char *val, size_t val_size);
+extern GSL_API void gsl_emit_size_t(struct gslEmitter *self, size_t val);
+
+// true if the library is built with GSL_WITH_CHECKS, i.e. malformed specs fail the parsing
+// with gsl_INVALID.  Otherwise they are trusted, and the behavior on them is undefined.
+extern GSL_API bool gsl_checks_enabled(void);
+
+// true if the library is built with GSL_WITH_STATS, i.e. the parser fills gslStats.
+extern GSL_API bool gsl_stats_enabled(void);
+// Stats of the parsing done by the calling thread since the last gsl_stats_reset().
+extern GSL_API const struct gslStats *gsl_stats_get(void);
+extern GSL_API void gsl_stats_reset(void);
+// Adds |other| to |self|, e.g. to aggregate the stats of several threads.
+extern GSL_API void gsl_stats_add(struct gslStats *self, const struct gslStats *other);
+
+// Turns the binary trace on for every thread, see gsl_trace.h.  Each thread keeps the last
+// |max_events| (rounded up to a power of 2) events.  Call it between parses.
+extern GSL_API gsl_err_t gsl_trace_enable(size_t max_events);
+extern GSL_API void gsl_trace_disable(void);
+// Forgets the events of the calling thread, e.g. before the next record.
+extern GSL_API void gsl_trace_reset(void);
+// Copies up to |max_events| last events of the calling thread, the oldest first.
+extern GSL_API size_t gsl_trace_events(struct gslTraceEvent *events, size_t max_events);
+// Decodes the events of the calling thread into |file|.  |rec| is the outermost record the
+// offsets point into, it's quoted if not NULL.
+extern GSL_API void gsl_trace_dump(FILE *file, const char *rec);
+
+// true if the library is built with GSL_WITH_PROFILE, i.e. the callbacks are timed.
+extern GSL_API bool gsl_profile_enabled(void);
+// Adds the profile of the calling thread to the process-wide one.  The workers of
+// gsl_parse_batch() and gsl_ingest_files() do it when they finish; call it before a
+// thread of yours that parses exits.
+extern GSL_API void gsl_profile_flush(void);
+extern GSL_API void gsl_profile_reset(void);
+// Copies up to |max_entries| entries of the process-wide profile (with the calling
+// thread flushed), the highest self time first.
+extern GSL_API size_t gsl_profile_entries(struct gslProfileEntry *entries, size_t max_entries);
+// Writes gsl_profile_entries() as a table to |file|.
+extern GSL_API void gsl_profile_report(FILE *file);
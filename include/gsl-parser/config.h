@@ -2,3 +2,11 @@
 
 #define GSL_NUM_ENCODE_BASE 10
 
+
+// The functions of the public headers.  The shared library is built with hidden
+// visibility, and exports nothing else.
+#if defined(__GNUC__)
+#define GSL_API __attribute__((visibility("default")))
+#else
+#define GSL_API
+#endif
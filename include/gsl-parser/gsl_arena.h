@@ -0,0 +1,21 @@
+#pragma once
+
+#include "gsl-parser/gsl_ctx.h"
+
+#include <stddef.h>
+
+struct gslArenaChunk;
+
+// Bump allocator for strings of parsed objects.  Everything is released at once by
+// gsl_arena_reset() or gsl_arena_free().
+struct gslArena {
+    struct gslArenaChunk *chunks;  // the newest first
+    size_t chunk_size;
+    const struct gslAllocator *allocator;  // of the chunks, NULL for malloc()
+};
+
+// Null-terminated string stored in an arena.
+struct gslStr {
+    const char *str;
+    size_t size;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "gsl-parser/gsl_err.h"
+#include "gsl-parser/gsl_stats.h"
+
+#include <stddef.h>
+
+// A single top-level "{...}" record found in a stream of concatenated records.
+struct gslRecord {
+    const char *rec;
+    size_t rec_size;
+};
+
+// Parser worker of gsl_parse_batch().  Every worker owns its |obj| (and thus its
+// own spec/object set), so |parse| is never called concurrently for the same worker.
+struct gslBatchWorker {
+    void *obj;
+
+    // |rec| is a null-terminated copy of the record number |rec_idx|.
+    gsl_err_t (*parse)(void *obj, size_t rec_idx, const char *rec, size_t *total_size);
+
+    // Sum of the stats of the records parsed by this worker, see gsl_stats.h.
+    struct gslStats stats;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "gsl-parser/gsl_err.h"
+#include "gsl-parser/gsl_stats.h"
+
+#include <stddef.h>
+
+// Memory of the callbacks and of the arenas initialized with gsl_arena_init_allocator().
+struct gslAllocator {
+    void *(*alloc)(void *state, size_t size);
+    void (*free)(void *state, void *ptr);
+    void *state;
+};
+
+struct gslCtxOptions {
+    size_t max_depth;  // of the nested gsl_parse_task(), gsl_parse_array() and gsl_parse_cdata() calls,
+                       // deeper ones fail with gsl_LIMIT; 0 for no limit
+};
+
+#define GSL_CTX_MAX_ERR_DESC_SIZE 64
+
+// Where the last failed parse under a context failed: the innermost parser call the
+// error propagated from.
+struct gslCtxError {
+    int code;         // gsl_OK if the last parse succeeded
+    size_t offset;    // in the outermost record, e.g. of the unknown tag
+    size_t depth;     // of the failed call, 1 for the outermost one
+    // Example: "nick" for gsl_NO_MATCH, or a failed condition for gsl_INVALID
+    char desc[GSL_CTX_MAX_ERR_DESC_SIZE];  // a copy of gsl_err_t.val, truncated, not null-terminated
+    size_t desc_size;
+};
+
+// State of the parses run by gsl_ctx_parse() and gsl_ctx_parse_task().  Nothing of it is
+// shared: a thread parses under one context at a time, and contexts of different threads
+// are independent.  Every parser call nested into the parse (by the callbacks of the
+// specs) runs under the same context, and the callbacks reach it by gsl_ctx_current().
+struct gslCtx {
+    struct gslCtxOptions options;
+    struct gslAllocator allocator;
+    void *user;                // for the callbacks
+
+    struct gslStats stats;     // sum of the parses under this context, see gsl_stats.h
+    struct gslCtxError error;
+
+    // Private.
+    const char *rec;           // the outermost record being parsed
+    size_t depth;
+    struct gslCtx *outer;      // of the calling thread, if the parse is nested into another one
+};
@@ -4,7 +4,7 @@
 
 /* error codes */
 typedef enum { gsl_OK, gsl_FAIL, gsl_LIMIT, gsl_NO_MATCH, gsl_FORMAT,
-               gsl_EXISTS, gsl_EXTERNAL = 0x7f000000 }
+               gsl_EXISTS, gsl_INVALID, gsl_EXTERNAL = 0x7f000000 }
   gsl_err_codes_t;
 
 typedef struct {
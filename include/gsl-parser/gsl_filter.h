@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+
+// Most predicates a filter can have.
+#define GSL_FILTER_MAX_PREDICATES 64
+
+typedef enum {
+    GSL_PREDICATE_EXISTS,    // there is a field on |path|
+    GSL_PREDICATE_EQUALS,    // its value is |val|
+    GSL_PREDICATE_PREFIX,    // its value starts with |val|
+    GSL_PREDICATE_RANGE,     // its value is a number from |min| to |max| inclusive
+    GSL_PREDICATE_CONTAINS   // the array on |path| has an atomic item |val|
+} gsl_predicate_type;
+
+// A condition on the fields of a record, checked by gsl_filter_match() while it scans.
+// |path| is as of gslPath, e.g. "user/contacts/email" or "user/groups[]/gid".  The value
+// of a field is its terminal value or cdata, e.g. "a@b.c" of "{email a@b.c}", or the
+// atomic item on a "[]" path: a field with nested fields has none and doesn't match.
+//
+// Fields are unique in a record, so the first one on a path decides a predicate: the
+// record is dropped right there if its value doesn't match, or at the close of the
+// innermost field of the path which is there, if it isn't.  Through "[]" any item can
+// match, and the predicate is decided at the close of the array.
+struct gslPredicate {
+    const char *path;
+    gsl_predicate_type type;
+    const char *val;    // EQUALS, PREFIX and CONTAINS
+    double min, max;    // RANGE
+};
+
+// The predicates compiled into a trie of their paths, see gsl_filter_create().
+// Immutable: one filter can be used by many threads at once.
+struct gslFilter;
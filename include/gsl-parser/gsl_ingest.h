@@ -0,0 +1,25 @@
+#pragma once
+
+#include "gsl-parser/gsl_err.h"
+
+#include <stddef.h>
+
+// Options of gsl_ingest_files().  Zero fields are replaced with defaults.
+struct gslIngestOptions {
+    size_t buf_size;         // bytes read at once, default is 1 MiB
+    size_t max_record_size;  // longest part of a record carried to the next buffer, default is |buf_size|
+    size_t num_bufs;         // buffers in flight (read-ahead depth), at least 2, default is 8
+    size_t num_io_threads;   // readers of the pread() fallback, default is 2
+    size_t queue_size;       // records waiting for parser workers, default is 4096
+    size_t out_queue_size;   // outputs waiting for consumers, default is 4096
+    size_t batch_size;       // records or outputs a thread takes from a queue at once, default is 16
+};
+
+// Consumer thread of gsl_ingest_pipeline().  Every output passed to gsl_ingest_emit()
+// reaches one of the consumers, even after an error, so |consume| can release it.
+struct gslIngestConsumer {
+    void *obj;
+
+    // |outs| come from all the workers, in no particular order.
+    gsl_err_t (*consume)(void *obj, void *const *outs, size_t num_outs);
+};
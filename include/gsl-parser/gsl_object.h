@@ -0,0 +1,55 @@
+#pragma once
+
+#include "gsl-parser/gsl_err.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Static description of a C struct, normally generated from a schema (see
+// tools/gsl_schema_gen.c).  gsl_parse_object() turns it into task specs.
+
+#define GSL_OBJECT_MAX_FIELDS 32
+
+typedef enum { GSL_FIELD_STR, GSL_FIELD_ARENA_STR, GSL_FIELD_SIZE_T, GSL_FIELD_OBJECT } gsl_field_kind;
+
+// Maps a tag to the index of its field, or returns -1.
+typedef int (*gsl_spec_lookup_t)(const char *name, size_t name_size);
+
+struct gslObjectSpec;
+
+struct gslFieldSpec {
+    const char *name;
+    size_t name_size;
+    gsl_field_kind kind;
+
+    bool is_implied;
+    bool is_list;
+
+    size_t offset;        // of the value, or of the first list item
+    size_t size_offset;   // of the size_t size of GSL_FIELD_STR (of the array of sizes for lists)
+    size_t count_offset;  // of the size_t number of list items
+    size_t item_size;     // distance between list items
+    size_t max_items;
+    size_t max_size;      // capacity of GSL_FIELD_STR, limit of GSL_FIELD_ARENA_STR (0 - none)
+
+    const struct gslObjectSpec *object;  // of GSL_FIELD_OBJECT
+};
+
+struct gslObjectSpec {
+    const char *tag;
+    size_t tag_size;
+    size_t size;  // sizeof the struct
+
+    const struct gslFieldSpec *fields;
+    size_t num_fields;
+
+    gsl_spec_lookup_t lookup;  // optional
+};
+
+// Output buffer of the emitters.  Output stops at the first error, which is kept.
+struct gslEmitter {
+    char *buf;
+    size_t size;
+    size_t max_size;
+    gsl_err_t err;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "gsl-parser/gsl_ctx.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Work-stealing thread pool.  Every worker has a deque of tasks: it pushes and pops the
+// tasks it submits at the bottom, and an idle worker steals the oldest (usually the
+// largest) task from the top of another one.  So a worker stuck in a huge record doesn't
+// hold the rest of the batch, and the parts it splits off are picked up by idle cores.
+struct gslPool;
+
+// Records shorter than that are parsed by gsl_parse_task_pool() right in the calling thread.
+#define GSL_POOL_MIN_TASK_SIZE (1 << 20)
+// Ranges of the top-level fields per worker in gsl_parse_task_pool(), so a range of a few
+// large fields doesn't keep the rest of the workers waiting for it.
+#define GSL_POOL_TASK_RANGES_PER_WORKER 4
+
+// Options of gsl_pool_create().  Zero fields are replaced with defaults.
+struct gslPoolOptions {
+    size_t num_workers;         // default is the number of online CPUs
+    bool pin;                   // worker #i runs on CPU #(first_cpu + i) only
+    size_t first_cpu;
+    size_t arena_chunk_size;    // of the arenas of the workers, see gsl_arena_init()
+    struct gslCtxOptions ctx_options;  // of the contexts of the workers
+};
+
+struct gslPoolGroup;
+
+// Intrusive task: embed it into the state of the task, |run| gets its address back.
+// It's owned by the caller until |run| returns.
+struct gslPoolTask {
+    void (*run)(struct gslPoolTask *self);
+
+    // Private.
+    struct gslPoolGroup *group;
+    struct gslPoolTask *next;  // of the queue of the tasks submitted by other threads
+};
+
+// Tasks being waited for together, see gsl_pool_wait().  Zero-initialized.
+struct gslPoolGroup {
+    atomic_size_t num_pending;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Time spent in the callbacks of specs by tag, filled when the library is built with
+// GSL_WITH_PROFILE.  Every run/parse/validate call is timed; the time of the callbacks
+// nested into it (e.g. the fields of a parsed object) is its child time, the rest is
+// its self time.  So the self times of all the tags add up to the time spent in the
+// callbacks, and a slow consumer callback stands out at the top of the report.
+typedef enum { GSL_PROFILE_RUN, GSL_PROFILE_PARSE, GSL_PROFILE_VALIDATE } gsl_profile_kind_t;
+
+#define GSL_PROFILE_MAX_TAG_SIZE 32
+
+struct gslProfileEntry {
+    // Example: "name", or "groups[]" for the items of a list, or "(implied)", "(default)"
+    char tag[GSL_PROFILE_MAX_TAG_SIZE];  // truncated, not null-terminated
+    size_t tag_size;
+    gsl_profile_kind_t kind;
+
+    size_t calls;
+    uint64_t total_ns;  // with the nested callbacks
+    uint64_t self_ns;
+};
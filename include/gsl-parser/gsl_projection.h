@@ -0,0 +1,27 @@
+#pragma once
+
+#include "gsl-parser/gsl_err.h"
+
+#include <stddef.h>
+
+// A field to pick out of a record by gsl_parse_projection(): the tags of the fields it is
+// nested in from the top of the record, separated by '/'.  "[]" after a tag stands for the
+// items of the array, e.g. "user/groups[]" for "audio" and "sudo" of
+// "{user [groups audio sudo]}", and the path can go on into "{...}" items:
+// "user/groups[]/name".  '!' of the record doesn't matter, "user" is also "{!user" and
+// "[user".
+//
+// |run| gets the body of the field as it is in the record, without the surrounding spaces:
+// the value of "{email a@b.c}", "{name John} {sid 1}" of "{user {name John} {sid 1}}", or
+// the body of a "{...}" item.  Fields with nested fields can be passed further to
+// gsl_parse_task(), and nested paths are visited after |run| of their parent.  It's run
+// for every field on the path, e.g. for every item.
+struct gslPath {
+    const char *path;
+    void *obj;
+    gsl_err_t (*run)(void *obj, const char *val, size_t val_size);
+};
+
+// The paths compiled into a trie, see gsl_projection_create().  Immutable: one projection
+// can be used by many threads at once.
+struct gslProjection;
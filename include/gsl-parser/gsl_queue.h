@@ -0,0 +1,12 @@
+#pragma once
+
+// Bounded lock-free queues of fixed-size items, copied in and out by value.  Both a full
+// and an empty queue make the blocking calls spin for a while and then sleep, so a fast
+// stage is held back by a slow one instead of buffering without limit.
+//
+// gslSpscQueue is a ring for one producer and one consumer thread: a push or a pop is a
+// copy and a release store.  gslMpmcQueue takes any number of both: every slot carries a
+// sequence number, a thread claims a slot by a CAS on the head or on the tail, and threads
+// never wait for each other unless the queue is full or empty.
+struct gslSpscQueue;
+struct gslMpmcQueue;
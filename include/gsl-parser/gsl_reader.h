@@ -0,0 +1,64 @@
+#pragma once
+
+#include "gsl-parser/gsl_err.h"
+#include "gsl-parser/gsl_task_spec.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Deepest nesting of fields and array items a gslReader accepts, deeper records fail with
+// gsl_LIMIT.
+#define GSL_READER_MAX_DEPTH 256
+
+typedef enum {
+    GSL_EVENT_END,          // the end of the record, or the closing brace of the enclosing field
+    GSL_EVENT_FIELD_OPEN,   // "{tag", "{!tag", "[tag" or "[!tag": |kind| and the tag in |val|
+    GSL_EVENT_FIELD_CLOSE,  // of the innermost open field or "{...}" item, with its |kind|
+    GSL_EVENT_TERMINAL,     // value of a field without nested fields, e.g. "John" of "{name John}"
+    GSL_EVENT_IMPLIED,      // value next to nested fields, e.g. "jsmith" of "{user jsmith {name...}}",
+                            // and any value out of a field
+    GSL_EVENT_CDATA,        // Example: "a}b" of "{bio {\"a}b\"}}"
+    GSL_EVENT_ARRAY_ITEM    // atomic item, or NULL |val| for a "{...}" item: the events of its
+                            // contents and GSL_EVENT_FIELD_CLOSE of GSL_GET_STATE follow
+} gsl_event_type;
+
+struct gslEvent {
+    gsl_event_type type;
+    gsl_task_spec_type kind;  // of GSL_EVENT_FIELD_OPEN and GSL_EVENT_FIELD_CLOSE
+    const char *val;          // into the record, without the surrounding spaces
+    size_t val_size;
+    const char *pos;          // where the event starts in the record, e.g. its opening brace
+};
+
+// Private, see gslReader: an open "{tag" or "[tag", or a "{" of an array item.
+struct gslReaderLevel {
+    unsigned char kind;  // gsl_task_spec_type
+    bool is_array;
+    bool is_tagged;      // not an array item, nor the record: its value can be terminal
+    bool has_children;   // nested fields, items or cdata: its values are implied
+};
+
+// Pull-style scan of a record: the caller asks for the events one by one by gsl_next(),
+// so it keeps its state in local variables rather than behind |obj| of callbacks, and
+// stops wherever it likes.  The same events as of gsl_sax_parse(), with no spec tables
+// and no allocations: the reader lives on the stack of the caller.
+//
+// Example:
+//   struct gslReader reader;
+//   struct gslEvent event;
+//   gsl_reader_init(&reader, "{user {name John} [groups audio]}");
+//   while (!(err = gsl_next(&reader, &event)).code && event.type != GSL_EVENT_END) {
+//       if (event.type == GSL_EVENT_TERMINAL && reader.depth == 2)
+//           ...  // "John"
+//   }
+struct gslReader {
+    const char *rec;
+    const char *pos;  // where the next gsl_next() starts; after GSL_EVENT_END or an error, where
+                      // the scan stopped, i.e. rec + total_size of gsl_parse_task()
+    size_t depth;     // of the open fields and "{...}" items
+
+    // Private.
+    gsl_err_t err;
+    bool is_done;
+    struct gslReaderLevel levels[GSL_READER_MAX_DEPTH + 1];
+};
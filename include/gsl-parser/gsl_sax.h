@@ -0,0 +1,44 @@
+#pragma once
+
+#include "gsl-parser/gsl_err.h"
+#include "gsl-parser/gsl_reader.h"
+#include "gsl-parser/gsl_task_spec.h"
+
+#include <stddef.h>
+
+// Deepest nesting of fields and array items gsl_sax_parse() accepts, deeper records fail
+// with gsl_LIMIT.
+#define GSL_SAX_MAX_DEPTH GSL_READER_MAX_DEPTH
+
+// Events of gsl_sax_parse(), for consumers which don't know the tags ahead of time, e.g.
+// indexers, converters or loggers.  Every callback can be NULL, and an error returned by
+// one of them stops the scan.  Values point into the record, without the surrounding spaces.
+// A loop over gsl_next() (see gsl_reader.h) which calls back on every event.
+//
+// Example: "{user jsmith {name John Smith} [groups audio {sudo}] {bio {\"a}b\"}}}" gives
+//   on_field_open(GSL_GET_STATE, "user")
+//   on_implied("jsmith")
+//   on_field_open(GSL_GET_STATE, "name"), on_terminal("John Smith"), on_field_close(GSL_GET_STATE)
+//   on_field_open(GSL_GET_ARRAY_STATE, "groups"), on_array_item("audio"),
+//     on_array_item(NULL), on_implied("sudo"), on_field_close(GSL_GET_STATE),
+//     on_field_close(GSL_GET_ARRAY_STATE)
+//   on_field_open(GSL_GET_STATE, "bio"), on_cdata("a}b"), on_field_close(GSL_GET_STATE)
+//   on_field_close(GSL_GET_STATE)
+struct gslSaxHandler {
+    void *obj;
+
+    // "{tag", "{!tag", "[tag" or "[!tag": GSL_GET_STATE, GSL_SET_STATE, GSL_GET_ARRAY_STATE
+    // or GSL_SET_ARRAY_STATE respectively.
+    gsl_err_t (*on_field_open)(void *obj, gsl_task_spec_type kind, const char *tag, size_t tag_size);
+    // Value of a field without nested fields, e.g. "John Smith" of "{name John Smith}".
+    gsl_err_t (*on_terminal)(void *obj, const char *val, size_t val_size);
+    // Value next to nested fields, e.g. "jsmith" of "{user jsmith {name...}}", and any
+    // value out of a field.
+    gsl_err_t (*on_implied)(void *obj, const char *val, size_t val_size);
+    // Example: "a}b" of "{bio {\"a}b\"}}"
+    gsl_err_t (*on_cdata)(void *obj, const char *val, size_t val_size);
+    gsl_err_t (*on_field_close)(void *obj, gsl_task_spec_type kind);
+    // Atomic item of an array, e.g. "audio" of "[groups audio]".  A "{...}" item comes with
+    // NULL and is followed by the events of its contents and on_field_close(GSL_GET_STATE).
+    gsl_err_t (*on_array_item)(void *obj, const char *val, size_t val_size);
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "gsl-parser/config.h"
+#include "gsl-parser/gsl_err.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>  // for SIZE_MAX
+
+// Scanning primitives of the specialized parsers generated by gsl_schema_gen.  They
+// follow the rules of gsl_parse_task() and are inline, so that the generated code
+// doesn't pay for calls.
+
+static inline bool
+gsl_scan_is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline const char *
+gsl_scan_space(const char *c)
+{
+    while (gsl_scan_is_space(*c))
+        c++;
+    return c;
+}
+
+// Example: rec = "name John}"
+//                     ^  -- returned: a space, a brace or '\0'
+static inline const char *
+gsl_scan_tag(const char *c)
+{
+    for (;; c++) {
+        switch (*c) {
+        case ' ': case '\t': case '\n': case '\r':
+        case '{': case '}': case '[': case ']':
+        case '\0':
+            return c;
+        }
+    }
+}
+
+// Terminal or implied value without the surrounding spaces.
+// Example: rec = "  John Smith }"
+//                   ^^^^^^^^^^  -- |*val|, |*val_size|
+//                               ^  -- returned: a brace or '\0'
+static inline const char *
+gsl_scan_value(const char *c, const char **val, size_t *val_size)
+{
+    const char *e;
+
+    c = gsl_scan_space(c);
+    *val = e = c;
+    for (;; c++) {
+        switch (*c) {
+        case ' ': case '\t': case '\n': case '\r':
+            continue;
+        case '{': case '}': case '[': case ']':
+        case '\0':
+            *val_size = e - *val;
+            return c;
+        }
+        e = c + 1;
+    }
+}
+
+// Atomic list item.
+// Example: rec = "en fr]"
+//                   ^  -- returned: a space, a brace, '-' or '\0'
+static inline const char *
+gsl_scan_item(const char *c)
+{
+    for (;; c++) {
+        switch (*c) {
+        case ' ': case '\t': case '\n': case '\r':
+        case '{': case '}': case '[': case ']':
+        case '-':
+        case '\0':
+            return c;
+        }
+    }
+}
+
+// Same as gsl_run_set_size_t(), but doesn't need a delimiter after the digits.
+static inline gsl_err_t
+gsl_scan_size_t(const char *val, size_t val_size, size_t *num)
+{
+    size_t n = 0;
+
+    if (!val_size)
+        return make_gsl_err(gsl_FORMAT);
+
+    for (size_t i = 0; i < val_size; i++) {
+        unsigned d = (unsigned char)val[i] - '0';
+        if (d >= GSL_NUM_ENCODE_BASE)
+            return make_gsl_err(gsl_FORMAT);
+        if (n > (SIZE_MAX - d) / GSL_NUM_ENCODE_BASE)
+            return make_gsl_err(gsl_LIMIT);
+        n = n * GSL_NUM_ENCODE_BASE + d;
+    }
+
+    *num = n;
+    return make_gsl_err(gsl_OK);
+}
+
+// Skips a comment that starts at |rec|.  |total_size| points to |closing_brace|.
+// Example: rec = "-- {name John} --}"
+//                                  ^  -- total_size
+extern GSL_API gsl_err_t gsl_scan_comment(const char *rec, char closing_brace, size_t *total_size);
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "gsl-parser/gsl_task_spec.h"
+
+#include <stddef.h>
+
+// Counters of the input shape filled by the parser when the library is built with
+// GSL_WITH_STATS (otherwise they stay zero, see gsl_stats_enabled()).  Every thread
+// has its own set, so the hot path doesn't share cache lines; gsl_parse_batch() and
+// gsl_ingest_files() also sum up the records parsed by every worker in its |stats|.
+struct gslStats {
+    size_t bytes_scanned;    // by the outermost gsl_parse_task(), gsl_parse_array() or gsl_parse_cdata() calls
+    size_t bytes_visited;    // by the scanning loops, with rescans: a small multiple of bytes_scanned unless
+                             // an input makes the parser superlinear
+    size_t fields[4];        // tagged fields by gsl_task_spec_type: GET, GET_ARRAY, SET, SET_ARRAY
+    size_t implied_fields;
+    size_t list_items;
+
+    size_t spec_lookups;     // tags looked up in specs
+    size_t spec_index_hits;  // of them resolved by a precomputed index
+    size_t spec_misses;      // of them not matched by name (a validator or an error)
+
+    // Callback invocations per kind.
+    size_t runs;
+    size_t parses;
+    size_t validates;
+    size_t bufs;             // values copied to |buf| of a spec
+
+    size_t max_depth;        // deepest nesting of the parser calls
+    size_t comment_bytes;    // skipped in "-...-" comments
+    size_t cdata_bytes;      // of values in {"..."}
+};
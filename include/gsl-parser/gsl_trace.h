@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+// Binary trace of the parser: a ring buffer of compact events per thread, cheap enough to
+// stay on in production, unlike gsl_log().  When tracing is off (the default) every trace
+// point costs a single well-predicted branch.  The events are decoded only on demand, e.g.
+// by gsl_trace_dump() when a record fails.
+typedef enum {
+    GSL_TRACE_ENTER,    // gsl_parse_task(), gsl_parse_array() or gsl_parse_cdata() starts at |offset|
+    GSL_TRACE_LEAVE,    // ...returns at |offset| with |arg| as an error code
+    GSL_TRACE_FIELD,    // a tag at |offset| is matched with |spec_idx| of type |arg|
+    GSL_TRACE_IMPLIED,  // an implied field at |offset| goes to |spec_idx|
+    GSL_TRACE_DEFAULT,  // an empty field is handled by |spec_idx|
+    GSL_TRACE_ITEM,     // a list item at |offset|
+    GSL_TRACE_COMMENT,  // a comment of |arg| bytes at |offset| is skipped
+    GSL_TRACE_NUM_EVENTS
+} gsl_trace_event_t;
+
+#define GSL_TRACE_NO_SPEC UINT16_MAX
+
+struct gslTraceEvent {
+    uint32_t offset;    // from the beginning of the outermost record
+    uint8_t event;      // gsl_trace_event_t
+    uint8_t depth;      // of the nested parser calls, 1 for the outermost one
+    uint16_t spec_idx;  // in the specs of the current call, or GSL_TRACE_NO_SPEC
+    int32_t arg;
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "gsl-parser/gsl_object.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Compile-time object specs without a generator.  The fields are listed once, in an
+// X-macro which takes the field macro and a context to pass through:
+//
+//   #define USER_FIELDS(X, _)
+//       X(_, IMPLIED_STR, name, 64)
+//       X(_, STR, sid, 16)
+//       X(_, ARENA_STR, note, 0)
+//       X(_, SIZE_T, age)
+//       X(_, STR_LIST, languages, 16, 4)
+//       X(_, OBJECT_LIST, groups, group, 8)       (with the line continuations)
+//
+//   GSL_XOBJECT_DECLARE(user, USER_FIELDS)           -- struct user, user_FIELD_* and user_spec
+//   GSL_XOBJECT_DEFINE(user, "user", USER_FIELDS)    -- in one .c file
+//
+// Then gsl_parse_object(&user_spec, &user, arena, rec, &total_size) fills |user|.
+//
+// Kinds and their arguments (limits as of gslFieldSpec, 0 - none for arena strings):
+//   STR(name, max_size)                IMPLIED_STR(name, max_size)
+//   ARENA_STR(name, max_size)          IMPLIED_ARENA_STR(name, max_size)
+//   SIZE_T(name)                       OBJECT(name, type)
+//   STR_LIST(name, max_size, max_items)          ARENA_STR_LIST(name, max_size, max_items)
+//   SIZE_T_LIST(name, max_items)                 OBJECT_LIST(name, type, max_items)
+// where |type| is the prefix of another X-object: struct type, type_spec.  An object needs
+// at least one field.
+//
+// The field table is const and keeps the order of the declaration, which is also the
+// order of the struct members.  Instead of sorting it (the preprocessor can't compare
+// strings), the lookup goes through |prefix_buckets|: a bitmask of the fields for every
+// tag length, computed at compile time.
+
+// Tags of GSL_XOBJECT_MAX_BUCKET bytes or longer share the last bucket.
+#define GSL_XOBJECT_MAX_BUCKET 16
+
+#define GSL_XCALL(macro, ...) macro(__VA_ARGS__)
+#define GSL_XUNWRAP(...) __VA_ARGS__
+#define GSL_XNAME(f, ...) f
+
+// --------------------------------------------------------------------------------
+// Struct members
+
+#define GSL_XDECL(_, kind, ...) GSL_XDECL_##kind(__VA_ARGS__)
+
+#define GSL_XDECL_STR(f, sz) char f[sz]; size_t f##_size;
+#define GSL_XDECL_IMPLIED_STR(f, sz) GSL_XDECL_STR(f, sz)
+#define GSL_XDECL_ARENA_STR(f, sz) struct gslStr f;
+#define GSL_XDECL_IMPLIED_ARENA_STR(f, sz) struct gslStr f;
+#define GSL_XDECL_SIZE_T(f) size_t f;
+#define GSL_XDECL_OBJECT(f, t) struct t f;
+#define GSL_XDECL_STR_LIST(f, sz, n)                                                    \
+    char f[n][sz]; size_t f##_sizes[n]; size_t num_##f;
+#define GSL_XDECL_ARENA_STR_LIST(f, sz, n) struct gslStr f[n]; size_t num_##f;
+#define GSL_XDECL_SIZE_T_LIST(f, n) size_t f[n]; size_t num_##f;
+#define GSL_XDECL_OBJECT_LIST(f, t, n) struct t f[n]; size_t num_##f;
+
+// --------------------------------------------------------------------------------
+// Field indices: prefix_FIELD_name
+
+#define GSL_XENUM(prefix, kind, ...) GSL_XCALL(GSL_XENUM_, prefix, GSL_XNAME(__VA_ARGS__, ~))
+#define GSL_XENUM_(prefix, f) prefix##_FIELD_##f,
+
+// --------------------------------------------------------------------------------
+// Field specs
+
+#define GSL_XSPEC(prefix, kind, ...) GSL_XSPEC_##kind(prefix, __VA_ARGS__)
+
+#define GSL_XSPEC_NAME(prefix, f)                                                       \
+    .name = #f, .name_size = sizeof #f - 1,                                             \
+    .offset = offsetof(struct prefix, f)
+
+#define GSL_XSPEC_LIST(prefix, f, n)                                                    \
+    .is_list = true, .count_offset = offsetof(struct prefix, num_##f),                  \
+    .item_size = sizeof ((struct prefix *)0)->f[0], .max_items = (n)
+
+#define GSL_XSPEC_STR(prefix, f, sz)                                                    \
+    { GSL_XSPEC_NAME(prefix, f), .kind = GSL_FIELD_STR,                                 \
+      .size_offset = offsetof(struct prefix, f##_size), .max_size = (sz) },
+#define GSL_XSPEC_IMPLIED_STR(prefix, f, sz)                                            \
+    { GSL_XSPEC_NAME(prefix, f), .kind = GSL_FIELD_STR, .is_implied = true,             \
+      .size_offset = offsetof(struct prefix, f##_size), .max_size = (sz) },
+#define GSL_XSPEC_ARENA_STR(prefix, f, sz)                                              \
+    { GSL_XSPEC_NAME(prefix, f), .kind = GSL_FIELD_ARENA_STR, .max_size = (sz) },
+#define GSL_XSPEC_IMPLIED_ARENA_STR(prefix, f, sz)                                      \
+    { GSL_XSPEC_NAME(prefix, f), .kind = GSL_FIELD_ARENA_STR, .is_implied = true,       \
+      .max_size = (sz) },
+#define GSL_XSPEC_SIZE_T(prefix, f)                                                     \
+    { GSL_XSPEC_NAME(prefix, f), .kind = GSL_FIELD_SIZE_T },
+#define GSL_XSPEC_OBJECT(prefix, f, t)                                                  \
+    { GSL_XSPEC_NAME(prefix, f), .kind = GSL_FIELD_OBJECT, .object = &t##_spec },
+#define GSL_XSPEC_STR_LIST(prefix, f, sz, n)                                            \
+    { GSL_XSPEC_NAME(prefix, f), .kind = GSL_FIELD_STR, GSL_XSPEC_LIST(prefix, f, n),   \
+      .size_offset = offsetof(struct prefix, f##_sizes), .max_size = (sz) },
+#define GSL_XSPEC_ARENA_STR_LIST(prefix, f, sz, n)                                      \
+    { GSL_XSPEC_NAME(prefix, f), .kind = GSL_FIELD_ARENA_STR, GSL_XSPEC_LIST(prefix, f, n), \
+      .max_size = (sz) },
+#define GSL_XSPEC_SIZE_T_LIST(prefix, f, n)                                             \
+    { GSL_XSPEC_NAME(prefix, f), .kind = GSL_FIELD_SIZE_T, GSL_XSPEC_LIST(prefix, f, n) },
+#define GSL_XSPEC_OBJECT_LIST(prefix, f, t, n)                                          \
+    { GSL_XSPEC_NAME(prefix, f), .kind = GSL_FIELD_OBJECT, GSL_XSPEC_LIST(prefix, f, n), \
+      .object = &t##_spec },
+
+// --------------------------------------------------------------------------------
+// Length buckets
+
+#define GSL_XBUCKET_OF(size) ((size) < GSL_XOBJECT_MAX_BUCKET ? (size) : GSL_XOBJECT_MAX_BUCKET)
+
+// |ctx| is (prefix, bucket).  Implied fields have no tag.
+#define GSL_XBIT(ctx, kind, ...) GSL_XCALL(GSL_XBIT_, GSL_XUNWRAP ctx, kind, GSL_XNAME(__VA_ARGS__, ~))
+#define GSL_XBIT_(prefix, bucket, kind, f)                                              \
+    | (GSL_XBUCKET_OF(sizeof #f - 1) == (bucket) && !GSL_XIS_IMPLIED_##kind             \
+           ? UINT32_C(1) << prefix##_FIELD_##f : 0)
+
+#define GSL_XIS_IMPLIED_STR 0
+#define GSL_XIS_IMPLIED_IMPLIED_STR 1
+#define GSL_XIS_IMPLIED_ARENA_STR 0
+#define GSL_XIS_IMPLIED_IMPLIED_ARENA_STR 1
+#define GSL_XIS_IMPLIED_SIZE_T 0
+#define GSL_XIS_IMPLIED_OBJECT 0
+#define GSL_XIS_IMPLIED_STR_LIST 0
+#define GSL_XIS_IMPLIED_ARENA_STR_LIST 0
+#define GSL_XIS_IMPLIED_SIZE_T_LIST 0
+#define GSL_XIS_IMPLIED_OBJECT_LIST 0
+
+#define GSL_XBUCKET(prefix, FIELDS, bucket) (0 FIELDS(GSL_XBIT, (prefix, bucket)))
+
+#define GSL_XBUCKETS(prefix, FIELDS)                                                    \
+    GSL_XBUCKET(prefix, FIELDS, 0),  GSL_XBUCKET(prefix, FIELDS, 1),                    \
+    GSL_XBUCKET(prefix, FIELDS, 2),  GSL_XBUCKET(prefix, FIELDS, 3),                    \
+    GSL_XBUCKET(prefix, FIELDS, 4),  GSL_XBUCKET(prefix, FIELDS, 5),                    \
+    GSL_XBUCKET(prefix, FIELDS, 6),  GSL_XBUCKET(prefix, FIELDS, 7),                    \
+    GSL_XBUCKET(prefix, FIELDS, 8),  GSL_XBUCKET(prefix, FIELDS, 9),                    \
+    GSL_XBUCKET(prefix, FIELDS, 10), GSL_XBUCKET(prefix, FIELDS, 11),                   \
+    GSL_XBUCKET(prefix, FIELDS, 12), GSL_XBUCKET(prefix, FIELDS, 13),                   \
+    GSL_XBUCKET(prefix, FIELDS, 14), GSL_XBUCKET(prefix, FIELDS, 15),                   \
+    GSL_XBUCKET(prefix, FIELDS, 16)
+
+// Returns the index of the field named |name| or -1.
+static inline int
+gsl_xobject_lookup(const struct gslFieldSpec *fields, const uint32_t *buckets,
+                   const char *name, size_t name_size)
+{
+    uint32_t mask = buckets[GSL_XBUCKET_OF(name_size)];
+
+    while (mask) {
+        int idx = __builtin_ctz(mask);
+        const struct gslFieldSpec *field = &fields[idx];
+
+        if (field->name_size == name_size && field->name[0] == name[0] &&
+            !memcmp(field->name, name, name_size))
+            return idx;
+        mask &= mask - 1;
+    }
+    return -1;
+}
+
+// --------------------------------------------------------------------------------
+// Public macros
+
+#define GSL_XOBJECT_DECLARE(prefix, FIELDS)                                             \
+    struct prefix { FIELDS(GSL_XDECL, prefix) };                                        \
+    enum { FIELDS(GSL_XENUM, prefix) prefix##_NUM_FIELDS };                             \
+    _Static_assert(prefix##_NUM_FIELDS <= GSL_OBJECT_MAX_FIELDS,                        \
+                   #prefix ": too many fields");                                        \
+    extern const struct gslObjectSpec prefix##_spec
+
+#define GSL_XOBJECT_DEFINE(prefix, tag_literal, FIELDS)                                 \
+    static const struct gslFieldSpec prefix##_fields[] = { FIELDS(GSL_XSPEC, prefix) }; \
+    static const uint32_t prefix##_buckets[GSL_XOBJECT_MAX_BUCKET + 1] = {              \
+        GSL_XBUCKETS(prefix, FIELDS)                                                    \
+    };                                                                                  \
+    static int prefix##_lookup(const char *name, size_t name_size) {                    \
+        return gsl_xobject_lookup(prefix##_fields, prefix##_buckets, name, name_size);  \
+    }                                                                                   \
+    const struct gslObjectSpec prefix##_spec = {                                        \
+        .tag = tag_literal, .tag_size = sizeof tag_literal - 1,                         \
+        .size = sizeof(struct prefix),                                                  \
+        .fields = prefix##_fields, .num_fields = prefix##_NUM_FIELDS,                   \
+        .lookup = prefix##_lookup                                                       \
+    }
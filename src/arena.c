@@ -0,0 +1,136 @@
+#include "gsl-parser.h"
+#include "gsl-parser/gsl_log.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEBUG_ARENA_LEVEL_1 0
+
+#define GSL_ARENA_DEFAULT_CHUNK_SIZE (64u * 1024)
+
+struct gslArenaChunk {
+    struct gslArenaChunk *next;
+    size_t size;
+    size_t used;
+    _Alignas(max_align_t) char data[];
+};
+
+void
+gsl_arena_init(struct gslArena *self, size_t chunk_size)
+{
+    gsl_arena_init_allocator(self, chunk_size, NULL);
+}
+
+void
+gsl_arena_init_allocator(struct gslArena *self, size_t chunk_size, const struct gslAllocator *allocator)
+{
+    self->chunks = NULL;
+    self->chunk_size = chunk_size ? chunk_size : GSL_ARENA_DEFAULT_CHUNK_SIZE;
+    self->allocator = allocator;
+}
+
+static void *
+gsl_arena_chunk_alloc(struct gslArena *self, size_t size)
+{
+    if (self->allocator)
+        return self->allocator->alloc(self->allocator->state, size);
+    return malloc(size);
+}
+
+static void
+gsl_arena_chunk_free(struct gslArena *self, struct gslArenaChunk *chunk)
+{
+    if (!chunk)
+        return;
+    if (self->allocator)
+        self->allocator->free(self->allocator->state, chunk);
+    else
+        free(chunk);
+}
+
+static void *
+gsl_arena_alloc_aligned(struct gslArena *self, size_t size, size_t align)
+{
+    struct gslArenaChunk *chunk = self->chunks;
+    size_t offset;
+
+    if (chunk) {
+        offset = (chunk->used + align - 1) & ~(align - 1);
+        if (offset <= chunk->size && size <= chunk->size - offset) {
+            chunk->used = offset + size;
+            return chunk->data + offset;
+        }
+    }
+
+    // Example: the chunk is full, or |size| is larger than a chunk
+    size_t chunk_size = size > self->chunk_size ? size : self->chunk_size;
+    if (chunk_size > SIZE_MAX - sizeof *chunk)
+        return NULL;
+
+    chunk = gsl_arena_chunk_alloc(self, sizeof *chunk + chunk_size);
+    if (!chunk) {
+        if (DEBUG_ARENA_LEVEL_1)
+            gsl_log("-- cannot allocate an arena chunk of %zu bytes", chunk_size);
+        return NULL;
+    }
+    chunk->size = chunk_size;
+    chunk->used = size;
+
+    // An oversized chunk goes behind the current one, so that the rest of the current
+    // one is still used.
+    if (self->chunks && size > self->chunk_size) {
+        chunk->next = self->chunks->next;
+        self->chunks->next = chunk;
+    } else {
+        chunk->next = self->chunks;
+        self->chunks = chunk;
+    }
+    return chunk->data;
+}
+
+void *
+gsl_arena_alloc(struct gslArena *self, size_t size)
+{
+    return gsl_arena_alloc_aligned(self, size, _Alignof(max_align_t));
+}
+
+gsl_err_t
+gsl_arena_set_str(struct gslArena *self, struct gslStr *str, const char *val, size_t val_size)
+{
+    // Strings are packed without alignment.
+    char *buf = gsl_arena_alloc_aligned(self, val_size + 1, 1);
+    if (!buf)
+        return make_gsl_err(gsl_FAIL);
+
+    memcpy(buf, val, val_size);
+    buf[val_size] = '\0';
+    str->str = buf;
+    str->size = val_size;
+    return make_gsl_err(gsl_OK);
+}
+
+void
+gsl_arena_reset(struct gslArena *self)
+{
+    struct gslArenaChunk *chunk, *next;
+
+    if (!self->chunks)
+        return;
+
+    // Keep the first regular chunk for the next round.
+    for (chunk = self->chunks->next; chunk; chunk = next) {
+        next = chunk->next;
+        gsl_arena_chunk_free(self, chunk);
+    }
+    self->chunks->next = NULL;
+    self->chunks->used = 0;
+}
+
+void
+gsl_arena_free(struct gslArena *self)
+{
+    gsl_arena_reset(self);
+    gsl_arena_chunk_free(self, self->chunks);
+    self->chunks = NULL;
+}
@@ -0,0 +1,262 @@
+#include "internal.h"
+#include "gsl-parser/gsl_log.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEBUG_BATCH_LEVEL_1 0
+
+struct gslBatchRange;
+
+struct gslBatch {
+    const struct gslRecord *records;
+    size_t num_records;
+    gsl_err_t *errs;
+
+    atomic_size_t next_record;
+
+    // Of gsl_parse_batch_pool().
+    struct gslPool *pool;
+    struct gslBatchWorker *workers;
+    struct gslBatchRange *ranges;  // by their first record
+    struct gslPoolGroup group;
+
+    // The failure path is cold, so the first failed record is tracked under a lock.
+    pthread_mutex_t failed_lock;
+    size_t first_failed;
+    gsl_err_t first_err;
+};
+
+// Records [begin, end) of a batch parsed on a pool.
+struct gslBatchRange {
+    struct gslPoolTask task;
+    struct gslBatch *batch;
+    size_t begin;
+    size_t end;
+};
+
+// Arguments of worker->parse() for gsl_ctx_parse().
+struct gslBatchCall {
+    struct gslBatchWorker *worker;
+    size_t rec_idx;
+};
+
+struct gslBatchThread {
+    struct gslBatch *batch;
+    struct gslBatchWorker *worker;
+    pthread_t thread;
+};
+
+static gsl_err_t
+gsl_batch_call_worker(void *obj, const char *rec, size_t *total_size)
+{
+    struct gslBatchCall *call = (struct gslBatchCall *)obj;
+
+    return call->worker->parse(call->worker->obj, call->rec_idx, rec, total_size);
+}
+
+gsl_err_t
+gsl_batch_parse_record(struct gslBatchWorker *worker, struct gslScratch *scratch,
+                       struct gslCtx *ctx, size_t rec_idx, const char *rec, size_t rec_size)
+{
+    size_t total_size;
+    gsl_err_t err;
+#ifdef GSL_STATS
+    // Stats of this record alone go to the worker, and the thread keeps its total.
+    struct gslStats thread_stats = *gsl_stats_get();
+    gsl_stats_reset();
+#endif
+
+    // The parser stops at '\0' only, so every record gets its own null-terminated copy.
+    if (rec_size + 1 > scratch->max_buf_size) {
+        char *buf = realloc(scratch->buf, rec_size + 1);
+        if (!buf) return make_gsl_err(gsl_FAIL);
+
+        scratch->buf = buf;
+        scratch->max_buf_size = rec_size + 1;
+    }
+    memcpy(scratch->buf, rec, rec_size);
+    scratch->buf[rec_size] = '\0';
+
+    if (atomic_load_explicit(&gsl_trace_is_on, memory_order_relaxed))
+        gsl_trace_reset();
+    if (ctx) {
+        struct gslBatchCall call = { worker, rec_idx };
+        err = gsl_ctx_parse(ctx, gsl_batch_call_worker, &call, scratch->buf, &total_size);
+    } else {
+        err = worker->parse(worker->obj, rec_idx, scratch->buf, &total_size);
+    }
+    if (err.code && DEBUG_BATCH_LEVEL_1)
+        gsl_log("-- record #%zu failed: %d at %zu", rec_idx, err.code, total_size);
+
+    // The trace is decoded only for the failed records.
+    if (err.code && atomic_load_explicit(&gsl_trace_is_on, memory_order_relaxed))
+        gsl_trace_dump_failed(stderr, rec_idx, err, total_size, scratch->buf);
+
+#ifdef GSL_STATS
+    gsl_stats_add(&worker->stats, gsl_stats_get());
+    gsl_stats_add(&thread_stats, gsl_stats_get());
+    gsl_thread_stats = thread_stats;
+#endif
+
+    return err;
+}
+
+static void
+gsl_batch_record_done(struct gslBatch *self, size_t rec_idx, gsl_err_t err)
+{
+    if (self->errs)
+        self->errs[rec_idx] = err;
+
+    if (err.code) {
+        pthread_mutex_lock(&self->failed_lock);
+        if (rec_idx < self->first_failed) {
+            self->first_failed = rec_idx;
+            self->first_err = err;
+        }
+        pthread_mutex_unlock(&self->failed_lock);
+    }
+}
+
+static void *
+gsl_batch_worker(void *arg)
+{
+    struct gslBatchThread *self = (struct gslBatchThread *)arg;
+    struct gslBatch *batch = self->batch;
+    struct gslScratch scratch = { NULL, 0 };
+
+    size_t i;
+    gsl_err_t err;
+
+    // Records are picked one by one: their sizes vary too much for static partitioning.
+    while ((i = atomic_fetch_add_explicit(&batch->next_record, 1, memory_order_relaxed)) < batch->num_records) {
+        err = gsl_batch_parse_record(self->worker, &scratch, NULL, i, batch->records[i].rec, batch->records[i].rec_size);
+        gsl_batch_record_done(batch, i, err);
+    }
+
+    gsl_profile_flush();
+    free(scratch.buf);
+    return NULL;
+}
+
+gsl_err_t
+gsl_parse_batch(const struct gslRecord *records, size_t num_records,
+                struct gslBatchWorker *workers, size_t num_workers,
+                gsl_err_t *errs)
+{
+    struct gslBatch batch = {
+        .records = records,
+        .num_records = num_records,
+        .errs = errs,
+        .first_failed = num_records,
+        .first_err = { .code = gsl_OK }
+    };
+    struct gslBatchThread *threads;
+    size_t num_started = 1;
+
+    if (!num_workers)
+        return make_gsl_err(gsl_FAIL);
+
+    atomic_init(&batch.next_record, 0);
+
+    threads = calloc(num_workers, sizeof *threads);
+    if (!threads)
+        return make_gsl_err(gsl_FAIL);
+
+    pthread_mutex_init(&batch.failed_lock, NULL);
+
+    for (size_t i = 0; i < num_workers; i++) {
+        threads[i].batch = &batch;
+        threads[i].worker = &workers[i];
+    }
+
+    // Worker #0 runs in the calling thread.  If some threads cannot be started, the
+    // rest of the workers take their share.
+    for (; num_started < num_workers && num_started < num_records; num_started++) {
+        if (pthread_create(&threads[num_started].thread, NULL, gsl_batch_worker, &threads[num_started])) {
+            if (DEBUG_BATCH_LEVEL_1)
+                gsl_log("-- cannot start worker #%zu", num_started);
+            break;
+        }
+    }
+
+    gsl_batch_worker(&threads[0]);
+
+    for (size_t i = 1; i < num_started; i++)
+        pthread_join(threads[i].thread, NULL);
+
+    free(threads);
+    pthread_mutex_destroy(&batch.failed_lock);
+
+    return batch.first_err;
+}
+
+// Splits the upper halves off for the thieves, so that a stolen range is as large as it
+// gets, and parses the first record of the range.
+static void
+gsl_batch_run_range(struct gslPoolTask *task)
+{
+    struct gslBatchRange *self = (struct gslBatchRange *)task;
+    struct gslBatch *batch = self->batch;
+    size_t worker_idx = gsl_pool_worker_idx();
+    size_t rec_idx;
+    gsl_err_t err;
+
+    while (self->end - self->begin > 1) {
+        size_t mid = self->begin + (self->end - self->begin) / 2;
+        struct gslBatchRange *upper = &batch->ranges[mid];
+
+        upper->task.run = gsl_batch_run_range;
+        upper->batch = batch;
+        upper->begin = mid;
+        upper->end = self->end;
+        self->end = mid;
+        gsl_pool_submit(batch->pool, &batch->group, &upper->task);
+    }
+
+    rec_idx = self->begin;
+    err = gsl_batch_parse_record(&batch->workers[worker_idx], gsl_pool_scratch(batch->pool, worker_idx),
+                                 gsl_pool_ctx(batch->pool, worker_idx), rec_idx,
+                                 batch->records[rec_idx].rec, batch->records[rec_idx].rec_size);
+    gsl_batch_record_done(batch, rec_idx, err);
+}
+
+gsl_err_t
+gsl_parse_batch_pool(struct gslPool *pool, const struct gslRecord *records, size_t num_records,
+                     struct gslBatchWorker *workers, gsl_err_t *errs)
+{
+    struct gslBatch batch = {
+        .records = records,
+        .num_records = num_records,
+        .errs = errs,
+        .pool = pool,
+        .workers = workers,
+        .first_failed = num_records,
+        .first_err = { .code = gsl_OK }
+    };
+
+    if (!num_records)
+        return make_gsl_err(gsl_OK);
+
+    // A range for every record it can start from, so the splits don't allocate.
+    batch.ranges = malloc(num_records * sizeof *batch.ranges);
+    if (!batch.ranges)
+        return make_gsl_err(gsl_FAIL);
+
+    atomic_init(&batch.group.num_pending, 0);
+    pthread_mutex_init(&batch.failed_lock, NULL);
+
+    batch.ranges[0].task.run = gsl_batch_run_range;
+    batch.ranges[0].batch = &batch;
+    batch.ranges[0].begin = 0;
+    batch.ranges[0].end = num_records;
+    gsl_pool_submit(pool, &batch.group, &batch.ranges[0].task);
+    gsl_pool_wait(pool, &batch.group);
+
+    free(batch.ranges);
+    pthread_mutex_destroy(&batch.failed_lock);
+
+    return batch.first_err;
+}
@@ -0,0 +1,28 @@
+#include "internal.h"
+#include "gsl-parser/gsl_log.h"
+
+#include <string.h>
+
+#define DEBUG_CHECK_LEVEL_1 0
+
+bool
+gsl_checks_enabled(void)
+{
+#ifdef GSL_CHECKED
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef GSL_CHECKED
+gsl_err_t
+gsl_check_failed(const char *cond, const char *file, int line)
+{
+    if (DEBUG_CHECK_LEVEL_1)
+        gsl_log("-- check failed: %s at %s:%d", cond, file, line);
+
+    // Example: "spec->obj != NULL"
+    return make_gsl_desc_err(gsl_INVALID, cond, (int)strlen(cond));
+}
+#endif
@@ -0,0 +1,173 @@
+#include "internal.h"
+#include "gsl-parser/gsl_log.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEBUG_CTX_LEVEL_1 0
+
+_Thread_local struct gslCtx *gsl_thread_ctx;
+
+struct gslCtxTask {
+    struct gslTaskSpec *specs;
+    size_t num_specs;
+};
+
+static void *
+gsl_default_alloc(void *state, size_t size)
+{
+    (void)state;
+    return malloc(size);
+}
+
+static void
+gsl_default_free(void *state, void *ptr)
+{
+    (void)state;
+    free(ptr);
+}
+
+void
+gsl_ctx_init(struct gslCtx *self, const struct gslCtxOptions *options)
+{
+    memset(self, 0, sizeof *self);
+    if (options)
+        self->options = *options;
+    self->allocator.alloc = gsl_default_alloc;
+    self->allocator.free = gsl_default_free;
+}
+
+void
+gsl_ctx_reset(struct gslCtx *self)
+{
+    memset(&self->stats, 0, sizeof self->stats);
+    memset(&self->error, 0, sizeof self->error);
+}
+
+struct gslCtx *
+gsl_ctx_current(void)
+{
+    return gsl_thread_ctx;
+}
+
+void *
+gsl_ctx_alloc(struct gslCtx *self, size_t size)
+{
+    return self->allocator.alloc(self->allocator.state, size);
+}
+
+void
+gsl_ctx_free(struct gslCtx *self, void *ptr)
+{
+    if (ptr)
+        self->allocator.free(self->allocator.state, ptr);
+}
+
+// |depth| of 0 is the parse function of gsl_ctx_parse() itself.
+static void
+gsl_ctx_record_error(struct gslCtx *self, gsl_err_t err, const char *pos, size_t depth)
+{
+    struct gslCtxError *error = &self->error;
+
+    error->code = err.code;
+    // Example: a callback parses a copy of its value, the offset is out of the record then
+    error->offset = (uintptr_t)pos >= (uintptr_t)self->rec ? (uintptr_t)pos - (uintptr_t)self->rec : 0;
+    error->depth = depth;
+    error->desc_size = 0;
+    if (err.val && err.val_size > 0) {
+        error->desc_size = (size_t)err.val_size < sizeof error->desc ? (size_t)err.val_size : sizeof error->desc;
+        memcpy(error->desc, err.val, error->desc_size);
+    }
+
+    if (DEBUG_CTX_LEVEL_1)
+        gsl_log("-- ctx error %d at %zu, depth %zu: \"%.*s\"",
+                error->code, error->offset, error->depth, (int)error->desc_size, error->desc);
+}
+
+void
+gsl_ctx_set_error(struct gslCtx *self, gsl_err_t err, const char *pos)
+{
+    // The error of a nested call is being propagated: keep the innermost position.  A
+    // different code means a callback has replaced the error by its own.
+    if (self->error.code == err.code && self->error.depth > self->depth)
+        return;
+
+    gsl_ctx_record_error(self, err, pos, self->depth);
+}
+
+gsl_err_t
+gsl_ctx_depth_exceeded(struct gslCtx *self, const char *rec, size_t *total_size)
+{
+    if (DEBUG_CTX_LEVEL_1)
+        gsl_log("-- depth limit reached: %zu max: %zu", self->depth, self->options.max_depth);
+
+    *total_size = 0;
+    gsl_ctx_record_error(self, make_gsl_err(gsl_LIMIT), rec, self->depth);
+    self->depth--;
+    return make_gsl_err(gsl_LIMIT);
+}
+
+gsl_err_t
+gsl_ctx_parse(struct gslCtx *self,
+              gsl_err_t (*parse)(void *obj, const char *rec, size_t *total_size), void *obj,
+              const char *rec, size_t *total_size)
+{
+    struct gslCtx *outer = gsl_thread_ctx;
+    gsl_err_t err;
+
+    // Example: a callback parses a part of its value by itself
+    if (self == outer)
+        return parse(obj, rec, total_size);
+
+#ifdef GSL_STATS
+    // Stats of this parse alone go to the context, and the thread keeps its total.
+    struct gslStats thread_stats = *gsl_stats_get();
+    gsl_stats_reset();
+#endif
+
+    self->rec = rec;
+    self->depth = 0;
+    memset(&self->error, 0, sizeof self->error);
+    self->outer = outer;
+    gsl_thread_ctx = self;
+
+    // Example: |parse| fails before it gets to set the size, the error is at |rec| then
+    *total_size = 0;
+    err = parse(obj, rec, total_size);
+
+    gsl_thread_ctx = outer;
+    self->outer = NULL;
+
+    if (!err.code)
+        memset(&self->error, 0, sizeof self->error);
+    else if (self->error.code != err.code)
+        // Example: the parse function fails before any parser call, or replaces their error
+        gsl_ctx_record_error(self, err, rec + *total_size, 0);
+    self->rec = NULL;
+
+#ifdef GSL_STATS
+    gsl_stats_add(&self->stats, gsl_stats_get());
+    gsl_stats_add(&thread_stats, gsl_stats_get());
+    gsl_thread_stats = thread_stats;
+#endif
+
+    return err;
+}
+
+static gsl_err_t
+gsl_ctx_run_task(void *obj, const char *rec, size_t *total_size)
+{
+    struct gslCtxTask *task = (struct gslCtxTask *)obj;
+
+    return gsl_parse_task(rec, total_size, task->specs, task->num_specs);
+}
+
+gsl_err_t
+gsl_ctx_parse_task(struct gslCtx *self, const char *rec, size_t *total_size,
+                   struct gslTaskSpec *specs, size_t num_specs)
+{
+    struct gslCtxTask task = { specs, num_specs };
+
+    return gsl_ctx_parse(self, gsl_ctx_run_task, &task, rec, total_size);
+}
@@ -0,0 +1,246 @@
+#include "internal.h"
+#include "gsl-parser/gsl_log.h"
+
+#include <stdlib.h>
+
+#define DEBUG_FILTER_LEVEL_1 0
+
+#define GSL_FILTER_MAX_NUMBER_SIZE 64
+
+// A predicate with its |val| copied next to the names of the trie.
+struct gslFilterPredicate {
+    gsl_predicate_type type;
+    const char *val;
+    size_t val_size;
+    double min, max;
+};
+
+struct gslFilter {
+    struct gslFilterPredicate preds[GSL_FILTER_MAX_PREDICATES];
+    uint64_t all;
+    uint64_t exists;    // true as soon as their field is open
+    uint64_t decisive;  // false as soon as their field doesn't match
+    struct gslPathTrie trie;
+    struct gslPathNode nodes[];
+};
+
+gsl_err_t
+gsl_filter_create(const struct gslPredicate *preds, size_t num_preds, struct gslFilter **filter)
+{
+    struct gslFilter *self;
+    struct gslPathNode *node, *scope;
+    bool is_in_array;
+    size_t max_nodes = 1, names_size = 0;
+    gsl_err_t err;
+
+    if (num_preds > GSL_FILTER_MAX_PREDICATES) {
+        if (DEBUG_FILTER_LEVEL_1)
+            gsl_log("-- %zu predicates, at most %d", num_preds, GSL_FILTER_MAX_PREDICATES);
+        return make_gsl_err(gsl_LIMIT);
+    }
+
+    for (size_t i = 0; i < num_preds; i++) {
+        if (!preds[i].path)
+            return make_gsl_err(gsl_INVALID);
+        if (preds[i].type != GSL_PREDICATE_EXISTS && preds[i].type != GSL_PREDICATE_RANGE && !preds[i].val)
+            return make_gsl_desc_err(gsl_INVALID, preds[i].path, (int)strlen(preds[i].path));
+        gsl_path_trie_count(preds[i].path, &max_nodes, &names_size);
+        if (preds[i].val)
+            names_size += strlen(preds[i].val);
+    }
+
+    self = malloc(sizeof *self + max_nodes * sizeof self->nodes[0] + names_size);
+    if (!self)
+        return make_gsl_err(gsl_FAIL);
+    self->all = self->exists = self->decisive = 0;
+    gsl_path_trie_init(&self->trie, self->nodes, (char *)&self->nodes[max_nodes]);
+
+    for (size_t i = 0; i < num_preds; i++) {
+        struct gslFilterPredicate *pred = &self->preds[i];
+        uint64_t bit = (uint64_t)1 << i;
+
+        err = gsl_path_trie_add(&self->trie, preds[i].path, &node);
+        if (err.code) {
+            free(self);
+            return err;
+        }
+        if (preds[i].type == GSL_PREDICATE_CONTAINS)
+            node = gsl_path_trie_items(&self->trie, node);
+
+        *pred = (struct gslFilterPredicate){ .type = preds[i].type, .min = preds[i].min, .max = preds[i].max };
+        if (preds[i].val) {
+            pred->val = self->trie.names;
+            pred->val_size = strlen(preds[i].val);
+            memcpy(self->trie.names, preds[i].val, pred->val_size);
+            self->trie.names += pred->val_size;
+        }
+
+        // Example: path = "user/groups[]/gid"
+        //                       ^^^^^^  -- the outermost array is the scope, else the parent of the field
+        scope = node->parent;
+        is_in_array = false;
+        for (struct gslPathNode *n = node; n->parent; n = n->parent) {
+            if (n->parent->items == n) {
+                scope = n->parent;
+                is_in_array = true;
+            }
+        }
+        if (!is_in_array)
+            self->decisive |= bit;
+
+        // Example: rec = "{user {name John}}"
+        //                                  ^  -- "user/contacts/email" is false, as there is no "contacts"
+        node->preds |= bit;
+        for (; scope; scope = scope->parent)
+            scope->scoped |= bit;
+        self->all |= bit;
+        if (pred->type == GSL_PREDICATE_EXISTS)
+            self->exists |= bit;
+    }
+
+    *filter = self;
+    return make_gsl_err(gsl_OK);
+}
+
+void
+gsl_filter_destroy(struct gslFilter *self)
+{
+    free(self);
+}
+
+static bool
+gsl_filter_is_true(const struct gslFilterPredicate *self, const char *val, size_t val_size)
+{
+    char buf[GSL_FILTER_MAX_NUMBER_SIZE];
+    char *e;
+    double num;
+
+    switch (self->type) {
+    case GSL_PREDICATE_EQUALS:
+    case GSL_PREDICATE_CONTAINS:
+        return val_size == self->val_size && !memcmp(val, self->val, val_size);
+    case GSL_PREDICATE_PREFIX:
+        return val_size >= self->val_size && !memcmp(val, self->val, self->val_size);
+    case GSL_PREDICATE_RANGE:
+        // Example: rec = "{age 42}"
+        //                      ^^  -- copied for strtod(), which wants a null-terminated string
+        if (!val_size || val_size >= sizeof buf)
+            return false;
+        memcpy(buf, val, val_size);
+        buf[val_size] = '\0';
+        num = strtod(buf, &e);
+        return e == buf + val_size && num >= self->min && num <= self->max;
+    case GSL_PREDICATE_EXISTS:
+        break;
+    }
+    return true;
+}
+
+// Checks the value of a field on |node|.  Returns false if it's decided that the record
+// doesn't match.
+static bool
+gsl_filter_check(const struct gslFilter *self, const struct gslPathNode *node,
+                 const char *val, size_t val_size, uint64_t *satisfied)
+{
+    for (uint64_t preds = node->preds & ~self->exists & ~*satisfied; preds; preds &= preds - 1) {
+        int i = __builtin_ctzll(preds);
+
+        if (gsl_filter_is_true(&self->preds[i], val, val_size))
+            *satisfied |= (uint64_t)1 << i;
+        else if (self->decisive & ((uint64_t)1 << i))
+            return false;
+    }
+    return true;
+}
+
+// The same walk along the paths as of gsl_parse_projection(), with the predicates checked
+// on the values: the scan stops as soon as the record is decided either way.
+gsl_err_t
+gsl_filter_match(const char *rec, size_t *total_size, const struct gslFilter *filter)
+{
+    const struct gslPathNode *nodes[GSL_READER_MAX_DEPTH + 1];  // of the open levels
+    const struct gslPathNode *node;
+    struct gslReader reader;
+    struct gslEvent event;
+    uint64_t satisfied = 0;
+    gsl_err_t err = make_gsl_err(gsl_OK);
+
+    GSL_CTX_ENTER(rec, total_size);
+
+    GSL_STAT_ENTER();
+    GSL_TRACE(GSL_TRACE_ENTER, rec, GSL_TRACE_NO_SPEC, 0);
+    gsl_reader_init(&reader, rec);
+    nodes[0] = &filter->nodes[0];
+    while (satisfied != filter->all && !(err = gsl_next(&reader, &event)).code) {
+        switch (event.type) {
+        case GSL_EVENT_FIELD_OPEN:
+            node = gsl_path_node_child(nodes[reader.depth - 1], event.val, event.val_size);
+            break;
+        case GSL_EVENT_ARRAY_ITEM:
+            if (!event.val) {
+                node = nodes[reader.depth - 1]->items;
+                break;
+            }
+
+            // Example: rec = "[groups audio sudo]"
+            //                         ^^^^^  -- an item of "user/groups[]"
+            node = nodes[reader.depth]->items;
+            if (!node)
+                continue;
+            satisfied |= node->preds & filter->exists;
+            if (!gsl_filter_check(filter, node, event.val, event.val_size, &satisfied))
+                goto no_match;
+            continue;
+        case GSL_EVENT_TERMINAL:
+        case GSL_EVENT_CDATA:
+            if (!gsl_filter_check(filter, nodes[reader.depth], event.val, event.val_size, &satisfied))
+                goto no_match;
+            continue;
+        case GSL_EVENT_FIELD_CLOSE:
+            // Example: rec = "{user {name John} [groups audio]}"
+            //                                                ^  -- "user/groups" contains no "sudo"
+            node = nodes[reader.depth + 1];
+            if (node && (node->scoped & ~satisfied))
+                goto no_match;
+            continue;
+        case GSL_EVENT_END:
+            if (satisfied != filter->all)
+                goto no_match;
+            goto done;
+        default:
+            continue;
+        }
+
+        nodes[reader.depth] = node;
+        if (node) {
+            satisfied |= node->preds & filter->exists;
+        } else if ((err = gsl_reader_skip(&reader)).code) {
+            break;
+        }
+    }
+    goto done;
+
+no_match:
+    if (DEBUG_FILTER_LEVEL_1)
+        gsl_log("-- no match at \"%.*s\"", 16, event.pos);
+    reader.pos = event.pos;
+    err = make_gsl_err(gsl_NO_MATCH);
+done:
+    *total_size = reader.pos - rec;
+    GSL_TRACE(GSL_TRACE_LEAVE, reader.pos, GSL_TRACE_NO_SPEC, err.code);
+    GSL_STAT_LEAVE(*total_size);
+
+    return gsl_ctx_leave(err, reader.pos);
+}
+
+gsl_err_t
+gsl_parse_task_filtered(const struct gslFilter *filter, const char *rec, size_t *total_size,
+                        struct gslTaskSpec *specs, size_t num_specs)
+{
+    gsl_err_t err;
+
+    err = gsl_filter_match(rec, total_size, filter);
+    if (err.code)
+        return err;
+    return gsl_parse_task(rec, total_size, specs, num_specs);
+}
@@ -0,0 +1,898 @@
+#define _GNU_SOURCE  // pread(), open()
+
+#include "internal.h"
+#include "gsl-parser/gsl_log.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef GSL_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#define DEBUG_INGEST_LEVEL_1 0
+#define DEBUG_INGEST_LEVEL_2 0
+
+#define GSL_INGEST_DEFAULT_BUF_SIZE (1u << 20)
+#define GSL_INGEST_DEFAULT_NUM_BUFS 8
+#define GSL_INGEST_DEFAULT_NUM_IO_THREADS 2
+#define GSL_INGEST_DEFAULT_QUEUE_SIZE 4096
+#define GSL_INGEST_DEFAULT_BATCH_SIZE 16
+#define GSL_INGEST_MAX_BATCH_SIZE 256
+#define GSL_INGEST_MAX_SPLIT_RECORDS 256
+
+struct gslIngestFile {
+    const char *path;
+    int fd;
+    off_t size;
+};
+
+// Every buffer is laid out as |max_record_size| bytes reserved for the incomplete tail
+// of the previous buffer, followed by |buf_size| bytes of file data.
+struct gslIngestBuf {
+    char *mem;
+    int idx;  // index of the registered buffer
+
+    size_t file_idx;
+    off_t offset;
+    size_t size;       // bytes requested
+    size_t done_size;  // bytes read so far
+    int io_errno;
+    bool is_done;
+
+    // One reference is owned by the dispatcher, one more by each record in the queue.
+    atomic_size_t refs;
+
+    struct gslIngestBuf *next;  // link of the free list or of the pread() queue
+};
+
+struct gslIngestItem {
+    const char *rec;
+    size_t rec_size;
+    size_t rec_idx;
+    struct gslIngestBuf *buf;
+};
+
+struct gslIngest {
+    struct gslIngestOptions opts;
+
+    struct gslIngestFile *files;
+    size_t num_files;
+
+    struct gslIngestBuf *bufs;
+    char *mem;
+
+    // Free buffers and the first error share the lock.
+    pthread_mutex_t lock;
+    pthread_cond_t buf_released;
+    struct gslIngestBuf *free_bufs;
+
+    // Records go from the dispatcher to the workers, and outputs from the workers to the
+    // consumers, without locks.
+    struct gslMpmcQueue *items;
+    struct gslMpmcQueue *outs;  // NULL without consumers
+
+    gsl_err_t err;
+    atomic_bool is_failed;
+
+    bool use_uring;
+#ifdef GSL_HAVE_LIBURING
+    struct io_uring ring;
+    bool use_fixed_bufs;
+#endif
+
+    pthread_mutex_t io_lock;
+    pthread_cond_t io_submitted;
+    pthread_cond_t io_completed;
+    struct gslIngestBuf *io_head, *io_tail;
+    bool io_is_closed;
+    pthread_t *io_threads;
+    size_t num_io_threads;
+};
+
+struct gslIngestWorker {
+    struct gslIngest *ingest;
+    struct gslBatchWorker *worker;
+    pthread_t thread;
+};
+
+struct gslIngestConsumerThread {
+    struct gslIngest *ingest;
+    struct gslIngestConsumer *consumer;
+    pthread_t thread;
+};
+
+// The worker the calling thread is, for gsl_ingest_emit().
+static _Thread_local struct gslIngestWorker *gsl_ingest_thread_worker;
+
+static void
+gsl_ingest_fail(struct gslIngest *self, gsl_err_t err)
+{
+    pthread_mutex_lock(&self->lock);
+    if (!atomic_load_explicit(&self->is_failed, memory_order_relaxed)) {
+        self->err = err;
+        atomic_store_explicit(&self->is_failed, true, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&self->lock);
+}
+
+static bool
+gsl_ingest_is_failed(struct gslIngest *self)
+{
+    return atomic_load_explicit(&self->is_failed, memory_order_relaxed);
+}
+
+static void
+gsl_ingest_buf_put(struct gslIngest *self, struct gslIngestBuf *buf)
+{
+    pthread_mutex_lock(&self->lock);
+    buf->next = self->free_bufs;
+    self->free_bufs = buf;
+    pthread_cond_signal(&self->buf_released);
+    pthread_mutex_unlock(&self->lock);
+}
+
+static void
+gsl_ingest_buf_release(struct gslIngest *self, struct gslIngestBuf *buf)
+{
+    if (atomic_fetch_sub_explicit(&buf->refs, 1, memory_order_acq_rel) == 1)
+        gsl_ingest_buf_put(self, buf);
+}
+
+static struct gslIngestBuf *
+gsl_ingest_buf_acquire(struct gslIngest *self, bool wait)
+{
+    struct gslIngestBuf *buf;
+
+    pthread_mutex_lock(&self->lock);
+    while (wait && !self->free_bufs)
+        pthread_cond_wait(&self->buf_released, &self->lock);
+    buf = self->free_bufs;
+    if (buf)
+        self->free_bufs = buf->next;
+    pthread_mutex_unlock(&self->lock);
+
+    return buf;
+}
+
+static void *
+gsl_ingest_worker(void *arg)
+{
+    struct gslIngestWorker *self = (struct gslIngestWorker *)arg;
+    struct gslIngest *ingest = self->ingest;
+    struct gslScratch scratch = { NULL, 0 };
+    struct gslIngestItem items[GSL_INGEST_MAX_BATCH_SIZE];
+    size_t num_items;
+    gsl_err_t err;
+
+    gsl_ingest_thread_worker = self;
+    while ((num_items = gsl_mpmc_pop(ingest->items, items, ingest->opts.batch_size))) {
+        for (size_t i = 0; i < num_items; i++) {
+            if (!gsl_ingest_is_failed(ingest)) {
+                err = gsl_batch_parse_record(self->worker, &scratch, NULL, items[i].rec_idx,
+                                             items[i].rec, items[i].rec_size);
+                if (err.code)
+                    gsl_ingest_fail(ingest, err);
+            }
+            gsl_ingest_buf_release(ingest, items[i].buf);
+        }
+    }
+    gsl_ingest_thread_worker = NULL;
+
+    gsl_profile_flush();
+    free(scratch.buf);
+    return NULL;
+}
+
+static void *
+gsl_ingest_consumer(void *arg)
+{
+    struct gslIngestConsumerThread *self = (struct gslIngestConsumerThread *)arg;
+    struct gslIngest *ingest = self->ingest;
+    void *outs[GSL_INGEST_MAX_BATCH_SIZE];
+    size_t num_outs;
+    gsl_err_t err;
+
+    while ((num_outs = gsl_mpmc_pop(ingest->outs, outs, ingest->opts.batch_size))) {
+        err = self->consumer->consume(self->consumer->obj, outs, num_outs);
+        if (err.code)
+            gsl_ingest_fail(ingest, err);
+    }
+    return NULL;
+}
+
+gsl_err_t
+gsl_ingest_emit(void *out)
+{
+    struct gslIngestWorker *worker = gsl_ingest_thread_worker;
+
+    if (!worker || !worker->ingest->outs || gsl_ingest_is_failed(worker->ingest))
+        return make_gsl_err(gsl_FAIL);
+
+    // The queue is closed only after all the workers are done.
+    gsl_mpmc_push(worker->ingest->outs, &out);
+    return make_gsl_err(gsl_OK);
+}
+
+// --------------------------------------------------------------------------------
+// I/O backends
+
+static bool
+gsl_ingest_buf_read_completed(struct gslIngestBuf *buf, ssize_t res)
+{
+    if (res < 0) {
+        buf->io_errno = (int)-res;
+        return true;
+    }
+    buf->done_size += (size_t)res;
+    return res == 0 || buf->done_size == buf->size;
+}
+
+#ifdef GSL_HAVE_LIBURING
+
+static int
+gsl_ingest_uring_init(struct gslIngest *self)
+{
+    size_t buf_mem_size = self->opts.max_record_size + self->opts.buf_size;
+    struct iovec *iovecs;
+    int ret;
+
+    ret = io_uring_queue_init((unsigned)self->opts.num_bufs, &self->ring, 0);
+    if (ret < 0) {
+        if (DEBUG_INGEST_LEVEL_1)
+            gsl_log("-- io_uring_queue_init failed: %d", ret);
+        return -1;
+    }
+
+    iovecs = calloc(self->opts.num_bufs, sizeof *iovecs);
+    if (!iovecs) {
+        io_uring_queue_exit(&self->ring);
+        return -1;
+    }
+    for (size_t i = 0; i < self->opts.num_bufs; i++) {
+        iovecs[i].iov_base = self->bufs[i].mem;
+        iovecs[i].iov_len = buf_mem_size;
+    }
+
+    // Registration pins the buffers and may fail because of RLIMIT_MEMLOCK.  Plain reads
+    // into the same buffers are used then.
+    ret = io_uring_register_buffers(&self->ring, iovecs, (unsigned)self->opts.num_bufs);
+    self->use_fixed_bufs = ret == 0;
+    if (ret && DEBUG_INGEST_LEVEL_1)
+        gsl_log("-- io_uring_register_buffers failed: %d, using unregistered buffers", ret);
+
+    free(iovecs);
+    return 0;
+}
+
+static void
+gsl_ingest_uring_fini(struct gslIngest *self)
+{
+    io_uring_queue_exit(&self->ring);
+}
+
+static void
+gsl_ingest_uring_prep(struct gslIngest *self, struct gslIngestBuf *buf)
+{
+    struct io_uring_sqe *sqe;
+    char *data = buf->mem + self->opts.max_record_size + buf->done_size;
+    unsigned size = (unsigned)(buf->size - buf->done_size);
+    int fd = self->files[buf->file_idx].fd;
+    off_t offset = buf->offset + (off_t)buf->done_size;
+
+    sqe = io_uring_get_sqe(&self->ring);
+    if (!sqe) {
+        // The ring has as many entries as there are buffers, but completions of
+        // resubmitted short reads may still occupy it.
+        io_uring_submit(&self->ring);
+        sqe = io_uring_get_sqe(&self->ring);
+        assert(sqe);
+    }
+
+    if (self->use_fixed_bufs)
+        io_uring_prep_read_fixed(sqe, fd, data, size, (unsigned long long)offset, buf->idx);
+    else
+        io_uring_prep_read(sqe, fd, data, size, (unsigned long long)offset);
+    io_uring_sqe_set_data(sqe, buf);
+}
+
+static void
+gsl_ingest_uring_submit(struct gslIngest *self, struct gslIngestBuf *buf)
+{
+    gsl_ingest_uring_prep(self, buf);
+    io_uring_submit(&self->ring);
+}
+
+static void
+gsl_ingest_uring_wait(struct gslIngest *self, struct gslIngestBuf *buf)
+{
+    struct io_uring_cqe *cqe;
+    struct gslIngestBuf *done_buf;
+    int ret;
+
+    while (!buf->is_done) {
+        ret = io_uring_wait_cqe(&self->ring, &cqe);
+        if (ret == -EINTR)
+            continue;
+        if (ret < 0) {
+            // Nothing can be completed anymore, fail all the buffers in flight.
+            for (size_t i = 0; i < self->opts.num_bufs; i++) {
+                self->bufs[i].io_errno = -ret;
+                self->bufs[i].is_done = true;
+            }
+            return;
+        }
+
+        done_buf = (struct gslIngestBuf *)io_uring_cqe_get_data(cqe);
+        if (gsl_ingest_buf_read_completed(done_buf, cqe->res)) {
+            done_buf->is_done = true;
+        } else {
+            // Short read: ask for the rest.
+            gsl_ingest_uring_prep(self, done_buf);
+            io_uring_submit(&self->ring);
+        }
+        io_uring_cqe_seen(&self->ring, cqe);
+    }
+}
+
+#endif  // GSL_HAVE_LIBURING
+
+static void *
+gsl_ingest_pread_thread(void *arg)
+{
+    struct gslIngest *self = (struct gslIngest *)arg;
+    struct gslIngestBuf *buf;
+    ssize_t res;
+
+    for (;;) {
+        pthread_mutex_lock(&self->io_lock);
+        while (!self->io_head && !self->io_is_closed)
+            pthread_cond_wait(&self->io_submitted, &self->io_lock);
+        buf = self->io_head;
+        if (!buf) {
+            pthread_mutex_unlock(&self->io_lock);
+            break;
+        }
+        self->io_head = buf->next;
+        if (!self->io_head)
+            self->io_tail = NULL;
+        pthread_mutex_unlock(&self->io_lock);
+
+        for (;;) {
+            res = pread(self->files[buf->file_idx].fd,
+                        buf->mem + self->opts.max_record_size + buf->done_size,
+                        buf->size - buf->done_size, buf->offset + (off_t)buf->done_size);
+            if (res < 0 && errno == EINTR)
+                continue;
+            if (gsl_ingest_buf_read_completed(buf, res < 0 ? -errno : res))
+                break;
+        }
+
+        pthread_mutex_lock(&self->io_lock);
+        buf->is_done = true;
+        pthread_cond_broadcast(&self->io_completed);
+        pthread_mutex_unlock(&self->io_lock);
+    }
+
+    return NULL;
+}
+
+static void gsl_ingest_pread_fini(struct gslIngest *self);
+
+static int
+gsl_ingest_pread_init(struct gslIngest *self)
+{
+    pthread_mutex_init(&self->io_lock, NULL);
+    pthread_cond_init(&self->io_submitted, NULL);
+    pthread_cond_init(&self->io_completed, NULL);
+    self->io_head = self->io_tail = NULL;
+    self->io_is_closed = false;
+    self->num_io_threads = 0;
+
+    self->io_threads = calloc(self->opts.num_io_threads, sizeof *self->io_threads);
+    if (!self->io_threads)
+        return -1;
+
+    for (; self->num_io_threads < self->opts.num_io_threads; self->num_io_threads++) {
+        if (pthread_create(&self->io_threads[self->num_io_threads], NULL, gsl_ingest_pread_thread, self))
+            break;
+    }
+    if (!self->num_io_threads) {
+        gsl_ingest_pread_fini(self);
+        return -1;
+    }
+    return 0;
+}
+
+static void
+gsl_ingest_pread_fini(struct gslIngest *self)
+{
+    pthread_mutex_lock(&self->io_lock);
+    self->io_is_closed = true;
+    pthread_cond_broadcast(&self->io_submitted);
+    pthread_mutex_unlock(&self->io_lock);
+
+    for (size_t i = 0; i < self->num_io_threads; i++)
+        pthread_join(self->io_threads[i], NULL);
+    free(self->io_threads);
+
+    pthread_cond_destroy(&self->io_completed);
+    pthread_cond_destroy(&self->io_submitted);
+    pthread_mutex_destroy(&self->io_lock);
+}
+
+static void
+gsl_ingest_pread_submit(struct gslIngest *self, struct gslIngestBuf *buf)
+{
+    pthread_mutex_lock(&self->io_lock);
+    buf->next = NULL;
+    if (self->io_tail)
+        self->io_tail->next = buf;
+    else
+        self->io_head = buf;
+    self->io_tail = buf;
+    pthread_cond_signal(&self->io_submitted);
+    pthread_mutex_unlock(&self->io_lock);
+}
+
+static void
+gsl_ingest_pread_wait(struct gslIngest *self, struct gslIngestBuf *buf)
+{
+    pthread_mutex_lock(&self->io_lock);
+    while (!buf->is_done)
+        pthread_cond_wait(&self->io_completed, &self->io_lock);
+    pthread_mutex_unlock(&self->io_lock);
+}
+
+// The backend the last ingestion has taken, for gsl_ingest_backend().
+static _Atomic(const char *) gsl_ingest_io_backend;
+
+static int
+gsl_ingest_io_init(struct gslIngest *self)
+{
+#ifdef GSL_HAVE_LIBURING
+    // io_uring can be unavailable at runtime as well (old kernel, seccomp), fall back
+    // to pread() then.
+    self->use_uring = gsl_ingest_uring_init(self) == 0;
+    if (self->use_uring) {
+        atomic_store_explicit(&gsl_ingest_io_backend, "io_uring", memory_order_relaxed);
+        return 0;
+    }
+#endif
+    atomic_store_explicit(&gsl_ingest_io_backend, "pread", memory_order_relaxed);
+    return gsl_ingest_pread_init(self);
+}
+
+static void
+gsl_ingest_io_fini(struct gslIngest *self)
+{
+#ifdef GSL_HAVE_LIBURING
+    if (self->use_uring) {
+        gsl_ingest_uring_fini(self);
+        return;
+    }
+#endif
+    gsl_ingest_pread_fini(self);
+}
+
+static void
+gsl_ingest_io_submit(struct gslIngest *self, struct gslIngestBuf *buf)
+{
+#ifdef GSL_HAVE_LIBURING
+    if (self->use_uring) {
+        gsl_ingest_uring_submit(self, buf);
+        return;
+    }
+#endif
+    gsl_ingest_pread_submit(self, buf);
+}
+
+static void
+gsl_ingest_io_wait(struct gslIngest *self, struct gslIngestBuf *buf)
+{
+#ifdef GSL_HAVE_LIBURING
+    if (self->use_uring) {
+        gsl_ingest_uring_wait(self, buf);
+        return;
+    }
+#endif
+    gsl_ingest_pread_wait(self, buf);
+}
+
+const char *
+gsl_ingest_backend(void)
+{
+    const char *backend = atomic_load_explicit(&gsl_ingest_io_backend, memory_order_relaxed);
+#ifdef GSL_HAVE_LIBURING
+    struct io_uring ring;
+#endif
+
+    if (backend)
+        return backend;
+
+#ifdef GSL_HAVE_LIBURING
+    // Nothing is ingested yet: the same setup of a ring, which fails where io_uring is off
+    if (io_uring_queue_init(1, &ring, 0) == 0) {
+        io_uring_queue_exit(&ring);
+        return "io_uring";
+    }
+#endif
+    return "pread";
+}
+
+// --------------------------------------------------------------------------------
+// Dispatcher
+
+struct gslIngestCursor {
+    size_t file_idx;
+    off_t offset;
+
+    // Incomplete tail of the last processed buffer.  It's carried into the reserved
+    // space of the next buffer of the same file.
+    struct gslIngestBuf *tail_buf;
+    const char *tail;
+    size_t tail_size;
+
+    size_t rec_idx;
+};
+
+static gsl_err_t
+gsl_ingest_open(struct gslIngest *self, size_t file_idx)
+{
+    struct gslIngestFile *file = &self->files[file_idx];
+    struct stat st;
+
+    file->fd = open(file->path, O_RDONLY | O_CLOEXEC);
+    if (file->fd < 0) {
+        if (DEBUG_INGEST_LEVEL_1)
+            gsl_log("-- cannot open \"%s\": %d", file->path, errno);
+        return make_gsl_desc_err(gsl_FAIL, file->path, (int)strlen(file->path));
+    }
+    if (fstat(file->fd, &st)) {
+        close(file->fd);
+        file->fd = -1;
+        return make_gsl_desc_err(gsl_FAIL, file->path, (int)strlen(file->path));
+    }
+    file->size = st.st_size;
+    return make_gsl_err(gsl_OK);
+}
+
+static void
+gsl_ingest_close(struct gslIngest *self, size_t file_idx)
+{
+    struct gslIngestFile *file = &self->files[file_idx];
+    if (file->fd >= 0)
+        close(file->fd);
+    file->fd = -1;
+}
+
+// Takes the next chunk of the files and submits its read into |buf|.  Returns false if
+// there is nothing left to read.
+static bool
+gsl_ingest_submit_next(struct gslIngest *self, struct gslIngestCursor *cursor,
+                       struct gslIngestBuf *buf)
+{
+    struct gslIngestFile *file;
+    gsl_err_t err;
+
+    for (; cursor->file_idx < self->num_files; cursor->file_idx++, cursor->offset = 0) {
+        file = &self->files[cursor->file_idx];
+
+        if (!cursor->offset) {
+            err = gsl_ingest_open(self, cursor->file_idx);
+            if (err.code) {
+                gsl_ingest_fail(self, err);
+                return false;
+            }
+        }
+        if (cursor->offset < file->size)
+            break;
+
+        // Example: an empty file
+        gsl_ingest_close(self, cursor->file_idx);
+    }
+    if (cursor->file_idx == self->num_files)
+        return false;
+
+    file = &self->files[cursor->file_idx];
+
+    buf->file_idx = cursor->file_idx;
+    buf->offset = cursor->offset;
+    buf->size = (size_t)(file->size - cursor->offset) < self->opts.buf_size ?
+                (size_t)(file->size - cursor->offset) : self->opts.buf_size;
+    buf->done_size = 0;
+    buf->io_errno = 0;
+    buf->is_done = false;
+    atomic_store_explicit(&buf->refs, 1, memory_order_relaxed);
+
+    if (DEBUG_INGEST_LEVEL_2)
+        gsl_log(".. read \"%s\" [%lld, +%zu) into buf #%d",
+                file->path, (long long)buf->offset, buf->size, buf->idx);
+
+    gsl_ingest_io_submit(self, buf);
+
+    cursor->offset += (off_t)buf->size;
+    if (cursor->offset == file->size) {
+        cursor->file_idx++;
+        cursor->offset = 0;
+    }
+    return true;
+}
+
+static void
+gsl_ingest_process(struct gslIngest *self, struct gslIngestCursor *cursor,
+                   struct gslIngestBuf *buf)
+{
+    struct gslIngestFile *file = &self->files[buf->file_idx];
+    struct gslRecord records[GSL_INGEST_MAX_SPLIT_RECORDS];
+    size_t num_records, total_size;
+    char *c = buf->mem + self->opts.max_record_size;
+    const char *end = c + buf->size;
+    const bool is_last = buf->offset + (off_t)buf->size == file->size;
+    gsl_err_t err;
+
+    if (buf->io_errno || buf->done_size != buf->size) {
+        if (DEBUG_INGEST_LEVEL_1)
+            gsl_log("-- cannot read \"%s\": %d", file->path, buf->io_errno);
+        gsl_ingest_fail(self, make_gsl_desc_err(gsl_FAIL, file->path, (int)strlen(file->path)));
+        goto done;
+    }
+
+    if (cursor->tail_buf) {
+        // Tails never cross file boundaries, so the tail belongs to the same file.
+        c -= cursor->tail_size;
+        memcpy(c, cursor->tail, cursor->tail_size);
+        gsl_ingest_buf_release(self, cursor->tail_buf);
+        cursor->tail_buf = NULL;
+        cursor->tail_size = 0;
+    }
+
+    do {
+        err = gsl_split_records(c, end - c, records, GSL_INGEST_MAX_SPLIT_RECORDS, &num_records, &total_size);
+        if (err.code && err.code != gsl_LIMIT) {
+            gsl_ingest_fail(self, err);
+            goto done;
+        }
+
+        for (size_t i = 0; i < num_records; i++) {
+            struct gslIngestItem item = {
+                .rec = records[i].rec,
+                .rec_size = records[i].rec_size,
+                .rec_idx = cursor->rec_idx++,
+                .buf = buf
+            };
+            atomic_fetch_add_explicit(&buf->refs, 1, memory_order_relaxed);
+            // The queue is closed only after the dispatcher is done.
+            gsl_mpmc_push(self->items, &item);
+        }
+        c += total_size;
+    } while (err.code == gsl_LIMIT);
+
+    if (c != end) {
+        if (is_last) {
+            // Example: the file ends with "... {user {name Jo"
+            if (DEBUG_INGEST_LEVEL_1)
+                gsl_log("-- incomplete record at the end of \"%s\"", file->path);
+            gsl_ingest_fail(self, make_gsl_desc_err(gsl_FORMAT, file->path, (int)strlen(file->path)));
+            goto done;
+        }
+        if ((size_t)(end - c) > self->opts.max_record_size) {
+            if (DEBUG_INGEST_LEVEL_1)
+                gsl_log("-- record in \"%s\" is longer than %zu", file->path, self->opts.max_record_size);
+            gsl_ingest_fail(self, make_gsl_desc_err(gsl_LIMIT, file->path, (int)strlen(file->path)));
+            goto done;
+        }
+
+        // Keep the dispatcher's reference until the tail is copied.
+        cursor->tail_buf = buf;
+        cursor->tail = c;
+        cursor->tail_size = end - c;
+        return;
+    }
+
+done:
+    if (is_last)
+        gsl_ingest_close(self, buf->file_idx);
+    gsl_ingest_buf_release(self, buf);
+}
+
+static void
+gsl_ingest_dispatch(struct gslIngest *self)
+{
+    struct gslIngestCursor cursor = { 0 };
+    struct gslIngestBuf **in_flight;
+    size_t head = 0, num_in_flight = 0;
+    struct gslIngestBuf *buf;
+    bool has_more = true;
+
+    in_flight = calloc(self->opts.num_bufs, sizeof *in_flight);
+    if (!in_flight) {
+        gsl_ingest_fail(self, make_gsl_err(gsl_FAIL));
+        return;
+    }
+
+    for (;;) {
+        // Read ahead into all the free buffers.
+        while (has_more && !gsl_ingest_is_failed(self)) {
+            buf = gsl_ingest_buf_acquire(self, false);
+            if (!buf) break;
+
+            has_more = gsl_ingest_submit_next(self, &cursor, buf);
+            if (!has_more) {
+                gsl_ingest_buf_put(self, buf);
+                break;
+            }
+            in_flight[(head + num_in_flight++) % self->opts.num_bufs] = buf;
+        }
+
+        if (!num_in_flight) {
+            if (!has_more || gsl_ingest_is_failed(self))
+                break;
+
+            // Example: all the buffers are held by records waiting for parser workers
+            buf = gsl_ingest_buf_acquire(self, true);
+            gsl_ingest_buf_put(self, buf);
+            continue;
+        }
+
+        // Buffers are processed in order of submission, whatever order reads complete in.
+        buf = in_flight[head];
+        head = (head + 1) % self->opts.num_bufs;
+        num_in_flight--;
+
+        gsl_ingest_io_wait(self, buf);
+
+        if (gsl_ingest_is_failed(self)) {
+            // Files are closed at cleanup: other reads from them may still be in flight.
+            gsl_ingest_buf_release(self, buf);
+            continue;
+        }
+        gsl_ingest_process(self, &cursor, buf);
+    }
+
+    if (cursor.tail_buf)
+        gsl_ingest_buf_release(self, cursor.tail_buf);
+    free(in_flight);
+}
+
+gsl_err_t
+gsl_ingest_pipeline(const char *const *paths, size_t num_paths,
+                    const struct gslIngestOptions *options,
+                    struct gslBatchWorker *workers, size_t num_workers,
+                    struct gslIngestConsumer *consumers, size_t num_consumers)
+{
+    struct gslIngest self = { .err = { .code = gsl_OK } };
+    struct gslIngestWorker *threads = NULL;
+    struct gslIngestConsumerThread *consumer_threads = NULL;
+    size_t num_started = 0, num_consumers_started = 0;
+    size_t buf_mem_size;
+    bool has_io = false;
+
+    if (options)
+        self.opts = *options;
+    if (!self.opts.buf_size)
+        self.opts.buf_size = GSL_INGEST_DEFAULT_BUF_SIZE;
+    if (!self.opts.max_record_size)
+        self.opts.max_record_size = self.opts.buf_size;
+    if (!self.opts.num_bufs)
+        self.opts.num_bufs = GSL_INGEST_DEFAULT_NUM_BUFS;
+    if (!self.opts.num_io_threads)
+        self.opts.num_io_threads = GSL_INGEST_DEFAULT_NUM_IO_THREADS;
+    if (!self.opts.queue_size)
+        self.opts.queue_size = GSL_INGEST_DEFAULT_QUEUE_SIZE;
+    if (!self.opts.out_queue_size)
+        self.opts.out_queue_size = GSL_INGEST_DEFAULT_QUEUE_SIZE;
+    if (!self.opts.batch_size)
+        self.opts.batch_size = GSL_INGEST_DEFAULT_BATCH_SIZE;
+    if (self.opts.batch_size > GSL_INGEST_MAX_BATCH_SIZE)
+        self.opts.batch_size = GSL_INGEST_MAX_BATCH_SIZE;
+
+    // One buffer may hold the tail of a record while the next one is being read.
+    if (self.opts.num_bufs < 2 || !num_workers)
+        return make_gsl_err(gsl_FAIL);
+
+    atomic_init(&self.is_failed, false);
+    pthread_mutex_init(&self.lock, NULL);
+    pthread_cond_init(&self.buf_released, NULL);
+
+    buf_mem_size = self.opts.max_record_size + self.opts.buf_size;
+    self.num_files = num_paths;
+    self.files = calloc(num_paths ? num_paths : 1, sizeof *self.files);
+    self.bufs = calloc(self.opts.num_bufs, sizeof *self.bufs);
+    self.mem = malloc(self.opts.num_bufs * buf_mem_size);
+    threads = calloc(num_workers, sizeof *threads);
+    consumer_threads = calloc(num_consumers ? num_consumers : 1, sizeof *consumer_threads);
+    if (!self.files || !self.bufs || !self.mem || !threads || !consumer_threads ||
+        gsl_mpmc_create(self.opts.queue_size, sizeof(struct gslIngestItem), &self.items).code ||
+        (num_consumers && gsl_mpmc_create(self.opts.out_queue_size, sizeof(void *), &self.outs).code)) {
+        self.err = make_gsl_err(gsl_FAIL);
+        goto cleanup;
+    }
+
+    for (size_t i = 0; i < num_paths; i++) {
+        self.files[i].path = paths[i];
+        self.files[i].fd = -1;
+    }
+    for (size_t i = self.opts.num_bufs; i > 0; i--) {
+        struct gslIngestBuf *buf = &self.bufs[i - 1];
+        buf->mem = self.mem + (i - 1) * buf_mem_size;
+        buf->idx = (int)(i - 1);
+        atomic_init(&buf->refs, 0);
+        buf->next = self.free_bufs;
+        self.free_bufs = buf;
+    }
+
+    if (gsl_ingest_io_init(&self)) {
+        self.err = make_gsl_err(gsl_FAIL);
+        goto cleanup;
+    }
+    has_io = true;
+
+    for (; num_consumers_started < num_consumers; num_consumers_started++) {
+        consumer_threads[num_consumers_started].ingest = &self;
+        consumer_threads[num_consumers_started].consumer = &consumers[num_consumers_started];
+        if (pthread_create(&consumer_threads[num_consumers_started].thread, NULL, gsl_ingest_consumer,
+                           &consumer_threads[num_consumers_started]))
+            break;
+    }
+    if (num_consumers && !num_consumers_started) {
+        self.err = make_gsl_err(gsl_FAIL);
+        goto cleanup;
+    }
+
+    for (; num_started < num_workers; num_started++) {
+        threads[num_started].ingest = &self;
+        threads[num_started].worker = &workers[num_started];
+        if (pthread_create(&threads[num_started].thread, NULL, gsl_ingest_worker, &threads[num_started]))
+            break;
+    }
+    if (!num_started) {
+        self.err = make_gsl_err(gsl_FAIL);
+        goto cleanup;
+    }
+
+    gsl_ingest_dispatch(&self);
+
+cleanup:
+    // Every stage drains its queue before the next one is closed.
+    if (self.items)
+        gsl_mpmc_close(self.items);
+    for (size_t i = 0; i < num_started; i++)
+        pthread_join(threads[i].thread, NULL);
+    if (self.outs)
+        gsl_mpmc_close(self.outs);
+    for (size_t i = 0; i < num_consumers_started; i++)
+        pthread_join(consumer_threads[i].thread, NULL);
+    if (has_io)
+        gsl_ingest_io_fini(&self);
+    for (size_t i = 0; i < num_paths && self.files; i++)
+        gsl_ingest_close(&self, i);
+
+    gsl_mpmc_destroy(self.outs);
+    gsl_mpmc_destroy(self.items);
+    free(consumer_threads);
+    free(threads);
+    free(self.mem);
+    free(self.bufs);
+    free(self.files);
+    pthread_cond_destroy(&self.buf_released);
+    pthread_mutex_destroy(&self.lock);
+
+    return self.err;
+}
+
+gsl_err_t
+gsl_ingest_files(const char *const *paths, size_t num_paths,
+                 const struct gslIngestOptions *options,
+                 struct gslBatchWorker *workers, size_t num_workers)
+{
+    return gsl_ingest_pipeline(paths, num_paths, options, workers, num_workers, NULL, 0);
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+// Declarations shared between the library modules.  Not a part of the public API.
+
+#include "gsl-parser.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Counting for gslStats.  Everything compiles to nothing without GSL_STATS.
+#ifdef GSL_STATS
+extern _Thread_local struct gslStats gsl_thread_stats;
+extern _Thread_local size_t gsl_thread_depth;
+
+#define GSL_STAT_ADD(field, n) (gsl_thread_stats.field += (n))
+#define GSL_STAT_INC(field) GSL_STAT_ADD(field, 1)
+
+// Brackets an entry point of the parser.  Only the outermost call counts the bytes,
+// nested ones are parts of them.
+static inline void
+gsl_stats_enter(void)
+{
+    if (++gsl_thread_depth > gsl_thread_stats.max_depth)
+        gsl_thread_stats.max_depth = gsl_thread_depth;
+}
+
+static inline void
+gsl_stats_leave(size_t total_size)
+{
+    if (!--gsl_thread_depth)
+        gsl_thread_stats.bytes_scanned += total_size;
+}
+
+#define GSL_STAT_ENTER() gsl_stats_enter()
+#define GSL_STAT_LEAVE(total_size) gsl_stats_leave(total_size)
+#else
+#define GSL_STAT_ADD(field, n) ((void)0)
+#define GSL_STAT_INC(field) ((void)0)
+#define GSL_STAT_ENTER() ((void)0)
+#define GSL_STAT_LEAVE(total_size) ((void)0)
+#endif
+
+// The context of the parse the calling thread runs, see gsl_ctx.h.  NULL outside of
+// gsl_ctx_parse(), and then a parser call costs a thread-local load and a branch.
+extern _Thread_local struct gslCtx *gsl_thread_ctx;
+
+extern gsl_err_t gsl_ctx_depth_exceeded(struct gslCtx *self, const char *rec, size_t *total_size);
+extern void gsl_ctx_set_error(struct gslCtx *self, gsl_err_t err, const char *pos);
+
+// Brackets an entry point of the parser: counts the depth against the limit of the
+// context and records where the error is coming from.
+#define GSL_CTX_ENTER(rec, total_size)                                                          \
+    do {                                                                                        \
+        struct gslCtx *ctx_ = gsl_thread_ctx;                                                   \
+        if (ctx_ && ++ctx_->depth > ctx_->options.max_depth && ctx_->options.max_depth)         \
+            return gsl_ctx_depth_exceeded(ctx_, (rec), (total_size));                           \
+    } while (0)
+
+static inline gsl_err_t
+gsl_ctx_leave(gsl_err_t err, const char *pos)
+{
+    struct gslCtx *ctx = gsl_thread_ctx;
+
+    if (!ctx) return err;
+
+    if (err.code)
+        gsl_ctx_set_error(ctx, err, pos);
+    else if (ctx->error.code && ctx->error.depth > ctx->depth)
+        // Example: a callback has recovered from the error of a nested call
+        ctx->error.code = gsl_OK;
+    ctx->depth--;
+    return err;
+}
+
+// Checks of the specs passed by the caller and of the parser invariants.  With GSL_CHECKED
+// a violation fails the call with gsl_INVALID and the condition as the description;
+// without it the checks compile to nothing and the specs are trusted.
+#ifdef GSL_CHECKED
+extern gsl_err_t gsl_check_failed(const char *cond, const char *file, int line);
+
+#define GSL_CHECK(cond)                                                       \
+    do {                                                                      \
+        if (!(cond)) return gsl_check_failed(#cond, __FILE__, __LINE__);      \
+    } while (0)
+#else
+#define GSL_CHECK(cond) ((void)0)
+#endif
+
+// Timing of the callbacks for gsl_profile_report().  Everything compiles to nothing
+// without GSL_PROFILE.
+#ifdef GSL_PROFILE
+extern void gsl_profile_begin(const char *tag, size_t tag_size, gsl_profile_kind_t kind);
+extern void gsl_profile_end(void);
+
+#define GSL_PROFILE_BEGIN(tag, tag_size, kind) gsl_profile_begin((tag), (tag_size), (kind))
+#define GSL_PROFILE_END() gsl_profile_end()
+#else
+#define GSL_PROFILE_BEGIN(tag, tag_size, kind) ((void)0)
+#define GSL_PROFILE_END() ((void)0)
+#endif
+
+// Binary trace, see gsl_trace.h.  A trace point is a relaxed load and a branch while the
+// trace is off.
+extern atomic_bool gsl_trace_is_on;
+extern void gsl_trace_emit(gsl_trace_event_t event, const char *pos, size_t spec_idx, int arg);
+// gsl_trace_dump() after a line about the failed record number |rec_idx|.
+extern void gsl_trace_dump_failed(FILE *file, size_t rec_idx, gsl_err_t err, size_t total_size,
+                                  const char *rec);
+
+#define GSL_TRACE(event, pos, spec_idx, arg)                                  \
+    do {                                                                      \
+        if (atomic_load_explicit(&gsl_trace_is_on, memory_order_relaxed))     \
+            gsl_trace_emit((event), (pos), (spec_idx), (arg));                \
+    } while (0)
+
+// Growable buffer for null-terminated copies of records.
+struct gslScratch {
+    char *buf;
+    size_t max_buf_size;
+};
+
+// Parses a null-terminated copy of |rec| by |worker|, under |ctx| if it's not NULL.  See
+// gsl_parse_batch().
+extern gsl_err_t gsl_batch_parse_record(struct gslBatchWorker *worker, struct gslScratch *scratch,
+                                        struct gslCtx *ctx, size_t rec_idx, const char *rec, size_t rec_size);
+
+// Scratch of the worker number |worker_idx| of |self|, for the records it parses.
+extern struct gslScratch *gsl_pool_scratch(struct gslPool *self, size_t worker_idx);
+
+// gsl_parse_task() with an optional precomputed index of |specs| by tag.
+extern gsl_err_t gsl_parse_task_lookup(const char *rec, size_t *total_size,
+                                       struct gslTaskSpec *specs, size_t num_specs,
+                                       gsl_spec_lookup_t lookup);
+
+// gsl_parse_task() of the top-level fields of |rec| up to |end|: the opening brace of a
+// field to stop at, or the closing brace of the record.  The default spec is not checked
+// for: the caller does it once all the ranges of the record are parsed, see
+// gsl_parse_task_pool().
+extern gsl_err_t gsl_parse_task_range(const char *rec, const char *end, size_t *total_size,
+                                      struct gslTaskSpec *specs, size_t num_specs);
+// Steps of gsl_parse_task() done by gsl_parse_task_pool() after the ranges.
+extern gsl_err_t gsl_spec_buf_copy(struct gslTaskSpec *spec, const char *val, size_t val_size);
+extern gsl_err_t gsl_check_default(const char *rec, struct gslTaskSpec *specs, size_t num_specs);
+
+#define GSL_SCAN_CHUNK_MAX_LOWS (GSL_READER_MAX_DEPTH + 2)
+
+// Braces of [begin, end) of a record, counted from wherever the scan starts as if it were
+// out of comments and cdata: that's the guess gsl_parse_task_pool() checks later.  A
+// comment or cdata opened in the chunk is skipped as a whole, up to |buf_end|.
+struct gslScanChunk {
+    const char *begin;
+    const char *end;
+    const char *buf_end;
+
+    // Results, the depths are relative to the start of the scan.
+    const char *resume;     // where the scan of the next chunk should start: |end|, or past it
+    ptrdiff_t depth;        // at |resume|
+    const char *first_top;  // first closing brace back to the depth 0, or NULL
+    const char *lows[GSL_SCAN_CHUNK_MAX_LOWS];  // the first closing brace down to -(i + 1)
+    size_t num_lows;
+};
+
+extern void gsl_validate_chunk(struct gslScanChunk *self, const char *c);
+
+// Trie of the tag paths of gsl_projection_create() and gsl_filter_create(), see
+// gslPath.  A node is a tag of a path, or the "[]" after it; siblings are few, so they
+// are just a list.
+struct gslPathNode {
+    const char *name;
+    size_t name_size;
+    struct gslPathNode *parent;
+    struct gslPathNode *first_child;
+    struct gslPathNode *next_sibling;
+    struct gslPathNode *items;  // "[]"
+
+    // Of a projection.
+    void *obj;
+    gsl_err_t (*run)(void *obj, const char *val, size_t val_size);
+
+    // Of a filter, bit i stands for the predicate i.
+    uint64_t preds;   // on the field
+    uint64_t scoped;  // decided by the close of the field
+};
+
+// |nodes| and |names| are allocated by the owner of the trie, as counted by
+// gsl_path_trie_count(); node 0 is the top of the record.
+struct gslPathTrie {
+    struct gslPathNode *nodes;
+    size_t num_nodes;
+    char *names;
+};
+
+static inline const struct gslPathNode *
+gsl_path_node_child(const struct gslPathNode *self, const char *name, size_t name_size)
+{
+    const struct gslPathNode *node;
+
+    for (node = self->first_child; node; node = node->next_sibling) {
+        if (node->name_size == name_size && !memcmp(node->name, name, name_size))
+            return node;
+    }
+    return NULL;
+}
+
+// Adds to |*max_nodes| and |*names_size| what |path| can take, its "[]" node included.
+extern void gsl_path_trie_count(const char *path, size_t *max_nodes, size_t *names_size);
+extern void gsl_path_trie_init(struct gslPathTrie *self, struct gslPathNode *nodes, char *names);
+// Finds or adds the nodes of |path|, |*node| is set to the last one.  gsl_INVALID with
+// |path| in the description if it's malformed.
+extern gsl_err_t gsl_path_trie_add(struct gslPathTrie *self, const char *path, struct gslPathNode **node);
+// The "[]" node of |node|, found or added.
+extern struct gslPathNode *gsl_path_trie_items(struct gslPathTrie *self, struct gslPathNode *node);
@@ -0,0 +1,313 @@
+#include "internal.h"
+#include "gsl-parser/gsl_log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define DEBUG_OBJECT_LEVEL_1 0
+#define DEBUG_OBJECT_LEVEL_2 0
+
+// Binds a field description to the object being parsed.
+struct gslObjectField {
+    const struct gslFieldSpec *field;
+    char *obj;
+    struct gslArena *arena;
+};
+
+struct gslObjectRecord {
+    const struct gslObjectSpec *spec;
+    void *obj;
+    struct gslArena *arena;
+};
+
+static gsl_err_t
+gsl_object_next_item(struct gslObjectField *self, size_t *idx)
+{
+    size_t *count = (size_t *)(self->obj + self->field->count_offset);
+
+    if (*count == self->field->max_items) {
+        if (DEBUG_OBJECT_LEVEL_1)
+            gsl_log("-- %.*s: list limit reached: %zu",
+                    (int)self->field->name_size, self->field->name, self->field->max_items);
+        return make_gsl_err(gsl_LIMIT);
+    }
+
+    *idx = (*count)++;
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t
+gsl_object_run_str_item(void *obj, const char *val, size_t val_size)
+{
+    struct gslObjectField *self = (struct gslObjectField *)obj;
+    const struct gslFieldSpec *field = self->field;
+    size_t idx;
+    gsl_err_t err;
+
+    if (val_size > field->max_size) {
+        if (DEBUG_OBJECT_LEVEL_1)
+            gsl_log("-- %.*s: item limit reached: %zu max: %zu",
+                    (int)field->name_size, field->name, val_size, field->max_size);
+        return make_gsl_err(gsl_LIMIT);
+    }
+
+    err = gsl_object_next_item(self, &idx);
+    if (err.code) return err;
+
+    memcpy(self->obj + field->offset + idx * field->item_size, val, val_size);
+    ((size_t *)(self->obj + field->size_offset))[idx] = val_size;
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t
+gsl_object_run_arena_str(void *obj, const char *val, size_t val_size)
+{
+    struct gslObjectField *self = (struct gslObjectField *)obj;
+    const struct gslFieldSpec *field = self->field;
+    struct gslStr *str = (struct gslStr *)(self->obj + field->offset);
+    size_t idx;
+    gsl_err_t err;
+
+    // Same errors as of .buf specs.
+    if (!val_size)
+        return make_gsl_err(gsl_FORMAT);
+    if (field->max_size && val_size > field->max_size)
+        return make_gsl_err(gsl_LIMIT);
+    if (!self->arena) {
+        if (DEBUG_OBJECT_LEVEL_1)
+            gsl_log("-- %.*s: no arena for the string", (int)field->name_size, field->name);
+        return make_gsl_err(gsl_FAIL);
+    }
+
+    if (field->is_list) {
+        err = gsl_object_next_item(self, &idx);
+        if (err.code) return err;
+        str += idx;
+    } else if (str->size) {
+        return make_gsl_err(gsl_EXISTS);
+    }
+
+    return gsl_arena_set_str(self->arena, str, val, val_size);
+}
+
+static gsl_err_t
+gsl_object_run_size_t(void *obj, const char *val, size_t val_size)
+{
+    struct gslObjectField *self = (struct gslObjectField *)obj;
+    const struct gslFieldSpec *field = self->field;
+    size_t *num = (size_t *)(self->obj + field->offset);
+    size_t idx;
+    gsl_err_t err;
+
+    // Example: rec = "{age}"
+    if (!val_size)
+        return make_gsl_err(gsl_FORMAT);
+
+    if (field->is_list) {
+        err = gsl_object_next_item(self, &idx);
+        if (err.code) return err;
+        num += idx;
+    }
+
+    return gsl_run_set_size_t(num, val, val_size);
+}
+
+static gsl_err_t
+gsl_object_parse_object(void *obj, const char *rec, size_t *total_size)
+{
+    struct gslObjectField *self = (struct gslObjectField *)obj;
+    const struct gslFieldSpec *field = self->field;
+    char *item = self->obj + field->offset;
+    size_t idx;
+    gsl_err_t err;
+
+    if (field->is_list) {
+        err = gsl_object_next_item(self, &idx);
+        if (err.code) return *total_size = 0, err;
+        item += idx * field->item_size;
+    }
+
+    return gsl_parse_object(field->object, item, self->arena, rec, total_size);
+}
+
+static gsl_err_t
+gsl_object_run_default(void *obj, const char *val, size_t val_size)
+{
+    // Example: rec = "{user}"  -- all the fields are optional
+    (void)obj; (void)val; (void)val_size;
+    return make_gsl_err(gsl_OK);
+}
+
+gsl_err_t
+gsl_parse_object(const struct gslObjectSpec *spec, void *obj, struct gslArena *arena,
+                 const char *rec, size_t *total_size)
+{
+    struct gslTaskSpec specs[GSL_OBJECT_MAX_FIELDS + 1];
+    struct gslTaskSpec item_specs[GSL_OBJECT_MAX_FIELDS];
+    struct gslObjectField fields[GSL_OBJECT_MAX_FIELDS];
+    char *base = (char *)obj;
+
+    // Example: a hand-written spec, the generated ones are checked by gsl_schema_gen
+    if (spec->num_fields > GSL_OBJECT_MAX_FIELDS) {
+        if (DEBUG_OBJECT_LEVEL_1)
+            gsl_log("-- %.*s: %zu fields, at most %d",
+                    (int)spec->tag_size, spec->tag, spec->num_fields, GSL_OBJECT_MAX_FIELDS);
+        return *total_size = 0, make_gsl_err(gsl_LIMIT);
+    }
+
+    if (DEBUG_OBJECT_LEVEL_2)
+        gsl_log(".. parse object \"%.*s\": \"%.*s\"", (int)spec->tag_size, spec->tag, 16, rec);
+
+    memset(obj, 0, spec->size);
+
+    for (size_t i = 0; i < spec->num_fields; i++) {
+        const struct gslFieldSpec *field = &spec->fields[i];
+        struct gslTaskSpec *item_spec = &item_specs[i];
+
+        fields[i] = (struct gslObjectField){ .field = field, .obj = base, .arena = arena };
+        specs[i] = (struct gslTaskSpec){
+            .name = field->is_implied ? NULL : field->name,
+            .name_size = field->is_implied ? 0 : field->name_size,
+            .is_implied = field->is_implied
+        };
+
+        if (field->is_list) {
+            // Example: rec = "[groups a b c]"  or  "[groups {a} {b}]"
+            *item_spec = (struct gslTaskSpec){ .is_list_item = true, .obj = &fields[i] };
+            switch (field->kind) {
+            case GSL_FIELD_STR:       item_spec->run = gsl_object_run_str_item; break;
+            case GSL_FIELD_ARENA_STR: item_spec->run = gsl_object_run_arena_str; break;
+            case GSL_FIELD_SIZE_T:    item_spec->run = gsl_object_run_size_t; break;
+            case GSL_FIELD_OBJECT:    item_spec->parse = gsl_object_parse_object; break;
+            }
+            specs[i].type = GSL_GET_ARRAY_STATE;
+            specs[i].parse = gsl_parse_array;
+            specs[i].obj = item_spec;
+            continue;
+        }
+
+        switch (field->kind) {
+        case GSL_FIELD_STR:
+            specs[i].buf = base + field->offset;
+            specs[i].buf_size = (size_t *)(base + field->size_offset);
+            specs[i].max_buf_size = field->max_size;
+            break;
+        case GSL_FIELD_ARENA_STR:
+            specs[i].run = gsl_object_run_arena_str;
+            specs[i].obj = &fields[i];
+            break;
+        case GSL_FIELD_SIZE_T:
+            specs[i].run = gsl_object_run_size_t;
+            specs[i].obj = &fields[i];
+            break;
+        case GSL_FIELD_OBJECT:
+            specs[i].parse = gsl_object_parse_object;
+            specs[i].obj = &fields[i];
+            break;
+        }
+    }
+
+    // Indices of the fields and of the specs match, so |spec->lookup| applies as is.
+    specs[spec->num_fields] = (struct gslTaskSpec){
+        .is_default = true, .run = gsl_object_run_default, .obj = obj
+    };
+
+    return gsl_parse_task_lookup(rec, total_size, specs, spec->num_fields + 1, spec->lookup);
+}
+
+static gsl_err_t
+gsl_object_parse_record(void *obj, const char *rec, size_t *total_size)
+{
+    struct gslObjectRecord *self = (struct gslObjectRecord *)obj;
+    return gsl_parse_object(self->spec, self->obj, self->arena, rec, total_size);
+}
+
+gsl_err_t
+gsl_parse_object_record(const struct gslObjectSpec *spec, void *obj, struct gslArena *arena,
+                        const char *rec, size_t *total_size)
+{
+    struct gslObjectRecord record = { .spec = spec, .obj = obj, .arena = arena };
+    struct gslTaskSpec specs[] = {
+        { .name = spec->tag, .name_size = spec->tag_size,
+          .parse = gsl_object_parse_record, .obj = &record }
+    };
+
+    return gsl_parse_task(rec, total_size, specs, sizeof specs / sizeof specs[0]);
+}
+
+// --------------------------------------------------------------------------------
+// Emitter
+
+void
+gsl_emit_raw(struct gslEmitter *self, const char *val, size_t val_size)
+{
+    if (self->err.code)
+        return;
+    if (val_size > self->max_size - self->size) {
+        self->err = make_gsl_err(gsl_LIMIT);
+        return;
+    }
+    memcpy(self->buf + self->size, val, val_size);
+    self->size += val_size;
+}
+
+// Checks that the parser would read |val| back the same.  Values are trimmed and can't
+// contain braces, list items can't contain spaces and dashes either.
+static bool
+gsl_emit_is_valid(const char *val, size_t val_size, bool is_item)
+{
+    if (!val_size)
+        return false;
+
+    for (size_t i = 0; i < val_size; i++) {
+        switch (val[i]) {
+        case '{':
+        case '}':
+        case '[':
+        case ']':
+            return false;
+        case '-':
+            if (is_item) return false;
+            break;
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+            if (is_item || i == 0 || i == val_size - 1) return false;
+            break;
+        }
+    }
+    return true;
+}
+
+void
+gsl_emit_value(struct gslEmitter *self, const char *val, size_t val_size)
+{
+    if (!gsl_emit_is_valid(val, val_size, false)) {
+        if (!self->err.code)
+            self->err = make_gsl_desc_err(gsl_FORMAT, val, (int)val_size);
+        return;
+    }
+    gsl_emit_raw(self, " ", 1);
+    gsl_emit_raw(self, val, val_size);
+}
+
+void
+gsl_emit_item(struct gslEmitter *self, const char *val, size_t val_size)
+{
+    if (!gsl_emit_is_valid(val, val_size, true)) {
+        if (!self->err.code)
+            self->err = make_gsl_desc_err(gsl_FORMAT, val, (int)val_size);
+        return;
+    }
+    gsl_emit_raw(self, " ", 1);
+    gsl_emit_raw(self, val, val_size);
+}
+
+void
+gsl_emit_size_t(struct gslEmitter *self, size_t val)
+{
+    char buf[32];
+    int buf_size = snprintf(buf, sizeof buf, " %zu", val);
+    gsl_emit_raw(self, buf, (size_t)buf_size);
+}
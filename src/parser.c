@@ -1,6 +1,4 @@
-#undef NDEBUG  // For developing
-
-#include "gsl-parser.h"
+#include "internal.h"
 #include "gsl-parser/config.h"
 #include "gsl-parser/gsl_log.h"
 
@@ -11,10 +9,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-/* numeric conversion by strtol */
-#include <errno.h>
-#include <limits.h>
-
 #define DEBUG_PARSER_LEVEL_1 0
 #define DEBUG_PARSER_LEVEL_2 0
 #define DEBUG_PARSER_LEVEL_3 0
@@ -35,6 +29,7 @@ gsl_check_floating_boundary(char repeatee, size_t count,
     do {
         c++;
     } while (*c == repeatee);
+    GSL_STAT_ADD(bytes_visited, c - rec);
 
     *total_size = c - rec;
     return count == (size_t)(c - rec) && *c == end_marker;
@@ -45,10 +40,10 @@ gsl_run_set_size_t(void *obj,
                    const char *val, size_t val_size)
 {
     size_t *self = (size_t *)obj;
-    char *num_end;
-    unsigned long long num;
+    size_t num = 0;
+    unsigned digit;
 
-    assert(val && val_size != 0);
+    GSL_CHECK(val && val_size != 0);
 
     if (!isdigit(val[0])) {
         if (DEBUG_PARSER_LEVEL_1)
@@ -57,36 +52,27 @@ gsl_run_set_size_t(void *obj,
         return make_gsl_err(gsl_FORMAT);
     }
 
-    errno = 0;
-    num = strtoull(val, &num_end, GSL_NUM_ENCODE_BASE);  // FIXME(k15tfu): Null-terminated string is expected
-    if (errno == ERANGE && num == ULLONG_MAX) {
-        if (DEBUG_PARSER_LEVEL_1)
-            gsl_log("-- num limit reached: %.*s max: %llu",
-                    (int)val_size, val, ULLONG_MAX);
-        return make_gsl_err(gsl_LIMIT);
-    }
-    else if (errno != 0 && num == 0) {
-        if (DEBUG_PARSER_LEVEL_1)
-            gsl_log("-- cannot convert \"%.*s\" to num: %d",
-                    (int)val_size, val, errno);
-        return make_gsl_err(gsl_FORMAT);
-    }
-
-    if (val + val_size != num_end) {
-        if (DEBUG_PARSER_LEVEL_1)
-            gsl_log("-- not all characters in \"%.*s\" were parsed: \"%.*s\"",
-                    (int)val_size, val, (int)(num_end - val), val);
-        return make_gsl_err(gsl_FORMAT);
-    }
+    // Converted in place rather than by strtoull(): the value isn't null-terminated, and
+    // errno is shared with everything else the calling thread does.
+    for (size_t i = 0; i < val_size; i++) {
+        digit = (unsigned)(val[i] - '0');
+        if (digit >= GSL_NUM_ENCODE_BASE) {
+            if (DEBUG_PARSER_LEVEL_1)
+                gsl_log("-- not all characters in \"%.*s\" were parsed: \"%.*s\"",
+                        (int)val_size, val, (int)i, val);
+            return make_gsl_err(gsl_FORMAT);
+        }
 
-    if (ULLONG_MAX > SIZE_MAX && num > SIZE_MAX) {
-        if (DEBUG_PARSER_LEVEL_1)
-            gsl_log("-- num size_t limit reached: %llu max: %llu",
-                    num, (unsigned long long)SIZE_MAX);
-        return make_gsl_err(gsl_LIMIT);
+        if (num > (SIZE_MAX - digit) / GSL_NUM_ENCODE_BASE) {
+            if (DEBUG_PARSER_LEVEL_1)
+                gsl_log("-- num size_t limit reached: %.*s max: %zu",
+                        (int)val_size, val, (size_t)SIZE_MAX);
+            return make_gsl_err(gsl_LIMIT);
+        }
+        num = num * GSL_NUM_ENCODE_BASE + digit;
     }
 
-    *self = (size_t)num;
+    *self = num;
     if (DEBUG_PARSER_LEVEL_3)
         gsl_log("++ got num size_t: %zu",
                 *self);
@@ -116,113 +102,115 @@ gsl_parse_size_t(void *obj,
     return make_gsl_err(gsl_OK);
 }
 
-static int
-gsl_spec_is_correct(struct gslTaskSpec *spec)
+#ifdef GSL_CHECKED
+// Checks that |spec| is properly filled: returns gsl_INVALID with the violated condition.
+static gsl_err_t
+gsl_check_spec(const struct gslTaskSpec *spec)
 {
     if (DEBUG_PARSER_LEVEL_4)
         gsl_log(".. check spec: \"%.*s\"..", spec->name_size, spec->name);
 
     // Check the fields are not mutually exclusive (by groups):
 
-    assert(spec->type == GSL_GET_STATE || spec->type == GSL_GET_ARRAY_STATE ||
-           spec->type == GSL_SET_STATE || spec->type == GSL_SET_ARRAY_STATE);
+    GSL_CHECK(spec->type == GSL_GET_STATE || spec->type == GSL_GET_ARRAY_STATE ||
+              spec->type == GSL_SET_STATE || spec->type == GSL_SET_ARRAY_STATE);
 
-    assert((spec->name != NULL) == (spec->name_size != 0));
+    GSL_CHECK((spec->name != NULL) == (spec->name_size != 0));
 
-    assert(!spec->is_completed);
+    GSL_CHECK(!spec->is_completed);
 
     if (spec->is_default)
-        assert(!spec->is_selector && !spec->is_implied && !spec->is_list_item);
+        GSL_CHECK(!spec->is_selector && !spec->is_implied && !spec->is_list_item);
     if (spec->is_selector)
-        assert(!spec->is_default && !spec->is_list_item);
+        GSL_CHECK(!spec->is_default && !spec->is_list_item);
     if (spec->is_implied)
-        assert(!spec->is_default && !spec->is_list_item);
+        GSL_CHECK(!spec->is_default && !spec->is_list_item);
     if (spec->is_list_item)
-        assert(!spec->is_default && !spec->is_selector && !spec->is_implied);
+        GSL_CHECK(!spec->is_default && !spec->is_selector && !spec->is_implied);
 
-    assert((spec->buf != NULL) == (spec->buf_size != NULL));
-    assert((spec->buf != NULL) == (spec->max_buf_size != 0));
+    GSL_CHECK((spec->buf != NULL) == (spec->buf_size != NULL));
+    GSL_CHECK((spec->buf != NULL) == (spec->max_buf_size != 0));
     if (spec->buf)
-        assert(*spec->buf_size == 0);
+        GSL_CHECK(*spec->buf_size == 0);
 
-    // ?? assert(spec->obj == NULL);
+    // ?? GSL_CHECK(spec->obj == NULL);
 
     if (spec->buf)
-        assert(spec->run == NULL && spec->parse == NULL && spec->validate == NULL);
+        GSL_CHECK(spec->run == NULL && spec->parse == NULL && spec->validate == NULL);
     if (spec->parse)
-        assert(spec->buf == NULL && spec->run == NULL && spec->validate == NULL);
+        GSL_CHECK(spec->buf == NULL && spec->run == NULL && spec->validate == NULL);
     if (spec->validate)
-        assert(spec->buf == NULL && spec->run == NULL && spec->parse == NULL);
+        GSL_CHECK(spec->buf == NULL && spec->run == NULL && spec->parse == NULL);
     if (spec->run)
-        assert(spec->buf == NULL && spec->parse == NULL && spec->validate == NULL);
+        GSL_CHECK(spec->buf == NULL && spec->parse == NULL && spec->validate == NULL);
 
     // Check that they are not mutually exclusive (in general):
 
     if (spec->type == GSL_SET_STATE) {
-        assert(!spec->is_default && (!spec->is_implied || spec->name != NULL) && !spec->is_list_item);
-        // ?? assert(spec->name != NULL);
+        GSL_CHECK(!spec->is_default && (!spec->is_implied || spec->name != NULL) && !spec->is_list_item);
+        // ?? GSL_CHECK(spec->name != NULL);
     } else if (spec->type == GSL_GET_ARRAY_STATE || spec->type == GSL_SET_ARRAY_STATE) {
-        assert(!spec->is_default && !spec->is_implied && !spec->is_list_item);
-        assert(spec->name != NULL || spec->validate != NULL);  // FIXME(k15tfu)
-        assert(spec->obj != NULL);
-        assert(spec->parse != NULL || spec->validate != NULL);
+        GSL_CHECK(!spec->is_default && !spec->is_implied && !spec->is_list_item);
+        GSL_CHECK(spec->name != NULL || spec->validate != NULL);  // FIXME(k15tfu)
+        GSL_CHECK(spec->obj != NULL);
+        GSL_CHECK(spec->parse != NULL || spec->validate != NULL);
     }
 
     if (spec->name) {
         // |spec->type| can be set
-        assert(!spec->is_default && !spec->is_list_item);
-        assert(spec->validate == NULL);
+        GSL_CHECK(!spec->is_default && !spec->is_list_item);
+        GSL_CHECK(spec->validate == NULL);
     }
 
     if (spec->is_default) {
-        assert(spec->type == 0);  // type is useless for default_spec
-        assert(spec->name == NULL);
-        assert(spec->obj != NULL);
-        assert(spec->run != NULL);
+        GSL_CHECK(spec->type == 0);  // type is useless for default_spec
+        GSL_CHECK(spec->name == NULL);
+        GSL_CHECK(spec->obj != NULL);
+        GSL_CHECK(spec->run != NULL);
     }
 
     if (spec->is_implied) {
-        assert(spec->type == 0 || spec->name != NULL);
+        GSL_CHECK(spec->type == 0 || spec->name != NULL);
         // |spec->name| can be set
-        assert(spec->obj != NULL || spec->buf != NULL);
-        assert(spec->run != NULL || spec->buf != NULL);
+        GSL_CHECK(spec->obj != NULL || spec->buf != NULL);
+        GSL_CHECK(spec->run != NULL || spec->buf != NULL);
     }
 
     if (spec->is_list_item) {
-        assert(spec->type == 0);  // type is useless for list items
-        assert(spec->name == NULL);
-        assert(spec->obj != NULL);
-        assert(spec->buf == NULL);
-        assert(spec->validate == NULL);
-        assert(spec->run != NULL || spec->parse != NULL);
+        GSL_CHECK(spec->type == 0);  // type is useless for list items
+        GSL_CHECK(spec->name == NULL);
+        GSL_CHECK(spec->obj != NULL);
+        GSL_CHECK(spec->buf == NULL);
+        GSL_CHECK(spec->validate == NULL);
+        GSL_CHECK(spec->run != NULL || spec->parse != NULL);
     }
 
-    assert(spec->obj != NULL || spec->buf != NULL);
+    GSL_CHECK(spec->obj != NULL || spec->buf != NULL);
 
     if (spec->buf) {
         // |spec->type| can be set (depends on |spec->name|)
-        assert(!spec->is_default && !spec->is_list_item);
-        assert(spec->name != NULL || spec->is_implied);
-        assert(spec->obj == NULL);
+        GSL_CHECK(!spec->is_default && !spec->is_list_item);
+        GSL_CHECK(spec->name != NULL || spec->is_implied);
+        GSL_CHECK(spec->obj == NULL);
     }
 
     if (spec->run) {
         // |spec->type| can be set (depends on |spec->name|)
-        assert(spec->name != NULL || spec->is_default || spec->is_implied || spec->is_list_item);
-        assert(spec->obj != NULL);
+        GSL_CHECK(spec->name != NULL || spec->is_default || spec->is_implied || spec->is_list_item);
+        GSL_CHECK(spec->obj != NULL);
     }
 
     if (spec->parse) {
         // |spec->type| can be set
-        assert(!spec->is_default && !spec->is_implied);
-        assert(spec->name != NULL || spec->is_list_item);
-        assert(spec->obj != NULL);
+        GSL_CHECK(!spec->is_default && !spec->is_implied);
+        GSL_CHECK(spec->name != NULL || spec->is_list_item);
+        GSL_CHECK(spec->obj != NULL);
     }
 
     if (spec->validate) {
         // |spec->type| can be set
-        assert(spec->name == NULL);
-        assert(spec->obj != NULL);
+        GSL_CHECK(spec->name == NULL);
+        GSL_CHECK(spec->obj != NULL);
     }
 
     // Test plans:
@@ -259,13 +247,43 @@ gsl_spec_is_correct(struct gslTaskSpec *spec)
     //     gsl_check_default:
     //       } - NOT TESTED!
     //       ) - NOT TESTED!
-    assert(spec->name != NULL || spec->is_default || spec->is_implied || spec->is_list_item || spec->validate != NULL);
-    assert(spec->buf != NULL || spec->run != NULL || spec->parse != NULL || spec->validate != NULL);
+    GSL_CHECK(spec->name != NULL || spec->is_default || spec->is_implied || spec->is_list_item || spec->validate != NULL);
+    GSL_CHECK(spec->buf != NULL || spec->run != NULL || spec->parse != NULL || spec->validate != NULL);
+
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t
+gsl_check_task_specs(const struct gslTaskSpec *specs, size_t num_specs)
+{
+    gsl_err_t err;
+
+    for (size_t i = 0; i < num_specs; i++) {
+        err = gsl_check_spec(&specs[i]);
+        if (err.code) return err;
+    }
+    return make_gsl_err(gsl_OK);
+}
 
-    return 1;
+static gsl_err_t
+gsl_check_list_item_spec(const struct gslTaskSpec *spec)
+{
+    GSL_CHECK(spec->type == 0);  // type is useless for list items
+    GSL_CHECK(spec->name == NULL);
+    GSL_CHECK(spec->run != NULL || spec->parse != NULL);
+    return gsl_check_spec(spec);
 }
 
 static gsl_err_t
+gsl_check_cdata_spec(const struct gslTaskSpec *spec)
+{
+    GSL_CHECK(spec->type == GSL_GET_STATE || spec->type == GSL_SET_STATE);
+    GSL_CHECK(spec->buf != NULL || spec->run != NULL);
+    return gsl_check_spec(spec);
+}
+#endif
+
+gsl_err_t
 gsl_spec_buf_copy(struct gslTaskSpec *spec,
                   const char *val, size_t val_size)
 {
@@ -294,6 +312,7 @@ gsl_spec_buf_copy(struct gslTaskSpec *spec,
 
     memcpy(spec->buf, val, val_size);
     *spec->buf_size = val_size;
+    GSL_STAT_INC(bufs);
 
     return make_gsl_err(gsl_OK);
 }
@@ -304,18 +323,33 @@ gsl_find_spec(const char *name,
               gsl_task_spec_type spec_type,
               struct gslTaskSpec *specs,
               size_t num_specs,
+              gsl_spec_lookup_t lookup,
               struct gslTaskSpec **out_spec)
 {
     struct gslTaskSpec *spec;
     struct gslTaskSpec *validator_spec = NULL;
 
+    GSL_STAT_INC(spec_lookups);
+
+    if (lookup) {
+        // Precomputed index of the named specs, see gsl_parse_object().  Anything it
+        // doesn't resolve (validators, other types) falls back to the scan below.
+        int idx = lookup(name, name_size);
+        if (idx >= 0 && (size_t)idx < num_specs && specs[idx].type == spec_type) {
+            GSL_CHECK(specs[idx].name_size == name_size && !memcmp(specs[idx].name, name, name_size));
+            *out_spec = &specs[idx];
+            GSL_STAT_INC(spec_index_hits);
+            return make_gsl_err(gsl_OK);
+        }
+    }
+
     for (size_t i = 0; i < num_specs; i++) {
         spec = &specs[i];
 
         if (spec->type != spec_type) continue;
 
         if (spec->validate) {
-            assert(validator_spec == NULL && "validator_spec was already specified");
+            GSL_CHECK(validator_spec == NULL && "validator_spec was already specified");
             validator_spec = spec;
             continue;
         }
@@ -333,6 +367,8 @@ gsl_find_spec(const char *name,
                     "GET_ARRAY" : spec_type == GSL_SET_STATE ? "SET" : "SET_ARRAY",
                 validator_spec);
 
+    GSL_STAT_INC(spec_misses);
+
     if (validator_spec) {
         *out_spec = validator_spec;
         return make_gsl_err(gsl_OK);
@@ -354,9 +390,9 @@ gsl_check_matching_closing_brace(const char *c, gsl_task_spec_type in_field_type
             return make_gsl_err(gsl_OK);
         break;
     default:
-        assert(0 && "no closing brace found");
+        GSL_CHECK(0 && "no closing brace found");
     case '\0': // TODO(k15tfu): remove this case and return gsl_FORMAT at the end of gsl_parse_task()
-        // Avoid an assert() for \0 symbol.
+        // Avoid a failed check for \0 symbol.
         break;
     }
 
@@ -374,7 +410,7 @@ gsl_check_implied_field(const char *val, size_t val_size,
     struct gslTaskSpec *implied_spec = NULL;
     gsl_err_t err;
 
-    assert(val_size && "implied val is empty");
+    GSL_CHECK(val_size && "implied val is empty");
 
     if (DEBUG_PARSER_LEVEL_3)
         gsl_log("++ got implied val: \"%.*s\" [%zu]",
@@ -384,7 +420,7 @@ gsl_check_implied_field(const char *val, size_t val_size,
         spec = &specs[i];
 
         if (spec->is_implied) {
-            assert(implied_spec == NULL && "implied_spec was already specified");
+            GSL_CHECK(implied_spec == NULL && "implied_spec was already specified");
             implied_spec = spec;
         }
     }
@@ -401,15 +437,22 @@ gsl_check_implied_field(const char *val, size_t val_size,
         gsl_log("++ got implied spec: \"%.*s\" buf: %p run: %p!",
                 implied_spec->name_size, implied_spec->name, implied_spec->buf, implied_spec->run);
 
+    GSL_TRACE(GSL_TRACE_IMPLIED, val, implied_spec - specs, 0);
+
     if (implied_spec->buf) {
         err = gsl_spec_buf_copy(implied_spec, val, val_size);
         if (err.code) return err;
 
         implied_spec->is_completed = true;
+        GSL_STAT_INC(implied_fields);
         return make_gsl_err(gsl_OK);
     }
 
+    GSL_STAT_INC(runs);
+    GSL_PROFILE_BEGIN(implied_spec->name ? implied_spec->name : "(implied)",
+                      implied_spec->name ? implied_spec->name_size : strlen("(implied)"), GSL_PROFILE_RUN);
     err = implied_spec->run(implied_spec->obj, val, val_size);
+    GSL_PROFILE_END();
     if (err.code) {
         if (DEBUG_PARSER_LEVEL_1)
             gsl_log("-- implied func for \"%.*s\" failed: %d :(",
@@ -418,6 +461,7 @@ gsl_check_implied_field(const char *val, size_t val_size,
     }
 
     implied_spec->is_completed = true;
+    GSL_STAT_INC(implied_fields);
     return make_gsl_err(gsl_OK);
 }
 
@@ -427,6 +471,7 @@ gsl_check_field_tag(const char *name,
                     gsl_task_spec_type type,
                     struct gslTaskSpec *specs,
                     size_t num_specs,
+                    gsl_spec_lookup_t lookup,
                     struct gslTaskSpec **out_spec)
 {
     gsl_err_t err;
@@ -441,7 +486,7 @@ gsl_check_field_tag(const char *name,
         gsl_log("++ BASIC LOOP got tag after brace: \"%.*s\" [%zu]",
                 name_size, name, name_size);
 
-    err = gsl_find_spec(name, name_size, type, specs, num_specs, out_spec);
+    err = gsl_find_spec(name, name_size, type, specs, num_specs, lookup, out_spec);
     if (err.code) {
         if (DEBUG_PARSER_LEVEL_1)
             gsl_log("-- no spec found to handle the \"%.*s\" tag: %d",
@@ -453,6 +498,8 @@ gsl_check_field_tag(const char *name,
         gsl_log("++ got SPEC: \"%.*s\" (default: %d) (is validator: %d)",
                 (*out_spec)->name_size, (*out_spec)->name, (*out_spec)->is_default, (*out_spec)->validate != NULL);
 
+    GSL_STAT_INC(fields[type]);
+    GSL_TRACE(GSL_TRACE_FIELD, name, *out_spec - specs, type);
     return make_gsl_err(gsl_OK);
 }
 
@@ -466,11 +513,14 @@ gsl_parse_field_value(const char *name,
 {
     gsl_err_t err;
 
-    assert(name_size && "name is empty");
-    assert(!*in_terminal && "gsl_parse_field_value is called for terminal value");
+    GSL_CHECK(name_size && "name is empty");
+    GSL_CHECK(!*in_terminal && "gsl_parse_field_value is called for terminal value");
 
     if (spec->validate) {
+        GSL_STAT_INC(validates);
+        GSL_PROFILE_BEGIN(name, name_size, GSL_PROFILE_VALIDATE);
         err = spec->validate(spec->obj, name, name_size, rec, total_size);
+        GSL_PROFILE_END();
         if (err.code) {
             if (DEBUG_PARSER_LEVEL_2)
                 gsl_log("-- ERR: %d validation spec for \"%.*s\" failed :(",
@@ -487,7 +537,10 @@ gsl_parse_field_value(const char *name,
             gsl_log("\n    >>> further parsing required in \"%.*s\" FROM: \"%.*s\" FUNC: %p",
                     spec->name_size, spec->name, 16, rec, spec->parse);
 
+        GSL_STAT_INC(parses);
+        GSL_PROFILE_BEGIN(spec->name, spec->name_size, GSL_PROFILE_PARSE);
         err = spec->parse(spec->obj, rec, total_size);
+        GSL_PROFILE_END();
         if (err.code) {
             if (DEBUG_PARSER_LEVEL_2)
                 gsl_log("-- ERR: %d parsing of spec \"%.*s\" failed :(",
@@ -518,7 +571,7 @@ gsl_check_field_terminal_value(const char *val, size_t val_size,
         gsl_log("++ got terminal val: \"%.*s\" [%zu]",
                 val_size, val, val_size);
 
-    assert(spec->parse == NULL && spec->validate == NULL && "spec for terminal val has .parse or .validate");
+    GSL_CHECK(spec->parse == NULL && spec->validate == NULL && "spec for terminal val has .parse or .validate");
 
     if (spec->buf) {
         err = gsl_spec_buf_copy(spec, val, val_size);
@@ -528,7 +581,10 @@ gsl_check_field_terminal_value(const char *val, size_t val_size,
         return make_gsl_err(gsl_OK);
     }
 
+    GSL_STAT_INC(runs);
+    GSL_PROFILE_BEGIN(spec->name, spec->name_size, GSL_PROFILE_RUN);
     err = spec->run(spec->obj, val, val_size);
+    GSL_PROFILE_END();
     if (err.code) {
         if (DEBUG_PARSER_LEVEL_1)
             gsl_log("-- \"%.*s\" func run failed: %d :(",
@@ -540,7 +596,7 @@ gsl_check_field_terminal_value(const char *val, size_t val_size,
     return make_gsl_err(gsl_OK);
 }
 
-static gsl_err_t
+gsl_err_t
 gsl_check_default(const char *rec,
                   struct gslTaskSpec *specs,
                   size_t num_specs) {
@@ -552,7 +608,7 @@ gsl_check_default(const char *rec,
         spec = &specs[i];
 
         if (spec->is_default) {
-            assert(default_spec == NULL && "default_spec was already specified");
+            GSL_CHECK(default_spec == NULL && "default_spec was already specified");
             default_spec = spec;
             continue;
         }
@@ -568,7 +624,11 @@ gsl_check_default(const char *rec,
         return make_gsl_err(gsl_NO_MATCH);
     }
 
+    GSL_STAT_INC(runs);
+    GSL_TRACE(GSL_TRACE_DEFAULT, rec, default_spec - specs, 0);
+    GSL_PROFILE_BEGIN("(default)", strlen("(default)"), GSL_PROFILE_RUN);
     err = default_spec->run(default_spec->obj, NULL, 0);
+    GSL_PROFILE_END();
     if (err.code) {
         if (DEBUG_PARSER_LEVEL_1)
             gsl_log("-- default func run failed: %d :(",
@@ -579,22 +639,23 @@ gsl_check_default(const char *rec,
     return make_gsl_err(gsl_OK);
 }
 
-static gsl_err_t
-gsl_parse_comment(gsl_task_spec_type in_field_type,
-                  const char *rec,
-                  size_t *total_size)
+gsl_err_t
+gsl_scan_comment(const char *rec,
+                 char closing_brace,
+                 size_t *total_size)
 {
     const char *c;
-    const char closing_brace = in_field_type == GSL_GET_STATE || in_field_type == GSL_SET_STATE ? '}' : ']';
 
     size_t dash_count = 0;
     for (c = rec; *c == '-'; c++)
         dash_count++;
+    GSL_STAT_ADD(bytes_visited, dash_count);
 
     size_t chunk_size;
     gsl_err_t err;
 
     for (; *c; c++) {
+        GSL_STAT_INC(bytes_visited);
         if (*c != '-') continue;
 
         err.code = !gsl_check_floating_boundary('-', dash_count, closing_brace, c, &chunk_size);
@@ -607,19 +668,46 @@ gsl_parse_comment(gsl_task_spec_type in_field_type,
         c += chunk_size;
 
         *total_size = c - rec;
+        GSL_STAT_ADD(comment_bytes, *total_size);
         return make_gsl_err(gsl_OK);
     }
 
     if (DEBUG_PARSER_LEVEL_1)
         gsl_log("-- no matching closing sequence -%zutimes %c found: \"%.*s\"",
-                dash_count, (in_field_type == GSL_GET_STATE || in_field_type == GSL_SET_STATE ? '}' : ']'), 16, rec);
+                dash_count, closing_brace, 16, rec);
+    *total_size = c - rec;
     return make_gsl_err(gsl_FORMAT);
 }
 
+static gsl_err_t
+gsl_parse_comment(gsl_task_spec_type in_field_type,
+                  const char *rec,
+                  size_t *total_size)
+{
+    const char closing_brace = in_field_type == GSL_GET_STATE || in_field_type == GSL_SET_STATE ? '}' : ']';
+    gsl_err_t err;
+
+    err = gsl_scan_comment(rec, closing_brace, total_size);
+    GSL_TRACE(GSL_TRACE_COMMENT, rec, GSL_TRACE_NO_SPEC, (int)*total_size);
+    return err;
+}
+
 gsl_err_t gsl_parse_task(const char *rec,
                          size_t *total_size,
                          struct gslTaskSpec *specs,
                          size_t num_specs)
+{
+    return gsl_parse_task_lookup(rec, total_size, specs, num_specs, NULL);
+}
+
+// |end| is NULL, or see gsl_parse_task_range().
+static gsl_err_t
+gsl_parse_task_fields(const char *rec,
+                      const char *end,
+                      size_t *total_size,
+                      struct gslTaskSpec *specs,
+                      size_t num_specs,
+                      gsl_spec_lookup_t lookup)
 {
     const char *b, *c, *e;
 
@@ -642,11 +730,8 @@ gsl_err_t gsl_parse_task(const char *rec,
         gsl_log("\n\n*** start basic PARSING: \"%.*s\" num specs: %zu [%p]",
                 16, rec, num_specs, specs);
 
-    // Check gslTaskSpec is properly filled
-    for (size_t i = 0; i < num_specs; i++)
-        assert(gsl_spec_is_correct(&specs[i]));
-
     while (*c) {
+        GSL_STAT_INC(bytes_visited);
         switch (*c) {
         case '!':
             if (!in_field) {
@@ -711,7 +796,7 @@ gsl_err_t gsl_parse_task(const char *rec,
             // Example: rec = "{name ...
             //                      ^  -- handle a tag
 
-            err = gsl_check_field_tag(b, e - b, in_field_type, specs, num_specs, &spec);
+            err = gsl_check_field_tag(b, e - b, in_field_type, specs, num_specs, lookup, &spec);
             if (err.code) return *total_size = c - rec, err;
 
             err = gsl_parse_field_value(b, e - b, spec, c, &chunk_size, &in_terminal);
@@ -766,6 +851,13 @@ gsl_err_t gsl_parse_task(const char *rec,
                     in_implied_field = false;
                 }
 
+                if (c == end) {
+                    // Example: rec = "{name John} jsmith {sid 1}..."
+                    //                                    ^  -- |end|: the next range starts here
+                    *total_size = c - rec;
+                    return make_gsl_err(gsl_OK);
+                }
+
                 in_field = true;
                 in_field_type = *c == '{' ? GSL_GET_STATE : GSL_GET_ARRAY_STATE;
                 // in_tag == false
@@ -775,7 +867,7 @@ gsl_err_t gsl_parse_task(const char *rec,
                 break;
             }
 
-            assert(in_tag == in_terminal);
+            GSL_CHECK(in_tag == in_terminal);
 
             if (in_terminal) {  // or in_tag
                 // Example: rec = "{name John {Smith}}"
@@ -797,7 +889,7 @@ gsl_err_t gsl_parse_task(const char *rec,
             //      or: rec = "[groups{...
             //                        ^  -- same way
 
-            err = gsl_check_field_tag(b, e - b, in_field_type, specs, num_specs, &spec);
+            err = gsl_check_field_tag(b, e - b, in_field_type, specs, num_specs, lookup, &spec);
             if (err.code) return *total_size = c - rec, err;
 
             err = gsl_parse_field_value(b, e - b, spec, c, &chunk_size, &in_terminal);
@@ -846,14 +938,16 @@ gsl_err_t gsl_parse_task(const char *rec,
                     in_implied_field = false;
                 }
 
-                err = gsl_check_default(rec, specs, num_specs);
-                if (err.code) return *total_size = c - rec, err;
+                if (!end) {
+                    err = gsl_check_default(rec, specs, num_specs);
+                    if (err.code) return *total_size = c - rec, err;
+                }
 
                 *total_size = c - rec;
                 return make_gsl_err(gsl_OK);
             }
 
-            assert(in_tag == in_terminal);
+            GSL_CHECK(in_tag == in_terminal);
 
             // Closing brace in a field
             // Example: rec = "{name John Smith}"
@@ -881,7 +975,7 @@ gsl_err_t gsl_parse_task(const char *rec,
             // Example: rec = "{name}"
             //                      ^  -- handle a tag
 
-            err = gsl_check_field_tag(b, e - b, in_field_type, specs, num_specs, &spec);
+            err = gsl_check_field_tag(b, e - b, in_field_type, specs, num_specs, lookup, &spec);
             if (err.code) return *total_size = c - rec, err;
 
             err = gsl_parse_field_value(b, e - b, spec, c, &chunk_size, &in_terminal);  // TODO(k15tfu): allow in_terminal parsing
@@ -923,7 +1017,7 @@ gsl_err_t gsl_parse_task(const char *rec,
                 return make_gsl_err(gsl_OK);
             }
 
-            assert(in_tag == in_terminal);
+            GSL_CHECK(in_tag == in_terminal);
 
             // Closing brace in a field
             // Example: rec = "[groups]
@@ -933,13 +1027,13 @@ gsl_err_t gsl_parse_task(const char *rec,
             if (err.code) return *total_size = c - rec, err;
 
             // terminal value is not used with lists
-            assert(!in_terminal);
+            GSL_CHECK(!in_terminal);
 
             // Parse a tag after a closing brace ']' in a field.  Means in_tag can be set to true.
             // Example: rec = "[groups]"
             //                        ^  -- handle a tag
 
-            err = gsl_check_field_tag(b, e - b, in_field_type, specs, num_specs, &spec);
+            err = gsl_check_field_tag(b, e - b, in_field_type, specs, num_specs, lookup, &spec);
             if (err.code) return *total_size = c - rec, err;
 
             err = gsl_parse_field_value(b, e - b, spec, c, &chunk_size, &in_terminal);  // TODO(k15tfu): allow in_terminal parsing
@@ -947,7 +1041,7 @@ gsl_err_t gsl_parse_task(const char *rec,
             // ?? assert(chunk_size == 0);
 
             // terminal value is not used with lists
-            assert(!in_terminal);
+            GSL_CHECK(!in_terminal);
 
             in_field = false;
             in_field_type = -1;
@@ -998,17 +1092,58 @@ default_case:
     return make_gsl_err(gsl_OK);
 }
 
-gsl_err_t
-gsl_parse_array(void *obj,
-                const char *rec,
-                size_t *total_size)
+// Both entry points of gsl_parse_task_fields().
+static gsl_err_t
+gsl_parse_task_bounded(const char *rec,
+                       const char *end,
+                       size_t *total_size,
+                       struct gslTaskSpec *specs,
+                       size_t num_specs,
+                       gsl_spec_lookup_t lookup)
 {
-    struct gslTaskSpec *spec = (struct gslTaskSpec *)obj;
+    gsl_err_t err;
+
+    GSL_CTX_ENTER(rec, total_size);
+
+#ifdef GSL_CHECKED
+    *total_size = 0;  // where a failed check leaves it
+    err = gsl_check_task_specs(specs, num_specs);
+    if (err.code) return gsl_ctx_leave(err, rec);
+#endif
+
+    GSL_STAT_ENTER();
+    GSL_TRACE(GSL_TRACE_ENTER, rec, GSL_TRACE_NO_SPEC, 0);
+    err = gsl_parse_task_fields(rec, end, total_size, specs, num_specs, lookup);
+    GSL_TRACE(GSL_TRACE_LEAVE, rec + *total_size, GSL_TRACE_NO_SPEC, err.code);
+    GSL_STAT_LEAVE(*total_size);
 
-    assert(spec->type == 0);  // type is useless for list items
-    assert(spec->name == NULL);
-    assert(spec->run != NULL || spec->parse != NULL);
-    assert(gsl_spec_is_correct(spec));
+    return gsl_ctx_leave(err, rec + *total_size);
+}
+
+gsl_err_t gsl_parse_task_lookup(const char *rec,
+                                size_t *total_size,
+                                struct gslTaskSpec *specs,
+                                size_t num_specs,
+                                gsl_spec_lookup_t lookup)
+{
+    return gsl_parse_task_bounded(rec, NULL, total_size, specs, num_specs, lookup);
+}
+
+gsl_err_t gsl_parse_task_range(const char *rec,
+                               const char *end,
+                               size_t *total_size,
+                               struct gslTaskSpec *specs,
+                               size_t num_specs)
+{
+    return gsl_parse_task_bounded(rec, end, total_size, specs, num_specs, NULL);
+}
+
+static gsl_err_t
+gsl_parse_array_items(void *obj,
+                      const char *rec,
+                      size_t *total_size)
+{
+    struct gslTaskSpec *spec = (struct gslTaskSpec *)obj;
 
     const char *b, *c, *e;
 
@@ -1023,6 +1158,7 @@ gsl_parse_array(void *obj,
     e = rec;
 
     while (*c) {
+        GSL_STAT_INC(bytes_visited);
         switch (*c) {
         case '-':
         case '}':
@@ -1041,13 +1177,18 @@ gsl_parse_array(void *obj,
                 break;
             }
 
-            assert(is_atomic);  // |is_item| is used only with atomic elements
+            GSL_CHECK(is_atomic);  // |is_item| is used only with atomic elements
 
             if (DEBUG_PARSER_LEVEL_3)
                 gsl_log("  == got new item: \"%.*s\"",
                         (int)(e - b), b);
 
+            GSL_STAT_INC(list_items);
+            GSL_STAT_INC(runs);
+            GSL_TRACE(GSL_TRACE_ITEM, b, GSL_TRACE_NO_SPEC, 0);
+            GSL_PROFILE_BEGIN(NULL, 0, GSL_PROFILE_RUN);
             err = spec->run(spec->obj, b, e - b);
+            GSL_PROFILE_END();
             if (err.code) return *total_size = c - rec, err;
 
             in_item = false;
@@ -1064,7 +1205,12 @@ gsl_parse_array(void *obj,
             // Example: rec = "{user...
             //                 ^  -- allocate an element
 
+            GSL_STAT_INC(list_items);
+            GSL_STAT_INC(parses);
+            GSL_TRACE(GSL_TRACE_ITEM, c, GSL_TRACE_NO_SPEC, 0);
+            GSL_PROFILE_BEGIN(NULL, 0, GSL_PROFILE_PARSE);
             err = spec->parse(spec->obj, c + 1, &chunk_size);
+            GSL_PROFILE_END();
             if (err.code) return *total_size = c + chunk_size - rec, err;
 
             // Example: rec = "{user Sam}]
@@ -1081,13 +1227,18 @@ gsl_parse_array(void *obj,
                 // Example: rec = "... jsmith]
                 //                     ^^^^^^  -- handle the last item
 
-                assert(is_atomic);  // |is_item| is used only with atomic elements
+                GSL_CHECK(is_atomic);  // |is_item| is used only with atomic elements
 
                 if (DEBUG_PARSER_LEVEL_3)
                     gsl_log("  == got new item: \"%.*s\"",
                             (int)(e - b), b);
 
+                GSL_STAT_INC(list_items);
+                GSL_STAT_INC(runs);
+                GSL_TRACE(GSL_TRACE_ITEM, b, GSL_TRACE_NO_SPEC, 0);
+                GSL_PROFILE_BEGIN(NULL, 0, GSL_PROFILE_RUN);
                 err = spec->run(spec->obj, b, e - b);
+                GSL_PROFILE_END();
                 if (err.code) return *total_size = c - rec, err;
 
                 in_item = false;
@@ -1113,15 +1264,35 @@ gsl_parse_array(void *obj,
 }
 
 gsl_err_t
-gsl_parse_cdata(void *obj,
+gsl_parse_array(void *obj,
                 const char *rec,
                 size_t *total_size)
 {
-    struct gslTaskSpec *spec = (struct gslTaskSpec *)obj;
+    gsl_err_t err;
+
+    GSL_CTX_ENTER(rec, total_size);
+
+#ifdef GSL_CHECKED
+    *total_size = 0;  // where a failed check leaves it
+    err = gsl_check_list_item_spec(obj);
+    if (err.code) return gsl_ctx_leave(err, rec);
+#endif
+
+    GSL_STAT_ENTER();
+    GSL_TRACE(GSL_TRACE_ENTER, rec, GSL_TRACE_NO_SPEC, 0);
+    err = gsl_parse_array_items(obj, rec, total_size);
+    GSL_TRACE(GSL_TRACE_LEAVE, rec + *total_size, GSL_TRACE_NO_SPEC, err.code);
+    GSL_STAT_LEAVE(*total_size);
 
-    assert(spec->type == GSL_GET_STATE || spec->type == GSL_SET_STATE);
-    assert(spec->buf != NULL || spec->run != NULL);
-    assert(gsl_spec_is_correct(spec));
+    return gsl_ctx_leave(err, rec + *total_size);
+}
+
+static gsl_err_t
+gsl_parse_cdata_value(void *obj,
+                      const char *rec,
+                      size_t *total_size)
+{
+    struct gslTaskSpec *spec = (struct gslTaskSpec *)obj;
 
     bool in_cdata = false;
     size_t num_quotes = 0;
@@ -1143,6 +1314,7 @@ gsl_parse_cdata(void *obj,
     e = b = c;
 
     for (; *c; c++) {
+        GSL_STAT_INC(bytes_visited);
         switch (*c) {
         case '\n':
         case '\r':
@@ -1165,6 +1337,7 @@ gsl_parse_cdata(void *obj,
 
             err = gsl_check_field_terminal_value(b, e - b, spec);
             if (err.code) return *total_size = c - rec, err;
+            GSL_STAT_ADD(cdata_bytes, e - b);
 
             // in_cdata = false;
             //printf("c is %s;;  c + chunk_size is %s\n", c, c + chunk_size);
@@ -1191,3 +1364,27 @@ gsl_parse_cdata(void *obj,
     *total_size = c - rec;
     return make_gsl_err(gsl_FORMAT);
 }
+
+gsl_err_t
+gsl_parse_cdata(void *obj,
+                const char *rec,
+                size_t *total_size)
+{
+    gsl_err_t err;
+
+    GSL_CTX_ENTER(rec, total_size);
+
+#ifdef GSL_CHECKED
+    *total_size = 0;  // where a failed check leaves it
+    err = gsl_check_cdata_spec(obj);
+    if (err.code) return gsl_ctx_leave(err, rec);
+#endif
+
+    GSL_STAT_ENTER();
+    GSL_TRACE(GSL_TRACE_ENTER, rec, GSL_TRACE_NO_SPEC, 0);
+    err = gsl_parse_cdata_value(obj, rec, total_size);
+    GSL_TRACE(GSL_TRACE_LEAVE, rec + *total_size, GSL_TRACE_NO_SPEC, err.code);
+    GSL_STAT_LEAVE(*total_size);
+
+    return gsl_ctx_leave(err, rec + *total_size);
+}
@@ -0,0 +1,440 @@
+#define _GNU_SOURCE  // pthread_setaffinity_np()
+
+#include "internal.h"
+#include "gsl-parser/gsl_log.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DEBUG_POOL_LEVEL_1 0
+
+// Tasks of a deque, a power of 2.  A worker splitting a batch in halves takes a slot per
+// level; a full deque makes gsl_pool_submit() run the task right away.
+#define GSL_POOL_DEQUE_SIZE 1024
+
+// Rounds over the other deques before an idle worker goes to sleep.
+#define GSL_POOL_STEAL_ROUNDS 4
+
+#define GSL_POOL_CACHE_LINE 64
+
+// Chase-Lev deque, the C11 version of "Correct and Efficient Work-Stealing for Weak Memory
+// Models" (Lê et al.) with a fixed array.  The owner pushes and pops at the bottom, the
+// thieves take from the top.
+struct gslPoolDeque {
+    _Alignas(GSL_POOL_CACHE_LINE) atomic_llong top;
+    _Alignas(GSL_POOL_CACHE_LINE) atomic_llong bottom;
+    _Atomic(struct gslPoolTask *) tasks[GSL_POOL_DEQUE_SIZE];
+};
+
+struct gslPoolWorker {
+    struct gslPool *pool;
+    size_t idx;
+    pthread_t thread;
+    size_t victim;    // where the last steal succeeded, the next one starts from there
+
+    struct gslPoolDeque deque;
+
+    struct gslArena arena;
+    struct gslCtx ctx;
+    struct gslScratch scratch;
+};
+
+struct gslPool {
+    struct gslPoolWorker *workers;
+    size_t num_workers;
+    bool pin;
+    size_t first_cpu;
+
+    // Approximate, only for the decision to sleep: a task is counted after it's queued, so
+    // the counter can go below zero for a moment.
+    atomic_size_t num_queued;
+    atomic_size_t num_sleeping;
+    atomic_size_t num_injected;
+    atomic_bool is_stopping;
+
+    // The failure and the sleeping paths are cold, so they are under a lock.
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;  // a task is queued, or the pool is stopping
+    pthread_cond_t done_cond;  // all the tasks of a group are done
+    // Tasks submitted by the threads out of the pool, in order.
+    struct gslPoolTask *injected_first;
+    struct gslPoolTask *injected_last;
+};
+
+static _Thread_local struct gslPoolWorker *gsl_pool_thread_worker;
+
+static bool
+gsl_pool_deque_push(struct gslPoolDeque *self, struct gslPoolTask *task)
+{
+    long long b = atomic_load_explicit(&self->bottom, memory_order_relaxed);
+    long long t = atomic_load_explicit(&self->top, memory_order_acquire);
+
+    if (b - t >= GSL_POOL_DEQUE_SIZE)
+        return false;
+
+    atomic_store_explicit(&self->tasks[b & (GSL_POOL_DEQUE_SIZE - 1)], task, memory_order_relaxed);
+    // A release store rather than a fence: the same code, but the sanitizers see it.
+    atomic_store_explicit(&self->bottom, b + 1, memory_order_release);
+    return true;
+}
+
+static struct gslPoolTask *
+gsl_pool_deque_pop(struct gslPoolDeque *self)
+{
+    long long b = atomic_load_explicit(&self->bottom, memory_order_relaxed) - 1;
+    long long t;
+    struct gslPoolTask *task;
+
+    atomic_store_explicit(&self->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    t = atomic_load_explicit(&self->top, memory_order_relaxed);
+
+    if (t > b) {
+        // Example: empty
+        atomic_store_explicit(&self->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    task = atomic_load_explicit(&self->tasks[b & (GSL_POOL_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (t == b) {
+        // The last task: race the thieves for it.
+        if (!atomic_compare_exchange_strong_explicit(&self->top, &t, t + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed))
+            task = NULL;
+        atomic_store_explicit(&self->bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+static struct gslPoolTask *
+gsl_pool_deque_steal(struct gslPoolDeque *self)
+{
+    long long t = atomic_load_explicit(&self->top, memory_order_acquire);
+    long long b;
+    struct gslPoolTask *task;
+
+    atomic_thread_fence(memory_order_seq_cst);
+    b = atomic_load_explicit(&self->bottom, memory_order_acquire);
+    if (t >= b)
+        return NULL;
+
+    task = atomic_load_explicit(&self->tasks[t & (GSL_POOL_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&self->top, &t, t + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed))
+        return NULL;  // Example: the owner or another thief took it
+    return task;
+}
+
+static void
+gsl_pool_notify(struct gslPool *self)
+{
+    atomic_fetch_add(&self->num_queued, 1);
+    if (atomic_load(&self->num_sleeping)) {
+        pthread_mutex_lock(&self->lock);
+        pthread_cond_signal(&self->work_cond);
+        pthread_mutex_unlock(&self->lock);
+    }
+}
+
+static void
+gsl_pool_run_task(struct gslPool *self, struct gslPoolTask *task)
+{
+    // |task| can be gone after |run|, and |group| after the counter is down.
+    struct gslPoolGroup *group = task->group;
+
+    task->run(task);
+
+    if (atomic_fetch_sub_explicit(&group->num_pending, 1, memory_order_acq_rel) == 1) {
+        pthread_mutex_lock(&self->lock);
+        pthread_cond_broadcast(&self->done_cond);
+        pthread_mutex_unlock(&self->lock);
+    }
+}
+
+static struct gslPoolTask *
+gsl_pool_take_injected(struct gslPool *self)
+{
+    struct gslPoolTask *task;
+
+    if (!atomic_load_explicit(&self->num_injected, memory_order_relaxed))
+        return NULL;
+
+    pthread_mutex_lock(&self->lock);
+    task = self->injected_first;
+    if (task) {
+        self->injected_first = task->next;
+        if (!self->injected_first)
+            self->injected_last = NULL;
+        atomic_fetch_sub_explicit(&self->num_injected, 1, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&self->lock);
+    return task;
+}
+
+// Own tasks first (the newest, their data is in the cache), then the ones from out of the
+// pool, then the oldest tasks of the others.
+static struct gslPoolTask *
+gsl_pool_find_task(struct gslPoolWorker *worker)
+{
+    struct gslPool *pool = worker->pool;
+    struct gslPoolTask *task;
+
+    task = gsl_pool_deque_pop(&worker->deque);
+    if (!task)
+        task = gsl_pool_take_injected(pool);
+
+    for (size_t round = 0; !task && round < GSL_POOL_STEAL_ROUNDS; round++) {
+        for (size_t i = 0; !task && i < pool->num_workers; i++) {
+            size_t victim = (worker->victim + i) % pool->num_workers;
+            if (victim == worker->idx) continue;
+
+            task = gsl_pool_deque_steal(&pool->workers[victim].deque);
+            if (task)
+                worker->victim = victim;
+        }
+    }
+
+    if (task)
+        atomic_fetch_sub(&pool->num_queued, 1);
+    return task;
+}
+
+static void
+gsl_pool_pin(struct gslPoolWorker *worker)
+{
+#ifdef __linux__
+    cpu_set_t cpus;
+    size_t cpu = (worker->pool->first_cpu + worker->idx) % CPU_SETSIZE;
+
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    if (pthread_setaffinity_np(pthread_self(), sizeof cpus, &cpus) && DEBUG_POOL_LEVEL_1)
+        gsl_log("-- cannot pin worker #%zu to CPU #%zu", worker->idx, cpu);
+#else
+    (void)worker;
+#endif
+}
+
+static void *
+gsl_pool_worker(void *arg)
+{
+    struct gslPoolWorker *self = (struct gslPoolWorker *)arg;
+    struct gslPool *pool = self->pool;
+    struct gslPoolTask *task;
+
+    gsl_pool_thread_worker = self;
+    if (pool->pin)
+        gsl_pool_pin(self);
+
+    for (;;) {
+        task = gsl_pool_find_task(self);
+        if (task) {
+            gsl_pool_run_task(pool, task);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        atomic_fetch_add(&pool->num_sleeping, 1);
+        while (!atomic_load(&pool->is_stopping) && !atomic_load(&pool->num_queued))
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        atomic_fetch_sub(&pool->num_sleeping, 1);
+        pthread_mutex_unlock(&pool->lock);
+
+        if (atomic_load(&pool->is_stopping))
+            break;
+    }
+
+    gsl_profile_flush();
+    return NULL;
+}
+
+static void
+gsl_pool_stop(struct gslPool *self, size_t num_started)
+{
+    pthread_mutex_lock(&self->lock);
+    atomic_store(&self->is_stopping, true);
+    pthread_cond_broadcast(&self->work_cond);
+    pthread_mutex_unlock(&self->lock);
+
+    for (size_t i = 0; i < num_started; i++)
+        pthread_join(self->workers[i].thread, NULL);
+}
+
+static void
+gsl_pool_free(struct gslPool *self)
+{
+    for (size_t i = 0; i < self->num_workers; i++) {
+        gsl_arena_free(&self->workers[i].arena);
+        free(self->workers[i].scratch.buf);
+    }
+    pthread_cond_destroy(&self->done_cond);
+    pthread_cond_destroy(&self->work_cond);
+    pthread_mutex_destroy(&self->lock);
+    free(self->workers);
+    free(self);
+}
+
+gsl_err_t
+gsl_pool_create(const struct gslPoolOptions *options, struct gslPool **pool)
+{
+    struct gslPoolOptions opts = options ? *options : (struct gslPoolOptions){ 0 };
+    struct gslPool *self;
+    size_t workers_size;
+
+    if (!opts.num_workers) {
+        long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        opts.num_workers = num_cpus > 0 ? (size_t)num_cpus : 1;
+    }
+
+    self = calloc(1, sizeof *self);
+    if (!self)
+        return make_gsl_err(gsl_FAIL);
+
+    // Deques are aligned to cache lines, so are the workers.
+    workers_size = opts.num_workers * sizeof *self->workers;
+    self->workers = aligned_alloc(_Alignof(struct gslPoolWorker), workers_size);
+    if (!self->workers) {
+        free(self);
+        return make_gsl_err(gsl_FAIL);
+    }
+    memset(self->workers, 0, workers_size);
+
+    self->num_workers = opts.num_workers;
+    self->pin = opts.pin;
+    self->first_cpu = opts.first_cpu;
+    atomic_init(&self->num_queued, 0);
+    atomic_init(&self->num_sleeping, 0);
+    atomic_init(&self->num_injected, 0);
+    atomic_init(&self->is_stopping, false);
+    pthread_mutex_init(&self->lock, NULL);
+    pthread_cond_init(&self->work_cond, NULL);
+    pthread_cond_init(&self->done_cond, NULL);
+
+    // Everything is set up before the first thief looks at the others.
+    for (size_t i = 0; i < self->num_workers; i++) {
+        struct gslPoolWorker *worker = &self->workers[i];
+
+        worker->pool = self;
+        worker->idx = i;
+        worker->victim = (i + 1) % self->num_workers;
+        atomic_init(&worker->deque.top, 0);
+        atomic_init(&worker->deque.bottom, 0);
+        gsl_ctx_init(&worker->ctx, &opts.ctx_options);
+        gsl_arena_init_allocator(&worker->arena, opts.arena_chunk_size, &worker->ctx.allocator);
+    }
+
+    for (size_t i = 0; i < self->num_workers; i++) {
+        if (pthread_create(&self->workers[i].thread, NULL, gsl_pool_worker, &self->workers[i])) {
+            if (DEBUG_POOL_LEVEL_1)
+                gsl_log("-- cannot start worker #%zu", i);
+            gsl_pool_stop(self, i);
+            gsl_pool_free(self);
+            return make_gsl_err(gsl_FAIL);
+        }
+    }
+
+    *pool = self;
+    return make_gsl_err(gsl_OK);
+}
+
+void
+gsl_pool_destroy(struct gslPool *self)
+{
+    gsl_pool_stop(self, self->num_workers);
+    gsl_pool_free(self);
+}
+
+size_t
+gsl_pool_num_workers(const struct gslPool *self)
+{
+    return self->num_workers;
+}
+
+size_t
+gsl_pool_worker_idx(void)
+{
+    return gsl_pool_thread_worker ? gsl_pool_thread_worker->idx : SIZE_MAX;
+}
+
+struct gslArena *
+gsl_pool_arena(struct gslPool *self, size_t worker_idx)
+{
+    return &self->workers[worker_idx].arena;
+}
+
+struct gslCtx *
+gsl_pool_ctx(struct gslPool *self, size_t worker_idx)
+{
+    return &self->workers[worker_idx].ctx;
+}
+
+struct gslScratch *
+gsl_pool_scratch(struct gslPool *self, size_t worker_idx)
+{
+    return &self->workers[worker_idx].scratch;
+}
+
+void
+gsl_pool_submit(struct gslPool *self, struct gslPoolGroup *group, struct gslPoolTask *task)
+{
+    struct gslPoolWorker *worker = gsl_pool_thread_worker;
+
+    task->group = group;
+    task->next = NULL;
+    atomic_fetch_add_explicit(&group->num_pending, 1, memory_order_relaxed);
+
+    if (worker && worker->pool == self) {
+        if (!gsl_pool_deque_push(&worker->deque, task)) {
+            // Example: a split deeper than the deque
+            gsl_pool_run_task(self, task);
+            return;
+        }
+    } else {
+        pthread_mutex_lock(&self->lock);
+        if (self->injected_last)
+            self->injected_last->next = task;
+        else
+            self->injected_first = task;
+        self->injected_last = task;
+        atomic_fetch_add_explicit(&self->num_injected, 1, memory_order_relaxed);
+        pthread_mutex_unlock(&self->lock);
+    }
+
+    gsl_pool_notify(self);
+}
+
+void
+gsl_pool_wait(struct gslPool *self, struct gslPoolGroup *group)
+{
+    struct gslPoolWorker *worker = gsl_pool_thread_worker;
+    struct gslPoolTask *task;
+
+    if (worker && worker->pool == self) {
+        // The tasks of |group| not stolen yet are on top of the deque.  Anything below them
+        // is left for later: running it here would nest, e.g., another record into the
+        // callback that waits.
+        while (atomic_load_explicit(&group->num_pending, memory_order_acquire) &&
+               (task = gsl_pool_deque_pop(&worker->deque))) {
+            if (task->group != group) {
+                gsl_pool_deque_push(&worker->deque, task);
+                break;
+            }
+            atomic_fetch_sub(&self->num_queued, 1);
+            gsl_pool_run_task(self, task);
+        }
+    }
+
+    if (!atomic_load_explicit(&group->num_pending, memory_order_acquire))
+        return;
+
+    // Example: the rest of the tasks are being run by the thieves
+    pthread_mutex_lock(&self->lock);
+    while (atomic_load_explicit(&group->num_pending, memory_order_acquire))
+        pthread_cond_wait(&self->done_cond, &self->lock);
+    pthread_mutex_unlock(&self->lock);
+}
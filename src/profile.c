@@ -0,0 +1,282 @@
+#define _POSIX_C_SOURCE 200809L  // clock_gettime()
+
+#include "internal.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define GSL_PROFILE_MAX_DEPTH 64
+#define GSL_PROFILE_MIN_ENTRIES 64
+
+// Open addressing hash of the entries by tag and kind.
+struct gslProfileTable {
+    struct gslProfileEntry *entries;
+    size_t num_entries;
+    size_t max_entries;  // a power of 2, at most half full
+};
+
+struct gslProfileFrame {
+    uint64_t start_ns;
+    uint64_t child_ns;
+    char tag[GSL_PROFILE_MAX_TAG_SIZE];
+    size_t tag_size;
+    gsl_profile_kind_t kind;
+};
+
+// Callbacks being timed by the calling thread.
+struct gslProfileStack {
+    struct gslProfileFrame frames[GSL_PROFILE_MAX_DEPTH];
+    size_t depth;  // can exceed GSL_PROFILE_MAX_DEPTH, deeper calls are not timed
+};
+
+static _Thread_local struct gslProfileTable gsl_thread_profile;
+static _Thread_local struct gslProfileStack gsl_thread_profile_stack;
+
+// Entries of the finished worker threads, see gsl_profile_flush().
+static struct gslProfileTable gsl_profile;
+static pthread_mutex_t gsl_profile_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t
+gsl_profile_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static size_t
+gsl_profile_hash(const char *tag, size_t tag_size, gsl_profile_kind_t kind)
+{
+    size_t h = 2166136261u ^ (size_t)kind;  // FNV-1a
+
+    for (size_t i = 0; i < tag_size; i++)
+        h = (h ^ (unsigned char)tag[i]) * 16777619u;
+    return h;
+}
+
+// Returns the entry of |tag| and |kind|, a new one if needed, or NULL if out of memory.
+static struct gslProfileEntry *
+gsl_profile_table_get(struct gslProfileTable *self, const char *tag, size_t tag_size, gsl_profile_kind_t kind)
+{
+    struct gslProfileEntry *entry;
+
+    if (2 * (self->num_entries + 1) > self->max_entries) {
+        struct gslProfileTable table = { 0 };
+
+        table.max_entries = self->max_entries ? 2 * self->max_entries : GSL_PROFILE_MIN_ENTRIES;
+        table.entries = calloc(table.max_entries, sizeof *table.entries);
+        if (!table.entries) return NULL;
+
+        for (size_t i = 0; i < self->max_entries; i++) {
+            struct gslProfileEntry *old = &self->entries[i];
+            if (!old->calls) continue;
+
+            entry = gsl_profile_table_get(&table, old->tag, old->tag_size, old->kind);
+            *entry = *old;
+        }
+        free(self->entries);
+        *self = table;
+    }
+
+    for (size_t i = gsl_profile_hash(tag, tag_size, kind);; i++) {
+        entry = &self->entries[i & (self->max_entries - 1)];
+        if (!entry->calls) {
+            memcpy(entry->tag, tag, tag_size);
+            entry->tag_size = tag_size;
+            entry->kind = kind;
+            self->num_entries++;
+            return entry;
+        }
+        if (entry->kind == kind && entry->tag_size == tag_size && !memcmp(entry->tag, tag, tag_size))
+            return entry;
+    }
+}
+
+static void
+gsl_profile_table_merge(struct gslProfileTable *self, const struct gslProfileTable *other)
+{
+    for (size_t i = 0; i < other->max_entries; i++) {
+        const struct gslProfileEntry *src = &other->entries[i];
+        struct gslProfileEntry *dst;
+
+        if (!src->calls) continue;
+        if (!(dst = gsl_profile_table_get(self, src->tag, src->tag_size, src->kind))) return;
+
+        dst->calls += src->calls;
+        dst->total_ns += src->total_ns;
+        dst->self_ns += src->self_ns;
+    }
+}
+
+static void
+gsl_profile_table_free(struct gslProfileTable *self)
+{
+    free(self->entries);
+    memset(self, 0, sizeof *self);
+}
+
+// |tag| of NULL is an item of the list being parsed by the enclosing callback.
+void
+gsl_profile_begin(const char *tag, size_t tag_size, gsl_profile_kind_t kind)
+{
+    struct gslProfileStack *stack = &gsl_thread_profile_stack;
+    struct gslProfileFrame *frame;
+
+    if (stack->depth++ >= GSL_PROFILE_MAX_DEPTH)
+        return;
+    frame = &stack->frames[stack->depth - 1];
+
+    if (!tag && stack->depth > 1) {
+        // Example: "groups[]"
+        const struct gslProfileFrame *parent = frame - 1;
+        size_t size = parent->tag_size < GSL_PROFILE_MAX_TAG_SIZE - 2 ? parent->tag_size : GSL_PROFILE_MAX_TAG_SIZE - 2;
+
+        memcpy(frame->tag, parent->tag, size);
+        memcpy(frame->tag + size, "[]", 2);
+        frame->tag_size = size + 2;
+    } else {
+        if (!tag) {
+            // Example: the items of a list passed to gsl_parse_array() directly
+            tag = "[]";
+            tag_size = strlen("[]");
+        }
+        frame->tag_size = tag_size < GSL_PROFILE_MAX_TAG_SIZE ? tag_size : GSL_PROFILE_MAX_TAG_SIZE;
+        memcpy(frame->tag, tag, frame->tag_size);
+    }
+    frame->kind = kind;
+    frame->child_ns = 0;
+    // The last thing, so the bookkeeping above isn't timed.
+    frame->start_ns = gsl_profile_now_ns();
+}
+
+void
+gsl_profile_end(void)
+{
+    uint64_t end_ns = gsl_profile_now_ns();
+    struct gslProfileStack *stack = &gsl_thread_profile_stack;
+    struct gslProfileFrame *frame;
+    struct gslProfileEntry *entry;
+    uint64_t elapsed_ns;
+
+    if (!stack->depth) return;  // Example: gsl_profile_reset() inside a callback
+    if (stack->depth-- > GSL_PROFILE_MAX_DEPTH)
+        return;
+    frame = &stack->frames[stack->depth];
+
+    elapsed_ns = end_ns - frame->start_ns;
+    if (stack->depth)
+        frame[-1].child_ns += elapsed_ns;
+
+    entry = gsl_profile_table_get(&gsl_thread_profile, frame->tag, frame->tag_size, frame->kind);
+    if (!entry) return;
+    entry->calls++;
+    entry->total_ns += elapsed_ns;
+    entry->self_ns += elapsed_ns - frame->child_ns;
+}
+
+void
+gsl_profile_flush(void)
+{
+    if (!gsl_thread_profile.num_entries) return;
+
+    pthread_mutex_lock(&gsl_profile_lock);
+    gsl_profile_table_merge(&gsl_profile, &gsl_thread_profile);
+    pthread_mutex_unlock(&gsl_profile_lock);
+    gsl_profile_table_free(&gsl_thread_profile);
+}
+
+bool
+gsl_profile_enabled(void)
+{
+#ifdef GSL_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+void
+gsl_profile_reset(void)
+{
+    pthread_mutex_lock(&gsl_profile_lock);
+    gsl_profile_table_free(&gsl_profile);
+    pthread_mutex_unlock(&gsl_profile_lock);
+    gsl_profile_table_free(&gsl_thread_profile);
+    gsl_thread_profile_stack.depth = 0;
+}
+
+static int
+gsl_profile_cmp_self(const void *a, const void *b)
+{
+    const struct gslProfileEntry *x = a, *y = b;
+
+    return x->self_ns < y->self_ns ? 1 : x->self_ns > y->self_ns ? -1 : 0;
+}
+
+size_t
+gsl_profile_entries(struct gslProfileEntry *entries, size_t max_entries)
+{
+    struct gslProfileEntry *all;
+    size_t num_entries = 0;
+
+    gsl_profile_flush();
+
+    pthread_mutex_lock(&gsl_profile_lock);
+    all = malloc((gsl_profile.num_entries ? gsl_profile.num_entries : 1) * sizeof *all);
+    if (all) {
+        for (size_t i = 0; i < gsl_profile.max_entries; i++) {
+            if (gsl_profile.entries[i].calls)
+                all[num_entries++] = gsl_profile.entries[i];
+        }
+    }
+    pthread_mutex_unlock(&gsl_profile_lock);
+    if (!all) return 0;
+
+    qsort(all, num_entries, sizeof *all, gsl_profile_cmp_self);
+    if (num_entries > max_entries)
+        num_entries = max_entries;
+    memcpy(entries, all, num_entries * sizeof *entries);
+    free(all);
+    return num_entries;
+}
+
+// Example: tag              kind          calls     total ms      self ms  self %    ns/call
+//          text             parse         37164       37.096       34.797    28.9      998.2
+//          rel[]            parse         24384       80.565       24.499    20.3     3304.0
+void
+gsl_profile_report(FILE *file)
+{
+    static const char *const kind_names[] = { "run", "parse", "validate" };
+    struct gslProfileEntry *entries;
+    size_t num_entries;
+    uint64_t total_self_ns = 0;
+
+    gsl_profile_flush();
+
+    pthread_mutex_lock(&gsl_profile_lock);
+    num_entries = gsl_profile.num_entries;
+    pthread_mutex_unlock(&gsl_profile_lock);
+
+    entries = malloc((num_entries ? num_entries : 1) * sizeof *entries);
+    if (!entries) return;
+    num_entries = gsl_profile_entries(entries, num_entries);
+
+    for (size_t i = 0; i < num_entries; i++)
+        total_self_ns += entries[i].self_ns;
+
+    fprintf(file, "%-*s %-8s %10s %12s %12s %7s %10s\n", GSL_PROFILE_MAX_TAG_SIZE / 2, "tag", "kind",
+            "calls", "total ms", "self ms", "self %", "ns/call");
+    for (size_t i = 0; i < num_entries; i++) {
+        const struct gslProfileEntry *entry = &entries[i];
+
+        fprintf(file, "%-*.*s %-8s %10zu %12.3f %12.3f %7.1f %10.1f\n", GSL_PROFILE_MAX_TAG_SIZE / 2,
+                (int)entry->tag_size, entry->tag, kind_names[entry->kind], entry->calls,
+                entry->total_ns / 1e6, entry->self_ns / 1e6,
+                total_self_ns ? 100.0 * entry->self_ns / total_self_ns : 0.0,
+                (double)entry->total_ns / entry->calls);
+    }
+    free(entries);
+}
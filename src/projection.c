@@ -0,0 +1,228 @@
+#include "internal.h"
+#include "gsl-parser/gsl_log.h"
+#include "gsl-parser/gsl_scan.h"
+
+#include <stdlib.h>
+
+#define DEBUG_PROJECTION_LEVEL_1 0
+
+// The trie and its names are in the same allocation.
+struct gslProjection {
+    struct gslPathTrie trie;
+    struct gslPathNode nodes[];
+};
+
+// A tag of the record: no spaces nor braces, and not the start of a comment or cdata.
+static bool
+gsl_path_is_tag(const char *c, const char *end)
+{
+    if (c == end || *c == '!' || *c == '-' || *c == '"')
+        return false;
+
+    for (; c != end; c++) {
+        if (gsl_scan_is_space(*c) || *c == '{' || *c == '}' || *c == '[' || *c == ']')
+            return false;
+    }
+    return true;
+}
+
+// Example: path = "user/groups[]" -- a node of every tag, and one of its "[]"
+void
+gsl_path_trie_count(const char *path, size_t *max_nodes, size_t *names_size)
+{
+    for (*max_nodes += 2; *path; path++) {
+        *max_nodes += *path == '/' ? 2 : 0;
+        ++*names_size;
+    }
+}
+
+void
+gsl_path_trie_init(struct gslPathTrie *self, struct gslPathNode *nodes, char *names)
+{
+    self->nodes = nodes;
+    self->num_nodes = 1;
+    self->names = names;
+    nodes[0] = (struct gslPathNode){ .name = NULL };
+}
+
+struct gslPathNode *
+gsl_path_trie_items(struct gslPathTrie *self, struct gslPathNode *node)
+{
+    if (!node->items) {
+        node->items = &self->nodes[self->num_nodes++];
+        *node->items = (struct gslPathNode){ .parent = node };
+    }
+    return node->items;
+}
+
+gsl_err_t
+gsl_path_trie_add(struct gslPathTrie *self, const char *path, struct gslPathNode **node)
+{
+    struct gslPathNode *parent = &self->nodes[0], *child;
+    const char *c = path, *e, *tag_end;
+    bool is_items;
+
+    for (;;) {
+        // Example: path = "user/groups[]/name"
+        //                       ^^^^^^^^  -- a tag and the items of its array
+        e = c + strcspn(c, "/");
+        is_items = e - c >= 2 && e[-2] == '[' && e[-1] == ']';
+        tag_end = is_items ? e - 2 : e;
+
+        if (!gsl_path_is_tag(c, tag_end)) {
+            if (DEBUG_PROJECTION_LEVEL_1)
+                gsl_log("-- bad tag \"%.*s\" of path \"%s\"", (int)(e - c), c, path);
+            return make_gsl_desc_err(gsl_INVALID, path, (int)strlen(path));
+        }
+
+        child = (struct gslPathNode *)gsl_path_node_child(parent, c, tag_end - c);
+        if (!child) {
+            child = &self->nodes[self->num_nodes++];
+            *child = (struct gslPathNode){ .name = self->names, .name_size = tag_end - c, .parent = parent };
+            memcpy(self->names, c, tag_end - c);
+            self->names += tag_end - c;
+            child->next_sibling = parent->first_child;
+            parent->first_child = child;
+        }
+        parent = is_items ? gsl_path_trie_items(self, child) : child;
+
+        if (!*e)
+            break;
+        c = e + 1;
+    }
+
+    *node = parent;
+    return make_gsl_err(gsl_OK);
+}
+
+gsl_err_t
+gsl_projection_create(const struct gslPath *paths, size_t num_paths, struct gslProjection **projection)
+{
+    struct gslProjection *self;
+    struct gslPathNode *node;
+    size_t max_nodes = 1, names_size = 0;
+    gsl_err_t err;
+
+    for (size_t i = 0; i < num_paths; i++) {
+        if (!paths[i].path)
+            return make_gsl_err(gsl_INVALID);
+        if (!paths[i].run)
+            return make_gsl_desc_err(gsl_INVALID, paths[i].path, (int)strlen(paths[i].path));
+        gsl_path_trie_count(paths[i].path, &max_nodes, &names_size);
+    }
+
+    self = malloc(sizeof *self + max_nodes * sizeof self->nodes[0] + names_size);
+    if (!self)
+        return make_gsl_err(gsl_FAIL);
+    gsl_path_trie_init(&self->trie, self->nodes, (char *)&self->nodes[max_nodes]);
+
+    for (size_t i = 0; i < num_paths; i++) {
+        err = gsl_path_trie_add(&self->trie, paths[i].path, &node);
+        if (!err.code && node->run) {
+            if (DEBUG_PROJECTION_LEVEL_1)
+                gsl_log("-- path \"%s\" is given twice", paths[i].path);
+            err = make_gsl_desc_err(gsl_EXISTS, paths[i].path, (int)strlen(paths[i].path));
+        }
+        if (err.code) {
+            free(self);
+            return err;
+        }
+        node->obj = paths[i].obj;
+        node->run = paths[i].run;
+    }
+
+    *projection = self;
+    return make_gsl_err(gsl_OK);
+}
+
+void
+gsl_projection_destroy(struct gslProjection *self)
+{
+    free(self);
+}
+
+// Runs the callback of |node| on the body of the field or item just opened by |event|:
+// the reader skips to its closing brace, and comes back to the body if there are nested
+// paths to look for.
+static gsl_err_t
+gsl_projection_run(struct gslReader *reader, const struct gslPathNode *node, const struct gslEvent *event)
+{
+    const char *body = gsl_scan_space(reader->pos), *e;
+    gsl_err_t err;
+
+    err = gsl_reader_skip(reader);
+    if (err.code)
+        return err;
+
+    // Example: rec = "{user {name John} {sid 1} }"
+    //                       ^^^^^^^^^^^^^^^^^^^  -- the body of "user"
+    for (e = reader->pos; e > body && gsl_scan_is_space(e[-1]); e--)
+        ;
+    err = node->run(node->obj, body, e - body);
+    if (err.code) {
+        reader->pos = event->pos;
+        return err;
+    }
+
+    if (node->first_child)
+        reader->pos = body;
+    return make_gsl_err(gsl_OK);
+}
+
+// The reader goes along the paths event by event, and any other field or item is skipped
+// by gsl_reader_skip() as soon as it's opened: its contents never get to gsl_next().
+gsl_err_t
+gsl_parse_projection(const char *rec, size_t *total_size, const struct gslProjection *projection)
+{
+    const struct gslPathNode *nodes[GSL_READER_MAX_DEPTH + 1];  // of the open levels
+    const struct gslPathNode *node;
+    struct gslReader reader;
+    struct gslEvent event;
+    gsl_err_t err;
+
+    GSL_CTX_ENTER(rec, total_size);
+
+    GSL_STAT_ENTER();
+    GSL_TRACE(GSL_TRACE_ENTER, rec, GSL_TRACE_NO_SPEC, 0);
+    gsl_reader_init(&reader, rec);
+    nodes[0] = &projection->nodes[0];
+    while (!(err = gsl_next(&reader, &event)).code && event.type != GSL_EVENT_END) {
+        switch (event.type) {
+        case GSL_EVENT_FIELD_OPEN:
+            node = gsl_path_node_child(nodes[reader.depth - 1], event.val, event.val_size);
+            break;
+        case GSL_EVENT_ARRAY_ITEM:
+            if (!event.val) {
+                // Example: rec = "[groups {name audio} sudo]"
+                //                         ^  -- the item is open, the array is a level up
+                node = nodes[reader.depth - 1]->items;
+                break;
+            }
+
+            // Example: rec = "[groups {name audio} sudo]"
+            //                                      ^^^^  -- no level to skip
+            node = nodes[reader.depth]->items;
+            if (node && node->run && (err = node->run(node->obj, event.val, event.val_size)).code) {
+                reader.pos = event.pos;
+                goto done;
+            }
+            continue;
+        default:
+            continue;
+        }
+
+        nodes[reader.depth] = node;
+        if (!node)
+            err = gsl_reader_skip(&reader);
+        else if (node->run)
+            err = gsl_projection_run(&reader, node, &event);
+        if (err.code)
+            break;
+    }
+done:
+    *total_size = reader.pos - rec;
+    GSL_TRACE(GSL_TRACE_LEAVE, reader.pos, GSL_TRACE_NO_SPEC, err.code);
+    GSL_STAT_LEAVE(*total_size);
+
+    return gsl_ctx_leave(err, reader.pos);
+}
@@ -0,0 +1,473 @@
+#include "internal.h"
+#include "gsl-parser/gsl_log.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEBUG_QUEUE_LEVEL_1 0
+
+// Failed attempts of a blocking call before it goes to sleep.  The other side usually
+// catches up within a few microseconds.
+#define GSL_QUEUE_NUM_SPINS 64
+
+#define GSL_QUEUE_CACHE_LINE 64
+
+// Sleeping of the blocking calls.  The lock-free paths touch it only to check the
+// counters of the sleepers, the rest is cold.
+struct gslQueueSync {
+    atomic_bool is_closed;
+    atomic_size_t num_pushers;  // sleeping on a full queue
+    atomic_size_t num_poppers;  // sleeping on an empty queue
+
+    pthread_mutex_t lock;
+    pthread_cond_t popped;      // or closed
+    pthread_cond_t pushed;      // or closed
+};
+
+struct gslSpscQueue {
+    char *items;
+    size_t item_size;
+    size_t mask;
+
+    // Each side caches the index of the other one and reloads it only when the queue
+    // looks full or empty.
+    _Alignas(GSL_QUEUE_CACHE_LINE) atomic_size_t head;  // next to pop
+    size_t cached_tail;
+    _Alignas(GSL_QUEUE_CACHE_LINE) atomic_size_t tail;  // next to push
+    size_t cached_head;
+
+    _Alignas(GSL_QUEUE_CACHE_LINE) struct gslQueueSync sync;
+};
+
+// The slot of position |pos| is free for the push of |pos| while |seq| == |pos|, and
+// holds its item for the pop of |pos| when |seq| == |pos| + 1 ("Bounded MPMC queue",
+// D. Vyukov).
+struct gslMpmcSlot {
+    atomic_size_t seq;
+    alignas(max_align_t) char item[];
+};
+
+struct gslMpmcQueue {
+    char *slots;
+    size_t slot_size;
+    size_t item_size;
+    size_t mask;
+
+    _Alignas(GSL_QUEUE_CACHE_LINE) atomic_size_t head;
+    _Alignas(GSL_QUEUE_CACHE_LINE) atomic_size_t tail;
+
+    _Alignas(GSL_QUEUE_CACHE_LINE) struct gslQueueSync sync;
+};
+
+typedef size_t (*gsl_queue_try_t)(void *queue, void *items, size_t max_items);
+
+static size_t
+gsl_queue_capacity(size_t capacity)
+{
+    size_t size = 2;
+
+    while (size < capacity)
+        size <<= 1;
+    return size;
+}
+
+static void
+gsl_queue_sync_init(struct gslQueueSync *self)
+{
+    atomic_init(&self->is_closed, false);
+    atomic_init(&self->num_pushers, 0);
+    atomic_init(&self->num_poppers, 0);
+    pthread_mutex_init(&self->lock, NULL);
+    pthread_cond_init(&self->popped, NULL);
+    pthread_cond_init(&self->pushed, NULL);
+}
+
+static void
+gsl_queue_sync_fini(struct gslQueueSync *self)
+{
+    pthread_cond_destroy(&self->pushed);
+    pthread_cond_destroy(&self->popped);
+    pthread_mutex_destroy(&self->lock);
+}
+
+// Wakes sleepers of the other side after |num_items| are pushed or popped: one per item
+// at most.  The fence pairs with the one of gsl_queue_wait(): either the sleeper sees the
+// new item (or slot), or this sees the sleeper.
+static void
+gsl_queue_notify(struct gslQueueSync *self, atomic_size_t *num_sleeping, pthread_cond_t *cond,
+                 size_t num_items)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(num_sleeping, memory_order_relaxed))
+        return;
+
+    pthread_mutex_lock(&self->lock);
+    if (num_items > 1)
+        pthread_cond_broadcast(cond);
+    else
+        pthread_cond_signal(cond);
+    pthread_mutex_unlock(&self->lock);
+}
+
+// Calls |try_op| until it takes at least one item, or the queue is closed.  A closed queue
+// still gives away what's left in it, but takes nothing more.
+static size_t
+gsl_queue_wait(struct gslQueueSync *self, atomic_size_t *num_sleeping, pthread_cond_t *cond, bool is_push,
+               gsl_queue_try_t try_op, void *queue, void *items, size_t max_items)
+{
+    size_t num_items = 0;
+    bool is_closed;
+
+    for (size_t i = 0; i < GSL_QUEUE_NUM_SPINS; i++) {
+        // Closed is checked first: the last items are pushed before the queue is closed.
+        is_closed = atomic_load_explicit(&self->is_closed, memory_order_acquire);
+        if (is_closed && is_push)
+            return 0;
+        num_items = try_op(queue, items, max_items);
+        if (num_items || is_closed)
+            return num_items;
+        if (i >= GSL_QUEUE_NUM_SPINS / 2)
+            sched_yield();
+    }
+
+    pthread_mutex_lock(&self->lock);
+    atomic_fetch_add(num_sleeping, 1);
+    for (;;) {
+        atomic_thread_fence(memory_order_seq_cst);
+        is_closed = atomic_load_explicit(&self->is_closed, memory_order_acquire);
+        if (is_closed && is_push)
+            break;
+        num_items = try_op(queue, items, max_items);
+        if (num_items || is_closed)
+            break;
+        pthread_cond_wait(cond, &self->lock);
+    }
+    atomic_fetch_sub(num_sleeping, 1);
+    pthread_mutex_unlock(&self->lock);
+
+    if (DEBUG_QUEUE_LEVEL_1 && !num_items)
+        gsl_log("-- queue is closed");
+    return num_items;
+}
+
+static void
+gsl_queue_close(struct gslQueueSync *self)
+{
+    pthread_mutex_lock(&self->lock);
+    atomic_store_explicit(&self->is_closed, true, memory_order_release);
+    pthread_cond_broadcast(&self->pushed);
+    pthread_cond_broadcast(&self->popped);
+    pthread_mutex_unlock(&self->lock);
+}
+
+// --------------------------------------------------------------------------------
+// SPSC
+
+gsl_err_t
+gsl_spsc_create(size_t capacity, size_t item_size, struct gslSpscQueue **queue)
+{
+    struct gslSpscQueue *self;
+
+    if (!item_size)
+        return make_gsl_err(gsl_FAIL);
+
+    self = aligned_alloc(_Alignof(struct gslSpscQueue), sizeof *self);
+    if (!self)
+        return make_gsl_err(gsl_FAIL);
+    memset(self, 0, sizeof *self);
+
+    capacity = gsl_queue_capacity(capacity);
+    self->items = malloc(capacity * item_size);
+    if (!self->items) {
+        free(self);
+        return make_gsl_err(gsl_FAIL);
+    }
+    self->item_size = item_size;
+    self->mask = capacity - 1;
+    atomic_init(&self->head, 0);
+    atomic_init(&self->tail, 0);
+    gsl_queue_sync_init(&self->sync);
+
+    *queue = self;
+    return make_gsl_err(gsl_OK);
+}
+
+void
+gsl_spsc_destroy(struct gslSpscQueue *self)
+{
+    if (!self) return;
+
+    gsl_queue_sync_fini(&self->sync);
+    free(self->items);
+    free(self);
+}
+
+static size_t
+gsl_spsc_try_push_n(void *queue, void *items, size_t num_items)
+{
+    struct gslSpscQueue *self = (struct gslSpscQueue *)queue;
+    size_t tail = atomic_load_explicit(&self->tail, memory_order_relaxed);
+    size_t capacity = self->mask + 1;
+
+    (void)num_items;
+
+    if (tail - self->cached_head == capacity) {
+        self->cached_head = atomic_load_explicit(&self->head, memory_order_acquire);
+        if (tail - self->cached_head == capacity)
+            return 0;
+    }
+
+    memcpy(self->items + (tail & self->mask) * self->item_size, items, self->item_size);
+    atomic_store_explicit(&self->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+static size_t
+gsl_spsc_try_pop_n(void *queue, void *items, size_t max_items)
+{
+    struct gslSpscQueue *self = (struct gslSpscQueue *)queue;
+    size_t head = atomic_load_explicit(&self->head, memory_order_relaxed);
+    size_t num_items, first_size;
+
+    if (self->cached_tail - head < max_items) {
+        self->cached_tail = atomic_load_explicit(&self->tail, memory_order_acquire);
+        if (self->cached_tail == head)
+            return 0;
+    }
+
+    num_items = self->cached_tail - head < max_items ? self->cached_tail - head : max_items;
+    // The items can wrap around the end of the ring.
+    first_size = self->mask + 1 - (head & self->mask);
+    if (first_size > num_items)
+        first_size = num_items;
+    memcpy(items, self->items + (head & self->mask) * self->item_size, first_size * self->item_size);
+    memcpy((char *)items + first_size * self->item_size, self->items,
+           (num_items - first_size) * self->item_size);
+
+    atomic_store_explicit(&self->head, head + num_items, memory_order_release);
+    return num_items;
+}
+
+bool
+gsl_spsc_try_push(struct gslSpscQueue *self, const void *item)
+{
+    if (!gsl_spsc_try_push_n(self, (void *)item, 1))
+        return false;
+    gsl_queue_notify(&self->sync, &self->sync.num_poppers, &self->sync.pushed, 1);
+    return true;
+}
+
+bool
+gsl_spsc_push(struct gslSpscQueue *self, const void *item)
+{
+    if (!gsl_queue_wait(&self->sync, &self->sync.num_pushers, &self->sync.popped, true,
+                        gsl_spsc_try_push_n, self, (void *)item, 1))
+        return false;
+    gsl_queue_notify(&self->sync, &self->sync.num_poppers, &self->sync.pushed, 1);
+    return true;
+}
+
+size_t
+gsl_spsc_try_pop(struct gslSpscQueue *self, void *items, size_t max_items)
+{
+    size_t num_items = gsl_spsc_try_pop_n(self, items, max_items);
+
+    if (num_items)
+        gsl_queue_notify(&self->sync, &self->sync.num_pushers, &self->sync.popped, num_items);
+    return num_items;
+}
+
+size_t
+gsl_spsc_pop(struct gslSpscQueue *self, void *items, size_t max_items)
+{
+    size_t num_items;
+
+    if (!max_items) return 0;
+
+    num_items = gsl_queue_wait(&self->sync, &self->sync.num_poppers, &self->sync.pushed, false,
+                                      gsl_spsc_try_pop_n, self, items, max_items);
+
+    if (num_items)
+        gsl_queue_notify(&self->sync, &self->sync.num_pushers, &self->sync.popped, num_items);
+    return num_items;
+}
+
+void
+gsl_spsc_close(struct gslSpscQueue *self)
+{
+    gsl_queue_close(&self->sync);
+}
+
+// --------------------------------------------------------------------------------
+// MPMC
+
+static struct gslMpmcSlot *
+gsl_mpmc_slot(struct gslMpmcQueue *self, size_t pos)
+{
+    return (struct gslMpmcSlot *)(self->slots + (pos & self->mask) * self->slot_size);
+}
+
+gsl_err_t
+gsl_mpmc_create(size_t capacity, size_t item_size, struct gslMpmcQueue **queue)
+{
+    struct gslMpmcQueue *self;
+    size_t slot_align = _Alignof(struct gslMpmcSlot);
+
+    if (!item_size)
+        return make_gsl_err(gsl_FAIL);
+
+    self = aligned_alloc(_Alignof(struct gslMpmcQueue), sizeof *self);
+    if (!self)
+        return make_gsl_err(gsl_FAIL);
+    memset(self, 0, sizeof *self);
+
+    capacity = gsl_queue_capacity(capacity);
+    self->slot_size = (sizeof(struct gslMpmcSlot) + item_size + slot_align - 1) / slot_align * slot_align;
+    self->slots = aligned_alloc(slot_align, capacity * self->slot_size);
+    if (!self->slots) {
+        free(self);
+        return make_gsl_err(gsl_FAIL);
+    }
+    self->item_size = item_size;
+    self->mask = capacity - 1;
+    for (size_t pos = 0; pos < capacity; pos++)
+        atomic_init(&gsl_mpmc_slot(self, pos)->seq, pos);
+    atomic_init(&self->head, 0);
+    atomic_init(&self->tail, 0);
+    gsl_queue_sync_init(&self->sync);
+
+    *queue = self;
+    return make_gsl_err(gsl_OK);
+}
+
+void
+gsl_mpmc_destroy(struct gslMpmcQueue *self)
+{
+    if (!self) return;
+
+    gsl_queue_sync_fini(&self->sync);
+    free(self->slots);
+    free(self);
+}
+
+static size_t
+gsl_mpmc_try_push_n(void *queue, void *items, size_t num_items)
+{
+    struct gslMpmcQueue *self = (struct gslMpmcQueue *)queue;
+    size_t pos = atomic_load_explicit(&self->tail, memory_order_relaxed);
+    struct gslMpmcSlot *slot;
+    size_t seq;
+
+    (void)num_items;
+
+    for (;;) {
+        slot = gsl_mpmc_slot(self, pos);
+        seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq == pos) {
+            if (atomic_compare_exchange_weak_explicit(&self->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if ((ptrdiff_t)(seq - pos) < 0) {
+            // The item of the previous lap is not popped yet.
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&self->tail, memory_order_relaxed);
+        }
+    }
+
+    memcpy(slot->item, items, self->item_size);
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    return 1;
+}
+
+// Claims the run of ready items at the head by a single CAS.
+static size_t
+gsl_mpmc_try_pop_n(void *queue, void *items, size_t max_items)
+{
+    struct gslMpmcQueue *self = (struct gslMpmcQueue *)queue;
+    size_t pos = atomic_load_explicit(&self->head, memory_order_relaxed);
+    size_t num_items, seq;
+
+    for (;;) {
+        for (num_items = 0; num_items < max_items; num_items++) {
+            seq = atomic_load_explicit(&gsl_mpmc_slot(self, pos + num_items)->seq, memory_order_acquire);
+            if (seq != pos + num_items + 1)
+                break;
+        }
+        if (!num_items) {
+            seq = atomic_load_explicit(&gsl_mpmc_slot(self, pos)->seq, memory_order_relaxed);
+            // Example: another consumer has taken the head since it was loaded
+            if ((ptrdiff_t)(seq - (pos + 1)) > 0) {
+                pos = atomic_load_explicit(&self->head, memory_order_relaxed);
+                continue;
+            }
+            return 0;
+        }
+        if (atomic_compare_exchange_weak_explicit(&self->head, &pos, pos + num_items,
+                                                  memory_order_relaxed, memory_order_relaxed))
+            break;
+    }
+
+    for (size_t i = 0; i < num_items; i++) {
+        struct gslMpmcSlot *slot = gsl_mpmc_slot(self, pos + i);
+
+        memcpy((char *)items + i * self->item_size, slot->item, self->item_size);
+        // Free for the push of the next lap.
+        atomic_store_explicit(&slot->seq, pos + i + self->mask + 1, memory_order_release);
+    }
+    return num_items;
+}
+
+bool
+gsl_mpmc_try_push(struct gslMpmcQueue *self, const void *item)
+{
+    if (!gsl_mpmc_try_push_n(self, (void *)item, 1))
+        return false;
+    gsl_queue_notify(&self->sync, &self->sync.num_poppers, &self->sync.pushed, 1);
+    return true;
+}
+
+bool
+gsl_mpmc_push(struct gslMpmcQueue *self, const void *item)
+{
+    if (!gsl_queue_wait(&self->sync, &self->sync.num_pushers, &self->sync.popped, true,
+                        gsl_mpmc_try_push_n, self, (void *)item, 1))
+        return false;
+    gsl_queue_notify(&self->sync, &self->sync.num_poppers, &self->sync.pushed, 1);
+    return true;
+}
+
+size_t
+gsl_mpmc_try_pop(struct gslMpmcQueue *self, void *items, size_t max_items)
+{
+    size_t num_items = gsl_mpmc_try_pop_n(self, items, max_items);
+
+    if (num_items)
+        gsl_queue_notify(&self->sync, &self->sync.num_pushers, &self->sync.popped, num_items);
+    return num_items;
+}
+
+size_t
+gsl_mpmc_pop(struct gslMpmcQueue *self, void *items, size_t max_items)
+{
+    size_t num_items;
+
+    if (!max_items) return 0;
+
+    num_items = gsl_queue_wait(&self->sync, &self->sync.num_poppers, &self->sync.pushed, false,
+                                      gsl_mpmc_try_pop_n, self, items, max_items);
+
+    if (num_items)
+        gsl_queue_notify(&self->sync, &self->sync.num_pushers, &self->sync.popped, num_items);
+    return num_items;
+}
+
+void
+gsl_mpmc_close(struct gslMpmcQueue *self)
+{
+    gsl_queue_close(&self->sync);
+}
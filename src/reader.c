@@ -0,0 +1,308 @@
+#include "internal.h"
+#include "gsl-parser/gsl_log.h"
+#include "gsl-parser/gsl_scan.h"
+
+#include <string.h>
+
+#define DEBUG_READER_LEVEL_1 0
+#define DEBUG_READER_LEVEL_2 0
+
+// Fails the reader at |at|: the following gsl_next() calls return the same error.
+#define GSL_READER_FAIL(at, code)                                               \
+    do {                                                                        \
+        self->pos = (at);                                                       \
+        return gsl_reader_stop(self, make_gsl_err(code));                       \
+    } while (0)
+
+// Cdata value without the surrounding spaces; quotes inside of it are its part.
+// Example: rec = "\"\" J\"hn \"\"}"
+//                     ^^^^^  -- |*val|, |*val_size|
+//                                 ^  -- returned: the closing brace, or NULL if there is none
+static const char *
+gsl_reader_scan_cdata(const char *c, const char **val, size_t *val_size)
+{
+    const char *b, *e;
+    size_t num_quotes = 0;
+
+    for (; *c == '"' || gsl_scan_is_space(*c); c++)
+        num_quotes += *c == '"';
+
+    *val = e = c;
+    for (; *c; c++) {
+        if (*c != '"') {
+            if (!gsl_scan_is_space(*c))
+                e = c + 1;
+            continue;
+        }
+
+        for (b = c; *c == '"'; c++)
+            ;  // the whole sequence
+        if ((size_t)(c - b) == num_quotes && *c == '}') {
+            *val_size = e - *val;
+            return c;
+        }
+        e = c--;
+    }
+
+    if (DEBUG_READER_LEVEL_1)
+        gsl_log("-- no closing sequence %zutimes '\"' found", num_quotes);
+    return NULL;
+}
+
+static gsl_err_t
+gsl_reader_stop(struct gslReader *self, gsl_err_t err)
+{
+    self->err = err;
+    self->is_done = true;
+    GSL_STAT_ADD(bytes_visited, self->pos - self->rec);
+    return err;
+}
+
+void
+gsl_reader_init(struct gslReader *self, const char *rec)
+{
+    self->rec = self->pos = rec;
+    self->depth = 0;
+    self->err = make_gsl_err(gsl_OK);
+    self->is_done = false;
+    self->levels[0] = (struct gslReaderLevel){ .kind = GSL_GET_STATE };
+}
+
+// Every turn of the loop either returns an event or skips spaces or a comment: the nesting
+// is kept in |levels| rather than on the call stack, so the scan stops and resumes anywhere.
+gsl_err_t
+gsl_next(struct gslReader *self, struct gslEvent *event)
+{
+    struct gslReaderLevel *level = &self->levels[self->depth];
+    const char *c = self->pos, *n, *e;
+    size_t chunk_size;
+    gsl_err_t err;
+
+    if (self->is_done) {
+        *event = (struct gslEvent){ .type = GSL_EVENT_END, .pos = self->pos };
+        return self->err;
+    }
+
+    for (;;) {
+        c = gsl_scan_space(c);
+
+        switch (*c) {
+        case '\0':
+            if (self->depth) {
+                if (DEBUG_READER_LEVEL_1)
+                    gsl_log("-- %zu fields are not closed", self->depth);
+                GSL_READER_FAIL(c, gsl_FORMAT);
+            }
+            *event = (struct gslEvent){ .type = GSL_EVENT_END, .pos = c };
+            self->pos = c;
+            return gsl_reader_stop(self, make_gsl_err(gsl_OK));
+        case '}':
+        case ']':
+            if (!self->depth) {
+                // Example: rec = "{name John}}"
+                //                            ^  -- the end of the enclosing field
+                *event = (struct gslEvent){ .type = GSL_EVENT_END, .pos = c };
+                self->pos = c;
+                return gsl_reader_stop(self, make_gsl_err(gsl_OK));
+            }
+            if (*c != (level->is_array ? ']' : '}')) {
+                // Example: rec = "{name John]"
+                //                           ^
+                if (DEBUG_READER_LEVEL_1)
+                    gsl_log("-- mismatched closing brace '%c': \"%.*s\"", *c, 16, c);
+                GSL_READER_FAIL(c, gsl_FORMAT);
+            }
+
+            *event = (struct gslEvent){ .type = GSL_EVENT_FIELD_CLOSE, .kind = level->kind, .pos = c };
+            self->depth--;
+            self->pos = c + 1;
+            return make_gsl_err(gsl_OK);
+        case '{':
+        case '[':
+            n = c + 1;
+            if (*n == '!')
+                n++;
+
+            if (*n == '-') {
+                // Example: rec = "{user {-name John-} ...
+                //                       ^^^^^^^^^^^^^  -- skip the comment as a whole
+                err = gsl_scan_comment(n, *c == '{' ? '}' : ']', &chunk_size);
+                GSL_TRACE(GSL_TRACE_COMMENT, n, GSL_TRACE_NO_SPEC, (int)chunk_size);
+                if (err.code) {
+                    self->pos = n + chunk_size;
+                    return gsl_reader_stop(self, err);
+                }
+                c = n + chunk_size + 1;
+                break;
+            }
+
+            level->has_children = true;
+
+            if (*c == '{' && *n == '"') {
+                // Example: rec = "{bio {\"J}hn\"}}"
+                //                      ^^^^^^^^^  -- cdata as a whole
+                *event = (struct gslEvent){ .type = GSL_EVENT_CDATA, .pos = c };
+                e = gsl_reader_scan_cdata(n, &event->val, &event->val_size);
+                if (!e)
+                    GSL_READER_FAIL(c, gsl_FORMAT);
+
+                GSL_STAT_ADD(cdata_bytes, event->val_size);
+                self->pos = e + 1;
+                return make_gsl_err(gsl_OK);
+            }
+
+            if (self->depth == GSL_READER_MAX_DEPTH) {
+                if (DEBUG_READER_LEVEL_1)
+                    gsl_log("-- nesting is deeper than %d", GSL_READER_MAX_DEPTH);
+                GSL_READER_FAIL(c, gsl_LIMIT);
+            }
+
+            if (level->is_array) {
+                // Example: rec = "[groups {jsmith} {audio}]"
+                //                         ^  -- an item with fields or an implied value
+                if (*c == '[')
+                    GSL_READER_FAIL(c, gsl_FORMAT);
+
+                GSL_STAT_INC(list_items);
+                GSL_TRACE(GSL_TRACE_ITEM, c, GSL_TRACE_NO_SPEC, 0);
+                *event = (struct gslEvent){ .type = GSL_EVENT_ARRAY_ITEM, .pos = c };
+                self->levels[++self->depth] = (struct gslReaderLevel){ .kind = GSL_GET_STATE };
+                self->pos = c + 1;
+                return make_gsl_err(gsl_OK);
+            }
+
+            *event = (struct gslEvent){ .type = GSL_EVENT_FIELD_OPEN, .val = n, .pos = c };
+            if (*c == '{')
+                event->kind = n == c + 1 ? GSL_GET_STATE : GSL_SET_STATE;
+            else
+                event->kind = n == c + 1 ? GSL_GET_ARRAY_STATE : GSL_SET_ARRAY_STATE;
+
+            e = gsl_scan_tag(n);
+            if (e == n) {
+                if (DEBUG_READER_LEVEL_1)
+                    gsl_log("-- empty field tag: \"%.*s\"", 16, c);
+                GSL_READER_FAIL(c, gsl_FORMAT);
+            }
+            event->val_size = e - n;
+
+            if (DEBUG_READER_LEVEL_2)
+                gsl_log(".. field \"%.*s\" of type %d at depth %zu", (int)(e - n), n, event->kind, self->depth + 1);
+
+            GSL_STAT_INC(fields[event->kind]);
+            GSL_TRACE(GSL_TRACE_FIELD, n, GSL_TRACE_NO_SPEC, event->kind);
+            self->levels[++self->depth] = (struct gslReaderLevel){
+                .kind = event->kind,
+                .is_array = event->kind == GSL_GET_ARRAY_STATE || event->kind == GSL_SET_ARRAY_STATE,
+                .is_tagged = true
+            };
+            self->pos = e;
+            return make_gsl_err(gsl_OK);
+        default:
+            if (level->is_array) {
+                // Example: rec = "[groups audio sudo]"
+                //                         ^^^^^  -- an atomic item
+                e = gsl_scan_item(c);
+                if (*e == '-')
+                    GSL_READER_FAIL(e, gsl_FORMAT);
+
+                GSL_STAT_INC(list_items);
+                GSL_TRACE(GSL_TRACE_ITEM, c, GSL_TRACE_NO_SPEC, 0);
+                *event = (struct gslEvent){ .type = GSL_EVENT_ARRAY_ITEM, .val = c, .val_size = e - c, .pos = c };
+                self->pos = e;
+                return make_gsl_err(gsl_OK);
+            }
+
+            *event = (struct gslEvent){ .pos = c };
+            e = gsl_scan_value(c, &event->val, &event->val_size);
+            if ((*e == '}' || *e == ']') && level->is_tagged && !level->has_children) {
+                // Example: rec = "{name John Smith}"
+                //                       ^^^^^^^^^^  -- the whole value of the field
+                event->type = GSL_EVENT_TERMINAL;
+            } else {
+                // Example: rec = "{user jsmith {name John Smith}}"
+                //                       ^^^^^^  -- next to fields
+                GSL_STAT_INC(implied_fields);
+                GSL_TRACE(GSL_TRACE_IMPLIED, event->val, GSL_TRACE_NO_SPEC, 0);
+                event->type = GSL_EVENT_IMPLIED;
+            }
+            self->pos = e;
+            return make_gsl_err(gsl_OK);
+        }
+    }
+}
+
+// Braces are found by strcspn(), which compares many bytes at once, and only the braces
+// are looked at: the rest of the subtree never gets to the switch of gsl_next().
+gsl_err_t
+gsl_reader_skip(struct gslReader *self)
+{
+    bool open_arrays[GSL_READER_MAX_DEPTH];  // of the levels opened by the skip
+    const char *c = self->pos, *n, *e, *val;
+    size_t depth = 0, chunk_size, val_size;
+    gsl_err_t err;
+
+    if (self->is_done)
+        return self->err;
+
+    for (;;) {
+        c += strcspn(c, "{}[]");
+
+        switch (*c) {
+        case '\0':
+            if (self->depth + depth) {
+                if (DEBUG_READER_LEVEL_1)
+                    gsl_log("-- %zu fields are not closed", self->depth + depth);
+                GSL_READER_FAIL(c, gsl_FORMAT);
+            }
+            self->pos = c;
+            return make_gsl_err(gsl_OK);
+        case '}':
+        case ']':
+            if (!depth) {
+                // Example: rec = "{user {name John} {sid 1}} ..."
+                //                                          ^  -- the close of "{user"
+                self->pos = c;
+                return make_gsl_err(gsl_OK);
+            }
+            if ((*c == ']') != open_arrays[--depth]) {
+                if (DEBUG_READER_LEVEL_1)
+                    gsl_log("-- mismatched closing brace '%c': \"%.*s\"", *c, 16, c);
+                GSL_READER_FAIL(c, gsl_FORMAT);
+            }
+            c++;
+            break;
+        default:  // '{' or '['
+            n = c + 1;
+            if (*n == '!')
+                n++;
+
+            // Example: rec = "{-name {x}-} {bio {\"J}hn\"}}"
+            //                 ^^^^^^^^^^^^      ^^^^^^^^^^  -- braces inside don't count
+            if (*n == '-') {
+                err = gsl_scan_comment(n, *c == '{' ? '}' : ']', &chunk_size);
+                if (err.code) {
+                    self->pos = n + chunk_size;
+                    return gsl_reader_stop(self, err);
+                }
+                c = n + chunk_size + 1;
+                break;
+            }
+            if (*c == '{' && *n == '"') {
+                e = gsl_reader_scan_cdata(n, &val, &val_size);
+                if (!e)
+                    GSL_READER_FAIL(c, gsl_FORMAT);
+                c = e + 1;
+                break;
+            }
+
+            if (self->depth + depth == GSL_READER_MAX_DEPTH) {
+                if (DEBUG_READER_LEVEL_1)
+                    gsl_log("-- nesting is deeper than %d", GSL_READER_MAX_DEPTH);
+                GSL_READER_FAIL(c, gsl_LIMIT);
+            }
+            open_arrays[depth++] = *c == '[';
+            c++;
+            break;
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#include "internal.h"
+
+// Calls the callback of |handler| for |event| if it's set.
+static inline gsl_err_t
+gsl_sax_emit(const struct gslSaxHandler *handler, const struct gslEvent *event)
+{
+    switch (event->type) {
+    case GSL_EVENT_FIELD_OPEN:
+        if (handler->on_field_open)
+            return handler->on_field_open(handler->obj, event->kind, event->val, event->val_size);
+        break;
+    case GSL_EVENT_FIELD_CLOSE:
+        if (handler->on_field_close)
+            return handler->on_field_close(handler->obj, event->kind);
+        break;
+    case GSL_EVENT_TERMINAL:
+        if (handler->on_terminal)
+            return handler->on_terminal(handler->obj, event->val, event->val_size);
+        break;
+    case GSL_EVENT_IMPLIED:
+        if (handler->on_implied)
+            return handler->on_implied(handler->obj, event->val, event->val_size);
+        break;
+    case GSL_EVENT_CDATA:
+        if (handler->on_cdata)
+            return handler->on_cdata(handler->obj, event->val, event->val_size);
+        break;
+    case GSL_EVENT_ARRAY_ITEM:
+        if (handler->on_array_item)
+            return handler->on_array_item(handler->obj, event->val, event->val_size);
+        break;
+    case GSL_EVENT_END:
+        break;
+    }
+    return make_gsl_err(gsl_OK);
+}
+
+gsl_err_t
+gsl_sax_parse(const char *rec, size_t *total_size, const struct gslSaxHandler *handler)
+{
+    struct gslReader reader;
+    struct gslEvent event;
+    gsl_err_t err;
+
+    GSL_CTX_ENTER(rec, total_size);
+
+    GSL_STAT_ENTER();
+    GSL_TRACE(GSL_TRACE_ENTER, rec, GSL_TRACE_NO_SPEC, 0);
+    gsl_reader_init(&reader, rec);
+    while (!(err = gsl_next(&reader, &event)).code && event.type != GSL_EVENT_END) {
+        err = gsl_sax_emit(handler, &event);
+        if (err.code) {
+            // Example: rec = "{user {sid 1} {name John}}"
+            //                               ^  -- a callback fails the field
+            reader.pos = event.pos;
+            break;
+        }
+    }
+    *total_size = reader.pos - rec;
+    GSL_TRACE(GSL_TRACE_LEAVE, reader.pos, GSL_TRACE_NO_SPEC, err.code);
+    GSL_STAT_LEAVE(*total_size);
+
+    return gsl_ctx_leave(err, reader.pos);
+}
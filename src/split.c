@@ -0,0 +1,156 @@
+#include "gsl-parser.h"
+#include "gsl-parser/gsl_log.h"
+
+#include <assert.h>
+#include <string.h>
+
+#define DEBUG_SPLIT_LEVEL_1 0
+#define DEBUG_SPLIT_LEVEL_2 0
+
+enum { GSL_SPLIT_PLAIN, GSL_SPLIT_SPACE, GSL_SPLIT_OPEN, GSL_SPLIT_CLOSE };
+
+// Character classes of the splitter.  Only braces are interesting inside of a record,
+// comments and cdata are recognized right after an opening brace.
+static const unsigned char gsl_split_class[256] = {
+    ['\n'] = GSL_SPLIT_SPACE, ['\r'] = GSL_SPLIT_SPACE, ['\t'] = GSL_SPLIT_SPACE, [' '] = GSL_SPLIT_SPACE,
+    ['{'] = GSL_SPLIT_OPEN, ['['] = GSL_SPLIT_OPEN,
+    ['}'] = GSL_SPLIT_CLOSE, [']'] = GSL_SPLIT_CLOSE
+};
+
+// Skips a floating boundary block like "---...---}" or "\"\"...\"\"}".  |c| points to the
+// first |repeatee| of the opening sequence.  Returns NULL if the block is incomplete.
+static const char *
+gsl_split_skip_floating(char repeatee, bool skip_spaces, char end_marker,
+                        const char *c, const char *end)
+{
+    const char *b;
+    size_t count = 0;
+
+    assert(c != end && *c == repeatee);
+
+    // Example: rec = "{---name John Smith---}"
+    //                  ^^^  -- count the opening sequence
+    //      or: rec = "{\"\"John \"Smith\"\"\"}"
+    //                  ^^^^  -- same way
+    for (; c != end; c++) {
+        if (*c == repeatee)
+            count++;
+        else if (!skip_spaces || gsl_split_class[(unsigned char)*c] != GSL_SPLIT_SPACE)
+            break;
+    }
+
+    while (c != end) {
+        c = memchr(c, repeatee, end - c);
+        if (!c) break;
+
+        for (b = c; c != end && *c == repeatee; c++)
+            ;  // skip the whole sequence
+
+        if (c == end) break;
+
+        if ((size_t)(c - b) == count && *c == end_marker)
+            return c + 1;
+    }
+
+    if (DEBUG_SPLIT_LEVEL_2)
+        gsl_log("-- no closing sequence %zutimes '%c' followed by '%c' found yet",
+                count, repeatee, end_marker);
+    return NULL;
+}
+
+// Returns the end of a record which starts at |rec|, or NULL if the record is incomplete.
+// A comment or cdata out of any field is a record by itself, as gsl_validate() has it.
+// Example: rec = "{-x-}} {a}"
+//                 ^^^^^  -- the record, and the stray '}' is garbage between records
+static const char *
+gsl_split_record(const char *rec, const char *end)
+{
+    const char *c = rec, *n;
+    size_t depth = 0;
+
+    assert(*rec == '{');
+
+    while (c != end) {
+        switch (gsl_split_class[(unsigned char)*c]) {
+        case GSL_SPLIT_OPEN:
+            n = c + 1;
+            if (n != end && *n == '!')
+                n++;
+            if (n == end)
+                return NULL;  // cannot decide whether it's a comment
+
+            if (*n == '-') {
+                // Example: rec = "{user {-name John-} ...
+                //                       ^^^^^^^^^^^^^  -- skip the comment as a whole
+                c = gsl_split_skip_floating('-', false, *c == '{' ? '}' : ']', n, end);
+                if (!c || !depth) return c;
+                continue;
+            }
+            if (*c == '{' && *n == '"') {
+                // Example: rec = "{user {name {\"J}hn\"}} ...
+                //                             ^^^^^^^^^  -- skip cdata as a whole
+                c = gsl_split_skip_floating('"', true, '}', n, end);
+                if (!c || !depth) return c;
+                continue;
+            }
+
+            depth++;
+            break;
+        case GSL_SPLIT_CLOSE:
+            if (!--depth)
+                return c + 1;
+            break;
+        default:
+            break;
+        }
+        c++;
+    }
+
+    return NULL;
+}
+
+gsl_err_t
+gsl_split_records(const char *rec, size_t rec_size,
+                  struct gslRecord *records, size_t max_records,
+                  size_t *num_records, size_t *total_size)
+{
+    const char *c = rec, *e;
+    const char *end = rec + rec_size;
+
+    *num_records = 0;
+
+    for (;;) {
+        while (c != end && gsl_split_class[(unsigned char)*c] == GSL_SPLIT_SPACE)
+            c++;
+        if (c == end)
+            break;
+
+        if (*c != '{') {
+            if (DEBUG_SPLIT_LEVEL_1)
+                gsl_log("-- garbage between records: \"%.*s\"",
+                        (int)(end - c < 16 ? end - c : 16), c);
+            *total_size = c - rec;
+            return make_gsl_err(gsl_FORMAT);
+        }
+
+        if (*num_records == max_records) {
+            *total_size = c - rec;
+            return make_gsl_err(gsl_LIMIT);
+        }
+
+        e = gsl_split_record(c, end);
+        if (!e) {
+            // Example: rec = "{user ...} {user {name Jo"
+            //                            ^  -- wait for the rest of the record
+            break;
+        }
+
+        records[*num_records].rec = c;
+        records[*num_records].rec_size = e - c;
+        ++*num_records;
+        c = e;
+    }
+
+    *total_size = c - rec;
+    return make_gsl_err(gsl_OK);
+}
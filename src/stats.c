@@ -0,0 +1,60 @@
+#include "internal.h"
+
+#include <string.h>
+
+#ifdef GSL_STATS
+_Thread_local struct gslStats gsl_thread_stats;
+_Thread_local size_t gsl_thread_depth;
+#else
+static const struct gslStats gsl_thread_stats;
+#endif
+
+bool
+gsl_stats_enabled(void)
+{
+#ifdef GSL_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+const struct gslStats *
+gsl_stats_get(void)
+{
+    return &gsl_thread_stats;
+}
+
+void
+gsl_stats_reset(void)
+{
+#ifdef GSL_STATS
+    memset(&gsl_thread_stats, 0, sizeof gsl_thread_stats);
+#endif
+}
+
+void
+gsl_stats_add(struct gslStats *self, const struct gslStats *other)
+{
+    self->bytes_scanned += other->bytes_scanned;
+    self->bytes_visited += other->bytes_visited;
+    for (size_t i = 0; i < sizeof self->fields / sizeof self->fields[0]; i++)
+        self->fields[i] += other->fields[i];
+    self->implied_fields += other->implied_fields;
+    self->list_items += other->list_items;
+
+    self->spec_lookups += other->spec_lookups;
+    self->spec_index_hits += other->spec_index_hits;
+    self->spec_misses += other->spec_misses;
+
+    self->runs += other->runs;
+    self->parses += other->parses;
+    self->validates += other->validates;
+    self->bufs += other->bufs;
+
+    // Example: the deepest record of all the threads, not a sum
+    if (other->max_depth > self->max_depth)
+        self->max_depth = other->max_depth;
+    self->comment_bytes += other->comment_bytes;
+    self->cdata_bytes += other->cdata_bytes;
+}
@@ -0,0 +1,319 @@
+#include "internal.h"
+#include "gsl-parser/gsl_log.h"
+#include "gsl-parser/gsl_scan.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define DEBUG_TASK_POOL_LEVEL_1 0
+#define DEBUG_TASK_POOL_LEVEL_2 0
+
+struct gslTaskPool;
+
+// Value of a buf spec in a range.  The buf is shared by the ranges, so it's filled after
+// all of them, in the order of the record.
+struct gslTaskPoolValue {
+    const struct gslTaskSpec *spec;  // of the caller
+    const char *val;
+    size_t val_size;
+};
+
+// Top-level fields [begin, end) parsed with copies of the specs.
+struct gslTaskPoolRange {
+    struct gslPoolTask task;
+    struct gslTaskPool *owner;
+    const char *begin;
+    const char *end;
+    struct gslTaskSpec *specs;
+    struct gslTaskPoolValue *values;  // by spec
+    size_t total_size;
+    gsl_err_t err;
+};
+
+struct gslTaskPoolScan {
+    struct gslPoolTask task;
+    struct gslScanChunk chunk;
+};
+
+struct gslTaskPool {
+    struct gslPool *pool;
+    struct gslTaskSpec *specs;
+    size_t num_specs;
+    struct gslPoolGroup group;
+};
+
+// .run of the copy of a buf spec: the checks of gsl_spec_buf_copy() which need no buf.
+static gsl_err_t
+gsl_task_pool_keep_value(void *obj, const char *val, size_t val_size)
+{
+    struct gslTaskPoolValue *self = (struct gslTaskPoolValue *)obj;
+
+    if (!val_size) {
+        if (DEBUG_TASK_POOL_LEVEL_1)
+            gsl_log("-- empty value :(");
+        return make_gsl_err(gsl_FORMAT);
+    }
+    if (val_size > self->spec->max_buf_size) {
+        if (DEBUG_TASK_POOL_LEVEL_1)
+            gsl_log("-- %.*s: buf limit reached: %zu max: %zu",
+                    (int)self->spec->name_size, self->spec->name, val_size, self->spec->max_buf_size);
+        return make_gsl_err(gsl_LIMIT);
+    }
+    if (self->val) {
+        if (DEBUG_TASK_POOL_LEVEL_1)
+            gsl_log("-- %.*s: buf already contains \"%.*s\"",
+                    (int)self->spec->name_size, self->spec->name, (int)self->val_size, self->val);
+        return make_gsl_err(gsl_EXISTS);
+    }
+
+    self->val = val;
+    self->val_size = val_size;
+    return make_gsl_err(gsl_OK);
+}
+
+static void
+gsl_task_pool_run_scan(struct gslPoolTask *task)
+{
+    struct gslTaskPoolScan *self = (struct gslTaskPoolScan *)task;
+
+    gsl_validate_chunk(&self->chunk, self->chunk.begin);
+}
+
+static gsl_err_t
+gsl_task_pool_parse_range(void *obj, const char *rec, size_t *total_size)
+{
+    struct gslTaskPoolRange *self = (struct gslTaskPoolRange *)obj;
+
+    return gsl_parse_task_range(rec, self->end, total_size, self->specs, self->owner->num_specs);
+}
+
+static void
+gsl_task_pool_run_range(struct gslPoolTask *task)
+{
+    struct gslTaskPoolRange *self = (struct gslTaskPoolRange *)task;
+    struct gslCtx *ctx = gsl_pool_ctx(self->owner->pool, gsl_pool_worker_idx());
+
+    self->err = gsl_ctx_parse(ctx, gsl_task_pool_parse_range, self, self->begin, &self->total_size);
+}
+
+// Checks the guesses of the chunks in order: a chunk is scanned again from where the one
+// before it has really stopped, if that's not its beginning.  Every chunk gives the first
+// top-level field in it as the start of a range, up to the closing brace of the record
+// |*rec_end| if it's found.  Returns false if the depth at a chunk is past the limits.
+static bool
+gsl_task_pool_find_ranges(struct gslTaskPoolScan *scans, size_t num_scans,
+                          const char **starts, size_t *num_starts, const char **rec_end)
+{
+    const char *at = scans[0].chunk.begin;
+    const char *cut, *close, *c;
+    ptrdiff_t depth = 0;
+
+    starts[0] = at;
+    *num_starts = 1;
+    *rec_end = NULL;
+
+    for (size_t i = 0; i < num_scans; i++) {
+        struct gslScanChunk *chunk = &scans[i].chunk;
+
+        if (at >= chunk->end)
+            continue;  // Example: the whole chunk is in a comment
+
+        if (at != chunk->begin) {
+            // Example: rec = "...{bio {\"J}h|n\"}}..."
+            //                               ^  -- the chunk starts in cdata, the scan of the one before skips it
+            if (DEBUG_TASK_POOL_LEVEL_2)
+                gsl_log(".. chunk #%zu is scanned again from %zu bytes in", i, (size_t)(at - chunk->begin));
+            gsl_validate_chunk(chunk, at);
+        }
+
+        if (depth > GSL_READER_MAX_DEPTH)
+            return false;
+
+        // Example: rec = "{a {b |} {c}} {d}}"
+        //                        ^    ^    ^  -- from the depth 2 at |: -1, then |cut|, |close|
+        cut = depth ? ((size_t)depth <= chunk->num_lows ? chunk->lows[depth - 1] : NULL) : chunk->first_top;
+        close = (size_t)depth < chunk->num_lows ? chunk->lows[depth] : NULL;
+
+        if (cut && (!close || cut < close)) {
+            // Example: rec = "...{a John} jsmith {b...}"
+            //                           ^        ^  -- the range starts at the next field
+            for (c = cut + 1; *c && *c != '{' && *c != '[' && *c != '}' && *c != ']'; c++)
+                ;
+            if ((*c == '{' || *c == '[') && c > starts[*num_starts - 1])
+                starts[(*num_starts)++] = c;
+        }
+
+        if (close) {
+            *rec_end = close;
+            break;
+        }
+
+        depth += chunk->depth;
+        at = chunk->resume;
+    }
+
+    return true;
+}
+
+// Fills the bufs with the values of |range| and merges the completion of its specs.
+// Returns the first error of the range and sets |*pos| to it.
+static gsl_err_t
+gsl_task_pool_merge_range(struct gslTaskPool *self, struct gslTaskPoolRange *range, const char **pos)
+{
+    gsl_err_t err = make_gsl_err(gsl_OK), buf_err;
+    const char *at;
+
+    *pos = NULL;
+    if (range->err.code) {
+        err = range->err;
+        *pos = range->begin + range->total_size;
+    } else if (range->begin + range->total_size != range->end) {
+        // Example: rec = "{a {x} ...] {b}"
+        //                           ^  -- a callback has disagreed with the braces
+        if (DEBUG_TASK_POOL_LEVEL_1)
+            gsl_log("-- range stopped at %zu of %zu bytes", range->total_size, (size_t)(range->end - range->begin));
+        err = make_gsl_err(gsl_FORMAT);
+        *pos = range->begin + range->total_size;
+    }
+
+    for (size_t i = 0; i < self->num_specs; i++) {
+        struct gslTaskPoolValue *value = &range->values[i];
+
+        self->specs[i].is_completed |= range->specs[i].is_completed;
+        if (!value->val) continue;
+
+        buf_err = gsl_spec_buf_copy(&self->specs[i], value->val, value->val_size);
+        if (buf_err.code) {
+            // Example: rec = "{name John} ... {name Jim}"
+            //                                          ^  -- where gsl_parse_task() stops
+            at = gsl_scan_space(value->val + value->val_size);
+            if (!*pos || at < *pos) {
+                err = buf_err;
+                *pos = at;
+            }
+        }
+    }
+    return err;
+}
+
+// |*rec_end| is the closing brace of the record or its '\0', or NULL if the record should
+// be parsed in one piece.
+static gsl_err_t
+gsl_task_pool_parse(struct gslTaskPool *self, const char *rec, size_t rec_size, const char **rec_end)
+{
+    size_t num_scans = gsl_pool_num_workers(self->pool) * GSL_POOL_TASK_RANGES_PER_WORKER;
+    size_t num_ranges, num_specs = self->num_specs;
+    struct gslTaskPoolScan *scans;
+    struct gslTaskPoolRange *ranges = NULL;
+    const char **starts;
+    const char *pos;
+    gsl_err_t err = make_gsl_err(gsl_OK);
+
+    *rec_end = rec;  // where a failed allocation leaves it
+    scans = malloc(num_scans * (sizeof *scans + sizeof *starts));
+    if (!scans)
+        return make_gsl_err(gsl_FAIL);
+    starts = (const char **)(scans + num_scans);
+
+    for (size_t i = 0; i < num_scans; i++) {
+        scans[i].task.run = gsl_task_pool_run_scan;
+        scans[i].chunk.begin = rec + rec_size * i / num_scans;
+        scans[i].chunk.end = rec + rec_size * (i + 1) / num_scans;
+        scans[i].chunk.buf_end = rec + rec_size;
+        gsl_pool_submit(self->pool, &self->group, &scans[i].task);
+    }
+    gsl_pool_wait(self->pool, &self->group);
+
+    if (!gsl_task_pool_find_ranges(scans, num_scans, starts, &num_ranges, rec_end)) {
+        // Example: a record deeper than gslReader goes, which is rather broken than huge
+        if (DEBUG_TASK_POOL_LEVEL_1)
+            gsl_log("-- nesting is deeper than %d, parsing in one piece", GSL_READER_MAX_DEPTH);
+        free(scans);
+        *rec_end = NULL;
+        return make_gsl_err(gsl_OK);
+    }
+    if (!*rec_end)
+        *rec_end = rec + rec_size;
+
+    if (DEBUG_TASK_POOL_LEVEL_2)
+        gsl_log(".. %zu ranges of %zu bytes", num_ranges, (size_t)(*rec_end - rec));
+
+    // One allocation: the ranges, then the copies of the specs and the values of every range.
+    ranges = malloc(num_ranges * (sizeof *ranges + num_specs * (sizeof *ranges->specs + sizeof *ranges->values)));
+    if (!ranges) {
+        free(scans);
+        return make_gsl_err(gsl_FAIL);
+    }
+
+    for (size_t i = 0; i < num_ranges; i++) {
+        struct gslTaskPoolRange *range = &ranges[i];
+
+        range->task.run = gsl_task_pool_run_range;
+        range->owner = self;
+        range->begin = starts[i];
+        range->end = i + 1 < num_ranges ? starts[i + 1] : *rec_end;
+        range->specs = (struct gslTaskSpec *)(ranges + num_ranges) + i * num_specs;
+        range->values = (struct gslTaskPoolValue *)((struct gslTaskSpec *)(ranges + num_ranges) + num_ranges * num_specs) +
+                        i * num_specs;
+
+        memcpy(range->specs, self->specs, num_specs * sizeof *range->specs);
+        for (size_t j = 0; j < num_specs; j++) {
+            struct gslTaskSpec *spec = &range->specs[j];
+
+            range->values[j] = (struct gslTaskPoolValue){ .spec = &self->specs[j] };
+            if (!spec->buf) continue;
+
+            spec->buf = NULL;
+            spec->buf_size = NULL;
+            spec->max_buf_size = 0;
+            spec->obj = &range->values[j];
+            spec->run = gsl_task_pool_keep_value;
+        }
+        gsl_pool_submit(self->pool, &self->group, &range->task);
+    }
+    gsl_pool_wait(self->pool, &self->group);
+
+    // The ranges are merged in the order of the record, so the first failed one has the
+    // error gsl_parse_task() would stop at.
+    for (size_t i = 0; i < num_ranges; i++) {
+        err = gsl_task_pool_merge_range(self, &ranges[i], &pos);
+        if (err.code) {
+            *rec_end = pos;
+            break;
+        }
+    }
+
+    free(ranges);
+    free(scans);
+    return err;
+}
+
+gsl_err_t
+gsl_parse_task_pool(struct gslPool *pool, const char *rec, size_t *total_size,
+                    struct gslTaskSpec *specs, size_t num_specs)
+{
+    struct gslTaskPool self = { .pool = pool, .specs = specs, .num_specs = num_specs };
+    size_t rec_size = strlen(rec);
+    const char *rec_end;
+    gsl_err_t err;
+
+    if (rec_size < GSL_POOL_MIN_TASK_SIZE || gsl_pool_num_workers(pool) < 2)
+        return gsl_parse_task(rec, total_size, specs, num_specs);
+
+    GSL_CTX_ENTER(rec, total_size);
+
+    atomic_init(&self.group.num_pending, 0);
+    err = gsl_task_pool_parse(&self, rec, rec_size, &rec_end);
+    if (!err.code && !rec_end) {
+        err = gsl_parse_task(rec, total_size, specs, num_specs);
+        return gsl_ctx_leave(err, rec + *total_size);
+    }
+
+    // Example: rec = "{name John} {sid 1}}"
+    //                                    ^  -- no field is completed in any range: the default spec
+    if (!err.code && *rec_end == '}')
+        err = gsl_check_default(rec, specs, num_specs);
+    *total_size = rec_end - rec;
+
+    return gsl_ctx_leave(err, rec_end);
+}
@@ -0,0 +1,224 @@
+#include "internal.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#define GSL_TRACE_EXCERPT_SIZE 24
+
+// Ring of the calling thread.  It is allocated by the first event after gsl_trace_enable()
+// and freed when the thread exits.
+struct gslTraceRing {
+    size_t max_events;  // a power of 2
+    size_t num_events;  // ever written since the last reset, the ring keeps the last |max_events|
+    const char *rec;    // the outermost record
+    size_t depth;
+    struct gslTraceEvent events[];
+};
+
+atomic_bool gsl_trace_is_on;
+
+static atomic_size_t gsl_trace_max_events;
+static _Thread_local struct gslTraceRing *gsl_thread_ring;
+
+static pthread_once_t gsl_trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t gsl_trace_key;
+
+// Dumps of several threads are not interleaved.
+static pthread_mutex_t gsl_trace_dump_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *const gsl_trace_event_names[GSL_TRACE_NUM_EVENTS] = {
+    [GSL_TRACE_ENTER] = "enter",
+    [GSL_TRACE_LEAVE] = "leave",
+    [GSL_TRACE_FIELD] = "field",
+    [GSL_TRACE_IMPLIED] = "implied",
+    [GSL_TRACE_DEFAULT] = "default",
+    [GSL_TRACE_ITEM] = "item",
+    [GSL_TRACE_COMMENT] = "comment"
+};
+
+static void
+gsl_trace_create_key(void)
+{
+    pthread_key_create(&gsl_trace_key, free);
+}
+
+static struct gslTraceRing *
+gsl_trace_ring(void)
+{
+    struct gslTraceRing *ring = gsl_thread_ring;
+    size_t max_events = atomic_load_explicit(&gsl_trace_max_events, memory_order_relaxed);
+
+    if (ring && ring->max_events == max_events)
+        return ring;
+
+    // Example: the first event of the thread, or gsl_trace_enable() with another size
+    pthread_once(&gsl_trace_once, gsl_trace_create_key);
+    free(ring);
+    ring = calloc(1, sizeof *ring + max_events * sizeof ring->events[0]);
+    gsl_thread_ring = ring;
+    pthread_setspecific(gsl_trace_key, ring);
+    if (ring)
+        ring->max_events = max_events;
+    return ring;
+}
+
+gsl_err_t
+gsl_trace_enable(size_t max_events)
+{
+    size_t size = 1;
+
+    if (!max_events || max_events > SIZE_MAX / 2 / sizeof(struct gslTraceEvent))
+        return make_gsl_err(gsl_LIMIT);
+
+    while (size < max_events)
+        size *= 2;
+    atomic_store_explicit(&gsl_trace_max_events, size, memory_order_relaxed);
+    atomic_store_explicit(&gsl_trace_is_on, true, memory_order_relaxed);
+    return make_gsl_err(gsl_OK);
+}
+
+void
+gsl_trace_disable(void)
+{
+    atomic_store_explicit(&gsl_trace_is_on, false, memory_order_relaxed);
+}
+
+void
+gsl_trace_reset(void)
+{
+    struct gslTraceRing *ring = gsl_thread_ring;
+
+    if (!ring) return;
+    ring->num_events = 0;
+    ring->rec = NULL;
+    ring->depth = 0;
+}
+
+void
+gsl_trace_emit(gsl_trace_event_t event, const char *pos, size_t spec_idx, int arg)
+{
+    struct gslTraceRing *ring = gsl_trace_ring();
+    struct gslTraceEvent *ev;
+
+    if (!ring) return;
+
+    if (event == GSL_TRACE_ENTER && !ring->depth++)
+        ring->rec = pos;
+    // Example: tracing was turned on in the middle of a record -- wait for the next one
+    if (!ring->depth || !ring->rec)
+        return;
+
+    ev = &ring->events[ring->num_events++ & (ring->max_events - 1)];
+    ev->offset = (uint32_t)(pos - ring->rec);
+    ev->event = (uint8_t)event;
+    ev->depth = ring->depth > UINT8_MAX ? UINT8_MAX : (uint8_t)ring->depth;
+    ev->spec_idx = spec_idx > GSL_TRACE_NO_SPEC ? GSL_TRACE_NO_SPEC : (uint16_t)spec_idx;
+    ev->arg = arg;
+
+    if (event == GSL_TRACE_LEAVE && !--ring->depth)
+        ring->rec = NULL;
+}
+
+size_t
+gsl_trace_events(struct gslTraceEvent *events, size_t max_events)
+{
+    struct gslTraceRing *ring = gsl_thread_ring;
+    size_t num_events, first;
+
+    if (!ring) return 0;
+
+    num_events = ring->num_events < ring->max_events ? ring->num_events : ring->max_events;
+    if (num_events > max_events)
+        num_events = max_events;
+
+    // The newest |num_events| events, the oldest first.
+    first = ring->num_events - num_events;
+    for (size_t i = 0; i < num_events; i++)
+        events[i] = ring->events[(first + i) & (ring->max_events - 1)];
+    return num_events;
+}
+
+static const char *
+gsl_trace_err_name(int code)
+{
+    static const char *const names[] = { "OK", "FAIL", "LIMIT", "NO_MATCH", "FORMAT", "EXISTS", "INVALID" };
+
+    if (code >= 0 && (size_t)code < sizeof names / sizeof names[0])
+        return names[code];
+    return code & gsl_EXTERNAL ? "EXTERNAL" : "?";
+}
+
+static void
+gsl_trace_dump_event(FILE *file, const struct gslTraceEvent *ev, const char *rec)
+{
+    static const char *const type_names[] = { "GET", "GET_ARRAY", "SET", "SET_ARRAY" };
+
+    fprintf(file, "  @%-8u %*s%-8s", (unsigned)ev->offset, 2 * (ev->depth - 1), "",
+            ev->event < GSL_TRACE_NUM_EVENTS ? gsl_trace_event_names[ev->event] : "?");
+    if (ev->spec_idx != GSL_TRACE_NO_SPEC)
+        fprintf(file, " spec %u", (unsigned)ev->spec_idx);
+
+    switch (ev->event) {
+    case GSL_TRACE_LEAVE:
+        fprintf(file, " %s", gsl_trace_err_name(ev->arg));
+        if (ev->arg & gsl_EXTERNAL)
+            fprintf(file, " %d", ev->arg & ~gsl_EXTERNAL);
+        break;
+    case GSL_TRACE_FIELD:
+        if (ev->arg >= 0 && ev->arg < 4)
+            fprintf(file, " %s", type_names[ev->arg]);
+        break;
+    case GSL_TRACE_COMMENT:
+        fprintf(file, " %d bytes", ev->arg);
+        break;
+    }
+
+    if (rec) {
+        // The record is null-terminated, so the excerpt stops at its end.
+        const char *c = rec + ev->offset;
+        size_t size = 0;
+
+        while (size < GSL_TRACE_EXCERPT_SIZE && c[size] && c[size] != '\n')
+            size++;
+        fprintf(file, "  \"%.*s\"", (int)size, c);
+    }
+    fprintf(file, "\n");
+}
+
+static void
+gsl_trace_dump_events(FILE *file, const char *rec)
+{
+    struct gslTraceRing *ring = gsl_thread_ring;
+    size_t num_events = 0;
+
+    if (ring)
+        num_events = ring->num_events < ring->max_events ? ring->num_events : ring->max_events;
+
+    fprintf(file, "-- gsl trace: %zu of %zu events\n", num_events, ring ? ring->num_events : 0);
+    for (size_t i = ring ? ring->num_events - num_events : 0; ring && i < ring->num_events; i++)
+        gsl_trace_dump_event(file, &ring->events[i & (ring->max_events - 1)], rec);
+}
+
+// Example: -- gsl trace: 6 of 6 events
+//             @0        enter     "{user {-old-} {nick John"
+//             @1        field    spec 0 GET  "user {-old-} {nick John}"
+//             @5          enter     " {-old-} {nick John}}"
+//             @7          comment  5 bytes  "-old-} {nick John}}"
+//             @19         leave    NO_MATCH  " John}}"
+//             @19       leave    NO_MATCH  " John}}"
+void
+gsl_trace_dump(FILE *file, const char *rec)
+{
+    pthread_mutex_lock(&gsl_trace_dump_lock);
+    gsl_trace_dump_events(file, rec);
+    pthread_mutex_unlock(&gsl_trace_dump_lock);
+}
+
+void
+gsl_trace_dump_failed(FILE *file, size_t rec_idx, gsl_err_t err, size_t total_size, const char *rec)
+{
+    pthread_mutex_lock(&gsl_trace_dump_lock);
+    fprintf(file, "-- record #%zu failed: %s at %zu\n", rec_idx, gsl_trace_err_name(err.code), total_size);
+    gsl_trace_dump_events(file, rec);
+    pthread_mutex_unlock(&gsl_trace_dump_lock);
+}
@@ -0,0 +1,318 @@
+#include "internal.h"
+#include "gsl-parser/gsl_log.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define DEBUG_VALIDATE_LEVEL_1 0
+
+#define GSL_VALIDATE_BLOCK_SIZE 64
+
+// Structural characters: braces, and '\0' which would end the record for the parser.
+// Everything else matters only right after an opening brace.
+static const bool gsl_validate_is_structural[256] = {
+    ['\0'] = true, ['{'] = true, ['}'] = true, ['['] = true, [']'] = true
+};
+
+// Characters right after an opening brace which need a closer look: '!', the start of a
+// comment or cdata, and '\0' for the end of the input.
+static const bool gsl_validate_is_special[256] = {
+    ['\0'] = true, ['!'] = true, ['-'] = true, ['"'] = true
+};
+
+// Bit i is set if |block|[i] is structural.  |block| has GSL_VALIDATE_BLOCK_SIZE bytes.
+static inline uint64_t
+gsl_validate_block_mask(const char *block)
+{
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i open = _mm_set1_epi8('{'), close = _mm_set1_epi8('}');
+    const __m128i open_array = _mm_set1_epi8('['), close_array = _mm_set1_epi8(']');
+    uint64_t mask = 0;
+
+    for (int i = 0; i < GSL_VALIDATE_BLOCK_SIZE; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(block + i));
+        // Example: '{' = 0x7b, '}' = 0x7d, '[' = 0x5b, ']' = 0x5d -- one compare each
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, open), _mm_cmpeq_epi8(v, close)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, open_array), _mm_cmpeq_epi8(v, close_array)));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, zero));
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(m) << i;
+    }
+    return mask;
+#else
+    uint64_t mask = 0;
+
+    for (int i = 0; i < GSL_VALIDATE_BLOCK_SIZE; i++)
+        mask |= (uint64_t)gsl_validate_is_structural[(unsigned char)block[i]] << i;
+    return mask;
+#endif
+}
+
+// Same for the block at |c|, which can be shorter than GSL_VALIDATE_BLOCK_SIZE at the end.
+static inline uint64_t
+gsl_validate_mask_at(const char *c, const char *end)
+{
+    char tail[GSL_VALIDATE_BLOCK_SIZE];
+
+    if (end - c >= GSL_VALIDATE_BLOCK_SIZE)
+        return gsl_validate_block_mask(c);
+
+    // Example: the last 10 bytes of the buffer, padded with spaces
+    memset(tail, ' ', sizeof tail);
+    memcpy(tail, c, end - c);
+    return gsl_validate_block_mask(tail);
+}
+
+// Skips a comment "-...-}" or cdata "\"...\"}" as gsl_scan_comment() and the cdata parser
+// do: the closing sequence has as many |repeatee| as the opening one.  |c| points to the
+// first |repeatee|.  Returns the end of the block, or NULL if it isn't closed.
+static const char *
+gsl_validate_skip_floating(char repeatee, bool skip_spaces, char end_marker,
+                           const char *c, const char *end)
+{
+    const char *b;
+    size_t count = 0;
+
+    for (; c != end; c++) {
+        if (*c == repeatee)
+            count++;
+        else if (!skip_spaces || !gsl_scan_is_space(*c))
+            break;
+    }
+
+    while (c != end) {
+        c = memchr(c, repeatee, end - c);
+        if (!c) break;
+
+        for (b = c; c != end && *c == repeatee; c++)
+            ;  // the whole sequence
+
+        if (c != end && (size_t)(c - b) == count && *c == end_marker)
+            return c + 1;
+    }
+
+    if (DEBUG_VALIDATE_LEVEL_1)
+        gsl_log("-- no closing sequence %zutimes '%c' followed by '%c' found", count, repeatee, end_marker);
+    return NULL;
+}
+
+// Checks that there are only spaces between records, from |c| up to |end|.  |*e| is set
+// to |end|, or to the first byte of garbage.
+// Example: rec = "{user ...}\n {user ...}"
+//                           ^^^  -- spaces
+static bool
+gsl_validate_spaces(const char *c, const char *end, const char **e)
+{
+    for (; c != end; c++) {
+        if (!gsl_scan_is_space(*c)) {
+            if (DEBUG_VALIDATE_LEVEL_1)
+                gsl_log("-- garbage between records: \"%.*s\"", (int)(end - c < 16 ? end - c : 16), c);
+            *e = c;
+            return false;
+        }
+    }
+    *e = end;
+    return true;
+}
+
+// Skips a comment or cdata which starts right after the opening brace at |c|, or checks the
+// '!' there.  Returns the end of the comment or cdata, |c| if it's the start of a field, or
+// NULL if the record is malformed.
+static const char *
+gsl_validate_open(const char *c, const char *end)
+{
+    const char *n = c + 1;
+
+    if (n != end && *n == '!') {
+        n++;
+        // Example: rec = "{! name John}"
+        //                   ^  -- '!' goes right before a tag or a comment
+        if (n == end || gsl_scan_is_space(*n) || *n == '"' || gsl_validate_is_structural[(unsigned char)*n]) {
+            if (DEBUG_VALIDATE_LEVEL_1)
+                gsl_log("-- misplaced '!': \"%.*s\"", (int)(end - c < 16 ? end - c : 16), c);
+            return NULL;
+        }
+    }
+    if (n == end)
+        return NULL;  // Example: rec = "{user {"
+
+    // Example: rec = "{user {-name {x}-} {bio {\"J}hn\"}}}"
+    //                       ^^^^^^^^^^^^ ^^^^^^^^^^^^^^  -- skipped as a whole
+    if (*n == '-')
+        return gsl_validate_skip_floating('-', false, *c == '{' ? '}' : ']', n, end);
+    if (*n == '"' && *c == '{')
+        return gsl_validate_skip_floating('"', true, '}', n, end);
+    return c;
+}
+
+// Finds structural characters 64 bytes at a time and walks their bits, so the bytes of
+// tags and values are only compared in bulk.  The step over a brace has no branches but
+// the rare ones: the kinds of the open braces are kept in a stack of bytes, and pushes,
+// pops and mismatches are computed rather than tested for.
+gsl_err_t
+gsl_validate(const char *rec, size_t rec_size, size_t *total_size)
+{
+    unsigned char open_arrays[GSL_READER_MAX_DEPTH + 2];  // of the levels 1..depth, and the one above
+    const char *end = rec + rec_size;
+    const char *block = rec, *c = rec, *n;
+    uint64_t mask;
+    size_t depth = 0;
+    bool is_open, is_array, is_bad;
+    gsl_err_t err = make_gsl_err(gsl_OK);
+
+    open_arrays[0] = 0;
+    mask = gsl_validate_mask_at(block, end);
+
+    for (;;) {
+        while (!mask) {
+            block += GSL_VALIDATE_BLOCK_SIZE;
+            if (block >= end)
+                goto done;
+            mask = gsl_validate_mask_at(block, end);
+        }
+
+        n = block + __builtin_ctzll(mask);
+        mask &= mask - 1;
+
+        if (!depth) {
+            if (!gsl_validate_spaces(c, n, &c) || *c != '{') {
+                err = make_gsl_err(gsl_FORMAT);
+                goto done;
+            }
+        }
+        c = n;
+
+        // Example: rec = "{user {-name-} ...
+        //                       ^^  -- an opening brace with a special character next to it
+        is_open = (*c == '{') | (*c == '[');
+        if (is_open & gsl_validate_is_special[(unsigned char)(c + 1 != end ? c[1] : '\0')]) {
+            n = gsl_validate_open(c, end);
+            if (!n) {
+                err = make_gsl_err(gsl_FORMAT);
+                goto done;
+            }
+            if (n != c) {
+                c = n;
+                if (c - block >= GSL_VALIDATE_BLOCK_SIZE) {
+                    block = c;
+                    mask = block < end ? gsl_validate_mask_at(block, end) : 0;
+                } else {
+                    mask &= ~(uint64_t)0 << (c - block);
+                }
+                continue;
+            }
+        }
+
+        // Example: rec = "{user [groups a]}"
+        //                 ^     ^        ^^  -- push 0, push 1, pop 1, pop 0
+        is_array = (*c == '[') | (*c == ']');
+        is_bad = (*c == '\0') | (!is_open & (open_arrays[depth] != is_array));
+        open_arrays[depth + 1] = is_array;  // above the top for a closing brace
+        depth += 2 * (size_t)is_open - 1;
+        if (is_bad || depth > GSL_READER_MAX_DEPTH) {
+            if (*c == '\0') {
+                // Example: rec = "{name Jo\0hn}"
+                //                         ^  -- the parser would stop here
+            } else if (is_open) {
+                if (DEBUG_VALIDATE_LEVEL_1)
+                    gsl_log("-- nesting is deeper than %d", GSL_READER_MAX_DEPTH);
+                depth--;
+                err = make_gsl_err(gsl_LIMIT);
+                goto done;
+            } else if (DEBUG_VALIDATE_LEVEL_1) {
+                // Example: rec = "{name John]"
+                //                           ^
+                gsl_log("-- mismatched closing brace '%c': \"%.*s\"", *c, (int)(end - c < 16 ? end - c : 16), c);
+            }
+            err = make_gsl_err(gsl_FORMAT);
+            goto done;
+        }
+        c++;
+    }
+
+done:
+    if (!err.code && depth) {
+        // Example: rec = "{user {name John}"
+        //                                  ^  -- the record is incomplete
+        if (DEBUG_VALIDATE_LEVEL_1)
+            gsl_log("-- %zu fields are not closed", depth);
+        err = make_gsl_err(gsl_FORMAT);
+        c = end;
+    } else if (!err.code && !gsl_validate_spaces(c, end, &c)) {
+        err = make_gsl_err(gsl_FORMAT);
+    }
+    *total_size = c - rec;
+    GSL_STAT_ADD(bytes_visited, *total_size);
+    return err;
+}
+
+// The same walk over the braces with no checks: a malformed chunk gets some numbers, and
+// the parser of its range finds what's wrong with it.
+void
+gsl_validate_chunk(struct gslScanChunk *self, const char *c)
+{
+    const char *end = self->end, *buf_end = self->buf_end;
+    const char *block = c, *n;
+    uint64_t mask;
+    ptrdiff_t depth = 0, low = 0;
+
+    self->resume = end;
+    self->first_top = NULL;
+    self->num_lows = 0;
+    mask = block < end ? gsl_validate_mask_at(block, end) : 0;
+
+    for (;;) {
+        while (!mask) {
+            block += GSL_VALIDATE_BLOCK_SIZE;
+            if (block >= end)
+                goto done;
+            mask = gsl_validate_mask_at(block, end);
+        }
+
+        c = block + __builtin_ctzll(mask);
+        mask &= mask - 1;
+
+        if (((*c == '{') | (*c == '[')) &&
+            gsl_validate_is_special[(unsigned char)(c + 1 != buf_end ? c[1] : '\0')]) {
+            n = gsl_validate_open(c, buf_end);
+            if (n && n != c) {
+                // Example: rec = "...{-comment {x}-} {name..."
+                //                    ^^^^^^^^^^^^^^^  -- can end in one of the next chunks
+                if (n >= end) {
+                    self->resume = n;
+                    goto done;
+                }
+                c = n;
+                if (c - block >= GSL_VALIDATE_BLOCK_SIZE) {
+                    block = c;
+                    mask = gsl_validate_mask_at(block, end);
+                } else {
+                    mask &= ~(uint64_t)0 << (c - block);
+                }
+                continue;
+            }
+        }
+
+        if ((*c == '{') | (*c == '[')) {
+            depth++;
+            continue;
+        }
+
+        // Example: rec = "{name John}} {sid 1}}"
+        //                           ^^        ^  -- depth 0, -1, and -1 again
+        if (!--depth && !self->first_top)
+            self->first_top = c;
+        if (depth < low) {
+            low = depth;
+            if (self->num_lows < GSL_SCAN_CHUNK_MAX_LOWS)
+                self->lows[self->num_lows++] = c;
+        }
+    }
+
+done:
+    self->depth = depth;
+}
@@ -0,0 +1,273 @@
+#define _POSIX_C_SOURCE 200809L  // mkstemp()
+
+#include <gsl-parser.h>
+
+#include <check.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NUM_INGEST_RECORDS 1000
+#define NUM_INGEST_WORKERS 3
+#define NUM_INGEST_CONSUMERS 2
+
+// --------------------------------------------------------------------------------
+// Common routines
+
+struct IngestUser { char name[16]; size_t name_size; };
+
+static gsl_err_t parse_ingest_user(void *obj, size_t rec_idx, const char *rec, size_t *total_size) {
+    struct IngestUser *users = (struct IngestUser *)obj;
+    ck_assert(users);
+    ck_assert(rec); ck_assert(total_size);
+    ck_assert_uint_lt(rec_idx, NUM_INGEST_RECORDS);
+
+    struct gslTaskSpec specs[] = {
+        { .name = "user", .name_size = strlen("user"),
+          .buf = users[rec_idx].name, .buf_size = &users[rec_idx].name_size, .max_buf_size = sizeof users[rec_idx].name }
+    };
+    return gsl_parse_task(rec, total_size, specs, sizeof specs / sizeof specs[0]);
+}
+
+static char *write_file(const char *data) {
+    char *path = strdup("/tmp/gsl_ingest_test.XXXXXX");
+    ck_assert(path);
+
+    int fd = mkstemp(path);
+    ck_assert_int_ge(fd, 0);
+    ck_assert_int_eq(write(fd, data, strlen(data)), (ssize_t)strlen(data));
+    close(fd);
+    return path;
+}
+
+static void remove_file(char *path) {
+    unlink(path);
+    free(path);
+}
+
+// --------------------------------------------------------------------------------
+// Common variables
+gsl_err_t rc;
+struct IngestUser users[NUM_INGEST_RECORDS];
+struct gslBatchWorker workers[NUM_INGEST_WORKERS];
+
+// Small buffers make most of the records cross buffer boundaries.
+struct gslIngestOptions options = { .buf_size = 64, .max_record_size = 128, .num_bufs = 3, .queue_size = 16 };
+
+static void setup(void) {
+    memset(users, 0, sizeof users);
+    for (size_t i = 0; i < NUM_INGEST_WORKERS; i++)
+        workers[i] = (struct gslBatchWorker){ .obj = users, .parse = parse_ingest_user };
+}
+
+// --------------------------------------------------------------------------------
+// Ingestion
+
+START_TEST(ingest_files)
+    static char data[2][NUM_INGEST_RECORDS / 2 * 32];
+    char *paths[3];
+    size_t data_size[2] = { 0, 0 };
+
+    // Records are numbered across the files, so the second one continues the first one.
+    for (size_t i = 0; i < NUM_INGEST_RECORDS; i++) {
+        size_t file_idx = i < NUM_INGEST_RECORDS / 2 ? 0 : 1;
+        data_size[file_idx] += sprintf(data[file_idx] + data_size[file_idx], "{user u%zu}%s", i, i % 3 ? " " : "\n");
+    }
+
+    paths[0] = write_file(data[0]);
+    paths[1] = write_file("");
+    paths[2] = write_file(data[1]);
+
+    rc = gsl_ingest_files((const char *const *)paths, 3, &options, workers, NUM_INGEST_WORKERS);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    // The backend this run has taken, io_uring falls back to pread where it's off.
+    ck_assert(!strcmp(gsl_ingest_backend(), "io_uring") || !strcmp(gsl_ingest_backend(), "pread"));
+    for (size_t i = 0; i < NUM_INGEST_RECORDS; i++) {
+        char exp[16];
+        sprintf(exp, "u%zu", i);
+        ck_assert_msg(users[i].name_size == strlen(exp) && !memcmp(users[i].name, exp, users[i].name_size),
+                      "record #%zu: got \"%.*s\"", i, (int)users[i].name_size, users[i].name);
+    }
+
+    // Default options read the whole file at once.
+    memset(users, 0, sizeof users);
+    rc = gsl_ingest_files((const char *const *)paths, 3, NULL, workers, 1);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(users[NUM_INGEST_RECORDS - 1].name_size, strlen("u999"));
+
+    for (size_t i = 0; i < 3; i++)
+        remove_file(paths[i]);
+END_TEST
+
+START_TEST(ingest_files_empty)
+    char *path = write_file(" \n ");
+
+    rc = gsl_ingest_files((const char *const *)&path, 1, &options, workers, NUM_INGEST_WORKERS);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    rc = gsl_ingest_files(NULL, 0, &options, workers, NUM_INGEST_WORKERS);
+    ck_assert_int_eq(rc.code, gsl_OK);
+
+    remove_file(path);
+END_TEST
+
+START_TEST(ingest_files_failed)
+    char *paths[2];
+
+    // Example: incomplete record at the end of the file
+    paths[0] = write_file("{user a} {user b} {user c");
+    memset(users, 0, sizeof users);
+    rc = gsl_ingest_files((const char *const *)paths, 1, &options, workers, NUM_INGEST_WORKERS);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    remove_file(paths[0]);
+
+    // Example: a record longer than |max_record_size|
+    paths[0] = write_file("{user a} {user {-"
+                          "0123456789012345678901234567890123456789012345678901234567890123456789"
+                          "0123456789012345678901234567890123456789012345678901234567890123456789"
+                          "0123456789012345678901234567890123456789012345678901234567890123456789"
+                          "0123456789012345678901234567890123456789012345678901234567890123456789"
+                          "-}} {user b}");
+    memset(users, 0, sizeof users);
+    rc = gsl_ingest_files((const char *const *)paths, 1, &options, workers, NUM_INGEST_WORKERS);
+    ck_assert_int_eq(rc.code, gsl_LIMIT);
+    remove_file(paths[0]);
+
+    // Example: parser error
+    paths[0] = write_file("{user a} {name b} {user c}");
+    memset(users, 0, sizeof users);
+    rc = gsl_ingest_files((const char *const *)paths, 1, &options, workers, NUM_INGEST_WORKERS);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    remove_file(paths[0]);
+
+    // Example: missing file
+    paths[0] = write_file("{user a}");
+    paths[1] = "/nonexistent/gsl_ingest_test";
+    memset(users, 0, sizeof users);
+    rc = gsl_ingest_files((const char *const *)paths, 2, &options, workers, NUM_INGEST_WORKERS);
+    ck_assert_int_eq(rc.code, gsl_FAIL);
+    remove_file(paths[0]);
+
+    // Example: bad options
+    options.num_bufs = 1;
+    rc = gsl_ingest_files(NULL, 0, &options, workers, NUM_INGEST_WORKERS);
+    ck_assert_int_eq(rc.code, gsl_FAIL);
+    options.num_bufs = 3;
+    rc = gsl_ingest_files(NULL, 0, &options, workers, 0);
+    ck_assert_int_eq(rc.code, gsl_FAIL);
+END_TEST
+
+// --------------------------------------------------------------------------------
+// Pipeline
+
+struct IngestOut { size_t rec_idx; };
+
+struct IngestConsumer {
+    size_t num_outs;
+    size_t fail_rec_idx;  // SIZE_MAX for none
+};
+
+static gsl_err_t parse_ingest_emit(void *obj, size_t rec_idx, const char *rec, size_t *total_size) {
+    gsl_err_t err = parse_ingest_user(obj, rec_idx, rec, total_size);
+    if (err.code) return err;
+
+    struct IngestOut *out = malloc(sizeof *out);
+    ck_assert(out);
+    out->rec_idx = rec_idx;
+    err = gsl_ingest_emit(out);
+    if (err.code) free(out);
+    return err;
+}
+
+static gsl_err_t consume_ingest_outs(void *obj, void *const *outs, size_t num_outs) {
+    struct IngestConsumer *self = (struct IngestConsumer *)obj;
+    gsl_err_t err = make_gsl_err(gsl_OK);
+
+    ck_assert_uint_gt(num_outs, 0);
+    ck_assert_uint_le(num_outs, 4);
+    for (size_t i = 0; i < num_outs; i++) {
+        struct IngestOut *out = (struct IngestOut *)outs[i];
+        ck_assert_uint_lt(out->rec_idx, NUM_INGEST_RECORDS);
+        if (out->rec_idx == self->fail_rec_idx)
+            err = make_gsl_err(gsl_EXTERNAL);
+        free(out);
+    }
+    self->num_outs += num_outs;
+    return err;
+}
+
+START_TEST(ingest_pipeline)
+    static char data[NUM_INGEST_RECORDS * 16];
+    struct IngestConsumer consumer_objs[NUM_INGEST_CONSUMERS];
+    struct gslIngestConsumer consumers[NUM_INGEST_CONSUMERS];
+    struct gslIngestOptions pipeline_options = options;
+    size_t data_size = 0, num_outs = 0;
+    char *path;
+
+    for (size_t i = 0; i < NUM_INGEST_RECORDS; i++)
+        data_size += sprintf(data + data_size, "{user u%zu}\n", i);
+    path = write_file(data);
+
+    for (size_t i = 0; i < NUM_INGEST_WORKERS; i++)
+        workers[i].parse = parse_ingest_emit;
+    for (size_t i = 0; i < NUM_INGEST_CONSUMERS; i++) {
+        consumer_objs[i] = (struct IngestConsumer){ .fail_rec_idx = SIZE_MAX };
+        consumers[i] = (struct gslIngestConsumer){ .obj = &consumer_objs[i], .consume = consume_ingest_outs };
+    }
+    // Small queues make every stage wait for the next one.
+    pipeline_options.out_queue_size = 4;
+    pipeline_options.batch_size = 4;
+
+    rc = gsl_ingest_pipeline((const char *const *)&path, 1, &pipeline_options,
+                             workers, NUM_INGEST_WORKERS, consumers, NUM_INGEST_CONSUMERS);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    for (size_t i = 0; i < NUM_INGEST_CONSUMERS; i++)
+        num_outs += consumer_objs[i].num_outs;
+    ck_assert_uint_eq(num_outs, NUM_INGEST_RECORDS);
+    ck_assert_uint_eq(users[NUM_INGEST_RECORDS - 1].name_size, strlen("u999"));
+
+    // Example: a consumer fails, the outputs emitted before are still consumed (and freed)
+    consumer_objs[0].fail_rec_idx = 10;
+    consumer_objs[1].fail_rec_idx = 10;
+    memset(users, 0, sizeof users);
+    rc = gsl_ingest_pipeline((const char *const *)&path, 1, &pipeline_options,
+                             workers, NUM_INGEST_WORKERS, consumers, NUM_INGEST_CONSUMERS);
+    ck_assert_int_eq(rc.code, gsl_EXTERNAL);
+
+    // Example: no consumers to emit to
+    memset(users, 0, sizeof users);
+    rc = gsl_ingest_files((const char *const *)&path, 1, &pipeline_options, workers, NUM_INGEST_WORKERS);
+    ck_assert_int_eq(rc.code, gsl_FAIL);
+    rc = gsl_ingest_emit(NULL);
+    ck_assert_int_eq(rc.code, gsl_FAIL);
+
+    remove_file(path);
+END_TEST
+
+// --------------------------------------------------------------------------------
+// main
+
+int main() {
+    Suite* s = suite_create("suite");
+
+    TCase* tc_ingest = tcase_create("ingest cases");
+    tcase_add_checked_fixture(tc_ingest, setup, NULL);
+    tcase_add_test(tc_ingest, ingest_files);
+    tcase_add_test(tc_ingest, ingest_files_empty);
+    tcase_add_test(tc_ingest, ingest_files_failed);
+    suite_add_tcase(s, tc_ingest);
+
+    TCase* tc_pipeline = tcase_create("pipeline cases");
+    tcase_add_checked_fixture(tc_pipeline, setup, NULL);
+    tcase_add_test(tc_pipeline, ingest_pipeline);
+    suite_add_tcase(s, tc_pipeline);
+
+    SRunner* sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    int num_failures = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return num_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
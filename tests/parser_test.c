@@ -3,6 +3,7 @@
 #include <check.h>
 
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -294,7 +295,8 @@ static gsl_err_t parse_skills(void *obj,
         size_t __exp_size = (exp_size-0) == 0 ? strlen(__exp) : (exp_size-0);                    \
         ck_assert_msg(__act_size == __exp_size && 0 == strncmp(__act, __exp, __act_size),        \
             "Assertion '%s' failed: %s == \"%.*s\" [len: %zu] but expected \"%.*s\" [len: %zu]", \
-            #act" == "#exp, #act, __act_size, __act, __act_size, __exp_size, __exp, __exp_size); \
+            #act" == "#exp, #act, (int)__act_size, __act, __act_size,                            \
+            (int)__exp_size, __exp, __exp_size);                                                 \
     } while (0)
 
 // --------------------------------------------------------------------------------
@@ -2641,6 +2643,700 @@ START_TEST(parse_cdata)
   }
 END_TEST
 
+// --------------------------------------------------------------------------------
+START_TEST(parse_stats)
+    struct gslTaskSpec groups_item_spec = gen_groups_item_spec(&user, 0);
+    DEFINE_TaskSpecs(parse_user_args, gen_name_spec(&user, SPEC_NAME), gen_groups_spec(&groups_item_spec, 0));
+    struct gslTaskSpec specs[] = { gen_user_spec(&parse_user_args, 0) };
+    const struct gslStats *stats = gsl_stats_get();
+    struct gslStats total = { 0 };
+
+    gsl_stats_reset();
+    rc = gsl_parse_task(rec = "{user {name John} {-old-} [groups jsmith audio]}", &total_size, specs, sizeof specs / sizeof specs[0]);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec));
+    gsl_stats_add(&total, stats);
+
+    if (!gsl_stats_enabled()) {
+        const struct gslStats zero = { 0 };
+        ck_assert(!memcmp(stats, &zero, sizeof zero));
+    } else {
+        ck_assert_uint_eq(stats->bytes_scanned, strlen(rec));
+        // Example: the dashes of "-old-" are visited by the comment scan and by the boundary check
+        ck_assert(stats->bytes_visited >= strlen(rec) && stats->bytes_visited <= strlen(rec) + 4);
+        ck_assert_uint_eq(stats->fields[GSL_GET_STATE], 2);
+        ck_assert_uint_eq(stats->fields[GSL_GET_ARRAY_STATE], 1);
+        ck_assert_uint_eq(stats->fields[GSL_SET_STATE], 0);
+        ck_assert_uint_eq(stats->list_items, 2);
+        ck_assert_uint_eq(stats->spec_lookups, 3);
+        ck_assert_uint_eq(stats->spec_misses, 0);
+        ck_assert_uint_eq(stats->runs, 2);
+        ck_assert_uint_eq(stats->parses, 2);
+        ck_assert_uint_eq(stats->bufs, 1);
+        ck_assert_uint_eq(stats->max_depth, 3);
+        ck_assert_uint_eq(stats->comment_bytes, strlen("-old-"));
+    }
+    user.name_size = 0; user.num_groups = 0; RESET_IS_COMPLETED_gslTaskSpec(specs); RESET_IS_COMPLETED_TaskSpecs(&parse_user_args);
+
+    gsl_stats_reset();
+    rc = gsl_parse_task(rec = "{user {nick John}}", &total_size, specs, sizeof specs / sizeof specs[0]);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    ck_assert_uint_eq(stats->spec_misses, gsl_stats_enabled() ? 1 : 0);
+    gsl_stats_add(&total, stats);
+
+    // Example: sums of two parses, but the deepest of them
+    ck_assert_uint_eq(total.spec_lookups, gsl_stats_enabled() ? 5 : 0);
+    ck_assert_uint_eq(total.max_depth, gsl_stats_enabled() ? 3 : 0);
+END_TEST
+
+START_TEST(parse_trace)
+    DEFINE_TaskSpecs(parse_user_args, gen_name_spec(&user, SPEC_NAME));
+    struct gslTaskSpec specs[] = { gen_user_spec(&parse_user_args, 0) };
+    struct gslTraceEvent events[8];
+    size_t num_events;
+
+    ck_assert_int_eq(gsl_trace_enable(8).code, gsl_OK);
+    gsl_trace_reset();
+    rc = gsl_parse_task(rec = "{user {-old-} {nick John}}", &total_size, specs, sizeof specs / sizeof specs[0]);
+    gsl_trace_disable();
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+
+    num_events = gsl_trace_events(events, sizeof events / sizeof events[0]);
+    ck_assert_uint_eq(num_events, 6);
+    ck_assert_int_eq(events[0].event, GSL_TRACE_ENTER); ck_assert_uint_eq(events[0].offset, 0);
+    ck_assert_int_eq(events[1].event, GSL_TRACE_FIELD); ck_assert_uint_eq(events[1].offset, strlen("{"));
+    ck_assert_uint_eq(events[1].spec_idx, 0); ck_assert_int_eq(events[1].arg, GSL_GET_STATE);
+    ck_assert_int_eq(events[2].event, GSL_TRACE_ENTER); ck_assert_uint_eq(events[2].depth, 2);
+    ck_assert_int_eq(events[3].event, GSL_TRACE_COMMENT); ck_assert_uint_eq(events[3].offset, strlen("{user {"));
+    ck_assert_int_eq(events[3].arg, strlen("-old-"));
+    ck_assert_int_eq(events[4].event, GSL_TRACE_LEAVE); ck_assert_int_eq(events[4].arg, gsl_NO_MATCH);
+    ck_assert_uint_eq(events[4].offset, strlen("{user {-old-} {nick"));
+    ck_assert_int_eq(events[5].event, GSL_TRACE_LEAVE); ck_assert_uint_eq(events[5].depth, 1);
+
+    // Example: the ring keeps the newest events only
+    ck_assert_int_eq(gsl_trace_enable(2).code, gsl_OK);
+    gsl_trace_reset();
+    rc = gsl_parse_task(rec = "{user {-old-} {nick John}}", &total_size, specs, sizeof specs / sizeof specs[0]);
+    gsl_trace_disable();
+    ck_assert_uint_eq(gsl_trace_events(events, sizeof events / sizeof events[0]), 2);
+    ck_assert_int_eq(events[0].event, GSL_TRACE_LEAVE); ck_assert_uint_eq(events[0].depth, 2);
+    ck_assert_int_eq(events[1].event, GSL_TRACE_LEAVE); ck_assert_uint_eq(events[1].depth, 1);
+END_TEST
+
+static const struct gslProfileEntry *find_profile_entry(const struct gslProfileEntry *entries, size_t num_entries,
+                                                        const char *tag, gsl_profile_kind_t kind) {
+    for (size_t i = 0; i < num_entries; i++) {
+        if (entries[i].kind == kind && entries[i].tag_size == strlen(tag) && !memcmp(entries[i].tag, tag, strlen(tag)))
+            return &entries[i];
+    }
+    return NULL;
+}
+
+START_TEST(parse_profile)
+    struct gslTaskSpec groups_item_spec = gen_groups_item_spec(&user, 0);
+    DEFINE_TaskSpecs(parse_user_args, gen_name_spec(&user, SPEC_RUN | SPEC_NAME), gen_groups_spec(&groups_item_spec, 0));
+    struct gslTaskSpec specs[] = { gen_user_spec(&parse_user_args, 0) };
+    struct gslProfileEntry entries[8];
+    const struct gslProfileEntry *entry;
+    size_t num_entries;
+
+    gsl_profile_reset();
+    rc = gsl_parse_task(rec = "{user {name John} [groups jsmith audio]}", &total_size, specs, sizeof specs / sizeof specs[0]);
+    ck_assert_int_eq(rc.code, gsl_OK);
+
+    num_entries = gsl_profile_entries(entries, sizeof entries / sizeof entries[0]);
+    if (!gsl_profile_enabled()) {
+        ck_assert_uint_eq(num_entries, 0);
+        return;
+    }
+
+    ck_assert_uint_eq(num_entries, 4);
+    for (size_t i = 1; i < num_entries; i++)
+        ck_assert_uint_ge(entries[i - 1].self_ns, entries[i].self_ns);
+
+    ck_assert((entry = find_profile_entry(entries, num_entries, "name", GSL_PROFILE_RUN)) != NULL);
+    ck_assert_uint_eq(entry->calls, 1);
+    ck_assert((entry = find_profile_entry(entries, num_entries, "groups", GSL_PROFILE_PARSE)) != NULL);
+    ck_assert_uint_eq(entry->calls, 1);
+    ck_assert((entry = find_profile_entry(entries, num_entries, "groups[]", GSL_PROFILE_RUN)) != NULL);
+    ck_assert_uint_eq(entry->calls, 2);
+
+    // Example: "name" and "groups" are nested into "user", "groups[]" into "groups"
+    uint64_t children_ns = find_profile_entry(entries, num_entries, "name", GSL_PROFILE_RUN)->total_ns +
+                           find_profile_entry(entries, num_entries, "groups", GSL_PROFILE_PARSE)->total_ns;
+    ck_assert((entry = find_profile_entry(entries, num_entries, "user", GSL_PROFILE_PARSE)) != NULL);
+    ck_assert_uint_eq(entry->calls, 1);
+    ck_assert_uint_eq(entry->total_ns, entry->self_ns + children_ns);
+END_TEST
+
+// --------------------------------------------------------------------------------
+START_TEST(parse_invalid_specs)
+    struct gslTaskSpec buf_run_specs[] = { gen_name_spec(&user, SPEC_NAME) };
+    DEFINE_TaskSpecs(parse_user_args, gen_name_spec(&user, 0), gen_name_spec(&user, SPEC_RUN));
+    struct gslTaskSpec user_specs[] = { gen_user_spec(&parse_user_args, 0) };
+    struct gslTaskSpec named_item_spec = gen_groups_item_spec(&user, 0);
+
+#ifdef GSL_CHECKED
+    ck_assert(gsl_checks_enabled());
+#else
+    ck_assert(!gsl_checks_enabled());
+    return;  // the specs are trusted, the behavior on these is undefined
+#endif
+
+    // Example: either a buf or a callback
+    buf_run_specs[0].run = run_set_name;
+    buf_run_specs[0].obj = &user;
+    rc = gsl_parse_task(rec = "John Smith", &total_size, buf_run_specs, sizeof buf_run_specs / sizeof buf_run_specs[0]);
+    ck_assert_int_eq(rc.code, gsl_INVALID);
+    ASSERT_STR_EQ(rc.val, (size_t)rc.val_size, "spec->run == NULL && spec->parse == NULL && spec->validate == NULL");
+    ck_assert_uint_eq(total_size, 0);
+    ck_assert_uint_eq(user.name_size, 0);
+
+    // Example: two implied specs, found while parsing
+    rc = gsl_parse_task(rec = "{user John Smith}", &total_size, user_specs, sizeof user_specs / sizeof user_specs[0]);
+    ck_assert_int_eq(rc.code, gsl_INVALID);
+
+    // Example: a named list item
+    named_item_spec.name = "gid";
+    named_item_spec.name_size = strlen("gid");
+    rc = gsl_parse_array(&named_item_spec, rec = "jsmith audio]", &total_size);
+    ck_assert_int_eq(rc.code, gsl_INVALID);
+    ASSERT_STR_EQ(rc.val, (size_t)rc.val_size, "spec->name == NULL");
+    ck_assert_uint_eq(user.num_groups, 0);
+END_TEST
+
+// --------------------------------------------------------------------------------
+static gsl_err_t run_get_ctx(void *obj, const char *val, size_t val_size) {
+    (void)val; (void)val_size;
+    *(struct gslCtx **)obj = gsl_ctx_current();
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t parse_fail_early(void *obj, const char *rec, size_t *total_size) {
+    (void)obj; (void)rec; (void)total_size;
+    return make_gsl_err(gsl_FAIL);
+}
+
+START_TEST(parse_ctx)
+    struct gslTaskSpec groups_item_spec = gen_groups_item_spec(&user, 0);
+    DEFINE_TaskSpecs(parse_user_args, gen_name_spec(&user, SPEC_NAME), gen_groups_spec(&groups_item_spec, 0));
+    struct gslTaskSpec specs[] = { gen_user_spec(&parse_user_args, 0) };
+    struct gslCtxOptions options = { .max_depth = 2 };
+    struct gslCtx ctx, *current = NULL;
+    struct gslTaskSpec ctx_specs[] = { { .name = "ctx", .name_size = strlen("ctx"), .run = run_get_ctx, .obj = &current } };
+
+    gsl_ctx_init(&ctx, NULL);
+    rc = gsl_ctx_parse_task(&ctx, rec = "{user {name John} [groups jsmith audio]}", &total_size, specs, sizeof specs / sizeof specs[0]);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec));
+    ck_assert_int_eq(ctx.error.code, gsl_OK);
+    ck_assert_uint_eq(ctx.stats.list_items, gsl_stats_enabled() ? 2 : 0);
+    ck_assert_uint_eq(ctx.stats.max_depth, gsl_stats_enabled() ? 3 : 0);
+    ck_assert(gsl_ctx_current() == NULL);
+    user.name_size = 0; user.num_groups = 0; RESET_IS_COMPLETED_gslTaskSpec(specs); RESET_IS_COMPLETED_TaskSpecs(&parse_user_args);
+
+    // Example: the error of the innermost call, described after the record is gone
+    rc = gsl_ctx_parse_task(&ctx, rec = "{user {name John} {nick jsmith}}", &total_size, specs, sizeof specs / sizeof specs[0]);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    ck_assert_int_eq(ctx.error.code, gsl_NO_MATCH);
+    ck_assert_uint_eq(ctx.error.offset, strlen("{user {name John} {nick"));
+    ck_assert_uint_eq(ctx.error.depth, 2);
+    ck_assert_uint_eq(ctx.error.desc_size, strlen("nick"));
+    ck_assert(!memcmp(ctx.error.desc, "nick", strlen("nick")));
+    ck_assert_uint_eq(ctx.stats.spec_misses, gsl_stats_enabled() ? 1 : 0);
+    user.name_size = 0; RESET_IS_COMPLETED_gslTaskSpec(specs); RESET_IS_COMPLETED_TaskSpecs(&parse_user_args);
+
+    // Example: "[groups" is the third level
+    gsl_ctx_init(&ctx, &options);
+    rc = gsl_ctx_parse_task(&ctx, rec = "{user {name John} [groups jsmith audio]}", &total_size, specs, sizeof specs / sizeof specs[0]);
+    ck_assert_int_eq(rc.code, gsl_LIMIT);
+    ck_assert_int_eq(ctx.error.code, gsl_LIMIT);
+    ck_assert_uint_eq(ctx.error.offset, strlen("{user {name John} [groups"));
+    ck_assert_uint_eq(ctx.error.depth, 3);
+    ck_assert_uint_eq(user.num_groups, 0);
+    user.name_size = 0; RESET_IS_COMPLETED_gslTaskSpec(specs); RESET_IS_COMPLETED_TaskSpecs(&parse_user_args);
+
+    // Example: the limit is of the context only
+    rc = gsl_parse_task(rec = "{user {name John} [groups jsmith audio]}", &total_size, specs, sizeof specs / sizeof specs[0]);
+    ck_assert_int_eq(rc.code, gsl_OK);
+
+    rc = gsl_ctx_parse_task(&ctx, rec = "{ctx}", &total_size, ctx_specs, sizeof ctx_specs / sizeof ctx_specs[0]);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert(current == &ctx);
+    ck_assert_int_eq(ctx.error.code, gsl_OK);
+
+    // Example: the parse function fails without setting |total_size|
+    total_size = 12345;
+    rc = gsl_ctx_parse(&ctx, parse_fail_early, NULL, rec = "{ctx}", &total_size);
+    ck_assert_int_eq(rc.code, gsl_FAIL);
+    ck_assert_uint_eq(total_size, 0);
+    ck_assert_int_eq(ctx.error.code, gsl_FAIL);
+    ck_assert_uint_eq(ctx.error.offset, 0);
+END_TEST
+
+START_TEST(parse_size_t)
+    size_t num = 0;
+
+    ck_assert_int_eq(gsl_run_set_size_t(&num, "12345", strlen("12345")).code, gsl_OK);
+    ck_assert_uint_eq(num, 12345);
+
+    // Example: only |val_size| characters are the value
+    ck_assert_int_eq(gsl_run_set_size_t(&num, "42}", strlen("42")).code, gsl_OK);
+    ck_assert_uint_eq(num, 42);
+    ck_assert_int_eq(gsl_run_set_size_t(&num, "4567", strlen("45")).code, gsl_OK);
+    ck_assert_uint_eq(num, 45);
+
+    ck_assert_int_eq(gsl_run_set_size_t(&num, "12a", strlen("12a")).code, gsl_FORMAT);
+    ck_assert_int_eq(gsl_run_set_size_t(&num, "-1", strlen("-1")).code, gsl_FORMAT);
+
+    if (sizeof(size_t) == 8) {
+        ck_assert_int_eq(gsl_run_set_size_t(&num, "18446744073709551615", strlen("18446744073709551615")).code, gsl_OK);
+        ck_assert_uint_eq(num, (size_t)-1);
+        ck_assert_int_eq(gsl_run_set_size_t(&num, "18446744073709551616", strlen("18446744073709551616")).code, gsl_LIMIT);
+    }
+    ck_assert_int_eq(gsl_run_set_size_t(&num, "99999999999999999999999", strlen("99999999999999999999999")).code, gsl_LIMIT);
+END_TEST
+
+// --------------------------------------------------------------------------------
+// SAX events, logged as text: "{tag", "{!tag", "[tag", "[!tag", ":terminal", "=implied",
+// "\"cdata", "}" or "]" for a closing brace, "*item" or "*{" for a non-atomic item.
+struct SaxLog { char buf[512]; size_t size; const char *stop_tag; };
+
+// |val| is NULL for closing braces and non-atomic items.
+static void sax_log(struct SaxLog *self, const char *prefix, const char *val, size_t val_size) {
+    int n = snprintf(self->buf + self->size, sizeof self->buf - self->size, "%s%.*s ", prefix, (int)val_size,
+                     val ? val : "");
+    ck_assert_int_gt(n, 0);
+    ck_assert_uint_lt(self->size + n, sizeof self->buf);
+    self->size += n;
+}
+
+static gsl_err_t sax_field_open(void *obj, gsl_task_spec_type kind, const char *tag, size_t tag_size) {
+    static const char *prefixes[] = { [GSL_GET_STATE] = "{", [GSL_GET_ARRAY_STATE] = "[",
+                                      [GSL_SET_STATE] = "{!", [GSL_SET_ARRAY_STATE] = "[!" };
+    struct SaxLog *self = (struct SaxLog *)obj;
+    if (self->stop_tag && tag_size == strlen(self->stop_tag) && !memcmp(tag, self->stop_tag, tag_size))
+        return make_gsl_err_external(gsl_EXISTS);
+    sax_log(self, prefixes[kind], tag, tag_size);
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t sax_terminal(void *obj, const char *val, size_t val_size) {
+    sax_log((struct SaxLog *)obj, ":", val, val_size);
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t sax_implied(void *obj, const char *val, size_t val_size) {
+    sax_log((struct SaxLog *)obj, "=", val, val_size);
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t sax_cdata(void *obj, const char *val, size_t val_size) {
+    sax_log((struct SaxLog *)obj, "\"", val, val_size);
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t sax_field_close(void *obj, gsl_task_spec_type kind) {
+    sax_log((struct SaxLog *)obj, kind == GSL_GET_STATE || kind == GSL_SET_STATE ? "}" : "]", NULL, 0);
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t sax_array_item(void *obj, const char *val, size_t val_size) {
+    sax_log((struct SaxLog *)obj, val ? "*" : "*{", val, val_size);
+    return make_gsl_err(gsl_OK);
+}
+
+#define SAX_HANDLER(log)                                                                        \
+    { .obj = &(log), .on_field_open = sax_field_open, .on_terminal = sax_terminal,            \
+      .on_implied = sax_implied, .on_cdata = sax_cdata, .on_field_close = sax_field_close,    \
+      .on_array_item = sax_array_item }
+
+START_TEST(sax_parse)
+    struct SaxLog log = { .size = 0 };
+    struct gslSaxHandler handler = SAX_HANDLER(log);
+    const char *rec;
+    size_t total_size;
+
+    rc = gsl_sax_parse(rec = "{user jsmith {name John Smith} [groups audio {sudo}] {bio {\"a}b\"}}}", &total_size, &handler);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec));
+    ck_assert_str_eq(log.buf, "{user =jsmith {name :John Smith } [groups *audio *{ =sudo } ] {bio \"a}b } } ");
+
+    // Example: set state, spaces, comments, nested items and an implied value after the fields
+    log.size = 0;
+    rc = gsl_sax_parse(rec = " {!user {-name {x}-}\n[!langs  en\tfr ] {-- [x] --}"
+                             "[groups {{gid a} admin} {}] {email} {nick {\"\" J\"n \"\"}} tail }}", &total_size, &handler);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec) - 1);
+    ck_assert_str_eq(log.buf, "{!user [!langs *en *fr ] [groups *{ {gid :a } =admin } *{ } ] {email } "
+                              "{nick \"J\"n } =tail } ");
+
+    // Example: the body of a field, as .parse of a spec gets it
+    log.size = 0;
+    rc = gsl_sax_parse(rec = "jsmith {name John}} {user sam}", &total_size, &handler);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen("jsmith {name John}"));
+    ck_assert_str_eq(log.buf, "=jsmith {name :John } ");
+
+    // Example: no callbacks
+    rc = gsl_sax_parse(rec = "{user {name John} [groups a b]}", &total_size, &(struct gslSaxHandler){ .obj = NULL });
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec));
+END_TEST
+
+START_TEST(sax_parse_failed)
+    struct SaxLog log = { .size = 0 };
+    struct gslSaxHandler handler = SAX_HANDLER(log);
+    static char deep[2 * (GSL_SAX_MAX_DEPTH + 1) + 1];
+    const char *rec;
+    size_t total_size;
+
+    rc = gsl_sax_parse(rec = "{user {name John]}", &total_size, &handler);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen("{user {name John"));
+
+    rc = gsl_sax_parse(rec = "{user {name John}", &total_size, &handler);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen(rec));
+
+    rc = gsl_sax_parse(rec = "{user {} }", &total_size, &handler);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen("{user "));
+
+    rc = gsl_sax_parse(rec = "{user [groups a-b]}", &total_size, &handler);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen("{user [groups a"));
+
+    rc = gsl_sax_parse(rec = "{user {-name John}", &total_size, &handler);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+
+    rc = gsl_sax_parse(rec = "{user {bio {\"\"John\"}}}", &total_size, &handler);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen("{user {bio "));
+
+    // Example: a callback stops the scan at the field
+    log.stop_tag = "name";
+    rc = gsl_sax_parse(rec = "{user {sid 1} {name John}}", &total_size, &handler);
+    ck_assert(is_gsl_err_external(rc));
+    ck_assert_int_eq(gsl_err_external_to_ext_code(rc), gsl_EXISTS);
+    ck_assert_uint_eq(total_size, strlen("{user {sid 1} "));
+
+    // Example: too deep
+    for (size_t i = 0; i <= GSL_SAX_MAX_DEPTH; i++)
+        memcpy(deep + 2 * i, "{a", 2);
+    rc = gsl_sax_parse(deep, &total_size, &(struct gslSaxHandler){ .obj = NULL });
+    ck_assert_int_eq(rc.code, gsl_LIMIT);
+    ck_assert_uint_eq(total_size, 2 * GSL_SAX_MAX_DEPTH);
+END_TEST
+
+START_TEST(reader_next)
+    static const gsl_event_type types[] = {
+        GSL_EVENT_FIELD_OPEN, GSL_EVENT_IMPLIED, GSL_EVENT_FIELD_OPEN, GSL_EVENT_TERMINAL, GSL_EVENT_FIELD_CLOSE,
+        GSL_EVENT_FIELD_OPEN, GSL_EVENT_ARRAY_ITEM, GSL_EVENT_ARRAY_ITEM, GSL_EVENT_IMPLIED, GSL_EVENT_FIELD_CLOSE,
+        GSL_EVENT_FIELD_CLOSE, GSL_EVENT_FIELD_OPEN, GSL_EVENT_CDATA, GSL_EVENT_FIELD_CLOSE, GSL_EVENT_FIELD_CLOSE,
+        GSL_EVENT_END
+    };
+    const char *rec = "{user jsmith {name John} [!groups audio {sudo}] {bio {\"a}b\"}}} } {next}";
+    struct gslReader reader;
+    struct gslEvent event;
+    size_t num_events = 0;
+
+    gsl_reader_init(&reader, rec);
+    do {
+        rc = gsl_next(&reader, &event);
+        ck_assert_int_eq(rc.code, gsl_OK);
+        ck_assert_uint_lt(num_events, sizeof types / sizeof types[0]);
+        ck_assert_int_eq(event.type, types[num_events]);
+        num_events++;
+
+        if (event.type == GSL_EVENT_FIELD_OPEN && event.kind == GSL_SET_ARRAY_STATE) {
+            ck_assert_uint_eq(event.val_size, strlen("groups"));
+            ck_assert(!memcmp(event.val, "groups", event.val_size));
+            ck_assert_uint_eq(event.pos - rec, strlen("{user jsmith {name John} "));
+        }
+        if (event.type == GSL_EVENT_TERMINAL) {
+            ck_assert_uint_eq(reader.depth, 2);
+            ck_assert_uint_eq(event.val_size, strlen("John"));
+            ck_assert(!memcmp(event.val, "John", event.val_size));
+        }
+        if (event.type == GSL_EVENT_CDATA) {
+            ck_assert_uint_eq(event.val_size, strlen("a}b"));
+            ck_assert(!memcmp(event.val, "a}b", event.val_size));
+        }
+    } while (event.type != GSL_EVENT_END);
+    ck_assert_uint_eq(num_events, sizeof types / sizeof types[0]);
+    ck_assert_uint_eq(reader.pos - rec, strlen("{user jsmith {name John} [!groups audio {sudo}] {bio {\"a}b\"}}} "));
+
+    // Example: the end is sticky
+    rc = gsl_next(&reader, &event);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_int_eq(event.type, GSL_EVENT_END);
+
+    // Example: stop at the first terminal value, nothing to clean up
+    gsl_reader_init(&reader, rec = "{user {sid 1} {name John}}");
+    while (!(rc = gsl_next(&reader, &event)).code && event.type != GSL_EVENT_TERMINAL)
+        ;
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(event.val_size, 1);
+    ck_assert_int_eq(*event.val, '1');
+    ck_assert_uint_eq(reader.pos - rec, strlen("{user {sid 1"));
+END_TEST
+
+START_TEST(reader_next_failed)
+    const char *rec = "{user {name John]}";
+    struct gslReader reader;
+    struct gslEvent event;
+
+    gsl_reader_init(&reader, rec);
+    while (!(rc = gsl_next(&reader, &event)).code)
+        ck_assert_int_ne(event.type, GSL_EVENT_END);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(reader.pos - rec, strlen("{user {name John"));
+
+    // Example: the error is sticky
+    rc = gsl_next(&reader, &event);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_int_eq(event.type, GSL_EVENT_END);
+    ck_assert_uint_eq(reader.pos - rec, strlen("{user {name John"));
+END_TEST
+
+// --------------------------------------------------------------------------------
+// projections, logged as "prefix:body" of every field on a path; the body "stop" fails.
+struct ProjectionHit { struct SaxLog *log; const char *prefix; };
+
+static gsl_err_t projection_run(void *obj, const char *val, size_t val_size) {
+    struct ProjectionHit *self = (struct ProjectionHit *)obj;
+    if (val_size == strlen("stop") && !memcmp(val, "stop", val_size))
+        return make_gsl_err_external(gsl_EXISTS);
+    sax_log(self->log, self->prefix, val, val_size);
+    return make_gsl_err(gsl_OK);
+}
+
+START_TEST(projection_parse)
+    struct SaxLog log = { .size = 0 };
+    struct ProjectionHit name = { &log, "name:" }, contacts = { &log, "contacts:" }, email = { &log, "email:" },
+                         group = { &log, "group:" }, gid = { &log, "gid:" }, bio = { &log, "bio:" };
+    const struct gslPath paths[] = {
+        { "user/name", &name, projection_run },
+        { "user/contacts", &contacts, projection_run },
+        { "user/contacts/email", &email, projection_run },
+        { "user/groups[]", &group, projection_run },
+        { "user/groups[]/gid", &gid, projection_run },
+        { "user/bio", &bio, projection_run }
+    };
+    struct gslProjection *projection;
+    const char *rec;
+    size_t total_size;
+
+    rc = gsl_projection_create(paths, sizeof paths / sizeof paths[0], &projection);
+    ck_assert_int_eq(rc.code, gsl_OK);
+
+    rc = gsl_parse_projection(rec = "{user jsmith {name  John Smith } {sid 1 {-x}-}} {skip {\"a}b\"} [x {y}]}"
+                                    "{contacts {email a@b.c} {mobile {x {y}}}} [groups audio {gid 7} {{gid a} admin}]"
+                                    "{!bio {\"a}b\"}} {name Sam}}",
+                              &total_size, projection);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec));
+    ck_assert_str_eq(log.buf, "name:John Smith contacts:{email a@b.c} {mobile {x {y}}} email:a@b.c "
+                              "group:audio group:gid 7 group:{gid a} admin gid:a bio:{\"a}b\"} name:Sam ");
+
+    // Example: no field on the paths, and the body of a field, as .parse of a spec gets it
+    log.size = 0;
+    rc = gsl_parse_projection(rec = "{users {name John}} {name Sam}} {user {name Bob}}", &total_size, projection);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen("{users {name John}} {name Sam}"));
+    ck_assert_uint_eq(log.size, 0);
+
+    gsl_projection_destroy(projection);
+END_TEST
+
+START_TEST(projection_failed)
+    struct SaxLog log = { .size = 0 };
+    struct ProjectionHit name = { &log, "name:" };
+    static const char *bad_paths[] = { "", "user/", "user//name", "[]", "user/[]", "user/gr oups", "user/{name}",
+                                       "user/!name", "user/groups[]]", "user/groups[][]" };
+    static char deep[2 * (GSL_READER_MAX_DEPTH + 1) + 1];
+    struct gslProjection *projection;
+    const char *rec;
+    size_t total_size;
+
+    for (size_t i = 0; i < sizeof bad_paths / sizeof bad_paths[0]; i++) {
+        rc = gsl_projection_create(&(struct gslPath){ bad_paths[i], &name, projection_run }, 1, &projection);
+        ck_assert_int_eq(rc.code, gsl_INVALID);
+        ck_assert_ptr_eq(rc.val, bad_paths[i]);
+    }
+    rc = gsl_projection_create(&(struct gslPath){ "user/name", &name, NULL }, 1, &projection);
+    ck_assert_int_eq(rc.code, gsl_INVALID);
+    rc = gsl_projection_create((struct gslPath[]){ { "user/name", &name, projection_run },
+                                                   { NULL, &name, projection_run } }, 2, &projection);
+    ck_assert_int_eq(rc.code, gsl_INVALID);
+    ck_assert_ptr_eq(rc.val, NULL);
+
+    rc = gsl_projection_create((struct gslPath[]){ { "user/name", &name, projection_run },
+                                                   { "user/groups[]", &name, projection_run },
+                                                   { "user/name", &name, projection_run } }, 3, &projection);
+    ck_assert_int_eq(rc.code, gsl_EXISTS);
+    ck_assert_str_eq(rc.val, "user/name");
+
+    rc = gsl_projection_create(&(struct gslPath){ "user/name", &name, projection_run }, 1, &projection);
+    ck_assert_int_eq(rc.code, gsl_OK);
+
+    // Example: the braces of a skipped field
+    rc = gsl_parse_projection(rec = "{user {sid 1 [x}} {name John}}", &total_size, projection);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen("{user {sid 1 [x"));
+
+    rc = gsl_parse_projection(rec = "{user {sid {1}", &total_size, projection);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen(rec));
+
+    rc = gsl_parse_projection(rec = "{user {bio {\"\"John\"}}} {name John}}", &total_size, projection);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen("{user {bio "));
+
+    // Example: a callback stops the scan at the field
+    rc = gsl_parse_projection(rec = "{user {sid 1} {name stop}}", &total_size, projection);
+    ck_assert(is_gsl_err_external(rc));
+    ck_assert_int_eq(gsl_err_external_to_ext_code(rc), gsl_EXISTS);
+    ck_assert_uint_eq(total_size, strlen("{user {sid 1} "));
+    ck_assert_uint_eq(log.size, 0);
+    gsl_projection_destroy(projection);
+
+    // Example: too deep in a skipped field
+    rc = gsl_projection_create(&(struct gslPath){ "b", &name, projection_run }, 1, &projection);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    for (size_t i = 0; i <= GSL_READER_MAX_DEPTH; i++)
+        memcpy(deep + 2 * i, "{a", 2);
+    rc = gsl_parse_projection(deep, &total_size, projection);
+    ck_assert_int_eq(rc.code, gsl_LIMIT);
+    ck_assert_uint_eq(total_size, 2 * GSL_READER_MAX_DEPTH);
+    gsl_projection_destroy(projection);
+END_TEST
+
+START_TEST(filter_match)
+    const struct gslPredicate preds[] = {
+        { .path = "user/name", .type = GSL_PREDICATE_EQUALS, .val = "John Smith" },
+        { .path = "user/sid", .type = GSL_PREDICATE_RANGE, .min = 1, .max = 100 },
+        { .path = "user/contacts/email", .type = GSL_PREDICATE_PREFIX, .val = "john@" },
+        { .path = "user/groups", .type = GSL_PREDICATE_CONTAINS, .val = "sudo" },
+        { .path = "user/groups[]/gid", .type = GSL_PREDICATE_EQUALS, .val = "7" },
+        { .path = "user/bio", .type = GSL_PREDICATE_EXISTS }
+    };
+    struct gslFilter *filter;
+    const char *rec;
+    size_t total_size;
+
+    rc = gsl_filter_create(preds, sizeof preds / sizeof preds[0], &filter);
+    ck_assert_int_eq(rc.code, gsl_OK);
+
+    // Example: decided at "{bio", the rest is not looked at
+    rc = gsl_filter_match(rec = "{user {name  John Smith } {sid 42} {contacts {email john@b.c}}"
+                                "[groups audio {{gid 8}} {{gid 7} admin} sudo] {!bio x} {name {x]}",
+                          &total_size, filter);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strstr(rec, "{!bio") + strlen("{!bio") - rec);
+
+    rc = gsl_filter_match(rec = "{user {-name x-} {bio {\"x\"}} [groups {{gid 7}} sudo] {sid 1e2} {nick sam}"
+                                "{contacts {mobile 1} {email john@}} {name John Smith}}",
+                          &total_size, filter);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec) - strlen("}}"));
+
+    // Example: a value which doesn't match
+    rc = gsl_filter_match(rec = "{user {name John} {sid 42}}", &total_size, filter);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    ck_assert_uint_eq(total_size, strlen("{user {name "));
+
+    rc = gsl_filter_match(rec = "{user {sid 420} {name John Smith}}", &total_size, filter);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    ck_assert_uint_eq(total_size, strlen("{user {sid "));
+
+    rc = gsl_filter_match(rec = "{user {sid 4x} {name John Smith}}", &total_size, filter);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    ck_assert_uint_eq(total_size, strlen("{user {sid "));
+
+    // Example: no such item by the close of the array, no such field by the close of its parent
+    rc = gsl_filter_match(rec = "{user [groups audio {{gid 7}} {sudo}] {name John Smith}}", &total_size, filter);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    ck_assert_uint_eq(total_size, strlen("{user [groups audio {{gid 7}} {sudo}"));
+
+    rc = gsl_filter_match(rec = "{user [groups sudo {gid 7}] {name John Smith}}", &total_size, filter);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    ck_assert_uint_eq(total_size, strlen("{user [groups sudo {gid 7}"));
+
+    rc = gsl_filter_match(rec = "{user {contacts {mobile 1} {email {addr john@}}} {name John Smith}}", &total_size, filter);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    ck_assert_uint_eq(total_size, strlen("{user {contacts {mobile 1} {email {addr john@}}"));
+
+    rc = gsl_filter_match(rec = "{user {name John Smith} {sid 42} {contacts {email john@b.c}} [groups sudo {{gid 7}}]}",
+                          &total_size, filter);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    ck_assert_uint_eq(total_size, strlen(rec) - strlen("}"));
+
+    rc = gsl_filter_match(rec = "{user {name John Smith} {sid 42} [groups sudo {{gid 7}}] {bio x}}", &total_size, filter);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    ck_assert_uint_eq(total_size, strlen(rec) - strlen("}"));
+
+    rc = gsl_filter_match(rec = "{users {name John Smith}}", &total_size, filter);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    ck_assert_uint_eq(total_size, strlen(rec));
+
+    // Example: no predicates
+    gsl_filter_destroy(filter);
+    rc = gsl_filter_create(NULL, 0, &filter);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    rc = gsl_filter_match(rec = "{user {name John}}", &total_size, filter);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, 0);
+    gsl_filter_destroy(filter);
+END_TEST
+
+START_TEST(filter_failed)
+    struct gslPredicate preds[GSL_FILTER_MAX_PREDICATES + 1];
+    size_t sid = 0;
+    struct gslTaskSpec specs[] = {
+        { .name = "sid", .name_size = strlen("sid"), .obj = &sid, .run = gsl_run_set_size_t }
+    };
+    struct gslFilter *filter;
+    const char *rec;
+    size_t total_size;
+
+    for (size_t i = 0; i < sizeof preds / sizeof preds[0]; i++)
+        preds[i] = (struct gslPredicate){ .path = "user/name", .type = GSL_PREDICATE_EXISTS };
+    rc = gsl_filter_create(preds, sizeof preds / sizeof preds[0], &filter);
+    ck_assert_int_eq(rc.code, gsl_LIMIT);
+
+    rc = gsl_filter_create(&(struct gslPredicate){ .path = "user//name", .type = GSL_PREDICATE_EXISTS }, 1, &filter);
+    ck_assert_int_eq(rc.code, gsl_INVALID);
+    ck_assert_str_eq(rc.val, "user//name");
+    rc = gsl_filter_create(&(struct gslPredicate){ .path = "user/name", .type = GSL_PREDICATE_PREFIX }, 1, &filter);
+    ck_assert_int_eq(rc.code, gsl_INVALID);
+    ck_assert_str_eq(rc.val, "user/name");
+    rc = gsl_filter_create(&(struct gslPredicate){ .path = NULL, .type = GSL_PREDICATE_EXISTS }, 1, &filter);
+    ck_assert_int_eq(rc.code, gsl_INVALID);
+    ck_assert_ptr_eq(rc.val, NULL);
+
+    rc = gsl_filter_create(&(struct gslPredicate){ .path = "sid", .type = GSL_PREDICATE_RANGE, .min = 10, .max = 20 }, 1, &filter);
+    ck_assert_int_eq(rc.code, gsl_OK);
+
+    // Example: the braces of a skipped field
+    rc = gsl_filter_match(rec = "{name [x}} {sid 15}", &total_size, filter);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen("{name [x"));
+
+    // Example: the specs see only the records which match
+    rc = gsl_parse_task_filtered(filter, rec = "{sid 5}", &total_size, specs, 1);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    ck_assert_uint_eq(sid, 0);
+    ck_assert(!specs[0].is_completed);
+
+    rc = gsl_parse_task_filtered(filter, rec = "{sid 15}", &total_size, specs, 1);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec));
+    ck_assert_uint_eq(sid, 15);
+    gsl_filter_destroy(filter);
+END_TEST
+
 // --------------------------------------------------------------------------------
 // main
 
@@ -2756,6 +3452,35 @@ int main() {
     tcase_add_test(tc_cdata, parse_cdata);
     suite_add_tcase(s, tc_cdata);
 
+    TCase* tc_stats = tcase_create("stats cases");
+    tcase_add_checked_fixture(tc_stats, test_case_fixture_setup, NULL);
+    tcase_add_test(tc_stats, parse_stats);
+    tcase_add_test(tc_stats, parse_trace);
+    tcase_add_test(tc_stats, parse_profile);
+    suite_add_tcase(s, tc_stats);
+
+    TCase* tc_check = tcase_create("check cases");
+    tcase_add_checked_fixture(tc_check, test_case_fixture_setup, NULL);
+    tcase_add_test(tc_check, parse_invalid_specs);
+    suite_add_tcase(s, tc_check);
+
+    TCase* tc_ctx = tcase_create("ctx cases");
+    tcase_add_checked_fixture(tc_ctx, test_case_fixture_setup, NULL);
+    tcase_add_test(tc_ctx, parse_ctx);
+    tcase_add_test(tc_ctx, parse_size_t);
+    suite_add_tcase(s, tc_ctx);
+
+    TCase* tc_sax = tcase_create("sax cases");
+    tcase_add_test(tc_sax, sax_parse);
+    tcase_add_test(tc_sax, sax_parse_failed);
+    tcase_add_test(tc_sax, reader_next);
+    tcase_add_test(tc_sax, reader_next_failed);
+    tcase_add_test(tc_sax, projection_parse);
+    tcase_add_test(tc_sax, projection_failed);
+    tcase_add_test(tc_sax, filter_match);
+    tcase_add_test(tc_sax, filter_failed);
+    suite_add_tcase(s, tc_sax);
+
     SRunner* sr = srunner_create(s);
     //srunner_set_fork_status(sr, CK_NOFORK);
     srunner_run_all(sr, CK_NORMAL);
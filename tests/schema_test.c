@@ -0,0 +1,352 @@
+#include "user.gsl.h"
+
+#include <check.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --------------------------------------------------------------------------------
+// Same objects as of schema/user.gsl, declared by X-macros
+
+#define XGROUP_FIELDS(X, _)                     \
+    X(_, IMPLIED_STR, gid, 32)                  \
+    X(_, SIZE_T, level)
+
+#define XCONTACTS_FIELDS(X, _)                  \
+    X(_, STR, email, 64)                        \
+    X(_, STR, phone, 16)
+
+#define XUSER_FIELDS(X, _)                      \
+    X(_, IMPLIED_STR, name, 64)                 \
+    X(_, STR, sid, 6)                           \
+    X(_, ARENA_STR, note, 256)                  \
+    X(_, SIZE_T, age)                           \
+    X(_, OBJECT, contacts, xcontacts)           \
+    X(_, STR_LIST, languages, 16, 4)            \
+    X(_, ARENA_STR_LIST, aliases, 0, 2)         \
+    X(_, SIZE_T_LIST, scores, 3)                \
+    X(_, OBJECT_LIST, groups, xgroup, 4)
+
+GSL_XOBJECT_DECLARE(xgroup, XGROUP_FIELDS);
+GSL_XOBJECT_DECLARE(xcontacts, XCONTACTS_FIELDS);
+GSL_XOBJECT_DECLARE(xuser, XUSER_FIELDS);
+
+GSL_XOBJECT_DEFINE(xgroup, "group", XGROUP_FIELDS);
+GSL_XOBJECT_DEFINE(xcontacts, "contacts", XCONTACTS_FIELDS);
+GSL_XOBJECT_DEFINE(xuser, "user", XUSER_FIELDS);
+
+// Everything is known at compile time.
+_Static_assert(sizeof(struct xuser) == sizeof(struct User), "same layout as generated");
+_Static_assert(xuser_FIELD_groups == 8 && xuser_NUM_FIELDS == 9, "fields in order");
+
+// --------------------------------------------------------------------------------
+// Common variables
+gsl_err_t rc;
+size_t total_size;
+struct gslArena arena;
+struct User user;
+
+static void setup(void) {
+    gsl_arena_init(&arena, 0);
+}
+
+static void teardown(void) {
+    gsl_arena_free(&arena);
+}
+
+// --------------------------------------------------------------------------------
+// Parsing
+
+START_TEST(parse_generated_user)
+    const char *rec = "{user Fred {sid 7} {note likes cats} {age 42}"
+                      " {contacts {email fred@example.com}}"
+                      " [languages en fr] [aliases fr3d f] [scores 1 2 3]"
+                      " [groups {admin {level 9}} {dev}]}";
+
+    rc = user_parse_record(&user, &arena, rec, &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec));
+
+    ck_assert_uint_eq(user.name_size, strlen("Fred"));
+    ck_assert(!memcmp(user.name, "Fred", user.name_size));
+    ck_assert_uint_eq(user.sid_size, 1);
+    ck_assert_uint_eq(user.note.size, strlen("likes cats"));
+    ck_assert_str_eq(user.note.str, "likes cats");
+    ck_assert_uint_eq(user.age, 42);
+
+    ck_assert_uint_eq(user.contacts.email_size, strlen("fred@example.com"));
+    ck_assert_uint_eq(user.contacts.phone_size, 0);
+
+    ck_assert_uint_eq(user.num_languages, 2);
+    ck_assert_uint_eq(user.languages_sizes[1], 2);
+    ck_assert(!memcmp(user.languages[1], "fr", 2));
+    ck_assert_uint_eq(user.num_aliases, 2);
+    ck_assert_str_eq(user.aliases[0].str, "fr3d");
+    ck_assert_uint_eq(user.num_scores, 3);
+    ck_assert_uint_eq(user.scores[2], 3);
+
+    ck_assert_uint_eq(user.num_groups, 2);
+    ck_assert_uint_eq(user.groups[0].gid_size, strlen("admin"));
+    ck_assert_uint_eq(user.groups[0].level, 9);
+    ck_assert_uint_eq(user.groups[1].gid_size, strlen("dev"));
+    ck_assert_uint_eq(user.groups[1].level, 0);
+END_TEST
+
+START_TEST(parse_generated_user_empty)
+    rc = user_parse_record(&user, &arena, "{user}", &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(user.name_size, 0);
+    ck_assert_uint_eq(user.num_groups, 0);
+
+    rc = user_parse_record(&user, &arena, "{user {sid 1} {contacts}}", &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(user.sid_size, 1);
+END_TEST
+
+START_TEST(parse_generated_user_failed)
+    // Example: fixed string overflow
+    rc = user_parse_record(&user, &arena, "{user {sid 1234567}}", &total_size);
+    ck_assert_int_eq(rc.code, gsl_LIMIT);
+
+    // Example: too many list items
+    rc = user_parse_record(&user, &arena, "{user [scores 1 2 3 4]}", &total_size);
+    ck_assert_int_eq(rc.code, gsl_LIMIT);
+    rc = user_parse_record(&user, &arena, "{user [groups {a} {b} {c} {d} {e}]}", &total_size);
+    ck_assert_int_eq(rc.code, gsl_LIMIT);
+
+    // Example: bad number, empty number
+    rc = user_parse_record(&user, &arena, "{user {age x}}", &total_size);
+    ck_assert_int_ne(rc.code, gsl_OK);
+    rc = user_parse_record(&user, &arena, "{user {age}}", &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+
+    // Example: unknown field, wrong tag
+    rc = user_parse_record(&user, &arena, "{user {height 180}}", &total_size);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    rc = user_parse_record(&user, &arena, "{group admin}", &total_size);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+
+    // Example: arena strings without an arena
+    rc = user_parse_record(&user, NULL, "{user {note hi}}", &total_size);
+    ck_assert_int_eq(rc.code, gsl_FAIL);
+    rc = user_parse_record(&user, NULL, "{user {age 1}}", &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+
+    // Example: a hand-written spec with too many fields
+    static const struct gslFieldSpec many_fields[GSL_OBJECT_MAX_FIELDS + 1];
+    const struct gslObjectSpec many_spec = {
+        .tag = "user", .tag_size = strlen("user"), .size = sizeof user,
+        .fields = many_fields, .num_fields = GSL_OBJECT_MAX_FIELDS + 1
+    };
+    total_size = 1;
+    rc = gsl_parse_object(&many_spec, &user, &arena, "{age 1}", &total_size);
+    ck_assert_int_eq(rc.code, gsl_LIMIT);
+    ck_assert_uint_eq(total_size, 0);
+END_TEST
+
+START_TEST(parse_generated_user_generic)
+    // The specialized parser and gsl_parse_task() over |user_spec| agree.
+    static const char *recs[] = {
+        "{user Fred {sid 7} {note likes cats} {age 42} {contacts {email fred@example.com}}"
+        " [languages en fr] [aliases fr3d f] [scores 1 2 3] [groups {admin {level 9}} {dev}]}",
+        "{user}",
+        "{user\n\t{age 1}\n}",
+        "{user {-sid 7-} {age 1} [-groups {a}-]}",
+        "{user {contacts{phone 1}} [groups{a}]}",
+        "{user {age 1} {age 2}}",
+        "{user {sid 1} {sid 2}}",
+        "{user {sid 1234567}}",
+        "{user {sid}}",
+        "{user {age 1x}}",
+        "{user {age 99999999999999999999999}}",
+        "{user {height 180}}",
+        "{user {sid {x}}}",
+        "{user [sid 7]}",
+        "{user {groups {a}}}",
+        "{user [languages en-us]}",
+        "{user [languages a b c d e]}",
+        "{user [groups {a} {b} {c} {d} {e}]}",
+        "{group admin}"
+    };
+    struct User copy;
+    size_t copy_size;
+    char buf[1024], copy_buf[1024];
+    size_t buf_size, copy_buf_size;
+    gsl_err_t copy_rc;
+
+    for (size_t i = 0; i < sizeof recs / sizeof recs[0]; i++) {
+        rc = user_parse_record(&user, &arena, recs[i], &total_size);
+        copy_rc = gsl_parse_object_record(&user_spec, &copy, &arena, recs[i], &copy_size);
+        ck_assert_msg(rc.code == copy_rc.code, "%s: %d vs %d", recs[i], rc.code, copy_rc.code);
+        if (rc.code) continue;
+
+        ck_assert_uint_eq(total_size, copy_size);
+        ck_assert_int_eq(user_emit_record(&user, buf, sizeof buf, &buf_size).code, gsl_OK);
+        ck_assert_int_eq(user_emit_record(&copy, copy_buf, sizeof copy_buf, &copy_buf_size).code, gsl_OK);
+        ck_assert_uint_eq(buf_size, copy_buf_size);
+        ck_assert(!memcmp(buf, copy_buf, buf_size));
+    }
+
+    // Example: a single record is parsed
+    rc = user_parse_record(&user, &arena, "{user {age 1}}  {user {age 2}}", &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen("{user {age 1}}  "));
+    ck_assert_uint_eq(user.age, 1);
+
+    // Example: unterminated record, atomic item in a list of objects
+    rc = user_parse_record(&user, &arena, "{user {age 1}", &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    rc = user_parse_record(&user, &arena, "{user [groups a]}", &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+END_TEST
+
+START_TEST(parse_xobject_user)
+    static const char *recs[] = {
+        "{user Fred {sid 7} {note likes cats} {age 42} {contacts {email fred@example.com}}"
+        " [languages en fr] [aliases fr3d f] [scores 1 2 3] [groups {admin {level 9}} {dev}]}",
+        "{user}",
+        "{user {-sid 7-} {age 1} [-groups {a}-]}",
+        "{user {sid 1234567}}",
+        "{user {height 180}}",
+        "{user [sid 7]}",
+        "{user {groups {a}}}",
+        "{user [scores 1 2 3 4]}",
+        "{group admin}"
+    };
+    struct xuser xuser;
+    size_t xuser_size;
+
+    // Example: "sid" and "age" share the bucket, "name" is implied
+    ck_assert_uint_eq(xuser_buckets[3], (1u << xuser_FIELD_sid) | (1u << xuser_FIELD_age));
+    ck_assert_uint_eq(xuser_buckets[4], 1u << xuser_FIELD_note);
+    ck_assert_int_eq(xuser_lookup("languages", 9), xuser_FIELD_languages);
+    ck_assert_int_eq(xuser_lookup("name", 4), -1);
+    ck_assert_int_eq(xuser_lookup("agE", 3), -1);
+
+    for (size_t i = 0; i < sizeof recs / sizeof recs[0]; i++) {
+        rc = user_parse_record(&user, &arena, recs[i], &total_size);
+        gsl_err_t xrc = gsl_parse_object_record(&xuser_spec, &xuser, &arena, recs[i], &xuser_size);
+        ck_assert_msg(rc.code == xrc.code, "%s: %d vs %d", recs[i], rc.code, xrc.code);
+        if (rc.code) continue;
+
+        ck_assert_uint_eq(total_size, xuser_size);
+        ck_assert(!memcmp(xuser.name, user.name, sizeof user.name));
+        ck_assert_uint_eq(xuser.name_size, user.name_size);
+        ck_assert_uint_eq(xuser.note.size, user.note.size);
+        ck_assert_uint_eq(xuser.age, user.age);
+        ck_assert(!memcmp(&xuser.contacts, &user.contacts, sizeof user.contacts));
+        ck_assert(!memcmp(xuser.languages, user.languages, sizeof user.languages));
+        ck_assert_uint_eq(xuser.num_aliases, user.num_aliases);
+        ck_assert(!memcmp(xuser.scores, user.scores, sizeof user.scores));
+        ck_assert(!memcmp(xuser.groups, user.groups, sizeof user.groups));
+        ck_assert_uint_eq(xuser.num_groups, user.num_groups);
+    }
+END_TEST
+
+// --------------------------------------------------------------------------------
+// Setters and emitters
+
+START_TEST(set_generated_user)
+    struct Group *group;
+
+    memset(&user, 0, sizeof user);
+    ck_assert_int_eq(user_set_name(&user, "Fred", 4).code, gsl_OK);
+    ck_assert_int_eq(user_set_sid(&user, "1234567", 7).code, gsl_LIMIT);
+    ck_assert_int_eq(user_set_sid(&user, "123456", 6).code, gsl_OK);
+    ck_assert_int_eq(user_set_note(&user, &arena, "hello world", 11).code, gsl_OK);
+    ck_assert_int_eq(user_set_age(&user, 7).code, gsl_OK);
+    ck_assert_int_eq(user_contacts_set_phone(&user.contacts, "555", 3).code, gsl_OK);
+
+    for (size_t i = 0; i < 4; i++)
+        ck_assert_int_eq(user_add_languages(&user, "en", 2).code, gsl_OK);
+    ck_assert_int_eq(user_add_languages(&user, "fr", 2).code, gsl_LIMIT);
+    ck_assert_uint_eq(user.num_languages, 4);
+
+    ck_assert_int_eq(user_add_aliases(&user, &arena, "f", 1).code, gsl_OK);
+    ck_assert_int_eq(user_add_scores(&user, 10).code, gsl_OK);
+
+    for (size_t i = 0; i < 4; i++) {
+        group = user_add_groups(&user);
+        ck_assert(group);
+        ck_assert_int_eq(group_set_gid(group, "g", 1).code, gsl_OK);
+        ck_assert_int_eq(group_set_level(group, i).code, gsl_OK);
+    }
+    ck_assert(!user_add_groups(&user));
+
+    ck_assert_str_eq(user.note.str, "hello world");
+    ck_assert_uint_eq(user.groups[3].level, 3);
+END_TEST
+
+START_TEST(emit_generated_user)
+    struct User copy;
+    char buf[1024];
+    size_t buf_size;
+
+    rc = user_parse_record(&user, &arena,
+                           "{user Fred {sid 7} {note a b} {age 42} {contacts {phone 555}}"
+                           " [languages en] [aliases x y] [scores 0 5] [groups {admin {level 9}} {dev}]}",
+                           &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+
+    rc = user_emit_record(&user, buf, sizeof buf - 1, &buf_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    buf[buf_size] = '\0';
+    ck_assert_str_eq(buf, "{user Fred {sid 7} {note a b} {age 42} {contacts {phone 555}}"
+                          " [languages en] [aliases x y] [scores 0 5]"
+                          " [groups { admin {level 9}} { dev {level 0}}]}");
+
+    // Emit -> parse gives back the same object.
+    rc = user_parse_record(&copy, &arena, buf, &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, buf_size);
+    ck_assert(!memcmp(copy.name, user.name, sizeof user.name));
+    ck_assert_str_eq(copy.note.str, user.note.str);
+    ck_assert_uint_eq(copy.age, user.age);
+    ck_assert(!memcmp(&copy.contacts, &user.contacts, sizeof user.contacts));
+    ck_assert_str_eq(copy.aliases[1].str, "y");
+    ck_assert(!memcmp(copy.scores, user.scores, sizeof user.scores));
+    ck_assert(!memcmp(copy.groups, user.groups, sizeof user.groups));
+
+    // Example: the buffer is too small
+    rc = user_emit_record(&user, buf, 16, &buf_size);
+    ck_assert_int_eq(rc.code, gsl_LIMIT);
+
+    // Example: values the parser couldn't read back
+    ck_assert_int_eq(user_set_sid(&user, "{x}", 3).code, gsl_OK);
+    rc = user_emit_record(&user, buf, sizeof buf, &buf_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    user_set_sid(&user, "7", 1);
+    ck_assert_int_eq(user_add_languages(&user, "a b", 3).code, gsl_OK);
+    rc = user_emit_record(&user, buf, sizeof buf, &buf_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+END_TEST
+
+// --------------------------------------------------------------------------------
+// main
+
+int main() {
+    Suite* s = suite_create("suite");
+
+    TCase* tc_parse = tcase_create("parse cases");
+    tcase_add_checked_fixture(tc_parse, setup, teardown);
+    tcase_add_test(tc_parse, parse_generated_user);
+    tcase_add_test(tc_parse, parse_generated_user_empty);
+    tcase_add_test(tc_parse, parse_generated_user_failed);
+    tcase_add_test(tc_parse, parse_generated_user_generic);
+    tcase_add_test(tc_parse, parse_xobject_user);
+    suite_add_tcase(s, tc_parse);
+
+    TCase* tc_emit = tcase_create("emit cases");
+    tcase_add_checked_fixture(tc_emit, setup, teardown);
+    tcase_add_test(tc_emit, set_generated_user);
+    tcase_add_test(tc_emit, emit_generated_user);
+    suite_add_tcase(s, tc_emit);
+
+    SRunner* sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    int num_failures = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return num_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
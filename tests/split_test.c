@@ -0,0 +1,836 @@
+#include <gsl-parser.h>
+
+#include <check.h>
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_BATCH_RECORDS 256
+#define NUM_BATCH_WORKERS 4
+#define NUM_QUEUE_ITEMS 100000
+#define NUM_QUEUE_THREADS 3
+#define NUM_GRAPH_NODES 60000
+#define GRAPH_BLOCK_SIZE 300000
+
+// --------------------------------------------------------------------------------
+// Common routines
+
+#define ASSERT_RECORD_EQ(record, exp)                                                             \
+    do {                                                                                          \
+        const struct gslRecord *__record = &(record);                                             \
+        const char *__exp = (exp);                                                                \
+        ck_assert_msg(__record->rec_size == strlen(__exp) && 0 == strncmp(__record->rec, __exp, __record->rec_size), \
+            "Assertion '%s' failed: record == \"%.*s\" but expected \"%s\"",                      \
+            #record" == "#exp, (int)__record->rec_size, __record->rec, __exp);                    \
+    } while (0)
+
+struct BatchUser { char name[16]; size_t name_size; };
+
+static gsl_err_t parse_batch_user(void *obj, size_t rec_idx, const char *rec, size_t *total_size) {
+    struct BatchUser *users = (struct BatchUser *)obj;
+    ck_assert(users);
+    ck_assert(rec); ck_assert(total_size);
+
+    struct gslTaskSpec specs[] = {
+        { .name = "user", .name_size = strlen("user"),
+          .buf = users[rec_idx].name, .buf_size = &users[rec_idx].name_size, .max_buf_size = sizeof users[rec_idx].name }
+    };
+    return gsl_parse_task(rec, total_size, specs, sizeof specs / sizeof specs[0]);
+}
+
+// --------------------------------------------------------------------------------
+// Common variables
+gsl_err_t rc;
+const char *rec;
+size_t total_size;
+struct gslRecord records[8];
+size_t num_records;
+
+// --------------------------------------------------------------------------------
+// Splitter
+
+START_TEST(split_empty)
+    rec = "";
+    rc = gsl_split_records(rec, strlen(rec), records, sizeof records / sizeof records[0], &num_records, &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec));
+    ck_assert_uint_eq(num_records, 0);
+
+    rec = " \n\t ";
+    rc = gsl_split_records(rec, strlen(rec), records, sizeof records / sizeof records[0], &num_records, &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec));
+    ck_assert_uint_eq(num_records, 0);
+END_TEST
+
+START_TEST(split_records)
+    rec = "{user}{user John} {user {name John} [groups a b]}\n";
+    rc = gsl_split_records(rec, strlen(rec),
+                           records, sizeof records / sizeof records[0], &num_records, &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec));
+    ck_assert_uint_eq(num_records, 3);
+    ASSERT_RECORD_EQ(records[0], "{user}");
+    ASSERT_RECORD_EQ(records[1], "{user John}");
+    ASSERT_RECORD_EQ(records[2], "{user {name John} [groups a b]}");
+END_TEST
+
+START_TEST(split_records_incomplete)
+    rec = "{user John} {user {name Jo";
+    rc = gsl_split_records(rec, strlen(rec),
+                           records, sizeof records / sizeof records[0], &num_records, &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strchr(rec + 1, '{') - rec);
+    ck_assert_uint_eq(num_records, 1);
+    ASSERT_RECORD_EQ(records[0], "{user John}");
+
+    rec = "{user {-name}";
+    rc = gsl_split_records(rec, strlen(rec),
+                           records, sizeof records / sizeof records[0], &num_records, &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, 0);
+    ck_assert_uint_eq(num_records, 0);
+
+    rec = "{user {";
+    rc = gsl_split_records(rec, strlen(rec),
+                           records, sizeof records / sizeof records[0], &num_records, &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, 0);
+    ck_assert_uint_eq(num_records, 0);
+END_TEST
+
+START_TEST(split_records_comment)
+    rec = "{user {-name }}}-}}{user {!-name {-}}";
+    rc = gsl_split_records(rec, strlen(rec),
+                           records, sizeof records / sizeof records[0], &num_records, &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec));
+    ck_assert_uint_eq(num_records, 2);
+    ASSERT_RECORD_EQ(records[0], "{user {-name }}}-}}");
+    ASSERT_RECORD_EQ(records[1], "{user {!-name {-}}");
+
+    rec = "{user {---name -} --} ---}}{user [-!groups ]-]}";
+    rc = gsl_split_records(rec, strlen(rec),
+                           records, sizeof records / sizeof records[0], &num_records, &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec));
+    ck_assert_uint_eq(num_records, 2);
+    ASSERT_RECORD_EQ(records[0], "{user {---name -} --} ---}}");
+    ASSERT_RECORD_EQ(records[1], "{user [-!groups ]-]}");
+
+    // Example: a comment out of any field is a record by itself
+    rec = "{-x-} {a} {b}";
+    rc = gsl_split_records(rec, strlen(rec),
+                           records, sizeof records / sizeof records[0], &num_records, &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec));
+    ck_assert_uint_eq(num_records, 3);
+    ASSERT_RECORD_EQ(records[0], "{-x-}");
+    ASSERT_RECORD_EQ(records[1], "{a}");
+    ASSERT_RECORD_EQ(records[2], "{b}");
+
+    // Example: the closing brace after it is garbage, as for gsl_validate()
+    rec = "{-x-}} {a} {b} {c}";
+    rc = gsl_split_records(rec, strlen(rec),
+                           records, sizeof records / sizeof records[0], &num_records, &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen("{-x-}"));
+    ck_assert_uint_eq(num_records, 1);
+    ASSERT_RECORD_EQ(records[0], "{-x-}");
+    rc = gsl_validate(rec, strlen(rec), &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen("{-x-}"));
+END_TEST
+
+START_TEST(split_records_cdata)
+    rec = "{user {name {\"J}hn\"}}}{user {name {\"\"\" J\"}\"\"}{ \"\"\"}}}";
+    rc = gsl_split_records(rec, strlen(rec),
+                           records, sizeof records / sizeof records[0], &num_records, &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec));
+    ck_assert_uint_eq(num_records, 2);
+    ASSERT_RECORD_EQ(records[0], "{user {name {\"J}hn\"}}}");
+    ASSERT_RECORD_EQ(records[1], "{user {name {\"\"\" J\"}\"\"}{ \"\"\"}}}");
+END_TEST
+
+START_TEST(split_records_garbage)
+    rec = "{user John} jsmith {user}";
+    rc = gsl_split_records(rec, strlen(rec),
+                           records, sizeof records / sizeof records[0], &num_records, &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strchr(rec, 'j') - rec);
+    ck_assert_uint_eq(num_records, 1);
+    ASSERT_RECORD_EQ(records[0], "{user John}");
+
+    rec = "{user John}}";
+    rc = gsl_split_records(rec, strlen(rec),
+                           records, sizeof records / sizeof records[0], &num_records, &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen(rec) - 1);
+    ck_assert_uint_eq(num_records, 1);
+END_TEST
+
+START_TEST(split_records_limit)
+    rec = "{user a} {user b} {user c}";
+    rc = gsl_split_records(rec, strlen(rec),
+                           records, 2, &num_records, &total_size);
+    ck_assert_int_eq(rc.code, gsl_LIMIT);
+    ck_assert_uint_eq(total_size, strrchr(rec, '{') - rec);
+    ck_assert_uint_eq(num_records, 2);
+    ASSERT_RECORD_EQ(records[0], "{user a}");
+    ASSERT_RECORD_EQ(records[1], "{user b}");
+END_TEST
+
+// --------------------------------------------------------------------------------
+// Validation
+
+START_TEST(validate_records)
+    static char buf[1024];
+    size_t size;
+
+    rec = "";
+    rc = gsl_validate(rec, strlen(rec), &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, 0);
+
+    rec = " {user {name John} [!groups audio {sudo}] {!bio {\"\" a}]\"\"}}}\n"
+          "{-- {not closed --} {user [langs {-- ] --} en] {nick Jo!hn}} ";
+    rc = gsl_validate(rec, strlen(rec), &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(rec));
+
+    // Example: comments and cdata across the blocks of 64 bytes
+    size = snprintf(buf, sizeof buf, "{user {name %80s} {-- %100s } --} {bio {\"%70s}\"}} [tags%90s]}", "John",
+                    "{", "{", "a");
+    rc = gsl_validate(buf, size, &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, size);
+END_TEST
+
+START_TEST(validate_records_failed)
+    static char deep[2 * (GSL_READER_MAX_DEPTH + 1)];
+
+    rec = "{user {name John]}";
+    rc = gsl_validate(rec, strlen(rec), &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strchr(rec, ']') - rec);
+
+    rec = "{user John}}";
+    rc = gsl_validate(rec, strlen(rec), &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen(rec) - 1);
+
+    rec = "{user John} jsmith {user}";
+    rc = gsl_validate(rec, strlen(rec), &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strchr(rec, 'j') - rec);
+
+    rec = "{user John} x";
+    rc = gsl_validate(rec, strlen(rec), &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen(rec) - 1);
+
+    rec = "{user {name John}";
+    rc = gsl_validate(rec, strlen(rec), &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen(rec));
+
+    // Example: '!' out of place
+    rec = "{user {! name John}}";
+    rc = gsl_validate(rec, strlen(rec), &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen("{user "));
+
+    rec = "{user {!}}";
+    rc = gsl_validate(rec, strlen(rec), &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+
+    // Example: the closing sequences are one dash or quote short
+    rec = "{user {-- name John -}}";
+    rc = gsl_validate(rec, strlen(rec), &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen("{user "));
+
+    rec = "{user {bio {\"\"John\"}}}";
+    rc = gsl_validate(rec, strlen(rec), &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen("{user {bio "));
+
+    // Example: the parser stops at '\0'
+    rc = gsl_validate("{user Jo\0hn}", strlen("{user Jo") + strlen("hn}") + 1, &total_size);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    ck_assert_uint_eq(total_size, strlen("{user Jo"));
+
+    for (size_t i = 0; i <= GSL_READER_MAX_DEPTH; i++)
+        memcpy(deep + i, "{", 1), memcpy(deep + GSL_READER_MAX_DEPTH + 1 + i, "}", 1);
+    rc = gsl_validate(deep, sizeof deep, &total_size);
+    ck_assert_int_eq(rc.code, gsl_LIMIT);
+    ck_assert_uint_eq(total_size, GSL_READER_MAX_DEPTH);
+
+    rc = gsl_validate(deep + 1, sizeof deep - 2, &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+END_TEST
+
+// --------------------------------------------------------------------------------
+// Batch parsing
+
+START_TEST(parse_batch)
+    static char buf[NUM_BATCH_RECORDS * 32];
+    static struct gslRecord batch[NUM_BATCH_RECORDS];
+    static struct BatchUser users[NUM_BATCH_RECORDS];
+    static gsl_err_t errs[NUM_BATCH_RECORDS];
+    size_t buf_size = 0;
+
+    for (size_t i = 0; i < NUM_BATCH_RECORDS; i++)
+        buf_size += sprintf(buf + buf_size, "{user u%zu}\n", i);
+
+    rc = gsl_split_records(buf, buf_size, batch, NUM_BATCH_RECORDS, &num_records, &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, buf_size);
+    ck_assert_uint_eq(num_records, NUM_BATCH_RECORDS);
+
+    struct gslBatchWorker workers[NUM_BATCH_WORKERS];
+    for (size_t i = 0; i < NUM_BATCH_WORKERS; i++)
+        workers[i] = (struct gslBatchWorker){ .obj = users, .parse = parse_batch_user };
+
+    rc = gsl_parse_batch(batch, num_records, workers, NUM_BATCH_WORKERS, errs);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    for (size_t i = 0; i < NUM_BATCH_RECORDS; i++) {
+        char exp[16];
+        sprintf(exp, "u%zu", i);
+        ck_assert_int_eq(errs[i].code, gsl_OK);
+        ck_assert_msg(users[i].name_size == strlen(exp) && !memcmp(users[i].name, exp, users[i].name_size),
+                      "record #%zu: got \"%.*s\"", i, (int)users[i].name_size, users[i].name);
+    }
+
+    // Every record is counted by exactly one worker.
+    struct gslStats stats = { 0 };
+    for (size_t i = 0; i < NUM_BATCH_WORKERS; i++)
+        gsl_stats_add(&stats, &workers[i].stats);
+    ck_assert_uint_eq(stats.fields[GSL_GET_STATE], gsl_stats_enabled() ? NUM_BATCH_RECORDS : 0);
+    ck_assert_uint_eq(stats.bytes_scanned, gsl_stats_enabled() ? buf_size - NUM_BATCH_RECORDS : 0);  // but newlines
+END_TEST
+
+START_TEST(parse_batch_failed)
+    static struct BatchUser users[4];
+    gsl_err_t errs[4];
+    struct gslRecord batch[4] = {
+        { "{user a}", strlen("{user a}") },
+        { "{name b}", strlen("{name b}") },
+        { "{user c}", strlen("{user c}") },
+        { "{user 0123456789abcdefg}", strlen("{user 0123456789abcdefg}") }
+    };
+    struct gslBatchWorker workers[2] = {
+        { .obj = users, .parse = parse_batch_user },
+        { .obj = users, .parse = parse_batch_user }
+    };
+
+    rc = gsl_parse_batch(batch, 4, workers, 2, errs);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    ck_assert_int_eq(errs[0].code, gsl_OK);
+    ck_assert_int_eq(errs[1].code, gsl_NO_MATCH);
+    ck_assert_int_eq(errs[2].code, gsl_OK);
+    ck_assert_int_eq(errs[3].code, gsl_LIMIT);
+
+    memset(users, 0, sizeof users);
+    rc = gsl_parse_batch(batch + 2, 2, workers, 1, NULL);
+    ck_assert_int_eq(rc.code, gsl_LIMIT);
+END_TEST
+
+// --------------------------------------------------------------------------------
+// Pool
+
+struct Graph {
+    char id[16]; size_t id_size;
+    char name[16]; size_t name_size;
+    atomic_size_t num_nodes;
+    atomic_size_t weight;
+    atomic_size_t bio_size;
+    size_t num_defaults;
+};
+
+static gsl_err_t run_graph_weight(void *obj, const char *val, size_t val_size) {
+    struct Graph *graph = (struct Graph *)obj;
+    atomic_fetch_add(&graph->weight, strtoul(val, NULL, 10));
+    ck_assert_uint_gt(val_size, 0);
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t parse_graph_node(void *obj, const char *rec, size_t *total_size) {
+    struct Graph *graph = (struct Graph *)obj;
+    struct gslTaskSpec specs[] = {
+        { .name = "w", .name_size = strlen("w"), .run = run_graph_weight, .obj = graph }
+    };
+    atomic_fetch_add(&graph->num_nodes, 1);
+    return gsl_parse_task(rec, total_size, specs, sizeof specs / sizeof specs[0]);
+}
+
+static gsl_err_t run_graph_bio(void *obj, const char *val, size_t val_size) {
+    struct Graph *graph = (struct Graph *)obj;
+    ck_assert(val);
+    atomic_fetch_add(&graph->bio_size, val_size);
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t run_graph_default(void *obj, const char *val, size_t val_size) {
+    struct Graph *graph = (struct Graph *)obj;
+    ck_assert(!val); ck_assert_uint_eq(val_size, 0);
+    graph->num_defaults++;
+    return make_gsl_err(gsl_OK);
+}
+
+// Parses |rec| by gsl_parse_task_pool() and by gsl_parse_task(), and checks they agree.
+static gsl_err_t parse_graph(struct gslPool *pool, const char *rec, struct Graph *graph) {
+    struct Graph exp_graph;
+    gsl_err_t exp_rc;
+    size_t exp_total_size;
+
+    for (int pass = 0; pass < 2; pass++) {
+        struct Graph *self = pass ? graph : &exp_graph;
+        struct gslTaskSpec bio_spec = { .name = "bio", .name_size = strlen("bio"), .run = run_graph_bio, .obj = self };
+        struct gslTaskSpec specs[] = {
+            { .is_implied = true, .buf = self->id, .buf_size = &self->id_size, .max_buf_size = sizeof self->id },
+            { .name = "name", .name_size = strlen("name"),
+              .buf = self->name, .buf_size = &self->name_size, .max_buf_size = sizeof self->name },
+            { .name = "node", .name_size = strlen("node"), .parse = parse_graph_node, .obj = self },
+            { .name = "bio", .name_size = strlen("bio"), .parse = gsl_parse_cdata, .obj = &bio_spec },
+            { .is_default = true, .run = run_graph_default, .obj = self }
+        };
+
+        memset(self, 0, sizeof *self);
+        if (pass) {
+            rc = gsl_parse_task_pool(pool, rec, &total_size, specs, sizeof specs / sizeof specs[0]);
+        } else {
+            exp_rc = gsl_parse_task(rec, &exp_total_size, specs, sizeof specs / sizeof specs[0]);
+        }
+    }
+
+    ck_assert_int_eq(rc.code, exp_rc.code);
+    ck_assert_uint_eq(total_size, exp_total_size);
+    if (!rc.code) {
+        ck_assert_uint_eq(graph->id_size, exp_graph.id_size);
+        ck_assert(!memcmp(graph->id, exp_graph.id, graph->id_size));
+        ck_assert_uint_eq(graph->name_size, exp_graph.name_size);
+        ck_assert(!memcmp(graph->name, exp_graph.name, graph->name_size));
+        ck_assert_uint_eq(graph->num_nodes, exp_graph.num_nodes);
+        ck_assert_uint_eq(graph->weight, exp_graph.weight);
+        ck_assert_uint_eq(graph->bio_size, exp_graph.bio_size);
+        ck_assert_uint_eq(graph->num_defaults, exp_graph.num_defaults);
+    }
+    return rc;
+}
+
+// Example: "g1 {name Big} {node {w 0}} ... {-x}{y] ...-} ... {bio {\"J}h{n ...\"}} ... }"
+// with the comment and the cdata of GRAPH_BLOCK_SIZE bytes across the chunks of the scan.
+static char *gen_graph(const char *head, const char *middle, const char *tail) {
+    char *buf = malloc(NUM_GRAPH_NODES * 32 + 2 * GRAPH_BLOCK_SIZE + 1024);
+    size_t buf_size = 0;
+
+    ck_assert(buf);
+    buf_size += sprintf(buf + buf_size, "%s", head);
+    for (size_t i = 0; i < NUM_GRAPH_NODES; i++) {
+        if (i == NUM_GRAPH_NODES / 4) {
+            buf_size += sprintf(buf + buf_size, "{-");
+            for (size_t j = 0; j < GRAPH_BLOCK_SIZE / 5; j++)
+                buf_size += sprintf(buf + buf_size, "x}{y]");
+            buf_size += sprintf(buf + buf_size, "-} ");
+        }
+        if (i == NUM_GRAPH_NODES / 2) {
+            buf_size += sprintf(buf + buf_size, "%s {bio {\"", middle);
+            for (size_t j = 0; j < GRAPH_BLOCK_SIZE / 5; j++)
+                buf_size += sprintf(buf + buf_size, "J}h{n");
+            buf_size += sprintf(buf + buf_size, "\"}} ");
+        }
+        buf_size += sprintf(buf + buf_size, "{node {w %zu}} ", i % 97);
+    }
+    sprintf(buf + buf_size, "%s", tail);
+    ck_assert_uint_ge(strlen(buf), GSL_POOL_MIN_TASK_SIZE);
+    return buf;
+}
+
+START_TEST(parse_batch_pool)
+    static char buf[NUM_BATCH_RECORDS * 32];
+    static struct gslRecord batch[NUM_BATCH_RECORDS];
+    static struct BatchUser users[NUM_BATCH_RECORDS];
+    static gsl_err_t errs[NUM_BATCH_RECORDS];
+    struct gslPoolOptions options = { .num_workers = NUM_BATCH_WORKERS, .ctx_options = { .max_depth = 2 } };
+    struct gslPool *pool;
+    size_t buf_size = 0;
+
+    for (size_t i = 0; i < NUM_BATCH_RECORDS - 1; i++)
+        buf_size += sprintf(buf + buf_size, "{user u%zu}\n", i);
+    buf_size += sprintf(buf + buf_size, "{nick u%d}\n", NUM_BATCH_RECORDS - 1);
+
+    rc = gsl_split_records(buf, buf_size, batch, NUM_BATCH_RECORDS, &num_records, &total_size);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(num_records, NUM_BATCH_RECORDS);
+
+    rc = gsl_pool_create(&options, &pool);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(gsl_pool_num_workers(pool), NUM_BATCH_WORKERS);
+    ck_assert_uint_eq(gsl_pool_worker_idx(), SIZE_MAX);
+
+    struct gslBatchWorker workers[NUM_BATCH_WORKERS];
+    for (size_t i = 0; i < NUM_BATCH_WORKERS; i++)
+        workers[i] = (struct gslBatchWorker){ .obj = users, .parse = parse_batch_user };
+
+    rc = gsl_parse_batch_pool(pool, batch, num_records, workers, errs);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    for (size_t i = 0; i < NUM_BATCH_RECORDS - 1; i++) {
+        char exp[16];
+        sprintf(exp, "u%zu", i);
+        ck_assert_int_eq(errs[i].code, gsl_OK);
+        ck_assert_msg(users[i].name_size == strlen(exp) && !memcmp(users[i].name, exp, users[i].name_size),
+                      "record #%zu: got \"%.*s\"", i, (int)users[i].name_size, users[i].name);
+    }
+    ck_assert_int_eq(errs[NUM_BATCH_RECORDS - 1].code, gsl_NO_MATCH);
+
+    // Every record is counted by exactly one worker, and by its context.
+    struct gslStats stats = { 0 }, ctx_stats = { 0 };
+    size_t num_failed = 0;
+    for (size_t i = 0; i < NUM_BATCH_WORKERS; i++) {
+        struct gslCtx *ctx = gsl_pool_ctx(pool, i);
+        gsl_stats_add(&stats, &workers[i].stats);
+        gsl_stats_add(&ctx_stats, &ctx->stats);
+        num_failed += ctx->error.code == gsl_NO_MATCH;
+    }
+    ck_assert_uint_eq(stats.fields[GSL_GET_STATE], gsl_stats_enabled() ? NUM_BATCH_RECORDS - 1 : 0);
+    ck_assert_uint_eq(stats.spec_misses, gsl_stats_enabled() ? 1 : 0);
+    ck_assert_uint_eq(ctx_stats.fields[GSL_GET_STATE], stats.fields[GSL_GET_STATE]);
+    // Example: unless the worker has parsed another record after it
+    ck_assert_uint_le(num_failed, 1);
+
+    gsl_pool_destroy(pool);
+END_TEST
+
+struct PoolSum {
+    struct gslPoolTask task;
+    struct gslPool *pool;
+    size_t begin;
+    size_t end;
+    size_t sum;
+};
+
+// Sums up [begin, end) by halves, as a callback would split large array items.
+static void run_pool_sum(struct gslPoolTask *task) {
+    struct PoolSum *self = (struct PoolSum *)task;
+    struct gslPoolGroup group = { 0 };
+    struct PoolSum lower, upper;
+
+    ck_assert_uint_lt(gsl_pool_worker_idx(), gsl_pool_num_workers(self->pool));
+    if (self->end - self->begin <= 16) {
+        for (size_t i = self->begin; i < self->end; i++)
+            self->sum += i;
+        return;
+    }
+
+    lower = (struct PoolSum){ .task.run = run_pool_sum, .pool = self->pool,
+                              .begin = self->begin, .end = self->begin + (self->end - self->begin) / 2 };
+    upper = (struct PoolSum){ .task.run = run_pool_sum, .pool = self->pool, .begin = lower.end, .end = self->end };
+    gsl_pool_submit(self->pool, &group, &lower.task);
+    gsl_pool_submit(self->pool, &group, &upper.task);
+    gsl_pool_wait(self->pool, &group);
+    self->sum = lower.sum + upper.sum;
+}
+
+START_TEST(parse_task_pool)
+    struct gslPoolOptions options = { .num_workers = NUM_BATCH_WORKERS };
+    struct gslPool *pool;
+    struct Graph graph;
+    char *buf;
+
+    rc = gsl_pool_create(&options, &pool);
+    ck_assert_int_eq(rc.code, gsl_OK);
+
+    buf = gen_graph("g1 {name Big} ", "", "} {after}");
+    rc = parse_graph(pool, buf, &graph);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(buf) - strlen("} {after}"));
+    ck_assert_uint_eq(graph.id_size, strlen("g1"));
+    ck_assert_uint_eq(graph.name_size, strlen("Big"));
+    ck_assert_uint_eq(graph.num_nodes, NUM_GRAPH_NODES);
+    ck_assert_uint_eq(graph.bio_size, GRAPH_BLOCK_SIZE);
+    ck_assert_uint_eq(graph.num_defaults, 0);
+    free(buf);
+
+    // Example: the record ends at '\0', so there is no default spec check
+    buf = gen_graph("", "{name Big}", "");
+    rc = parse_graph(pool, buf, &graph);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(total_size, strlen(buf));
+    ck_assert_uint_eq(graph.id_size, 0);
+    ck_assert_uint_eq(graph.name_size, strlen("Big"));
+    free(buf);
+
+    // Example: nothing but a comment, the default spec is run once
+    buf = malloc(GSL_POOL_MIN_TASK_SIZE + 16);
+    ck_assert(buf);
+    memset(buf, 'x', GSL_POOL_MIN_TASK_SIZE + 16);
+    memcpy(buf, "{-", 2);
+    strcpy(buf + GSL_POOL_MIN_TASK_SIZE + 16 - 5, "-} }");
+    rc = parse_graph(pool, buf, &graph);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(graph.num_defaults, 1);
+    free(buf);
+
+    // Example: a short record is parsed by gsl_parse_task() right away
+    rc = parse_graph(pool, "g2 {node {w 3}} {name Small}}", &graph);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_uint_eq(graph.weight, 3);
+
+    gsl_pool_destroy(pool);
+END_TEST
+
+START_TEST(parse_task_pool_failed)
+    struct gslPoolOptions options = { .num_workers = NUM_BATCH_WORKERS };
+    struct gslPool *pool;
+    struct Graph graph;
+    char *buf;
+
+    rc = gsl_pool_create(&options, &pool);
+    ck_assert_int_eq(rc.code, gsl_OK);
+
+    // Example: the same buf field in different ranges
+    buf = gen_graph("{name Big} ", "", "{name Bigger}}");
+    rc = parse_graph(pool, buf, &graph);
+    ck_assert_int_eq(rc.code, gsl_EXISTS);
+    ck_assert_uint_eq(total_size, strlen(buf) - strlen("}}"));
+    free(buf);
+
+    // Example: an implied value after the fields is another value of the implied spec
+    buf = gen_graph("g1 ", "g2", "}");
+    rc = parse_graph(pool, buf, &graph);
+    ck_assert_int_eq(rc.code, gsl_EXISTS);
+    free(buf);
+
+    // Example: the first error is taken, the one in a later range is not
+    buf = gen_graph("{name Big} ", "{nick Big}", "{user x}}");
+    rc = parse_graph(pool, buf, &graph);
+    ck_assert_int_eq(rc.code, gsl_NO_MATCH);
+    ck_assert_uint_lt(total_size, strlen(buf) / 2 + GRAPH_BLOCK_SIZE);
+    free(buf);
+
+    buf = gen_graph("", "{name 0123456789abcdefg}", "}");
+    rc = parse_graph(pool, buf, &graph);
+    ck_assert_int_eq(rc.code, gsl_LIMIT);
+    free(buf);
+
+    // Example: the comment is never closed, its braces are counted as fields
+    buf = gen_graph("", "{- never closed", "}");
+    rc = parse_graph(pool, buf, &graph);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    free(buf);
+
+    buf = gen_graph("", "", "{node {w 1}");
+    rc = parse_graph(pool, buf, &graph);
+    ck_assert_int_eq(rc.code, gsl_FORMAT);
+    free(buf);
+
+    gsl_pool_destroy(pool);
+END_TEST
+
+START_TEST(pool_nested_tasks)
+    struct gslPoolOptions options = { .num_workers = 3, .pin = true };
+    struct gslPoolGroup group = { 0 };
+    struct PoolSum sums[4];
+    struct gslPool *pool;
+
+    rc = gsl_pool_create(&options, &pool);
+    ck_assert_int_eq(rc.code, gsl_OK);
+
+    for (size_t i = 0; i < 4; i++) {
+        sums[i] = (struct PoolSum){ .task.run = run_pool_sum, .pool = pool, .begin = 0, .end = 10000 * (i + 1) };
+        gsl_pool_submit(pool, &group, &sums[i].task);
+    }
+    gsl_pool_wait(pool, &group);
+
+    for (size_t i = 0; i < 4; i++)
+        ck_assert_uint_eq(sums[i].sum, sums[i].end * (sums[i].end - 1) / 2);
+
+    gsl_pool_destroy(pool);
+END_TEST
+
+// --------------------------------------------------------------------------------
+// Queues
+
+START_TEST(queue_spsc)
+    struct gslSpscQueue *queue;
+    size_t items[8];
+
+    // Capacity is rounded up to 8.
+    rc = gsl_spsc_create(5, sizeof(size_t), &queue);
+    ck_assert_int_eq(rc.code, gsl_OK);
+
+    for (size_t i = 0; i < 8; i++)
+        ck_assert(gsl_spsc_try_push(queue, &i));
+    ck_assert(!gsl_spsc_try_push(queue, &(size_t){ 8 }));
+
+    ck_assert_uint_eq(gsl_spsc_try_pop(queue, items, 5), 5);
+    ck_assert_uint_eq(items[0], 0);
+    ck_assert_uint_eq(items[4], 4);
+
+    // Example: the items wrap around the end of the ring
+    for (size_t i = 8; i < 13; i++)
+        ck_assert(gsl_spsc_push(queue, &i));
+    ck_assert_uint_eq(gsl_spsc_try_pop(queue, items, 8), 8);
+    for (size_t i = 0; i < 8; i++)
+        ck_assert_uint_eq(items[i], 5 + i);
+
+    ck_assert_uint_eq(gsl_spsc_try_pop(queue, items, 8), 0);
+    gsl_spsc_close(queue);
+    ck_assert_uint_eq(gsl_spsc_pop(queue, items, 8), 0);
+    ck_assert(!gsl_spsc_push(queue, &(size_t){ 0 }));
+
+    gsl_spsc_destroy(queue);
+END_TEST
+
+static void *run_spsc_producer(void *arg) {
+    struct gslSpscQueue *queue = (struct gslSpscQueue *)arg;
+    for (size_t i = 0; i < NUM_QUEUE_ITEMS; i++)
+        ck_assert(gsl_spsc_push(queue, &i));
+    gsl_spsc_close(queue);
+    return NULL;
+}
+
+START_TEST(queue_spsc_threads)
+    struct gslSpscQueue *queue;
+    pthread_t producer;
+    size_t items[16], num_items, next = 0;
+
+    // A small queue makes both sides wait for each other.
+    rc = gsl_spsc_create(16, sizeof(size_t), &queue);
+    ck_assert_int_eq(rc.code, gsl_OK);
+    ck_assert_int_eq(pthread_create(&producer, NULL, run_spsc_producer, queue), 0);
+
+    while ((num_items = gsl_spsc_pop(queue, items, 16))) {
+        for (size_t i = 0; i < num_items; i++)
+            ck_assert_uint_eq(items[i], next++);
+    }
+    ck_assert_uint_eq(next, NUM_QUEUE_ITEMS);
+
+    pthread_join(producer, NULL);
+    gsl_spsc_destroy(queue);
+END_TEST
+
+struct QueueThread {
+    struct gslMpmcQueue *queue;
+    size_t idx;
+    unsigned char *seen;
+    size_t num_popped;
+    pthread_t thread;
+};
+
+static void *run_mpmc_producer(void *arg) {
+    struct QueueThread *self = (struct QueueThread *)arg;
+    for (size_t i = 0; i < NUM_QUEUE_ITEMS; i++) {
+        size_t item = self->idx * NUM_QUEUE_ITEMS + i;
+        ck_assert(gsl_mpmc_push(self->queue, &item));
+    }
+    return NULL;
+}
+
+static void *run_mpmc_consumer(void *arg) {
+    struct QueueThread *self = (struct QueueThread *)arg;
+    size_t items[8], num_items;
+    size_t last[NUM_QUEUE_THREADS] = { 0 };
+
+    while ((num_items = gsl_mpmc_pop(self->queue, items, 1 + self->idx * 3))) {
+        for (size_t i = 0; i < num_items; i++) {
+            size_t producer_idx = items[i] / NUM_QUEUE_ITEMS;
+
+            // Items of a producer come out in order.
+            ck_assert_uint_lt(producer_idx, NUM_QUEUE_THREADS);
+            ck_assert_uint_ge(items[i] + 1, last[producer_idx]);
+            last[producer_idx] = items[i] + 1;
+            self->seen[items[i]]++;
+        }
+        self->num_popped += num_items;
+    }
+    return NULL;
+}
+
+START_TEST(queue_mpmc_threads)
+    static unsigned char seen[NUM_QUEUE_THREADS][NUM_QUEUE_THREADS * NUM_QUEUE_ITEMS];
+    struct QueueThread producers[NUM_QUEUE_THREADS], consumers[NUM_QUEUE_THREADS];
+    struct gslMpmcQueue *queue;
+    size_t num_popped = 0;
+
+    rc = gsl_mpmc_create(64, sizeof(size_t), &queue);
+    ck_assert_int_eq(rc.code, gsl_OK);
+
+    for (size_t i = 0; i < NUM_QUEUE_THREADS; i++) {
+        consumers[i] = (struct QueueThread){ .queue = queue, .idx = i, .seen = seen[i] };
+        ck_assert_int_eq(pthread_create(&consumers[i].thread, NULL, run_mpmc_consumer, &consumers[i]), 0);
+    }
+    for (size_t i = 0; i < NUM_QUEUE_THREADS; i++) {
+        producers[i] = (struct QueueThread){ .queue = queue, .idx = i };
+        ck_assert_int_eq(pthread_create(&producers[i].thread, NULL, run_mpmc_producer, &producers[i]), 0);
+    }
+    for (size_t i = 0; i < NUM_QUEUE_THREADS; i++)
+        pthread_join(producers[i].thread, NULL);
+    gsl_mpmc_close(queue);
+    for (size_t i = 0; i < NUM_QUEUE_THREADS; i++) {
+        pthread_join(consumers[i].thread, NULL);
+        num_popped += consumers[i].num_popped;
+    }
+
+    // Every item is popped exactly once.
+    ck_assert_uint_eq(num_popped, NUM_QUEUE_THREADS * NUM_QUEUE_ITEMS);
+    for (size_t i = 0; i < NUM_QUEUE_THREADS * NUM_QUEUE_ITEMS; i++) {
+        size_t num_seen = 0;
+        for (size_t j = 0; j < NUM_QUEUE_THREADS; j++)
+            num_seen += seen[j][i];
+        ck_assert_uint_eq(num_seen, 1);
+    }
+
+    ck_assert(!gsl_mpmc_push(queue, &(size_t){ 0 }));
+    gsl_mpmc_destroy(queue);
+END_TEST
+
+// --------------------------------------------------------------------------------
+// main
+
+int main() {
+    Suite* s = suite_create("suite");
+
+    TCase* tc_split = tcase_create("split cases");
+    tcase_add_test(tc_split, split_empty);
+    tcase_add_test(tc_split, split_records);
+    tcase_add_test(tc_split, split_records_incomplete);
+    tcase_add_test(tc_split, split_records_comment);
+    tcase_add_test(tc_split, split_records_cdata);
+    tcase_add_test(tc_split, split_records_garbage);
+    tcase_add_test(tc_split, split_records_limit);
+    tcase_add_test(tc_split, validate_records);
+    tcase_add_test(tc_split, validate_records_failed);
+    suite_add_tcase(s, tc_split);
+
+    TCase* tc_batch = tcase_create("batch cases");
+    tcase_add_test(tc_batch, parse_batch);
+    tcase_add_test(tc_batch, parse_batch_failed);
+    suite_add_tcase(s, tc_batch);
+
+    TCase* tc_pool = tcase_create("pool cases");
+    tcase_add_test(tc_pool, parse_batch_pool);
+    tcase_add_test(tc_pool, parse_task_pool);
+    tcase_add_test(tc_pool, parse_task_pool_failed);
+    tcase_add_test(tc_pool, pool_nested_tasks);
+    suite_add_tcase(s, tc_pool);
+
+    TCase* tc_queue = tcase_create("queue cases");
+    tcase_add_test(tc_queue, queue_spsc);
+    tcase_add_test(tc_queue, queue_spsc_threads);
+    tcase_add_test(tc_queue, queue_mpmc_threads);
+    suite_add_tcase(s, tc_queue);
+
+    SRunner* sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    int num_failures = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return num_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,933 @@
+// Generates C structs, static spec tables, typed setters and emitters from a schema.
+//
+// Usage: gsl_schema_gen SCHEMA.gsl OUT_DIR
+//
+// Writes OUT_DIR/SCHEMA.gsl.h and OUT_DIR/SCHEMA.gsl.c.  The schema is GSL itself:
+//
+//   {strings fixed}                      -- or arena: default storage of str fields
+//   {struct Group {tag group}            -- tag defaults to the snake_case struct name
+//       {str gid {max 64} {implied}}     -- the untagged value of the record
+//   }
+//   {struct User
+//       {str name {max 64} {implied}}
+//       {str note {arena} {max 4096}}    -- max is optional for arena strings
+//       {size_t age}
+//       {str langs {max 16} {list 4}}    -- [langs en fr]
+//       {object groups {type Group} {list 8}}  -- [groups {admin} {dev}]
+//   }
+//
+// For every struct the generated code has:
+//   - the struct itself: fixed strings are char arrays with a |_size|, arena strings are
+//     struct gslStr, lists are arrays with a |num_| counter;
+//   - |prefix_spec|, a static gslObjectSpec with a precomputed tag lookup;
+//   - |prefix_parse()| and |prefix_parse_record()|, specialized parsers which don't go
+//     through gsl_parse_task() (pass |prefix_spec| to gsl_parse_object() for that);
+//   - typed setters |prefix_set_field()| and |prefix_add_field()| for lists;
+//   - |prefix_emit()| and |prefix_emit_record()|.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <gsl-parser.h>
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCHEMA_MAX_NAME_SIZE 64
+#define SCHEMA_MAX_STRUCTS 64
+
+typedef enum { FIELD_STR, FIELD_SIZE_T, FIELD_OBJECT } field_kind;
+
+struct Field {
+    field_kind kind;
+    char name[SCHEMA_MAX_NAME_SIZE]; size_t name_size;
+    char type[SCHEMA_MAX_NAME_SIZE]; size_t type_size;
+    size_t max_size;
+    size_t max_items;
+    bool is_list;
+    bool is_implied;
+    bool is_arena;
+    bool is_fixed;
+
+    const struct Struct *object;
+};
+
+struct Struct {
+    char name[SCHEMA_MAX_NAME_SIZE]; size_t name_size;
+    char tag[SCHEMA_MAX_NAME_SIZE]; size_t tag_size;
+    char prefix[SCHEMA_MAX_NAME_SIZE * 2];
+    struct Field fields[GSL_OBJECT_MAX_FIELDS];
+    size_t num_fields;
+};
+
+struct Schema {
+    char strings[16]; size_t strings_size;
+    struct Struct structs[SCHEMA_MAX_STRUCTS];
+    size_t num_structs;
+    bool is_failed;
+};
+
+struct FieldArgs {
+    struct Struct *st;
+    field_kind kind;
+};
+
+static const char *schema_path;
+
+static void fail(struct Schema *schema, const char *fmt, ...) {
+    va_list args;
+
+    fprintf(stderr, "%s: ", schema_path);
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+    schema->is_failed = true;
+}
+
+// --------------------------------------------------------------------------------
+// Schema parsing
+
+static gsl_err_t run_flag(void *obj, const char *val, size_t val_size) {
+    (void)val; (void)val_size;
+    *(bool *)obj = true;
+    return make_gsl_err(gsl_OK);
+}
+
+static gsl_err_t run_list(void *obj, const char *val, size_t val_size) {
+    struct Field *self = (struct Field *)obj;
+    if (!val_size)
+        return make_gsl_err(gsl_FORMAT);
+    self->is_list = true;
+    return gsl_run_set_size_t(&self->max_items, val, val_size);
+}
+
+static gsl_err_t run_max(void *obj, const char *val, size_t val_size) {
+    struct Field *self = (struct Field *)obj;
+    if (!val_size)
+        return make_gsl_err(gsl_FORMAT);
+    return gsl_run_set_size_t(&self->max_size, val, val_size);
+}
+
+static gsl_err_t parse_field(void *obj, const char *rec, size_t *total_size) {
+    struct FieldArgs *args = (struct FieldArgs *)obj;
+    struct Field *self;
+
+    if (args->st->num_fields == GSL_OBJECT_MAX_FIELDS)
+        return *total_size = 0, make_gsl_err(gsl_LIMIT);
+    self = &args->st->fields[args->st->num_fields++];
+    self->kind = args->kind;
+
+    struct gslTaskSpec specs[] = {
+        { .is_implied = true,
+          .buf = self->name, .buf_size = &self->name_size, .max_buf_size = sizeof self->name - 1 },
+        { .name = "type", .name_size = strlen("type"),
+          .buf = self->type, .buf_size = &self->type_size, .max_buf_size = sizeof self->type - 1 },
+        { .name = "max", .name_size = strlen("max"), .run = run_max, .obj = self },
+        { .name = "list", .name_size = strlen("list"), .run = run_list, .obj = self },
+        { .name = "implied", .name_size = strlen("implied"), .run = run_flag, .obj = &self->is_implied },
+        { .name = "arena", .name_size = strlen("arena"), .run = run_flag, .obj = &self->is_arena },
+        { .name = "fixed", .name_size = strlen("fixed"), .run = run_flag, .obj = &self->is_fixed }
+    };
+    return gsl_parse_task(rec, total_size, specs, sizeof specs / sizeof specs[0]);
+}
+
+static gsl_err_t parse_str_field(void *obj, const char *rec, size_t *total_size) {
+    struct FieldArgs args = { (struct Struct *)obj, FIELD_STR };
+    return parse_field(&args, rec, total_size);
+}
+
+static gsl_err_t parse_size_t_field(void *obj, const char *rec, size_t *total_size) {
+    struct FieldArgs args = { (struct Struct *)obj, FIELD_SIZE_T };
+    return parse_field(&args, rec, total_size);
+}
+
+static gsl_err_t parse_object_field(void *obj, const char *rec, size_t *total_size) {
+    struct FieldArgs args = { (struct Struct *)obj, FIELD_OBJECT };
+    return parse_field(&args, rec, total_size);
+}
+
+static gsl_err_t parse_struct(void *obj, const char *rec, size_t *total_size) {
+    struct Schema *schema = (struct Schema *)obj;
+    struct Struct *self;
+
+    if (schema->num_structs == SCHEMA_MAX_STRUCTS)
+        return *total_size = 0, make_gsl_err(gsl_LIMIT);
+    self = &schema->structs[schema->num_structs++];
+
+    struct gslTaskSpec specs[] = {
+        { .is_implied = true,
+          .buf = self->name, .buf_size = &self->name_size, .max_buf_size = sizeof self->name - 1 },
+        { .name = "tag", .name_size = strlen("tag"),
+          .buf = self->tag, .buf_size = &self->tag_size, .max_buf_size = sizeof self->tag - 1 },
+        { .name = "str", .name_size = strlen("str"), .parse = parse_str_field, .obj = self },
+        { .name = "size_t", .name_size = strlen("size_t"), .parse = parse_size_t_field, .obj = self },
+        { .name = "object", .name_size = strlen("object"), .parse = parse_object_field, .obj = self }
+    };
+    return gsl_parse_task(rec, total_size, specs, sizeof specs / sizeof specs[0]);
+}
+
+static bool is_identifier(const char *name) {
+    if (!*name || !(isalpha((unsigned char)*name) || *name == '_'))
+        return false;
+    for (; *name; name++) {
+        if (!isalnum((unsigned char)*name) && *name != '_')
+            return false;
+    }
+    return true;
+}
+
+static bool is_tag(const char *tag) {
+    if (!*tag || *tag == '-' || *tag == '!')
+        return false;
+    for (; *tag; tag++) {
+        if (!isalnum((unsigned char)*tag) && !strchr("_-.:", *tag))
+            return false;
+    }
+    return true;
+}
+
+// Example: "UserContacts" -> "user_contacts"
+static void make_prefix(char *prefix, const char *name) {
+    for (size_t i = 0; name[i]; i++) {
+        if (i && isupper((unsigned char)name[i]) &&
+            (islower((unsigned char)name[i - 1]) || isdigit((unsigned char)name[i - 1])))
+            *prefix++ = '_';
+        *prefix++ = (char)tolower((unsigned char)name[i]);
+    }
+    *prefix = '\0';
+}
+
+static const struct Struct *find_struct(const struct Schema *schema, size_t num_structs, const char *name) {
+    for (size_t i = 0; i < num_structs; i++) {
+        if (!strcmp(schema->structs[i].name, name))
+            return &schema->structs[i];
+    }
+    return NULL;
+}
+
+static void check_schema(struct Schema *schema) {
+    bool is_arena_default = false;
+
+    if (schema->strings_size) {
+        if (!strcmp(schema->strings, "arena"))
+            is_arena_default = true;
+        else if (strcmp(schema->strings, "fixed"))
+            fail(schema, "strings: expected fixed or arena, got \"%s\"", schema->strings);
+    }
+
+    for (size_t i = 0; i < schema->num_structs; i++) {
+        struct Struct *st = &schema->structs[i];
+        size_t num_implied = 0;
+
+        if (!is_identifier(st->name)) {
+            fail(schema, "struct \"%s\": bad name", st->name);
+            continue;
+        }
+        if (find_struct(schema, i, st->name))
+            fail(schema, "struct %s: defined twice", st->name);
+
+        make_prefix(st->prefix, st->name);
+        if (!st->tag_size) {
+            strcpy(st->tag, st->prefix);
+            st->tag_size = strlen(st->tag);
+        }
+        if (!is_tag(st->tag))
+            fail(schema, "struct %s: bad tag \"%s\"", st->name, st->tag);
+
+        for (size_t j = 0; j < st->num_fields; j++) {
+            struct Field *field = &st->fields[j];
+
+            if (!is_identifier(field->name)) {
+                fail(schema, "struct %s: bad field name \"%s\"", st->name, field->name);
+                continue;
+            }
+            for (size_t k = 0; k < j; k++) {
+                if (!strcmp(st->fields[k].name, field->name))
+                    fail(schema, "%s.%s: defined twice", st->name, field->name);
+            }
+            if (field->is_list && !field->max_items)
+                fail(schema, "%s.%s: list of 0 items", st->name, field->name);
+            if (field->is_implied) {
+                num_implied++;
+                if (field->kind != FIELD_STR || field->is_list)
+                    fail(schema, "%s.%s: only a single str can be implied", st->name, field->name);
+            }
+            if (field->kind != FIELD_STR && (field->max_size || field->is_arena || field->is_fixed))
+                fail(schema, "%s.%s: max, arena and fixed apply to str only", st->name, field->name);
+            if (field->kind != FIELD_OBJECT && field->type_size)
+                fail(schema, "%s.%s: type applies to object only", st->name, field->name);
+
+            switch (field->kind) {
+            case FIELD_STR:
+                if (field->is_arena && field->is_fixed)
+                    fail(schema, "%s.%s: both arena and fixed", st->name, field->name);
+                if (!field->is_fixed && is_arena_default)
+                    field->is_arena = true;
+                if (!field->is_arena && !field->max_size)
+                    fail(schema, "%s.%s: fixed str requires max", st->name, field->name);
+                break;
+            case FIELD_SIZE_T:
+                break;
+            case FIELD_OBJECT:
+                // Structs are emitted in order, so only earlier ones can be nested.
+                field->object = find_struct(schema, i, field->type);
+                if (!field->object)
+                    fail(schema, "%s.%s: type \"%s\" is not defined above", st->name, field->name, field->type);
+                break;
+            }
+        }
+        if (num_implied > 1)
+            fail(schema, "struct %s: more than one implied field", st->name);
+    }
+}
+
+// --------------------------------------------------------------------------------
+// Code generation
+
+static void gen_struct(FILE *out, const struct Struct *st) {
+    fprintf(out, "struct %s {\n", st->name);
+    for (size_t i = 0; i < st->num_fields; i++) {
+        const struct Field *f = &st->fields[i];
+
+        fprintf(out, "    ");
+        switch (f->kind) {
+        case FIELD_STR:
+            if (f->is_arena && f->is_list)
+                fprintf(out, "struct gslStr %s[%zu];", f->name, f->max_items);
+            else if (f->is_arena)
+                fprintf(out, "struct gslStr %s;", f->name);
+            else if (f->is_list)
+                fprintf(out, "char %s[%zu][%zu]; size_t %s_sizes[%zu];", f->name, f->max_items, f->max_size, f->name, f->max_items);
+            else
+                fprintf(out, "char %s[%zu]; size_t %s_size;", f->name, f->max_size, f->name);
+            break;
+        case FIELD_SIZE_T:
+            if (f->is_list)
+                fprintf(out, "size_t %s[%zu];", f->name, f->max_items);
+            else
+                fprintf(out, "size_t %s;", f->name);
+            break;
+        case FIELD_OBJECT:
+            if (f->is_list)
+                fprintf(out, "struct %s %s[%zu];", f->object->name, f->name, f->max_items);
+            else
+                fprintf(out, "struct %s %s;", f->object->name, f->name);
+            break;
+        }
+        if (f->is_list)
+            fprintf(out, " size_t num_%s;", f->name);
+        fprintf(out, "\n");
+    }
+    fprintf(out, "};\n\n");
+}
+
+// Definitions have the return type on its own line, declarations don't.
+static void gen_setter_decl(FILE *out, const struct Struct *st, const struct Field *f, const char *sep) {
+    const char *verb = f->is_list ? "add" : "set";
+
+    switch (f->kind) {
+    case FIELD_STR:
+        fprintf(out, "gsl_err_t%s%s_%s_%s(struct %s *self, %sconst char *val, size_t val_size)",
+                sep, st->prefix, verb, f->name, st->name, f->is_arena ? "struct gslArena *arena, " : "");
+        break;
+    case FIELD_SIZE_T:
+        fprintf(out, "gsl_err_t%s%s_%s_%s(struct %s *self, size_t val)", sep, st->prefix, verb, f->name, st->name);
+        break;
+    case FIELD_OBJECT:
+        fprintf(out, "struct %s *%s%s_add_%s(struct %s *self)", f->object->name, sep, st->prefix, f->name, st->name);
+        break;
+    }
+}
+
+static void gen_header(FILE *out, const struct Schema *schema, const char *base) {
+    fprintf(out, "// Generated by gsl_schema_gen from %s.gsl.  Do not edit.\n\n", base);
+    fprintf(out, "#pragma once\n\n#include <gsl-parser.h>\n\n#include <stddef.h>\n\n");
+
+    for (size_t i = 0; i < schema->num_structs; i++) {
+        const struct Struct *st = &schema->structs[i];
+
+        fprintf(out, "// --------------------------------------------------------------------------------\n");
+        fprintf(out, "// {%s ...}\n\n", st->tag);
+        gen_struct(out, st);
+
+        fprintf(out, "extern const struct gslObjectSpec %s_spec;\n\n", st->prefix);
+        fprintf(out, "// Specialized gsl_parse_object(&%s_spec, ...).  The record variant parses a single\n"
+                     "// \"{%s ...}\" record and the spaces after it.\n", st->prefix, st->tag);
+        fprintf(out, "extern gsl_err_t %s_parse(struct %s *self, struct gslArena *arena, "
+                     "const char *rec, size_t *total_size);\n", st->prefix, st->name);
+        fprintf(out, "extern gsl_err_t %s_parse_record(struct %s *self, struct gslArena *arena, "
+                     "const char *rec, size_t *total_size);\n\n", st->prefix, st->name);
+
+        fprintf(out, "// Emit the fields only, or the whole \"{%s ...}\" record (not null-terminated).\n", st->tag);
+        fprintf(out, "extern void %s_emit(const struct %s *self, struct gslEmitter *out);\n", st->prefix, st->name);
+        fprintf(out, "extern gsl_err_t %s_emit_record(const struct %s *self, char *buf, size_t max_buf_size, "
+                     "size_t *buf_size);\n\n", st->prefix, st->name);
+
+        for (size_t j = 0; j < st->num_fields; j++) {
+            const struct Field *f = &st->fields[j];
+            if (f->kind == FIELD_OBJECT && !f->is_list)
+                continue;  // Example: &self->contacts
+            fprintf(out, "extern ");
+            gen_setter_decl(out, st, f, " ");
+            fprintf(out, ";\n");
+        }
+        fprintf(out, "\n");
+    }
+}
+
+// By size, then by name: the fields sharing the first byte become neighbours.
+static int cmp_fields_by_name_size(const void *a, const void *b) {
+    const struct Field *x = *(const struct Field *const *)a, *y = *(const struct Field *const *)b;
+    if (x->name_size != y->name_size)
+        return x->name_size < y->name_size ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+static void gen_lookup(FILE *out, const struct Struct *st) {
+    const struct Field *sorted[GSL_OBJECT_MAX_FIELDS];
+    size_t num_sorted = 0;
+
+    // Implied fields have no tag.
+    for (size_t i = 0; i < st->num_fields; i++) {
+        if (!st->fields[i].is_implied)
+            sorted[num_sorted++] = &st->fields[i];
+    }
+    qsort(sorted, num_sorted, sizeof sorted[0], cmp_fields_by_name_size);
+
+    fprintf(out, "static int\n%s_lookup(const char *name, size_t name_size)\n{\n", st->prefix);
+    if (num_sorted)
+        fprintf(out, "    switch (name_size) {\n");
+    for (size_t i = 0; i < num_sorted; i++) {
+        const struct Field *f = sorted[i];
+        if (!i || sorted[i - 1]->name_size != f->name_size)
+            fprintf(out, "    case %zu:\n", f->name_size);
+        fprintf(out, "        if (!memcmp(name, \"%s\", %zu)) return %zu;\n", f->name, f->name_size, (size_t)(f - st->fields));
+        if (i + 1 == num_sorted || sorted[i + 1]->name_size != f->name_size)
+            fprintf(out, "        break;\n");
+    }
+    if (num_sorted)
+        fprintf(out, "    }\n");
+    else
+        fprintf(out, "    (void)name; (void)name_size;\n");
+    fprintf(out, "    return -1;\n}\n\n");
+}
+
+static const char *field_kind_name(const struct Field *f) {
+    switch (f->kind) {
+    case FIELD_STR:    return f->is_arena ? "GSL_FIELD_ARENA_STR" : "GSL_FIELD_STR";
+    case FIELD_SIZE_T: return "GSL_FIELD_SIZE_T";
+    case FIELD_OBJECT: return "GSL_FIELD_OBJECT";
+    }
+    return NULL;
+}
+
+static void gen_spec(FILE *out, const struct Struct *st) {
+    if (st->num_fields) {
+        fprintf(out, "static const struct gslFieldSpec %s_fields[] = {\n", st->prefix);
+        for (size_t i = 0; i < st->num_fields; i++) {
+            const struct Field *f = &st->fields[i];
+
+            fprintf(out, "    { .name = \"%s\", .name_size = %zu, .kind = %s,", f->name, f->name_size, field_kind_name(f));
+            if (f->is_implied)
+                fprintf(out, " .is_implied = true,");
+            if (f->is_list)
+                fprintf(out, " .is_list = true,");
+            fprintf(out, "\n      .offset = offsetof(struct %s, %s)", st->name, f->name);
+            if (f->kind == FIELD_STR && !f->is_arena)
+                fprintf(out, ", .size_offset = offsetof(struct %s, %s_size%s)", st->name, f->name, f->is_list ? "s" : "");
+            if (f->is_list)
+                fprintf(out, ",\n      .count_offset = offsetof(struct %s, num_%s), .item_size = sizeof ((struct %s *)0)->%s[0], .max_items = %zu",
+                        st->name, f->name, st->name, f->name, f->max_items);
+            if (f->max_size)
+                fprintf(out, ", .max_size = %zu", f->max_size);
+            if (f->kind == FIELD_OBJECT)
+                fprintf(out, ", .object = &%s_spec", f->object->prefix);
+            fprintf(out, " }%s\n", i + 1 < st->num_fields ? "," : "");
+        }
+        fprintf(out, "};\n\n");
+    }
+
+    fprintf(out, "const struct gslObjectSpec %s_spec = {\n", st->prefix);
+    fprintf(out, "    .tag = \"%s\", .tag_size = %zu, .size = sizeof(struct %s),\n", st->tag, st->tag_size, st->name);
+    if (st->num_fields)
+        fprintf(out, "    .fields = %s_fields, .num_fields = sizeof %s_fields / sizeof %s_fields[0],\n",
+                st->prefix, st->prefix, st->prefix);
+    fprintf(out, "    .lookup = %s_lookup\n};\n\n", st->prefix);
+}
+
+static void gen_setter(FILE *out, const struct Struct *st, const struct Field *f) {
+    gen_setter_decl(out, st, f, "\n");
+    fprintf(out, "\n{\n");
+
+    if (f->is_list) {
+        fprintf(out, "    if (self->num_%s == %zu)\n", f->name, f->max_items);
+        fprintf(out, "        return %s;\n", f->kind == FIELD_OBJECT ? "NULL" : "make_gsl_err(gsl_LIMIT)");
+    }
+
+    switch (f->kind) {
+    case FIELD_STR:
+        if (f->max_size)
+            fprintf(out, "    if (val_size > %zu)\n        return make_gsl_err(gsl_LIMIT);\n", f->max_size);
+        if (f->is_arena) {
+            if (f->is_list)
+                fprintf(out, "    gsl_err_t err = gsl_arena_set_str(arena, &self->%s[self->num_%s], val, val_size);\n"
+                             "    if (!err.code)\n        self->num_%s++;\n    return err;\n", f->name, f->name, f->name);
+            else
+                fprintf(out, "    return gsl_arena_set_str(arena, &self->%s, val, val_size);\n", f->name);
+        } else if (f->is_list) {
+            fprintf(out, "    memcpy(self->%s[self->num_%s], val, val_size);\n", f->name, f->name);
+            fprintf(out, "    self->%s_sizes[self->num_%s++] = val_size;\n", f->name, f->name);
+            fprintf(out, "    return make_gsl_err(gsl_OK);\n");
+        } else {
+            fprintf(out, "    memcpy(self->%s, val, val_size);\n", f->name);
+            fprintf(out, "    self->%s_size = val_size;\n", f->name);
+            fprintf(out, "    return make_gsl_err(gsl_OK);\n");
+        }
+        break;
+    case FIELD_SIZE_T:
+        if (f->is_list)
+            fprintf(out, "    self->%s[self->num_%s++] = val;\n", f->name, f->name);
+        else
+            fprintf(out, "    self->%s = val;\n", f->name);
+        fprintf(out, "    return make_gsl_err(gsl_OK);\n");
+        break;
+    case FIELD_OBJECT:
+        fprintf(out, "    memset(&self->%s[self->num_%s], 0, sizeof self->%s[0]);\n", f->name, f->name, f->name);
+        fprintf(out, "    return &self->%s[self->num_%s++];\n", f->name, f->name);
+        break;
+    }
+    fprintf(out, "}\n\n");
+}
+
+// Writes a C string literal of " {name" or " [name" and its size.
+static void gen_emit_open(FILE *out, const char *indent, char brace, const struct Field *f) {
+    fprintf(out, "%sgsl_emit_raw(out, \" %c%s\", %zu);\n", indent, brace, f->name, f->name_size + 2);
+}
+
+static void gen_emit_value(FILE *out, const char *indent, const struct Field *f, const char *item) {
+    switch (f->kind) {
+    case FIELD_STR:
+        if (f->is_arena)
+            fprintf(out, "%sgsl_emit_%s(out, self->%s%s.str, self->%s%s.size);\n",
+                    indent, f->is_list ? "item" : "value", f->name, item, f->name, item);
+        else if (f->is_list)
+            fprintf(out, "%sgsl_emit_item(out, self->%s%s, self->%s_sizes%s);\n", indent, f->name, item, f->name, item);
+        else
+            fprintf(out, "%sgsl_emit_value(out, self->%s, self->%s_size);\n", indent, f->name, f->name);
+        break;
+    case FIELD_SIZE_T:
+        fprintf(out, "%sgsl_emit_size_t(out, self->%s%s);\n", indent, f->name, item);
+        break;
+    case FIELD_OBJECT:
+        if (f->is_list)
+            fprintf(out, "%sgsl_emit_raw(out, \" {\", 2);\n", indent);
+        fprintf(out, "%s%s_emit(&self->%s%s, out);\n", indent, f->object->prefix, f->name, item);
+        if (f->is_list)
+            fprintf(out, "%sgsl_emit_raw(out, \"}\", 1);\n", indent);
+        break;
+    }
+}
+
+static void gen_emitter(FILE *out, const struct Struct *st) {
+    fprintf(out, "void\n%s_emit(const struct %s *self, struct gslEmitter *out)\n{\n", st->prefix, st->name);
+    for (size_t i = 0; i < st->num_fields; i++) {
+        const struct Field *f = &st->fields[i];
+
+        if (f->is_list) {
+            // Example: [groups {admin} {dev}]  -- empty lists are omitted
+            fprintf(out, "    if (self->num_%s) {\n", f->name);
+            gen_emit_open(out, "        ", '[', f);
+            fprintf(out, "        for (size_t i = 0; i < self->num_%s; i++) {\n", f->name);
+            gen_emit_value(out, "            ", f, "[i]");
+            fprintf(out, "        }\n");
+            fprintf(out, "        gsl_emit_raw(out, \"]\", 1);\n    }\n");
+            continue;
+        }
+
+        switch (f->kind) {
+        case FIELD_STR:
+            // Empty strings are omitted, the parser doesn't accept them.
+            fprintf(out, "    if (self->%s%s) {\n", f->name, f->is_arena ? ".size" : "_size");
+            if (!f->is_implied)
+                gen_emit_open(out, "        ", '{', f);
+            gen_emit_value(out, "        ", f, "");
+            if (!f->is_implied)
+                fprintf(out, "        gsl_emit_raw(out, \"}\", 1);\n");
+            fprintf(out, "    }\n");
+            break;
+        case FIELD_SIZE_T:
+        case FIELD_OBJECT:
+            gen_emit_open(out, "    ", '{', f);
+            gen_emit_value(out, "    ", f, "");
+            fprintf(out, "    gsl_emit_raw(out, \"}\", 1);\n");
+            break;
+        }
+    }
+    if (!st->num_fields)
+        fprintf(out, "    (void)self; (void)out;\n");
+    fprintf(out, "}\n\n");
+
+    fprintf(out, "gsl_err_t\n%s_emit_record(const struct %s *self, char *buf, size_t max_buf_size, size_t *buf_size)\n{\n",
+            st->prefix, st->name);
+    fprintf(out, "    struct gslEmitter out = { .buf = buf, .max_size = max_buf_size };\n\n");
+    fprintf(out, "    gsl_emit_raw(&out, \"{%s\", %zu);\n", st->tag, st->tag_size + 1);
+    fprintf(out, "    %s_emit(self, &out);\n", st->prefix);
+    fprintf(out, "    gsl_emit_raw(&out, \"}\", 1);\n\n");
+    fprintf(out, "    *buf_size = out.size;\n    return out.err;\n}\n\n");
+}
+
+// --------------------------------------------------------------------------------
+// Specialized parser
+//
+// <prefix>_parse_fields() follows the rules of gsl_parse_task() for the specs built by
+// gsl_parse_object(), but the tags are matched by a switch on their length and first
+// byte, the values go straight to the typed setters and nested objects are parsed by
+// direct calls to their (static, so inlinable) parse functions.
+
+static void gen_dispatch(FILE *out, const struct Struct *st, bool is_list) {
+    const struct Field *sorted[GSL_OBJECT_MAX_FIELDS];
+    size_t num_sorted = 0;
+
+    for (size_t i = 0; i < st->num_fields; i++) {
+        if (!st->fields[i].is_implied && st->fields[i].is_list == is_list)
+            sorted[num_sorted++] = &st->fields[i];
+    }
+    if (!num_sorted) {
+        fprintf(out, "            // no %s fields\n", is_list ? "list" : "non-list");
+        return;
+    }
+    qsort(sorted, num_sorted, sizeof sorted[0], cmp_fields_by_name_size);
+
+    fprintf(out, "            switch (tag_size) {\n");
+    for (size_t i = 0; i < num_sorted; i++) {
+        const struct Field *f = sorted[i];
+        bool is_first_size = !i || sorted[i - 1]->name_size != f->name_size;
+        bool is_last_size = i + 1 == num_sorted || sorted[i + 1]->name_size != f->name_size;
+        bool is_first_char = true;
+
+        if (is_first_size)
+            fprintf(out, "            case %zu:\n                switch (tag[0]) {\n", f->name_size);
+
+        // Fields of the same size and first byte are chained by "else if".
+        for (size_t k = i; k-- > 0 && sorted[k]->name_size == f->name_size; ) {
+            if (sorted[k]->name[0] == f->name[0])
+                is_first_char = false;
+        }
+        if (is_first_char)
+            fprintf(out, "                case '%c':\n                    ", f->name[0]);
+        else
+            fprintf(out, "                    else ");
+
+        if (f->name_size == 1)
+            fprintf(out, "field = %zu;\n", (size_t)(f - st->fields));
+        else
+            fprintf(out, "if (!memcmp(tag + 1, \"%s\", %zu)) field = %zu;\n",
+                    f->name + 1, f->name_size - 1, (size_t)(f - st->fields));
+
+        bool is_last_char = true;
+        for (size_t k = i + 1; k < num_sorted && sorted[k]->name_size == f->name_size; k++) {
+            if (sorted[k]->name[0] == f->name[0])
+                is_last_char = false;
+        }
+        if (is_last_char)
+            fprintf(out, "                    break;\n");
+
+        if (is_last_size)
+            fprintf(out, "                }\n                break;\n");
+    }
+    fprintf(out, "            }\n");
+}
+
+// Puts |val| of |val_size| into the field, the last statement is "break;" or "return".
+static void gen_parse_value(FILE *out, const struct Struct *st, const struct Field *f, const char *indent) {
+    const char *verb = f->is_list ? "add" : "set";
+
+    switch (f->kind) {
+    case FIELD_STR:
+        if (f->is_arena)
+            fprintf(out, "%sif (!arena) return *total_size = c - rec, make_gsl_err(gsl_FAIL);\n", indent);
+        if (!f->is_list)
+            fprintf(out, "%sif (self->%s%s) return *total_size = c - rec, make_gsl_err(gsl_EXISTS);\n",
+                    indent, f->name, f->is_arena ? ".size" : "_size");
+        fprintf(out, "%serr = %s_%s_%s(self, %sval, val_size);\n",
+                indent, st->prefix, verb, f->name, f->is_arena ? "arena, " : "");
+        break;
+    case FIELD_SIZE_T:
+        fprintf(out, "%serr = gsl_scan_size_t(val, val_size, &num);\n", indent);
+        fprintf(out, "%sif (err.code) return *total_size = c - rec, err;\n", indent);
+        fprintf(out, "%serr = %s_%s_%s(self, num);\n", indent, st->prefix, verb, f->name);
+        break;
+    case FIELD_OBJECT:
+        assert(0 && "objects are not values");
+        break;
+    }
+    fprintf(out, "%sif (err.code) return *total_size = c - rec, err;\n", indent);
+}
+
+static void gen_parse_field(FILE *out, const struct Struct *st, const struct Field *f) {
+    const char *in = "                ";
+
+    fprintf(out, "        case %zu:  // %c%s ...%c\n", (size_t)(f - st->fields),
+            f->is_list ? '[' : '{', f->name, f->is_list ? ']' : '}');
+
+    if (!f->is_list) {
+        if (f->kind == FIELD_OBJECT) {
+            fprintf(out, "            memset(&self->%s, 0, sizeof self->%s);\n", f->name, f->name);
+            fprintf(out, "            err = %s_parse_fields(&self->%s, arena, c, &chunk_size);\n", f->object->prefix, f->name);
+            fprintf(out, "            if (err.code) return *total_size = c + chunk_size - rec, err;\n");
+            fprintf(out, "            c += chunk_size;\n");
+            fprintf(out, "            break;\n");
+            return;
+        }
+        // Example: rec = "{name John Smith}"  -- empty values are rejected like by .buf specs
+        fprintf(out, "            c = gsl_scan_value(c, &val, &val_size);\n");
+        fprintf(out, "            if (*c != '}' || !val_size) return *total_size = c - rec, make_gsl_err(gsl_FORMAT);\n");
+        gen_parse_value(out, st, f, "            ");
+        fprintf(out, "            break;\n");
+        return;
+    }
+
+    fprintf(out, "            for (;;) {\n");
+    fprintf(out, "%sc = gsl_scan_space(c);\n", in);
+    fprintf(out, "%sif (*c == ']') break;\n", in);
+    if (f->kind == FIELD_OBJECT) {
+        // Example: rec = "[groups {admin} {dev}]"
+        fprintf(out, "%sif (*c != '{') return *total_size = c - rec, make_gsl_err(gsl_FORMAT);\n", in);
+        fprintf(out, "%sstruct %s *item = %s_add_%s(self);\n", in, f->object->name, st->prefix, f->name);
+        fprintf(out, "%sif (!item) return *total_size = c - rec, make_gsl_err(gsl_LIMIT);\n", in);
+        fprintf(out, "%serr = %s_parse_fields(item, arena, c + 1, &chunk_size);\n", in, f->object->prefix);
+        fprintf(out, "%sif (err.code) return *total_size = c + 1 + chunk_size - rec, err;\n", in);
+        fprintf(out, "%sc += chunk_size + 2;\n", in);
+    } else {
+        // Example: rec = "[languages en fr]"
+        fprintf(out, "%sval = c;\n", in);
+        fprintf(out, "%sc = gsl_scan_item(c);\n", in);
+        fprintf(out, "%sval_size = c - val;\n", in);
+        fprintf(out, "%sif (!val_size) return *total_size = c - rec, make_gsl_err(gsl_FORMAT);\n", in);
+        gen_parse_value(out, st, f, in);
+    }
+    fprintf(out, "            }\n            break;\n");
+}
+
+static void gen_parser(FILE *out, const struct Struct *st) {
+    const struct Field *implied = NULL;
+    bool has_size_t = false;
+
+    for (size_t i = 0; i < st->num_fields; i++) {
+        if (st->fields[i].is_implied)
+            implied = &st->fields[i];
+        if (st->fields[i].kind == FIELD_SIZE_T)
+            has_size_t = true;
+    }
+
+    fprintf(out, "// Parses the fields up to the closing brace of the object, see gsl_parse_object().\n");
+    fprintf(out, "static gsl_err_t\n%s_parse_fields(struct %s *self, struct gslArena *arena, const char *rec, size_t *total_size)\n{\n",
+            st->prefix, st->name);
+    fprintf(out, "    const char *c = rec, *tag, *val;\n");
+    fprintf(out, "    size_t tag_size, val_size, chunk_size;\n");
+    if (has_size_t)
+        fprintf(out, "    size_t num;\n");
+    fprintf(out, "    int field;\n    gsl_err_t err;\n\n");
+    fprintf(out, "    (void)arena;\n\n");
+
+    fprintf(out, "    for (;;) {\n");
+    fprintf(out, "        c = gsl_scan_space(c);\n");
+    fprintf(out, "        switch (*c) {\n");
+    fprintf(out, "        case '}':\n");
+    fprintf(out, "            *total_size = c - rec;\n");
+    fprintf(out, "            return make_gsl_err(gsl_OK);\n");
+    fprintf(out, "        case ']':\n        case '\\0':\n");
+    fprintf(out, "            *total_size = c - rec;\n");
+    fprintf(out, "            return make_gsl_err(gsl_FORMAT);\n");
+    fprintf(out, "        case '{':\n        case '[':\n");
+    fprintf(out, "            break;\n");
+    fprintf(out, "        default:\n");
+    fprintf(out, "            // Example: rec = \"Fred {age 42}}\"\n");
+    fprintf(out, "            c = gsl_scan_value(c, &val, &val_size);\n");
+    fprintf(out, "            if (*c == ']' || !*c) return *total_size = c - rec, make_gsl_err(gsl_FORMAT);\n");
+    if (implied) {
+        gen_parse_value(out, st, implied, "            ");
+        fprintf(out, "            continue;\n");
+    } else {
+        fprintf(out, "            return *total_size = c - rec, make_gsl_desc_err(gsl_NO_MATCH, val, (int)val_size);\n");
+    }
+    fprintf(out, "        }\n\n");
+
+    fprintf(out, "        if (c[1] == '-') {\n");
+    fprintf(out, "            // Example: rec = \"{-name John-}\"\n");
+    fprintf(out, "            err = gsl_scan_comment(c + 1, *c == '{' ? '}' : ']', &chunk_size);\n");
+    fprintf(out, "            if (err.code) return *total_size = c + 1 + chunk_size - rec, err;\n");
+    fprintf(out, "            c += chunk_size + 2;\n");
+    fprintf(out, "            continue;\n");
+    fprintf(out, "        }\n\n");
+
+    fprintf(out, "        tag = c + 1;\n");
+    fprintf(out, "        c = gsl_scan_tag(tag);\n");
+    fprintf(out, "        tag_size = c - tag;\n");
+    fprintf(out, "        if (!tag_size) return *total_size = c - rec, make_gsl_err(gsl_FORMAT);\n\n");
+
+    fprintf(out, "        field = -1;\n");
+    fprintf(out, "        if (tag[-1] == '{') {\n");
+    gen_dispatch(out, st, false);
+    fprintf(out, "        } else {\n");
+    gen_dispatch(out, st, true);
+    fprintf(out, "        }\n\n");
+
+    fprintf(out, "        switch (field) {\n");
+    for (size_t i = 0; i < st->num_fields; i++) {
+        if (!st->fields[i].is_implied)
+            gen_parse_field(out, st, &st->fields[i]);
+    }
+    fprintf(out, "        default:\n");
+    fprintf(out, "            return *total_size = tag - rec, make_gsl_desc_err(gsl_NO_MATCH, tag, (int)tag_size);\n");
+    fprintf(out, "        }\n");
+    fprintf(out, "        c++;  // the closing brace\n");
+    fprintf(out, "    }\n}\n\n");
+
+    fprintf(out, "gsl_err_t\n%s_parse(struct %s *self, struct gslArena *arena, const char *rec, size_t *total_size)\n{\n",
+            st->prefix, st->name);
+    fprintf(out, "    memset(self, 0, sizeof *self);\n");
+    fprintf(out, "    return %s_parse_fields(self, arena, rec, total_size);\n}\n\n", st->prefix);
+
+    fprintf(out, "gsl_err_t\n%s_parse_record(struct %s *self, struct gslArena *arena, const char *rec, size_t *total_size)\n{\n",
+            st->prefix, st->name);
+    fprintf(out, "    const char *c = gsl_scan_space(rec);\n");
+    fprintf(out, "    size_t chunk_size;\n");
+    fprintf(out, "    gsl_err_t err;\n\n");
+    fprintf(out, "    if (*c != '{' || strncmp(c + 1, \"%s\", %zu) || gsl_scan_tag(c + %zu) != c + %zu)\n",
+            st->tag, st->tag_size, st->tag_size + 1, st->tag_size + 1);
+    fprintf(out, "        return *total_size = c - rec, make_gsl_err(gsl_NO_MATCH);\n");
+    fprintf(out, "    c += %zu;\n\n", st->tag_size + 1);
+    fprintf(out, "    memset(self, 0, sizeof *self);\n");
+    fprintf(out, "    err = %s_parse_fields(self, arena, c, &chunk_size);\n", st->prefix);
+    fprintf(out, "    if (err.code) return *total_size = c + chunk_size - rec, err;\n\n");
+    fprintf(out, "    *total_size = gsl_scan_space(c + chunk_size + 1) - rec;\n");
+    fprintf(out, "    return make_gsl_err(gsl_OK);\n}\n\n");
+}
+
+static void gen_source(FILE *out, const struct Schema *schema, const char *base) {
+    fprintf(out, "// Generated by gsl_schema_gen from %s.gsl.  Do not edit.\n\n", base);
+    fprintf(out, "#include \"%s.gsl.h\"\n\n#include <stdbool.h>\n#include <stddef.h>\n#include <string.h>\n\n", base);
+
+    for (size_t i = 0; i < schema->num_structs; i++) {
+        const struct Struct *st = &schema->structs[i];
+
+        fprintf(out, "// --------------------------------------------------------------------------------\n");
+        fprintf(out, "// {%s ...}\n\n", st->tag);
+
+        gen_lookup(out, st);
+        gen_spec(out, st);
+
+        for (size_t j = 0; j < st->num_fields; j++) {
+            const struct Field *f = &st->fields[j];
+            if (f->kind != FIELD_OBJECT || f->is_list)
+                gen_setter(out, st, f);
+        }
+
+        gen_parser(out, st);
+        gen_emitter(out, st);
+    }
+}
+
+// --------------------------------------------------------------------------------
+// main
+
+static char *read_file(const char *path) {
+    FILE *file = fopen(path, "rb");
+    char *buf = NULL;
+    size_t size = 0, max_size = 0, n;
+
+    if (!file)
+        return NULL;
+    do {
+        if (size == max_size) {
+            char *new_buf = realloc(buf, (max_size = max_size ? max_size * 2 : 4096) + 1);
+            if (!new_buf) {
+                free(buf);
+                fclose(file);
+                return NULL;
+            }
+            buf = new_buf;
+        }
+        n = fread(buf + size, 1, max_size - size, file);
+        size += n;
+    } while (n);
+    fclose(file);
+
+    buf[size] = '\0';
+    return buf;
+}
+
+static int write_file(const char *dir, const char *base, const char *ext,
+                      void (*gen)(FILE *, const struct Schema *, const char *), const struct Schema *schema) {
+    char path[4096];
+    FILE *out;
+
+    snprintf(path, sizeof path, "%s/%s%s", dir, base, ext);
+    out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        return -1;
+    }
+    gen(out, schema, base);
+    if (fclose(out)) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    static struct Schema schema;
+    char base[256];
+    const char *name, *ext;
+    size_t total_size;
+    gsl_err_t err;
+    char *rec;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s SCHEMA.gsl OUT_DIR\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    schema_path = argv[1];
+
+    // Example: "tests/schema/user.gsl" -> "user"
+    name = strrchr(schema_path, '/');
+    name = name ? name + 1 : schema_path;
+    ext = strstr(name, ".gsl");
+    snprintf(base, sizeof base, "%.*s", (int)(ext ? (size_t)(ext - name) : strlen(name)), name);
+
+    rec = read_file(schema_path);
+    if (!rec) {
+        perror(schema_path);
+        return EXIT_FAILURE;
+    }
+
+    struct gslTaskSpec specs[] = {
+        { .name = "strings", .name_size = strlen("strings"),
+          .buf = schema.strings, .buf_size = &schema.strings_size, .max_buf_size = sizeof schema.strings - 1 },
+        { .name = "struct", .name_size = strlen("struct"), .parse = parse_struct, .obj = &schema }
+    };
+    err = gsl_parse_task(rec, &total_size, specs, sizeof specs / sizeof specs[0]);
+    if (err.code) {
+        size_t line = 1;
+        for (size_t i = 0; i < total_size && rec[i]; i++)
+            line += rec[i] == '\n';
+        fail(&schema, "%zu: parse error %d", line, err.code);
+    } else {
+        check_schema(&schema);
+    }
+    free(rec);
+
+    if (schema.is_failed)
+        return EXIT_FAILURE;
+
+    if (write_file(argv[2], base, ".gsl.h", gen_header, &schema) ||
+        write_file(argv[2], base, ".gsl.c", gen_source, &schema))
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}